@@ -0,0 +1,219 @@
+#include "AnnexBReader.h"
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Parser input per call; access units never get near this, it only keeps sizes in int range
+static constexpr size_t kMaxParseChunk = 1u << 30;
+
+static bool HasExtension(const char *filename, const char *ext)
+{
+    size_t len = std::strlen(filename), extLen = std::strlen(ext);
+    if (len < extLen)
+        return false;
+    const char *tail = filename + len - extLen;
+    for (size_t i = 0; i < extLen; i++)
+    {
+        char c = tail[i];
+        if (c >= 'A' && c <= 'Z')
+            c = c - 'A' + 'a';
+        if (c != ext[i])
+            return false;
+    }
+    return true;
+}
+
+static void UnmapView(void *opaque, uint8_t *data)
+{
+#ifdef _WIN32
+    (void)opaque;
+    UnmapViewOfFile(data);
+#else
+    munmap(data, (size_t)(uintptr_t)opaque);
+#endif
+}
+
+// Map the whole file read-only; the returned buffer unmaps it when its last reference goes
+static AVBufferRef *MapFile(const char *filename, size_t &size)
+{
+    void *view = nullptr;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+    size = (size_t)fileSize.QuadPart;
+    HANDLE section = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!section)
+        return nullptr;
+    // The view keeps the section alive
+    view = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(section);
+    if (!view)
+        return nullptr;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+    size = (size_t)st.st_size;
+    view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+        return nullptr;
+    madvise(view, size, MADV_SEQUENTIAL);
+#endif
+
+    AVBufferRef *buf = av_buffer_create((uint8_t *)view, size, UnmapView, (void *)(uintptr_t)size, AV_BUFFER_FLAG_READONLY);
+    if (!buf)
+        UnmapView((void *)(uintptr_t)size, (uint8_t *)view);
+    return buf;
+}
+
+AVCodecID AnnexBReader::ProbeExtension(const char *filename)
+{
+    if (HasExtension(filename, ".h264") || HasExtension(filename, ".264"))
+        return AV_CODEC_ID_H264;
+    if (HasExtension(filename, ".h265") || HasExtension(filename, ".265") || HasExtension(filename, ".hevc"))
+        return AV_CODEC_ID_HEVC;
+    return AV_CODEC_ID_NONE;
+}
+
+bool AnnexBReader::Open(const char *filename, AVCodecID codec)
+{
+    Close();
+    codecId = codec;
+
+    mapping = MapFile(filename, size);
+    if (!mapping)
+    {
+        std::cerr << "Could not map input file: " << filename << std::endl;
+        return false;
+    }
+    data = mapping->data;
+    stats.mappedBytes = size;
+
+    parser = av_parser_init(codec);
+    parserCtx = avcodec_alloc_context3(nullptr);
+    if (!parser || !parserCtx)
+    {
+        std::cerr << "Could not create bitstream parser" << std::endl;
+        Close();
+        return false;
+    }
+    parserCtx->codec_id = codec;
+    parserCtx->codec_type = AVMEDIA_TYPE_VIDEO;
+    return true;
+}
+
+void AnnexBReader::Close()
+{
+    if (parser)
+    {
+        av_parser_close(parser);
+        parser = nullptr;
+    }
+    if (parserCtx)
+        avcodec_free_context(&parserCtx);
+    // Packets still inside the decoder keep the mapping alive
+    if (mapping)
+        av_buffer_unref(&mapping);
+    data = nullptr;
+    size = 0;
+    offset = 0;
+    parseStart = 0;
+    flushed = false;
+    stats = Stats();
+}
+
+bool AnnexBReader::ReadPacket(AVPacket *packet)
+{
+    if (!parser)
+        return false;
+
+    while (!flushed)
+    {
+        size_t remaining = size - offset;
+        const uint8_t *in = remaining ? data + offset : nullptr;
+        int inSize = (int)(remaining < kMaxParseChunk ? remaining : kMaxParseChunk);
+
+        uint8_t *out = nullptr;
+        int outSize = 0;
+        int used = av_parser_parse2(parser, parserCtx, &out, &outSize, in, inSize,
+                                    AV_NOPTS_VALUE, AV_NOPTS_VALUE, (int64_t)offset);
+        if (used < 0)
+            return false;
+        offset += used;
+        // An empty input flushes the access unit the parser still holds
+        if (inSize == 0)
+            flushed = true;
+        if (outSize <= 0)
+            continue;
+
+        // The decoder may read AV_INPUT_BUFFER_PADDING_SIZE bytes past the packet: reference the
+        // mapping only when those bytes are still inside it (they are then the next access unit,
+        // not zeros; see the class comment), otherwise copy into a zero-padded packet
+        const uint8_t *end = data + size;
+        if (out >= data && out < end && out + outSize + AV_INPUT_BUFFER_PADDING_SIZE <= end)
+        {
+            packet->buf = av_buffer_ref(mapping);
+            if (!packet->buf)
+                return false;
+            packet->data = out;
+            packet->size = outSize;
+            packet->pos = out - data;
+            stats.zeroCopyPackets++;
+        }
+        else
+        {
+            if (av_new_packet(packet, outSize) < 0)
+                return false;
+            std::memcpy(packet->data, out, outSize);
+            packet->pos = (int64_t)parseStart + parser->frame_offset;
+            stats.copiedPackets++;
+        }
+
+        packet->pts = AV_NOPTS_VALUE;
+        packet->dts = AV_NOPTS_VALUE;
+        if (parser->key_frame == 1)
+            packet->flags |= AV_PKT_FLAG_KEY;
+        return true;
+    }
+    return false;
+}
+
+bool AnnexBReader::Seek(int64_t pos)
+{
+    if (!parser || pos < 0 || (size_t)pos >= size)
+        return false;
+
+    // A fresh parser: the old one still buffers the partial access unit it was assembling
+    av_parser_close(parser);
+    parser = av_parser_init(codecId);
+    if (!parser)
+        return false;
+    offset = (size_t)pos;
+    parseStart = offset;
+    flushed = false;
+    return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+// Fast input path for raw Annex-B elementary streams (.h264/.264/.h265/.265/.hevc).
+// The file is memory-mapped and split into access units with av_parser_parse2, skipping
+// avformat probing (avformat_find_stream_info decodes frames just to probe). Packets
+// reference the mapping directly through a refcounted AVBufferRef, so no bytes are copied
+// on the way to the decoder; only access units the parser had to reassemble and the last
+// one in the file (where the padding would run past the mapping) are copied.
+//
+// The AV_INPUT_BUFFER_PADDING_SIZE bytes after a referenced packet are the next access
+// unit's start code and data rather than the zeros the packet API asks for. The H.264 and
+// HEVC decoders split a packet into NAL units and decode each within its own size, so the
+// last NAL unit of a packet sees the same kind of trailing bytes every other NAL unit of it
+// already sees (the next start code); they are only ever read as bitstream lookahead, never
+// decoded. H264_Test_AnnexBPadding checks that zero-copy packets and copies with zeroed
+// padding decode to identical frames.
+class AnnexBReader
+{
+public:
+    struct Stats
+    {
+        uint64_t zeroCopyPackets = 0;
+        uint64_t copiedPackets = 0;
+        uint64_t mappedBytes = 0;
+    };
+
+private:
+    AVBufferRef *mapping = nullptr; // owns the mapped view; unmapped once the last packet is freed
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    size_t offset = 0;
+    size_t parseStart = 0; // file offset the parser started at, its frame_offset counts from here
+    AVCodecParserContext *parser = nullptr;
+    AVCodecContext *parserCtx = nullptr; // parser-only context, keeps SPS side effects off the decoder
+    AVCodecID codecId = AV_CODEC_ID_NONE;
+    bool flushed = false;
+    Stats stats;
+
+public:
+    AnnexBReader() = default;
+    AnnexBReader(const AnnexBReader &) = delete;
+    AnnexBReader &operator=(const AnnexBReader &) = delete;
+    ~AnnexBReader() { Close(); }
+
+    // Codec of a raw elementary stream file by extension, AV_CODEC_ID_NONE for anything else
+    static AVCodecID ProbeExtension(const char *filename);
+
+    bool Open(const char *filename, AVCodecID codec);
+    void Close();
+
+    // Next access unit; false at EOF. packet->pos is its byte offset in the file.
+    bool ReadPacket(AVPacket *packet);
+    // Continue reading at a byte offset, which must be the start of an access unit (e.g. a
+    // keyframe's pos); the parser restarts so nothing of the previous position leaks in
+    bool Seek(int64_t pos);
+
+    AVCodecID GetCodecId() const { return codecId; }
+    // Known after the first ReadPacket (from the SPS); 0/0 when the stream has no timing info
+    AVRational GetFrameRate() const { return parserCtx ? parserCtx->framerate : AVRational{0, 1}; }
+    int GetWidth() const { return parser ? parser->width : 0; }
+    int GetHeight() const { return parser ? parser->height : 0; }
+    int GetPixelFormat() const { return parser ? parser->format : -1; }
+    const Stats &GetStats() const { return stats; }
+};
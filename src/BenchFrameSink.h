@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/hwcontext.h>
+#include <libswscale/swscale.h>
+}
+
+#include "BenchStats.h"
+#include "ColorConvert.h"
+#include "RawFrameSink.h"
+
+// Frame sink that times decode latency and converts every frame to RGBA. A frame is charged
+// with all decode calls since the previous frame: packets that produced nothing (decoder
+// priming, B-frame reordering, frame-thread fill) count towards the frame they led to.
+// Bracket each DecodePacket/Drain with BeginDecode/EndDecode; without EndDecode a frame is
+// timed from the last BeginDecode only.
+class BenchFrameSink : public IFrameSink
+{
+private:
+    SwsContext *swsCtx = nullptr;
+    AVFrame *swFrame = nullptr;
+    std::vector<uint8_t> rgbaBuffer;
+    StreamColorConverter colorConverter; // specialization resolved once per stream
+    std::chrono::steady_clock::time_point decodeStart;
+    double pendingUs = 0.0; // decode calls since the previous frame that returned no frame
+
+public:
+    StageStats decodeStats{"decode"};
+    StageStats convertStats{"convert"};
+    StageStats outputStats{"output"};
+    int64_t framesDecoded = 0;
+    bool convert = true;
+    RawFrameSink *output = nullptr;
+
+    BenchFrameSink() : swFrame(av_frame_alloc()) {}
+
+    ~BenchFrameSink() override
+    {
+        if (swsCtx)
+            sws_freeContext(swsCtx);
+        if (swFrame)
+            av_frame_free(&swFrame);
+    }
+
+    void BeginDecode() { decodeStart = std::chrono::steady_clock::now(); }
+
+    // The decode call returned: whatever it spent after its last frame carries over to the next
+    void EndDecode()
+    {
+        pendingUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - decodeStart).count();
+    }
+
+    bool OnFrame(AVFrame *frame) override
+    {
+        auto now = std::chrono::steady_clock::now();
+        decodeStats.Add(pendingUs + std::chrono::duration<double, std::micro>(now - decodeStart).count());
+        pendingUs = 0.0;
+        framesDecoded++;
+
+        if (convert)
+        {
+            ScopedStageTimer t(convertStats);
+            ConvertToRGBA(frame);
+        }
+        if (output)
+        {
+            ScopedStageTimer t(outputStats);
+            if (!output->OnFrame(frame))
+                return false;
+        }
+        // Further frames of the same decode call are timed from here
+        decodeStart = std::chrono::steady_clock::now();
+        return true;
+    }
+
+private:
+    void ConvertToRGBA(AVFrame *frame)
+    {
+        // Hardware backends: download to system memory first
+        const AVFrame *src = frame;
+        if (frame->hw_frames_ctx)
+        {
+            av_frame_unref(swFrame);
+            if (av_hwframe_transfer_data(swFrame, frame, 0) < 0)
+                return;
+            src = swFrame;
+        }
+
+        rgbaBuffer.resize((size_t)src->width * src->height * 4);
+        if (colorConverter.FrameToRGBA(src, rgbaBuffer.data(), src->width * 4))
+            return;
+
+        // Formats without a SIMD kernel fall back to libswscale
+        swsCtx = sws_getCachedContext(swsCtx, src->width, src->height, (AVPixelFormat)src->format,
+                                      src->width, src->height, AV_PIX_FMT_RGBA,
+                                      SWS_POINT, nullptr, nullptr, nullptr);
+        if (!swsCtx)
+            return;
+
+        uint8_t *dst[4] = {rgbaBuffer.data(), nullptr, nullptr, nullptr};
+        int dstStride[4] = {src->width * 4, 0, 0, 0};
+        sws_scale(swsCtx, src->data, src->linesize, 0, src->height, dst, dstStride);
+    }
+};
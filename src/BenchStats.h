@@ -0,0 +1,65 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Collects per-item latency samples for one pipeline stage (demux, decode, convert...)
+class StageStats
+{
+private:
+    const char *name;
+    std::vector<double> samplesUs;
+    double totalUs = 0.0;
+
+public:
+    explicit StageStats(const char *stageName) : name(stageName)
+    {
+        samplesUs.reserve(1 << 16);
+    }
+
+    void Add(double us)
+    {
+        samplesUs.push_back(us);
+        totalUs += us;
+    }
+
+    size_t Count() const { return samplesUs.size(); }
+    double TotalUs() const { return totalUs; }
+    const char *Name() const { return name; }
+
+    // Nearest-rank percentile, p in [0, 100]
+    double Percentile(double p) const
+    {
+        if (samplesUs.empty())
+            return 0.0;
+        std::vector<double> sorted(samplesUs);
+        size_t rank = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+    }
+
+    void Print(FILE *out = stdout) const
+    {
+        double avg = samplesUs.empty() ? 0.0 : totalUs / samplesUs.size();
+        std::fprintf(out, "  %-8s n=%-7zu avg=%9.1f us  p50=%9.1f us  p99=%9.1f us  total=%8.1f ms\n",
+                    name, samplesUs.size(), avg, Percentile(50.0), Percentile(99.0), totalUs / 1000.0);
+    }
+};
+
+// Measures one scope with the steady clock and adds it to a StageStats on destruction
+class ScopedStageTimer
+{
+private:
+    StageStats &stats;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ScopedStageTimer(StageStats &s) : stats(s), start(std::chrono::steady_clock::now()) {}
+    ~ScopedStageTimer()
+    {
+        auto end = std::chrono::steady_clock::now();
+        stats.Add(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+};
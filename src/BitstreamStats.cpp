@@ -0,0 +1,742 @@
+#include "BitstreamStats.h"
+#include "DecoderCore.h"
+#include "SoftwareDecodeBackend.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <iostream>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/video_enc_params.h>
+}
+
+// Slice headers are parsed up to slice_qp_delta; this many bytes always cover it
+static constexpr size_t kSliceHeaderBytes = 1024;
+
+// MSB-first reader of an RBSP with Exp-Golomb codes; reads past the end return zeros and
+// set Overrun
+class BitReader
+{
+private:
+    const uint8_t *data;
+    size_t bits;
+    size_t pos = 0;
+
+public:
+    BitReader(const uint8_t *d, size_t size) : data(d), bits(size * 8) {}
+
+    bool Overrun() const { return pos > bits; }
+
+    uint32_t ReadBit()
+    {
+        uint32_t bit = pos < bits ? (data[pos >> 3] >> (7 - (pos & 7))) & 1 : 0;
+        pos++;
+        return bit;
+    }
+
+    uint32_t ReadBits(int n)
+    {
+        uint32_t value = 0;
+        while (n-- > 0)
+            value = value << 1 | ReadBit();
+        return value;
+    }
+
+    uint32_t ReadUE()
+    {
+        int zeros = 0;
+        while (!ReadBit())
+        {
+            if (++zeros > 31 || Overrun())
+            {
+                pos = bits + 1;
+                return 0;
+            }
+        }
+        return ((1u << zeros) - 1) + ReadBits(zeros);
+    }
+
+    int32_t ReadSE()
+    {
+        uint32_t k = ReadUE();
+        return k & 1 ? (int32_t)((k + 1) / 2) : -(int32_t)(k / 2);
+    }
+};
+
+// First byte of the next 00 00 01 in [p, end), or end
+static const uint8_t *FindStartCode(const uint8_t *p, const uint8_t *end)
+{
+    while (p + 3 <= end)
+    {
+        if (p[2] > 1)
+            p += 3;
+        else if (p[1])
+            p += 2;
+        else if (p[0] || p[2] != 1)
+            p++;
+        else
+            return p;
+    }
+    return end;
+}
+
+static void SkipScalingList(BitReader &br, int size)
+{
+    int last = 8, next = 8;
+    for (int j = 0; j < size; j++)
+    {
+        if (next != 0)
+            next = (last + br.ReadSE() + 256) % 256;
+        last = next == 0 ? last : next;
+    }
+}
+
+static int TypeRank(char type)
+{
+    return type == 'B' ? 2 : (type == 'P' ? 1 : (type == 'I' ? 0 : -1));
+}
+
+void H264HeaderParser::SetExtradata(const uint8_t *data, int size)
+{
+    double qpSum = 0.0;
+    if (size >= 7 && data[0] == 1)
+    {
+        // avcC: NAL length size, then counted lists of 16-bit length prefixed SPS and PPS
+        lengthSize = (data[4] & 3) + 1;
+        const uint8_t *p = data + 5, *end = data + size;
+        for (int list = 0; list < 2 && p < end; list++)
+        {
+            int count = list == 0 ? (*p++ & 0x1F) : *p++;
+            for (int i = 0; i < count && end - p >= 2; i++)
+            {
+                size_t length = (size_t)(p[0] << 8 | p[1]);
+                p += 2;
+                if (length > (size_t)(end - p))
+                    return;
+                ParseNal(p, length, nullptr, qpSum);
+                p += length;
+            }
+        }
+    }
+    else if (size > 0)
+        ParseUnits(data, size, nullptr, qpSum);
+}
+
+bool H264HeaderParser::Parse(const uint8_t *data, int size, FrameStats &stats)
+{
+    double qpSum = 0.0;
+    ParseUnits(data, size, &stats, qpSum);
+    if (stats.slices == 0)
+        return false;
+    stats.qp = qpSum / stats.slices;
+    return true;
+}
+
+void H264HeaderParser::ParseUnits(const uint8_t *data, int size, FrameStats *stats, double &qpSum)
+{
+    const uint8_t *p = data, *end = data + size;
+    bool annexB = size >= 4 && p[0] == 0 && p[1] == 0 && (p[2] == 1 || (p[2] == 0 && p[3] == 1));
+    if (annexB)
+    {
+        const uint8_t *start = FindStartCode(p, end);
+        while (start < end)
+        {
+            const uint8_t *nal = start + 3;
+            start = FindStartCode(nal, end);
+            // Zero bytes before a start code belong to it (or are trailing padding)
+            const uint8_t *nalEnd = start;
+            while (nalEnd > nal && nalEnd[-1] == 0)
+                nalEnd--;
+            if (nalEnd > nal)
+                ParseNal(nal, (size_t)(nalEnd - nal), stats, qpSum);
+        }
+        return;
+    }
+
+    while (end - p >= lengthSize)
+    {
+        uint32_t length = 0;
+        for (int i = 0; i < lengthSize; i++)
+            length = length << 8 | p[i];
+        p += lengthSize;
+        if (length == 0 || length > (uint32_t)(end - p))
+        {
+            errors++;
+            return;
+        }
+        ParseNal(p, length, stats, qpSum);
+        p += length;
+    }
+}
+
+void H264HeaderParser::ParseNal(const uint8_t *nal, size_t size, FrameStats *stats, double &qpSum)
+{
+    int nalType = nal[0] & 0x1F;
+    int nalRefIdc = (nal[0] >> 5) & 3;
+    if (nalType != 1 && nalType != 5 && nalType != 7 && nalType != 8)
+        return;
+    if (nalType <= 5 && !stats)
+        return;
+
+    // Unescape the RBSP (drop emulation prevention bytes); a slice only up to its header
+    size_t limit = nalType <= 5 ? std::min(size, kSliceHeaderBytes) : size;
+    rbsp.clear();
+    int zeros = 0;
+    for (size_t i = 1; i < limit; i++)
+    {
+        if (zeros >= 2 && nal[i] == 3)
+        {
+            zeros = 0;
+            continue;
+        }
+        rbsp.push_back(nal[i]);
+        zeros = nal[i] == 0 ? zeros + 1 : 0;
+    }
+
+    bool ok;
+    if (nalType == 7)
+        ok = ParseSps(stats);
+    else if (nalType == 8)
+        ok = ParsePps(stats);
+    else
+        ok = ParseSlice(nalType, nalRefIdc, *stats, qpSum);
+    if (!ok)
+        errors++;
+}
+
+bool H264HeaderParser::ParseSps(FrameStats *stats)
+{
+    BitReader br(rbsp.data(), rbsp.size());
+    int profileIdc = br.ReadBits(8);
+    br.ReadBits(16); // constraint flags, level_idc
+    uint32_t id = br.ReadUE();
+    if (id >= 32)
+        return false;
+
+    Sps s;
+    int chromaFormatIdc = 1;
+    if (profileIdc == 100 || profileIdc == 110 || profileIdc == 122 || profileIdc == 244 || profileIdc == 44 ||
+        profileIdc == 83 || profileIdc == 86 || profileIdc == 118 || profileIdc == 128 || profileIdc == 138 ||
+        profileIdc == 139 || profileIdc == 134 || profileIdc == 135)
+    {
+        chromaFormatIdc = br.ReadUE();
+        if (chromaFormatIdc == 3)
+            s.separateColourPlane = br.ReadBit();
+        br.ReadUE(); // bit_depth_luma_minus8
+        br.ReadUE(); // bit_depth_chroma_minus8
+        br.ReadBit(); // qpprime_y_zero_transform_bypass_flag
+        if (br.ReadBit())
+        {
+            for (int i = 0; i < (chromaFormatIdc != 3 ? 8 : 12); i++)
+            {
+                if (br.ReadBit())
+                    SkipScalingList(br, i < 6 ? 16 : 64);
+            }
+        }
+    }
+    if (chromaFormatIdc > 3)
+        return false;
+    s.chromaArrayType = s.separateColourPlane ? 0 : chromaFormatIdc;
+
+    s.log2MaxFrameNum = br.ReadUE() + 4;
+    s.pocType = br.ReadUE();
+    if (s.pocType == 0)
+        s.log2MaxPocLsb = br.ReadUE() + 4;
+    else if (s.pocType == 1)
+    {
+        s.deltaPicOrderAlwaysZero = br.ReadBit();
+        br.ReadSE(); // offset_for_non_ref_pic
+        br.ReadSE(); // offset_for_top_to_bottom_field
+        uint32_t cycle = br.ReadUE();
+        if (cycle > 255)
+            return false;
+        for (uint32_t i = 0; i < cycle; i++)
+            br.ReadSE();
+    }
+    if (s.log2MaxFrameNum > 16 || s.log2MaxPocLsb > 16 || s.pocType > 2)
+        return false;
+
+    br.ReadUE();  // max_num_ref_frames
+    br.ReadBit(); // gaps_in_frame_num_value_allowed_flag
+    int widthMbs = br.ReadUE() + 1;
+    int heightMapUnits = br.ReadUE() + 1;
+    s.frameMbsOnly = br.ReadBit();
+    if (!s.frameMbsOnly)
+        br.ReadBit(); // mb_adaptive_frame_field_flag
+    br.ReadBit();     // direct_8x8_inference_flag
+    int crop[4] = {0, 0, 0, 0};
+    if (br.ReadBit())
+    {
+        for (int &c : crop)
+            c = br.ReadUE();
+    }
+    if (br.Overrun())
+        return false;
+
+    int cropUnitX = s.chromaArrayType == 0 || chromaFormatIdc == 3 ? 1 : 2;
+    int cropUnitY = (s.chromaArrayType == 0 || chromaFormatIdc != 1 ? 1 : 2) * (s.frameMbsOnly ? 1 : 2);
+    s.width = widthMbs * 16 - cropUnitX * (crop[0] + crop[1]);
+    s.height = heightMapUnits * 16 * (s.frameMbsOnly ? 1 : 2) - cropUnitY * (crop[2] + crop[3]);
+    s.valid = true;
+    s.rbsp = rbsp;
+
+    if (stats)
+    {
+        stats->paramSets++;
+        if (sps[id].valid ? sps[id].rbsp != s.rbsp : sliceSeen)
+            stats->paramChange = true;
+    }
+    sps[id] = std::move(s);
+    return true;
+}
+
+bool H264HeaderParser::ParsePps(FrameStats *stats)
+{
+    BitReader br(rbsp.data(), rbsp.size());
+    uint32_t id = br.ReadUE();
+    if (id >= 256)
+        return false;
+
+    Pps p;
+    p.spsId = br.ReadUE();
+    if (p.spsId >= 32)
+        return false;
+    p.cabac = br.ReadBit();
+    p.bottomFieldPicOrder = br.ReadBit();
+    uint32_t sliceGroups = br.ReadUE() + 1;
+    if (sliceGroups > 8)
+        return false;
+    if (sliceGroups > 1)
+    {
+        // Flexible macroblock ordering (Baseline): only skipped over
+        uint32_t mapType = br.ReadUE();
+        if (mapType == 0)
+        {
+            for (uint32_t i = 0; i < sliceGroups; i++)
+                br.ReadUE(); // run_length_minus1
+        }
+        else if (mapType == 2)
+        {
+            for (uint32_t i = 0; i + 1 < sliceGroups; i++)
+            {
+                br.ReadUE(); // top_left
+                br.ReadUE(); // bottom_right
+            }
+        }
+        else if (mapType >= 3 && mapType <= 5)
+        {
+            br.ReadBit(); // slice_group_change_direction_flag
+            br.ReadUE();  // slice_group_change_rate_minus1
+        }
+        else if (mapType == 6)
+        {
+            uint32_t units = br.ReadUE() + 1;
+            int bits = 0;
+            while ((1u << bits) < sliceGroups)
+                bits++;
+            for (uint32_t i = 0; i < units && !br.Overrun(); i++)
+                br.ReadBits(bits);
+        }
+    }
+
+    p.numRefIdxL0 = br.ReadUE() + 1;
+    p.numRefIdxL1 = br.ReadUE() + 1;
+    if (p.numRefIdxL0 > 32 || p.numRefIdxL1 > 32)
+        return false;
+    p.weightedPred = br.ReadBit();
+    p.weightedBipredIdc = br.ReadBits(2);
+    p.picInitQp = 26 + br.ReadSE();
+    br.ReadSE();  // pic_init_qs_minus26
+    br.ReadSE();  // chroma_qp_index_offset
+    br.ReadBit(); // deblocking_filter_control_present_flag
+    br.ReadBit(); // constrained_intra_pred_flag
+    p.redundantPicCnt = br.ReadBit();
+    if (br.Overrun())
+        return false;
+    p.valid = true;
+    p.rbsp = rbsp;
+
+    if (stats)
+    {
+        stats->paramSets++;
+        if (pps[id].valid ? pps[id].rbsp != p.rbsp : sliceSeen)
+            stats->paramChange = true;
+    }
+    pps[id] = std::move(p);
+    return true;
+}
+
+bool H264HeaderParser::ParseSlice(int nalType, int nalRefIdc, FrameStats &stats, double &qpSum)
+{
+    BitReader br(rbsp.data(), rbsp.size());
+    br.ReadUE(); // first_mb_in_slice
+    uint32_t sliceType = br.ReadUE();
+    uint32_t ppsId = br.ReadUE();
+    if (sliceType > 9 || ppsId >= 256 || !pps[ppsId].valid || !sps[pps[ppsId].spsId].valid)
+        return false;
+    const Pps &p = pps[ppsId];
+    const Sps &s = sps[p.spsId];
+    sliceType %= 5;
+    bool idr = nalType == 5;
+    bool bSlice = sliceType == 1;
+    bool iSlice = sliceType == 2 || sliceType == 4; // I, SI
+    bool pSlice = sliceType == 0 || sliceType == 3; // P, SP
+
+    if (s.separateColourPlane)
+        br.ReadBits(2); // colour_plane_id
+    int frameNum = br.ReadBits(s.log2MaxFrameNum);
+    bool fieldPic = false;
+    if (!s.frameMbsOnly)
+    {
+        fieldPic = br.ReadBit();
+        if (fieldPic)
+            br.ReadBit(); // bottom_field_flag
+    }
+    if (idr)
+        br.ReadUE(); // idr_pic_id
+    if (s.pocType == 0)
+    {
+        br.ReadBits(s.log2MaxPocLsb);
+        if (p.bottomFieldPicOrder && !fieldPic)
+            br.ReadSE(); // delta_pic_order_cnt_bottom
+    }
+    else if (s.pocType == 1 && !s.deltaPicOrderAlwaysZero)
+    {
+        br.ReadSE();
+        if (p.bottomFieldPicOrder && !fieldPic)
+            br.ReadSE();
+    }
+    if (p.redundantPicCnt)
+        br.ReadUE();
+    if (bSlice)
+        br.ReadBit(); // direct_spatial_mv_pred_flag
+
+    int refsL0 = iSlice ? 0 : p.numRefIdxL0;
+    int refsL1 = bSlice ? p.numRefIdxL1 : 0;
+    if (!iSlice && br.ReadBit())
+    {
+        refsL0 = br.ReadUE() + 1;
+        if (bSlice)
+            refsL1 = br.ReadUE() + 1;
+    }
+    if (refsL0 > 32 || refsL1 > 32)
+        return false;
+
+    // ref_pic_list_modification
+    int lists = bSlice ? 2 : (iSlice ? 0 : 1);
+    for (int list = 0; list < lists; list++)
+    {
+        if (!br.ReadBit())
+            continue;
+        while (true)
+        {
+            uint32_t idc = br.ReadUE();
+            if (idc == 3)
+                break;
+            if (idc > 2 || br.Overrun())
+                return false;
+            br.ReadUE(); // abs_diff_pic_num_minus1 / long_term_pic_num
+        }
+    }
+
+    if ((p.weightedPred && pSlice) || (p.weightedBipredIdc == 1 && bSlice))
+    {
+        // pred_weight_table
+        br.ReadUE(); // luma_log2_weight_denom
+        if (s.chromaArrayType != 0)
+            br.ReadUE(); // chroma_log2_weight_denom
+        for (int list = 0; list < lists; list++)
+        {
+            for (int i = 0; i < (list == 0 ? refsL0 : refsL1); i++)
+            {
+                if (br.ReadBit())
+                {
+                    br.ReadSE();
+                    br.ReadSE();
+                }
+                if (s.chromaArrayType != 0 && br.ReadBit())
+                {
+                    for (int c = 0; c < 4; c++)
+                        br.ReadSE();
+                }
+            }
+        }
+    }
+
+    if (nalRefIdc != 0)
+    {
+        // dec_ref_pic_marking
+        if (idr)
+            br.ReadBits(2); // no_output_of_prior_pics_flag, long_term_reference_flag
+        else if (br.ReadBit())
+        {
+            while (true)
+            {
+                uint32_t op = br.ReadUE();
+                if (op == 0)
+                    break;
+                if (op > 6 || br.Overrun())
+                    return false;
+                if (op == 1 || op == 3)
+                    br.ReadUE(); // difference_of_pic_nums_minus1
+                if (op == 2)
+                    br.ReadUE(); // long_term_pic_num
+                if (op == 3 || op == 6)
+                    br.ReadUE(); // long_term_frame_idx
+                if (op == 4)
+                    br.ReadUE(); // max_long_term_frame_idx_plus1
+            }
+        }
+    }
+    if (p.cabac && !iSlice)
+        br.ReadUE(); // cabac_init_idc
+    int qp = p.picInitQp + br.ReadSE();
+    if (br.Overrun() || qp < -48 || qp > 51)
+        return false;
+
+    sliceSeen = true;
+    if (stats.slices++ == 0)
+    {
+        stats.frameNum = frameNum;
+        stats.spsId = p.spsId;
+        stats.ppsId = (int)ppsId;
+        stats.width = s.width;
+        stats.height = s.height;
+    }
+    qpSum += qp;
+    char type = bSlice ? 'B' : (pSlice ? 'P' : 'I');
+    if (TypeRank(type) > TypeRank(stats.type))
+        stats.type = type;
+    stats.idr = stats.idr || idr;
+    stats.nalRefIdc = std::max(stats.nalRefIdc, nalRefIdc);
+    stats.refsL0 = std::max(stats.refsL0, refsL0);
+    stats.refsL1 = std::max(stats.refsL1, refsL1);
+    return true;
+}
+
+// Joins decoded frames back to their access unit through the packet number in frame->opaque
+class StatsSink : public IFrameSink
+{
+private:
+    std::vector<FrameStats> &frames;
+
+public:
+    uint64_t decoded = 0;
+
+    explicit StatsSink(std::vector<FrameStats> &out) : frames(out) {}
+
+    bool OnFrame(AVFrame *frame) override
+    {
+        int64_t index = (int64_t)(intptr_t)frame->opaque;
+        int64_t output = (int64_t)decoded++;
+        if (index < 0 || index >= (int64_t)frames.size())
+            return true;
+
+        FrameStats &stats = frames[index];
+        stats.outputIndex = output;
+        stats.decodedType = av_get_picture_type_char(frame->pict_type);
+
+        const AVFrameSideData *sd = av_frame_get_side_data(frame, AV_FRAME_DATA_VIDEO_ENC_PARAMS);
+        if (!sd)
+            return true;
+        AVVideoEncParams *params = (AVVideoEncParams *)sd->data;
+        if (params->nb_blocks == 0)
+        {
+            stats.decodedQp = params->qp;
+            return true;
+        }
+        double sum = 0.0, area = 0.0;
+        for (unsigned int i = 0; i < params->nb_blocks; i++)
+        {
+            const AVVideoBlockParams *block = av_video_enc_params_block(params, i);
+            double blockArea = (double)block->w * block->h;
+            sum += (params->qp + block->delta_qp) * blockArea;
+            area += blockArea;
+        }
+        stats.decodedQp = area > 0.0 ? sum / area : params->qp;
+        return true;
+    }
+};
+
+BitstreamAnalyzer::Result BitstreamAnalyzer::Analyze(const char *filename, const Config &config)
+{
+    Result result;
+    auto begin = std::chrono::steady_clock::now();
+    bool full = config.mode == Mode::Full;
+
+    // Header-only: the codec is opened (single thread) but never sees a packet
+    SoftwareDecodeBackend backend(full ? config.decodeThreads : 1);
+    DecoderCore decoder;
+    decoder.SetFrameAnalysis(full);
+    if (!decoder.Open(filename, &backend))
+        return result;
+
+    const AVCodecContext *codecCtx = decoder.GetCodecContext();
+    result.codec = avcodec_get_name(codecCtx->codec_id);
+    bool h264 = codecCtx->codec_id == AV_CODEC_ID_H264;
+    if (!h264 && !full)
+    {
+        std::cerr << filename << ": header-only analysis supports H.264, not " << result.codec
+                  << "; use full mode" << std::endl;
+        return result;
+    }
+
+    H264HeaderParser parser;
+    if (h264)
+        parser.SetExtradata(codecCtx->extradata, codecCtx->extradata_size);
+
+    StatsSink sink(result.frames);
+    while (decoder.ReadPacket())
+    {
+        const AVPacket *pkt = decoder.GetPacket();
+        FrameStats stats;
+        stats.index = (int64_t)result.frames.size();
+        stats.pts = pkt->pts;
+        stats.pos = pkt->pos;
+        stats.size = pkt->size;
+        stats.key = pkt->flags & AV_PKT_FLAG_KEY;
+        if (h264)
+            parser.Parse(pkt->data, pkt->size, stats);
+        result.frames.push_back(stats);
+
+        if (full && !decoder.DecodePacket(&sink))
+            break;
+    }
+    if (full)
+        decoder.Drain(&sink);
+
+    result.framesDecoded = sink.decoded;
+    result.headerErrors = parser.GetErrors();
+    result.ok = !result.frames.empty();
+    result.elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+// Empty field for unknown values keeps the CSV compact
+static void AppendInt(std::string &line, int64_t value, bool known)
+{
+    char buf[32];
+    line += ',';
+    if (known)
+    {
+        std::snprintf(buf, sizeof(buf), "%" PRId64, value);
+        line += buf;
+    }
+}
+
+static void AppendQp(std::string &line, double value)
+{
+    char buf[32];
+    line += ',';
+    if (value >= -48.0)
+    {
+        std::snprintf(buf, sizeof(buf), "%.2f", value);
+        line += buf;
+    }
+}
+
+static void AppendChar(std::string &line, char value)
+{
+    line += ',';
+    if (value != '?')
+        line += value;
+}
+
+void BitstreamAnalyzer::WriteCsvHeader(std::ostream &out)
+{
+    out << "file,index,pts,pos,size,key,type,idr,ref_idc,slices,qp,refs_l0,refs_l1,frame_num,sps,pps,width,height,"
+           "param_sets,param_change,output,dec_type,dec_qp\n";
+}
+
+void BitstreamAnalyzer::WriteCsvRows(std::ostream &out, int fileId, const Result &result)
+{
+    std::string line;
+    for (const FrameStats &f : result.frames)
+    {
+        bool parsed = f.slices > 0;
+        line.clear();
+        line += std::to_string(fileId);
+        AppendInt(line, f.index, true);
+        AppendInt(line, f.pts, f.pts != AV_NOPTS_VALUE);
+        AppendInt(line, f.pos, f.pos >= 0);
+        AppendInt(line, f.size, true);
+        AppendInt(line, f.key, true);
+        AppendChar(line, f.type);
+        AppendInt(line, f.idr, parsed);
+        AppendInt(line, f.nalRefIdc, parsed);
+        AppendInt(line, f.slices, parsed);
+        AppendQp(line, f.qp);
+        AppendInt(line, f.refsL0, parsed);
+        AppendInt(line, f.refsL1, parsed);
+        AppendInt(line, f.frameNum, parsed);
+        AppendInt(line, f.spsId, parsed);
+        AppendInt(line, f.ppsId, parsed);
+        AppendInt(line, f.width, parsed);
+        AppendInt(line, f.height, parsed);
+        AppendInt(line, f.paramSets, true);
+        AppendInt(line, f.paramChange, true);
+        AppendInt(line, f.outputIndex, f.outputIndex >= 0);
+        AppendChar(line, f.decodedType);
+        AppendQp(line, f.decodedQp);
+        line += '\n';
+        out << line;
+    }
+}
+
+void BitstreamAnalyzer::WriteSummaryHeader(std::ostream &out)
+{
+    out << "file,path,codec,frames,i,p,b,idr,param_changes,bytes,mean_qp,header_errors,decoded,seconds\n";
+}
+
+void BitstreamAnalyzer::WriteSummaryRow(std::ostream &out, int fileId, const std::string &path, const Result &result)
+{
+    uint64_t count[3] = {0, 0, 0};
+    uint64_t idr = 0, changes = 0, bytes = 0, qpFrames = 0;
+    double qpSum = 0.0;
+    for (const FrameStats &f : result.frames)
+    {
+        // The decoder's view where there is one
+        char type = f.decodedType != '?' ? (char)std::toupper(f.decodedType) : f.type;
+        int rank = TypeRank(type);
+        if (rank >= 0)
+            count[rank]++;
+        idr += f.idr;
+        changes += f.paramChange;
+        bytes += f.size;
+        double qp = f.decodedQp >= -48.0 ? f.decodedQp : f.qp;
+        if (qp >= -48.0)
+        {
+            qpSum += qp;
+            qpFrames++;
+        }
+    }
+
+    // Quote the path: it may hold commas
+    std::string quoted = "\"";
+    for (char c : path)
+    {
+        if (c == '"')
+            quoted += '"';
+        quoted += c;
+    }
+    quoted += '"';
+
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), ",%s,%zu,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64,
+                  result.codec.c_str(), result.frames.size(), count[0], count[1], count[2], idr, changes, bytes);
+    out << fileId << "," << quoted << buf;
+    if (qpFrames)
+    {
+        std::snprintf(buf, sizeof(buf), ",%.2f", qpSum / qpFrames);
+        out << buf;
+    }
+    else
+        out << ",";
+    std::snprintf(buf, sizeof(buf), ",%" PRIu64 ",%" PRIu64 ",%.3f\n", result.headerErrors, result.framesDecoded,
+                  result.elapsedSec);
+    out << buf;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+// Per-access-unit statistics of one coded picture, in decode order
+struct FrameStats
+{
+    int64_t index = 0; // decode order
+    int64_t pts = AV_NOPTS_VALUE;
+    int64_t pos = -1;
+    int size = 0;      // packet bytes
+    bool key = false;  // packet key flag
+    // From the NAL and slice headers (H.264); -1 / '?' when unknown
+    char type = '?';   // I, P or B: the "most predicted" slice type of the picture
+    bool idr = false;
+    int nalRefIdc = -1;
+    int slices = 0;
+    double qp = -1.0;  // mean slice QP (pic_init_qp + slice_qp_delta)
+    int refsL0 = -1;   // active reference indices, largest over the slices
+    int refsL1 = -1;
+    int frameNum = -1;
+    int spsId = -1;
+    int ppsId = -1;
+    int width = 0;     // cropped size from the active SPS
+    int height = 0;
+    int paramSets = 0;        // SPS/PPS NAL units carried in this access unit
+    bool paramChange = false; // one of them redefined an id in use, or a new one appeared mid-stream
+    // From decoding (full mode); -1 / '?' when not decoded or dropped by the decoder
+    int64_t outputIndex = -1; // display order
+    char decodedType = '?';   // frame->pict_type
+    double decodedQp = -1.0;  // AV_FRAME_DATA_VIDEO_ENC_PARAMS, mean over blocks by area
+};
+
+// H.264 NAL unit and slice header parser: no reconstruction, only the parameter sets and
+// the slice header fields up to slice_qp_delta. Accepts Annex-B and length-prefixed (avcC)
+// access units.
+class H264HeaderParser
+{
+private:
+    struct Sps
+    {
+        bool valid = false;
+        int chromaArrayType = 1;
+        bool separateColourPlane = false;
+        int log2MaxFrameNum = 4;
+        int pocType = 0;
+        int log2MaxPocLsb = 4;
+        bool deltaPicOrderAlwaysZero = false;
+        bool frameMbsOnly = true;
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> rbsp;
+    };
+
+    struct Pps
+    {
+        bool valid = false;
+        int spsId = 0;
+        bool cabac = false;
+        bool bottomFieldPicOrder = false;
+        int numRefIdxL0 = 1;
+        int numRefIdxL1 = 1;
+        bool weightedPred = false;
+        int weightedBipredIdc = 0;
+        int picInitQp = 26;
+        bool redundantPicCnt = false;
+        std::vector<uint8_t> rbsp;
+    };
+
+    Sps sps[32];
+    Pps pps[256];
+    int lengthSize = 4;      // NAL length prefix of avcC streams
+    bool sliceSeen = false;  // parameter sets before the first slice are the initial ones
+    std::vector<uint8_t> rbsp;
+    uint64_t errors = 0;
+
+public:
+    // avcC extradata (initial SPS/PPS and the NAL length size) or Annex-B parameter sets
+    void SetExtradata(const uint8_t *data, int size);
+
+    // Fill the header fields of stats from one access unit; false if it held no slice
+    bool Parse(const uint8_t *data, int size, FrameStats &stats);
+
+    // Malformed or unsupported NAL units skipped so far
+    uint64_t GetErrors() const { return errors; }
+
+private:
+    void ParseUnits(const uint8_t *data, int size, FrameStats *stats, double &qpSum);
+    void ParseNal(const uint8_t *nal, size_t size, FrameStats *stats, double &qpSum);
+    bool ParseSps(FrameStats *stats);
+    bool ParsePps(FrameStats *stats);
+    bool ParseSlice(int nalType, int nalRefIdc, FrameStats &stats, double &qpSum);
+};
+
+// Bitstream statistics of whole files: Headers parses NAL and slice headers of the demuxed
+// packets only; Full also decodes (software) and adds the decoder's picture type and QP
+class BitstreamAnalyzer
+{
+public:
+    enum class Mode
+    {
+        Headers,
+        Full
+    };
+
+    struct Config
+    {
+        Mode mode = Mode::Headers;
+        int decodeThreads = 1; // full mode, per file; parallelism normally comes from running files concurrently
+    };
+
+    struct Result
+    {
+        bool ok = false;
+        std::string codec;
+        std::vector<FrameStats> frames;
+        uint64_t framesDecoded = 0;
+        uint64_t headerErrors = 0;
+        double elapsedSec = 0.0;
+    };
+
+    static Result Analyze(const char *filename, const Config &config);
+
+    // CSV with one row per access unit; fileId numbers the input in the per-file summary
+    static void WriteCsvHeader(std::ostream &out);
+    static void WriteCsvRows(std::ostream &out, int fileId, const Result &result);
+
+    // One row per input file: frame type counts, IDRs, parameter set changes, mean QP
+    static void WriteSummaryHeader(std::ostream &out);
+    static void WriteSummaryRow(std::ostream &out, int fileId, const std::string &path, const Result &result);
+};
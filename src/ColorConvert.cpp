@@ -0,0 +1,300 @@
+#include "ColorConvert.h"
+#include "ColorConvertKernels.h"
+
+extern "C"
+{
+#include <libavutil/frame.h>
+}
+
+#ifdef COLOR_CONVERT_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+using namespace ColorConvertDetail;
+
+namespace ColorConvertDetail
+{
+    namespace
+    {
+        template <ColorMatrix M, ColorRange R>
+        struct KernelsScalar
+        {
+            using C = Coefs<M, R>;
+
+            static void NV12(const uint8_t *y, int yStride, const uint8_t *uv, int uvStride,
+                             uint8_t *dst, int dstStride, int width, int height)
+            {
+                for (int row = 0; row < height; row++)
+                {
+                    const uint8_t *uvRow = uv + (row >> 1) * uvStride;
+                    ConvertRowScalar<C>(y + row * yStride, uvRow, uvRow + 1, 2, dst + row * dstStride, 0, width);
+                }
+            }
+
+            static void I420(const uint8_t *y, int yStride, const uint8_t *u, int uStride,
+                             const uint8_t *v, int vStride, uint8_t *dst, int dstStride, int width, int height)
+            {
+                for (int row = 0; row < height; row++)
+                {
+                    ConvertRowScalar<C>(y + row * yStride, u + (row >> 1) * uStride, v + (row >> 1) * vStride, 1,
+                                        dst + row * dstStride, 0, width);
+                }
+            }
+        };
+    }
+
+    const KernelTable &GetScalarKernels()
+    {
+        static constexpr KernelTable table = MakeKernelTable<KernelsScalar>();
+        return table;
+    }
+}
+
+#ifdef COLOR_CONVERT_X86
+static void CpuId(int leaf, int subleaf, unsigned regs[4])
+{
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, leaf, subleaf);
+    for (int i = 0; i < 4; i++)
+        regs[i] = (unsigned)r[i];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long ReadXCR0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+
+static ConvertKernel DetectKernel()
+{
+    unsigned regs[4];
+    CpuId(0, 0, regs);
+    unsigned maxLeaf = regs[0];
+
+    CpuId(1, 0, regs);
+    bool sse41 = (regs[2] & (1u << 19)) != 0;
+    bool osxsave = (regs[2] & (1u << 27)) != 0;
+    if (!sse41)
+        return ConvertKernel::Scalar;
+    if (!osxsave || maxLeaf < 7)
+        return ConvertKernel::SSE41;
+
+    // The OS must save YMM (bits 1-2) and, for AVX-512, opmask/ZMM state (bits 5-7)
+    unsigned long long xcr0 = ReadXCR0();
+    bool osAvx = (xcr0 & 0x6) == 0x6;
+    bool osAvx512 = (xcr0 & 0xE6) == 0xE6;
+
+    CpuId(7, 0, regs);
+    bool avx2 = (regs[1] & (1u << 5)) != 0;
+    bool avx512f = (regs[1] & (1u << 16)) != 0;
+    bool avx512bw = (regs[1] & (1u << 30)) != 0;
+
+    if (osAvx512 && avx512f && avx512bw)
+        return ConvertKernel::AVX512;
+    if (osAvx && avx2)
+        return ConvertKernel::AVX2;
+    return ConvertKernel::SSE41;
+}
+#else
+static ConvertKernel DetectKernel()
+{
+    return ConvertKernel::Scalar;
+}
+#endif
+
+ConvertKernel ColorConverter::GetBestKernel()
+{
+    static const ConvertKernel best = DetectKernel();
+    return best;
+}
+
+bool ColorConverter::IsKernelSupported(ConvertKernel kernel)
+{
+    return (int)kernel <= (int)GetBestKernel();
+}
+
+const char *ColorConverter::GetKernelName(ConvertKernel kernel)
+{
+    switch (kernel)
+    {
+    case ConvertKernel::Scalar:
+        return "scalar";
+    case ConvertKernel::SSE41:
+        return "sse4.1";
+    case ConvertKernel::AVX2:
+        return "avx2";
+    case ConvertKernel::AVX512:
+        return "avx512";
+    default:
+        return "unknown";
+    }
+}
+
+const char *ColorConverter::GetMatrixName(ColorMatrix matrix)
+{
+    switch (matrix)
+    {
+    case ColorMatrix::BT601:
+        return "bt601";
+    case ColorMatrix::BT709:
+        return "bt709";
+    case ColorMatrix::BT2020:
+        return "bt2020";
+    default:
+        return "unknown";
+    }
+}
+
+const char *ColorConverter::GetRangeName(ColorRange range)
+{
+    return range == ColorRange::Full ? "full" : "limited";
+}
+
+static const KernelTable *GetKernelTable(ConvertKernel kernel)
+{
+    if (!ColorConverter::IsKernelSupported(kernel))
+        return nullptr;
+
+    switch (kernel)
+    {
+#ifdef COLOR_CONVERT_X86
+    case ConvertKernel::SSE41:
+        return &GetSSE41Kernels();
+    case ConvertKernel::AVX2:
+        return &GetAVX2Kernels();
+    case ConvertKernel::AVX512:
+        return &GetAVX512Kernels();
+#endif
+    default:
+        return &GetScalarKernels();
+    }
+}
+
+ColorConverter::NV12Func ColorConverter::GetNV12ToRGBA(ConvertKernel kernel, ColorSpec spec)
+{
+    const KernelTable *table = GetKernelTable(kernel);
+    return table ? table->nv12[(int)spec.matrix][(int)spec.range] : nullptr;
+}
+
+ColorConverter::I420Func ColorConverter::GetI420ToRGBA(ConvertKernel kernel, ColorSpec spec)
+{
+    const KernelTable *table = GetKernelTable(kernel);
+    return table ? table->i420[(int)spec.matrix][(int)spec.range] : nullptr;
+}
+
+ColorSpec ColorConverter::GetColorSpec(const AVFrame *frame)
+{
+    ColorSpec spec;
+    switch (frame->colorspace)
+    {
+    case AVCOL_SPC_BT709:
+        spec.matrix = ColorMatrix::BT709;
+        break;
+    case AVCOL_SPC_BT2020_NCL:
+    case AVCOL_SPC_BT2020_CL:
+        spec.matrix = ColorMatrix::BT2020;
+        break;
+    case AVCOL_SPC_BT470BG:
+    case AVCOL_SPC_SMPTE170M:
+        spec.matrix = ColorMatrix::BT601;
+        break;
+    default:
+        spec.matrix = frame->height > 576 ? ColorMatrix::BT709 : ColorMatrix::BT601;
+        break;
+    }
+
+    bool full = frame->color_range == AVCOL_RANGE_JPEG || frame->format == AV_PIX_FMT_YUVJ420P;
+    spec.range = full ? ColorRange::Full : ColorRange::Limited;
+    return spec;
+}
+
+void ColorConverter::GetFloatMatrix(ColorSpec spec, float rows[3][4])
+{
+    // Same factors as the fixed-point kernels, with the offsets moved to UNORM scale
+    ColorFactors f = GetFactors(spec.matrix, spec.range);
+    double yOffset = f.yOffset / 255.0, cOffset = 128.0 / 255.0;
+    double m[3][3] = {{f.yScale, 0.0, f.rv}, {f.yScale, -f.gu, -f.gv}, {f.yScale, f.bu, 0.0}};
+    for (int c = 0; c < 3; c++)
+    {
+        rows[c][0] = (float)m[c][0];
+        rows[c][1] = (float)m[c][1];
+        rows[c][2] = (float)m[c][2];
+        rows[c][3] = (float)(-m[c][0] * yOffset - (m[c][1] + m[c][2]) * cOffset);
+    }
+}
+
+void ColorConverter::NV12ToRGBA(const uint8_t *y, int yStride, const uint8_t *uv, int uvStride,
+                                uint8_t *dst, int dstStride, int width, int height)
+{
+    static const NV12Func func = GetNV12ToRGBA(GetBestKernel());
+    func(y, yStride, uv, uvStride, dst, dstStride, width, height);
+}
+
+void ColorConverter::I420ToRGBA(const uint8_t *y, int yStride, const uint8_t *u, int uStride,
+                                const uint8_t *v, int vStride, uint8_t *dst, int dstStride, int width, int height)
+{
+    static const I420Func func = GetI420ToRGBA(GetBestKernel());
+    func(y, yStride, u, uStride, v, vStride, dst, dstStride, width, height);
+}
+
+bool ColorConverter::FrameToRGBA(const AVFrame *frame, uint8_t *dst, int dstStride)
+{
+    StreamColorConverter converter;
+    return converter.FrameToRGBA(frame, dst, dstStride);
+}
+
+void StreamColorConverter::Resolve(ColorSpec colorSpec)
+{
+    spec = colorSpec;
+    nv12 = ColorConverter::GetNV12ToRGBA(kernel, spec);
+    i420 = ColorConverter::GetI420ToRGBA(kernel, spec);
+    resolved = true;
+}
+
+void StreamColorConverter::SetColorSpec(ColorSpec colorSpec)
+{
+    Resolve(colorSpec);
+    pinned = true;
+}
+
+bool StreamColorConverter::FrameToRGBA(const AVFrame *frame, uint8_t *dst, int dstStride)
+{
+    if (frame->format != AV_PIX_FMT_NV12 && frame->format != AV_PIX_FMT_YUV420P &&
+        frame->format != AV_PIX_FMT_YUVJ420P)
+        return false;
+
+    if (!pinned)
+    {
+        ColorSpec frameSpec = ColorConverter::GetColorSpec(frame);
+        if (!resolved)
+            Resolve(frameSpec);
+        else if (frameSpec != spec)
+        {
+            Resolve(frameSpec);
+            switches++;
+        }
+    }
+    if (!nv12 || !i420)
+        return false;
+
+    if (frame->format == AV_PIX_FMT_NV12)
+        nv12(frame->data[0], frame->linesize[0], frame->data[1], frame->linesize[1],
+             dst, dstStride, frame->width, frame->height);
+    else
+        i420(frame->data[0], frame->linesize[0], frame->data[1], frame->linesize[1],
+             frame->data[2], frame->linesize[2], dst, dstStride, frame->width, frame->height);
+    return true;
+}
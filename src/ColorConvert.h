@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+
+struct AVFrame;
+
+// CPU conversion kernels, fastest last
+enum class ConvertKernel
+{
+    Scalar,
+    SSE41,
+    AVX2,
+    AVX512
+};
+
+// YCbCr -> RGB matrix (frame->colorspace)
+enum class ColorMatrix
+{
+    BT601,
+    BT709,
+    BT2020 // non-constant luminance
+};
+
+// Nominal range of the 8-bit samples (frame->color_range)
+enum class ColorRange
+{
+    Limited, // Y 16-235, chroma 16-240
+    Full     // 0-255, JPEG
+};
+
+struct ColorSpec
+{
+    ColorMatrix matrix = ColorMatrix::BT601;
+    ColorRange range = ColorRange::Limited;
+
+    bool operator==(const ColorSpec &o) const { return matrix == o.matrix && range == o.range; }
+    bool operator!=(const ColorSpec &o) const { return !(*this == o); }
+};
+
+// NV12/I420 -> RGBA conversion for frames in system memory. Every kernel is a template on
+// ColorMatrix and ColorRange whose Q13 fixed-point coefficients are computed at compile
+// time from the matrix's Kr/Kb, so the six variants are separate functions with their
+// constants folded in; every ISA produces bit-identical output to the scalar kernel of
+// the same variant. Chroma is upsampled nearest-neighbour. The D3D11 renderers use the
+// same matrices (GetFloatMatrix).
+class ColorConverter
+{
+public:
+    using NV12Func = void (*)(const uint8_t *y, int yStride, const uint8_t *uv, int uvStride,
+                              uint8_t *dst, int dstStride, int width, int height);
+    using I420Func = void (*)(const uint8_t *y, int yStride, const uint8_t *u, int uStride,
+                              const uint8_t *v, int vStride, uint8_t *dst, int dstStride, int width, int height);
+
+    // Best kernel supported by this CPU/OS, detected once from CPUID
+    static ConvertKernel GetBestKernel();
+    static bool IsKernelSupported(ConvertKernel kernel);
+    static const char *GetKernelName(ConvertKernel kernel);
+    static const char *GetMatrixName(ColorMatrix matrix);
+    static const char *GetRangeName(ColorRange range);
+
+    // The specialization of a kernel for one matrix and range (default BT.601 limited)
+    static NV12Func GetNV12ToRGBA(ConvertKernel kernel, ColorSpec spec = ColorSpec());
+    static I420Func GetI420ToRGBA(ConvertKernel kernel, ColorSpec spec = ColorSpec());
+
+    // Matrix and range a frame's metadata asks for. Unspecified matrices follow the usual
+    // convention: BT.709 above 576 lines, BT.601 below; YUVJ formats are full range.
+    static ColorSpec GetColorSpec(const AVFrame *frame);
+
+    // The same conversion in floating point for shaders: channel c (R, G, B) is
+    // rows[c][0] * Y + rows[c][1] * Cb + rows[c][2] * Cr + rows[c][3] on UNORM samples
+    static void GetFloatMatrix(ColorSpec spec, float rows[3][4]);
+
+    // Convert with the best kernel, BT.601 limited range
+    static void NV12ToRGBA(const uint8_t *y, int yStride, const uint8_t *uv, int uvStride,
+                           uint8_t *dst, int dstStride, int width, int height);
+    static void I420ToRGBA(const uint8_t *y, int yStride, const uint8_t *u, int uStride,
+                           const uint8_t *v, int vStride, uint8_t *dst, int dstStride, int width, int height);
+
+    // Convert a system-memory NV12 / YUV420P / YUVJ420P frame per its metadata; false for
+    // other formats. Looks the specialization up on every call, see StreamColorConverter.
+    static bool FrameToRGBA(const AVFrame *frame, uint8_t *dst, int dstStride);
+};
+
+// Per-stream dispatch: resolves the kernel specialization from the first frame's colour
+// metadata and keeps the function pointers; later frames only compare the metadata and
+// re-resolve if the stream switched.
+class StreamColorConverter
+{
+private:
+    ConvertKernel kernel;
+    ColorSpec spec;
+    bool resolved = false;
+    bool pinned = false;
+    ColorConverter::NV12Func nv12 = nullptr;
+    ColorConverter::I420Func i420 = nullptr;
+    uint64_t switches = 0;
+
+public:
+    explicit StreamColorConverter(ConvertKernel k = ColorConverter::GetBestKernel()) : kernel(k) {}
+
+    // Pin the specialization instead of following the frames
+    void SetColorSpec(ColorSpec colorSpec);
+    // Same contract as ColorConverter::FrameToRGBA
+    bool FrameToRGBA(const AVFrame *frame, uint8_t *dst, int dstStride);
+
+    const ColorSpec &GetColorSpec() const { return spec; }
+    // Times the metadata changed after the first frame
+    uint64_t GetSwitchCount() const { return switches; }
+
+private:
+    void Resolve(ColorSpec colorSpec);
+};
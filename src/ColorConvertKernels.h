@@ -0,0 +1,132 @@
+#pragma once
+
+// Internal to the ColorConvert*.cpp translation units: fixed-point coefficients,
+// the scalar reference row and the per-ISA kernel tables.
+
+#include <cstdint>
+
+#include "ColorConvert.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define COLOR_CONVERT_X86 1
+#endif
+
+namespace ColorConvertDetail
+{
+    constexpr int kShift = 13;
+    constexpr int kMatrixCount = 3;
+    constexpr int kRangeCount = 2;
+
+    constexpr int RoundToInt(double v) { return v < 0 ? (int)(v - 0.5) : (int)(v + 0.5); }
+
+    constexpr double MatrixKr(ColorMatrix m)
+    {
+        return m == ColorMatrix::BT709 ? 0.2126 : (m == ColorMatrix::BT2020 ? 0.2627 : 0.299);
+    }
+
+    constexpr double MatrixKb(ColorMatrix m)
+    {
+        return m == ColorMatrix::BT709 ? 0.0722 : (m == ColorMatrix::BT2020 ? 0.0593 : 0.114);
+    }
+
+    // Exact YCbCr -> RGB factors of one matrix and range on the 8-bit scale:
+    // R = yScale * (Y - yOffset) + rv * (Cr - 128), G = ... - gu * (Cb - 128) - gv * (Cr - 128),
+    // B = ... + bu * (Cb - 128). Limited range stretches Y from 219 and chroma from 224 steps.
+    struct ColorFactors
+    {
+        double yScale, yOffset, rv, gu, gv, bu;
+    };
+
+    constexpr ColorFactors GetFactors(ColorMatrix m, ColorRange r)
+    {
+        double kr = MatrixKr(m), kb = MatrixKb(m), kg = 1.0 - kr - kb;
+        bool full = r == ColorRange::Full;
+        double c = full ? 1.0 : 255.0 / 224.0;
+        return {full ? 1.0 : 255.0 / 219.0, full ? 0.0 : 16.0, 2.0 * (1.0 - kr) * c,
+                2.0 * kb * (1.0 - kb) / kg * c, 2.0 * kr * (1.0 - kr) / kg * c, 2.0 * (1.0 - kb) * c};
+    }
+
+    // The factors in Q13, with the Y and chroma offsets and the rounding term folded into
+    // one bias per channel. All compile-time constants.
+    template <ColorMatrix M, ColorRange R>
+    struct Coefs
+    {
+        static constexpr ColorFactors f = GetFactors(M, R);
+        static constexpr int cy = RoundToInt(f.yScale * (1 << kShift));
+        static constexpr int crv = RoundToInt(f.rv * (1 << kShift));
+        static constexpr int cgu = RoundToInt(f.gu * (1 << kShift));
+        static constexpr int cgv = RoundToInt(f.gv * (1 << kShift));
+        static constexpr int cbu = RoundToInt(f.bu * (1 << kShift));
+
+        static constexpr int kRound = 1 << (kShift - 1);
+        static constexpr int yBias = -cy * (int)f.yOffset;
+        static constexpr int biasR = yBias - crv * 128 + kRound;
+        static constexpr int biasG = yBias + (cgu + cgv) * 128 + kRound;
+        static constexpr int biasB = yBias - cbu * 128 + kRound;
+
+        // The SIMD kernels multiply in 16-bit lanes (pmaddwd)
+        static_assert(cy < 32768 && crv < 32768 && cgu < 32768 && cgv < 32768 && cbu < 32768,
+                      "coefficients must fit int16");
+    };
+
+    static inline uint8_t Clamp8(int v) { return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v)); }
+
+    template <typename C>
+    static inline void ConvertPixel(int y, int u, int v, uint8_t *rgba)
+    {
+        rgba[0] = Clamp8((C::cy * y + C::crv * v + C::biasR) >> kShift);
+        rgba[1] = Clamp8((C::cy * y - C::cgu * u - C::cgv * v + C::biasG) >> kShift);
+        rgba[2] = Clamp8((C::cy * y + C::cbu * u + C::biasB) >> kShift);
+        rgba[3] = 255;
+    }
+
+    // Scalar row for pixels [x0, width); chroma samples are uvStep bytes apart
+    // (2 for interleaved NV12, 1 for planar I420). static so the copies compiled into the
+    // ISA-specific translation units are never merged into the baseline one.
+    template <typename C>
+    static inline void ConvertRowScalar(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvStep,
+                                        uint8_t *dst, int x0, int width)
+    {
+        for (int x = x0; x < width; x++)
+        {
+            int c = (x >> 1) * uvStep;
+            ConvertPixel<C>(y[x], u[c], v[c], dst + x * 4);
+        }
+    }
+
+    // One ISA's kernels, indexed by [ColorMatrix][ColorRange]
+    struct KernelTable
+    {
+        ColorConverter::NV12Func nv12[kMatrixCount][kRangeCount];
+        ColorConverter::I420Func i420[kMatrixCount][kRangeCount];
+    };
+
+    // K<M, R>::NV12 / K<M, R>::I420 for every matrix and range; taking the addresses
+    // instantiates the specializations in the calling translation unit
+    template <template <ColorMatrix, ColorRange> class K, ColorMatrix M, ColorRange R>
+    constexpr void SetKernels(KernelTable &table)
+    {
+        table.nv12[(int)M][(int)R] = &K<M, R>::NV12;
+        table.i420[(int)M][(int)R] = &K<M, R>::I420;
+    }
+
+    template <template <ColorMatrix, ColorRange> class K>
+    constexpr KernelTable MakeKernelTable()
+    {
+        KernelTable table = {};
+        SetKernels<K, ColorMatrix::BT601, ColorRange::Limited>(table);
+        SetKernels<K, ColorMatrix::BT601, ColorRange::Full>(table);
+        SetKernels<K, ColorMatrix::BT709, ColorRange::Limited>(table);
+        SetKernels<K, ColorMatrix::BT709, ColorRange::Full>(table);
+        SetKernels<K, ColorMatrix::BT2020, ColorRange::Limited>(table);
+        SetKernels<K, ColorMatrix::BT2020, ColorRange::Full>(table);
+        return table;
+    }
+
+    const KernelTable &GetScalarKernels();
+#ifdef COLOR_CONVERT_X86
+    const KernelTable &GetSSE41Kernels();
+    const KernelTable &GetAVX2Kernels();
+    const KernelTable &GetAVX512Kernels();
+#endif
+}
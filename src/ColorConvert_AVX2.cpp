@@ -0,0 +1,120 @@
+#include "ColorConvertKernels.h"
+
+#ifdef COLOR_CONVERT_X86
+
+#include <immintrin.h>
+
+namespace ColorConvertDetail
+{
+    namespace
+    {
+        // 16 pixels per iteration
+        template <typename C>
+        struct Coefs256
+        {
+            __m256i yv = _mm256_set1_epi32((C::crv << 16) | C::cy);
+            __m256i yu = _mm256_set1_epi32(((-C::cgu & 0xFFFF) << 16) | C::cy);
+            __m256i v0 = _mm256_set1_epi32(-C::cgv & 0xFFFF);
+            __m256i yub = _mm256_set1_epi32((C::cbu << 16) | C::cy);
+            __m256i biasR = _mm256_set1_epi32(C::biasR);
+            __m256i biasG = _mm256_set1_epi32(C::biasG);
+            __m256i biasB = _mm256_set1_epi32(C::biasB);
+            __m256i alpha = _mm256_set1_epi16(255);
+        };
+
+        inline __m256i Dup16(__m256i c32) { return _mm256_or_si256(c32, _mm256_slli_epi32(c32, 16)); }
+
+        // y, u, v: 16 x int16 in [0, 255]; writes 64 bytes of RGBA.
+        // unpack/pack work per 128-bit lane, so after packing each lane holds 8 pixels
+        // in order and only the final stores need a cross-lane permute.
+        template <typename K>
+        inline void Convert16(const K &k, __m256i y, __m256i u, __m256i v, uint8_t *dst)
+        {
+            __m256i zero = _mm256_setzero_si256();
+            __m256i yvLo = _mm256_unpacklo_epi16(y, v), yvHi = _mm256_unpackhi_epi16(y, v);
+            __m256i yuLo = _mm256_unpacklo_epi16(y, u), yuHi = _mm256_unpackhi_epi16(y, u);
+            __m256i vLo = _mm256_unpacklo_epi16(v, zero), vHi = _mm256_unpackhi_epi16(v, zero);
+
+            __m256i rLo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yvLo, k.yv), k.biasR), kShift);
+            __m256i rHi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yvHi, k.yv), k.biasR), kShift);
+            __m256i gLo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(yuLo, k.yu), _mm256_madd_epi16(vLo, k.v0)), k.biasG), kShift);
+            __m256i gHi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(yuHi, k.yu), _mm256_madd_epi16(vHi, k.v0)), k.biasG), kShift);
+            __m256i bLo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yuLo, k.yub), k.biasB), kShift);
+            __m256i bHi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yuHi, k.yub), k.biasB), kShift);
+
+            __m256i rg = _mm256_packus_epi16(_mm256_packs_epi32(rLo, rHi), _mm256_packs_epi32(gLo, gHi));
+            __m256i ba = _mm256_packus_epi16(_mm256_packs_epi32(bLo, bHi), k.alpha);
+
+            __m256i rgI = _mm256_unpacklo_epi8(rg, _mm256_srli_si256(rg, 8));
+            __m256i baI = _mm256_unpacklo_epi8(ba, _mm256_srli_si256(ba, 8));
+            __m256i lo = _mm256_unpacklo_epi16(rgI, baI); // pixels 0-3 | 8-11
+            __m256i hi = _mm256_unpackhi_epi16(rgI, baI); // pixels 4-7 | 12-15
+            _mm256_storeu_si256((__m256i *)dst, _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i *)(dst + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+
+        template <typename C, bool NV12>
+        void ConvertRow(const Coefs256<C> &k, const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                        uint8_t *dst, int width)
+        {
+            int x = 0;
+            for (; x + 16 <= width; x += 16)
+            {
+                __m256i y16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(y + x)));
+                __m256i u16, v16;
+                if constexpr (NV12)
+                {
+                    __m256i uv = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(u + x)));
+                    u16 = Dup16(_mm256_and_si256(uv, _mm256_set1_epi32(0xFFFF)));
+                    v16 = Dup16(_mm256_srli_epi32(uv, 16));
+                }
+                else
+                {
+                    u16 = Dup16(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(u + x / 2))));
+                    v16 = Dup16(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(v + x / 2))));
+                }
+                Convert16(k, y16, u16, v16, dst + x * 4);
+            }
+            ConvertRowScalar<C>(y, u, v, NV12 ? 2 : 1, dst, x, width);
+        }
+    }
+
+    namespace
+    {
+        template <ColorMatrix M, ColorRange R>
+        struct KernelsAVX2
+        {
+            using C = Coefs<M, R>;
+
+            static void NV12(const uint8_t *y, int yStride, const uint8_t *uv, int uvStride,
+                             uint8_t *dst, int dstStride, int width, int height)
+            {
+                Coefs256<C> k;
+                for (int row = 0; row < height; row++)
+                {
+                    const uint8_t *uvRow = uv + (row >> 1) * uvStride;
+                    ConvertRow<C, true>(k, y + row * yStride, uvRow, uvRow + 1, dst + row * dstStride, width);
+                }
+            }
+
+            static void I420(const uint8_t *y, int yStride, const uint8_t *u, int uStride,
+                             const uint8_t *v, int vStride, uint8_t *dst, int dstStride, int width, int height)
+            {
+                Coefs256<C> k;
+                for (int row = 0; row < height; row++)
+                {
+                    ConvertRow<C, false>(k, y + row * yStride, u + (row >> 1) * uStride, v + (row >> 1) * vStride,
+                                         dst + row * dstStride, width);
+                }
+            }
+        };
+    }
+
+    const KernelTable &GetAVX2Kernels()
+    {
+        static constexpr KernelTable table = MakeKernelTable<KernelsAVX2>();
+        return table;
+    }
+}
+
+#endif
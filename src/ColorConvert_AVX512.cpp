@@ -0,0 +1,121 @@
+#include "ColorConvertKernels.h"
+
+#ifdef COLOR_CONVERT_X86
+
+#include <immintrin.h>
+
+namespace ColorConvertDetail
+{
+    namespace
+    {
+        // 32 pixels per iteration (AVX-512F + AVX-512BW)
+        template <typename C>
+        struct Coefs512
+        {
+            __m512i yv = _mm512_set1_epi32((C::crv << 16) | C::cy);
+            __m512i yu = _mm512_set1_epi32(((-C::cgu & 0xFFFF) << 16) | C::cy);
+            __m512i v0 = _mm512_set1_epi32(-C::cgv & 0xFFFF);
+            __m512i yub = _mm512_set1_epi32((C::cbu << 16) | C::cy);
+            __m512i biasR = _mm512_set1_epi32(C::biasR);
+            __m512i biasG = _mm512_set1_epi32(C::biasG);
+            __m512i biasB = _mm512_set1_epi32(C::biasB);
+            __m512i alpha = _mm512_set1_epi16(255);
+            // Qword gather of the per-lane unpack results back into pixel order
+            __m512i order0 = _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11);
+            __m512i order1 = _mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15);
+        };
+
+        inline __m512i Dup16(__m512i c32) { return _mm512_or_si512(c32, _mm512_slli_epi32(c32, 16)); }
+
+        // y, u, v: 32 x int16 in [0, 255]; writes 128 bytes of RGBA
+        template <typename K>
+        inline void Convert32(const K &k, __m512i y, __m512i u, __m512i v, uint8_t *dst)
+        {
+            __m512i zero = _mm512_setzero_si512();
+            __m512i yvLo = _mm512_unpacklo_epi16(y, v), yvHi = _mm512_unpackhi_epi16(y, v);
+            __m512i yuLo = _mm512_unpacklo_epi16(y, u), yuHi = _mm512_unpackhi_epi16(y, u);
+            __m512i vLo = _mm512_unpacklo_epi16(v, zero), vHi = _mm512_unpackhi_epi16(v, zero);
+
+            __m512i rLo = _mm512_srai_epi32(_mm512_add_epi32(_mm512_madd_epi16(yvLo, k.yv), k.biasR), kShift);
+            __m512i rHi = _mm512_srai_epi32(_mm512_add_epi32(_mm512_madd_epi16(yvHi, k.yv), k.biasR), kShift);
+            __m512i gLo = _mm512_srai_epi32(_mm512_add_epi32(_mm512_add_epi32(_mm512_madd_epi16(yuLo, k.yu), _mm512_madd_epi16(vLo, k.v0)), k.biasG), kShift);
+            __m512i gHi = _mm512_srai_epi32(_mm512_add_epi32(_mm512_add_epi32(_mm512_madd_epi16(yuHi, k.yu), _mm512_madd_epi16(vHi, k.v0)), k.biasG), kShift);
+            __m512i bLo = _mm512_srai_epi32(_mm512_add_epi32(_mm512_madd_epi16(yuLo, k.yub), k.biasB), kShift);
+            __m512i bHi = _mm512_srai_epi32(_mm512_add_epi32(_mm512_madd_epi16(yuHi, k.yub), k.biasB), kShift);
+
+            __m512i rg = _mm512_packus_epi16(_mm512_packs_epi32(rLo, rHi), _mm512_packs_epi32(gLo, gHi));
+            __m512i ba = _mm512_packus_epi16(_mm512_packs_epi32(bLo, bHi), k.alpha);
+
+            __m512i rgI = _mm512_unpacklo_epi8(rg, _mm512_bsrli_epi128(rg, 8));
+            __m512i baI = _mm512_unpacklo_epi8(ba, _mm512_bsrli_epi128(ba, 8));
+            __m512i lo = _mm512_unpacklo_epi16(rgI, baI); // pixels 0-3 | 8-11 | 16-19 | 24-27
+            __m512i hi = _mm512_unpackhi_epi16(rgI, baI); // pixels 4-7 | 12-15 | 20-23 | 28-31
+            _mm512_storeu_si512(dst, _mm512_permutex2var_epi64(lo, k.order0, hi));
+            _mm512_storeu_si512(dst + 64, _mm512_permutex2var_epi64(lo, k.order1, hi));
+        }
+
+        template <typename C, bool NV12>
+        void ConvertRow(const Coefs512<C> &k, const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                        uint8_t *dst, int width)
+        {
+            int x = 0;
+            for (; x + 32 <= width; x += 32)
+            {
+                __m512i y16 = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(y + x)));
+                __m512i u16, v16;
+                if constexpr (NV12)
+                {
+                    __m512i uv = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(u + x)));
+                    u16 = Dup16(_mm512_and_si512(uv, _mm512_set1_epi32(0xFFFF)));
+                    v16 = Dup16(_mm512_srli_epi32(uv, 16));
+                }
+                else
+                {
+                    u16 = Dup16(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(u + x / 2))));
+                    v16 = Dup16(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(v + x / 2))));
+                }
+                Convert32(k, y16, u16, v16, dst + x * 4);
+            }
+            ConvertRowScalar<C>(y, u, v, NV12 ? 2 : 1, dst, x, width);
+        }
+    }
+
+    namespace
+    {
+        template <ColorMatrix M, ColorRange R>
+        struct KernelsAVX512
+        {
+            using C = Coefs<M, R>;
+
+            static void NV12(const uint8_t *y, int yStride, const uint8_t *uv, int uvStride,
+                             uint8_t *dst, int dstStride, int width, int height)
+            {
+                Coefs512<C> k;
+                for (int row = 0; row < height; row++)
+                {
+                    const uint8_t *uvRow = uv + (row >> 1) * uvStride;
+                    ConvertRow<C, true>(k, y + row * yStride, uvRow, uvRow + 1, dst + row * dstStride, width);
+                }
+            }
+
+            static void I420(const uint8_t *y, int yStride, const uint8_t *u, int uStride,
+                             const uint8_t *v, int vStride, uint8_t *dst, int dstStride, int width, int height)
+            {
+                Coefs512<C> k;
+                for (int row = 0; row < height; row++)
+                {
+                    ConvertRow<C, false>(k, y + row * yStride, u + (row >> 1) * uStride, v + (row >> 1) * vStride,
+                                         dst + row * dstStride, width);
+                }
+            }
+        };
+    }
+
+    const KernelTable &GetAVX512Kernels()
+    {
+        static constexpr KernelTable table = MakeKernelTable<KernelsAVX512>();
+        return table;
+    }
+}
+
+#endif
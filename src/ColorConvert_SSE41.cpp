@@ -0,0 +1,126 @@
+#include "ColorConvertKernels.h"
+
+#ifdef COLOR_CONVERT_X86
+
+#include <smmintrin.h>
+#include <cstring>
+
+namespace ColorConvertDetail
+{
+    namespace
+    {
+        // 8 pixels per iteration
+        template <typename C>
+        struct Coefs128
+        {
+            __m128i yv = _mm_set1_epi32((C::crv << 16) | C::cy);                // R: y*cy + v*crv
+            __m128i yu = _mm_set1_epi32(((-C::cgu & 0xFFFF) << 16) | C::cy);    // G: y*cy - u*cgu
+            __m128i v0 = _mm_set1_epi32(-C::cgv & 0xFFFF);                   // G: -v*cgv
+            __m128i yub = _mm_set1_epi32((C::cbu << 16) | C::cy);               // B: y*cy + u*cbu
+            __m128i biasR = _mm_set1_epi32(C::biasR);
+            __m128i biasG = _mm_set1_epi32(C::biasG);
+            __m128i biasB = _mm_set1_epi32(C::biasB);
+            __m128i alpha = _mm_set1_epi16(255);
+        };
+
+        // Duplicate 4 chroma values held in the low 16 bits of each 32-bit lane
+        inline __m128i Dup16(__m128i c32) { return _mm_or_si128(c32, _mm_slli_epi32(c32, 16)); }
+
+        inline int32_t Load32(const uint8_t *p)
+        {
+            int32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        // y, u, v: 8 x int16 in [0, 255]; writes 32 bytes of RGBA
+        template <typename K>
+        inline void Convert8(const K &k, __m128i y, __m128i u, __m128i v, uint8_t *dst)
+        {
+            __m128i yvLo = _mm_unpacklo_epi16(y, v), yvHi = _mm_unpackhi_epi16(y, v);
+            __m128i yuLo = _mm_unpacklo_epi16(y, u), yuHi = _mm_unpackhi_epi16(y, u);
+            __m128i vLo = _mm_unpacklo_epi16(v, _mm_setzero_si128()), vHi = _mm_unpackhi_epi16(v, _mm_setzero_si128());
+
+            __m128i rLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yvLo, k.yv), k.biasR), kShift);
+            __m128i rHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yvHi, k.yv), k.biasR), kShift);
+            __m128i gLo = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(yuLo, k.yu), _mm_madd_epi16(vLo, k.v0)), k.biasG), kShift);
+            __m128i gHi = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(yuHi, k.yu), _mm_madd_epi16(vHi, k.v0)), k.biasG), kShift);
+            __m128i bLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yuLo, k.yub), k.biasB), kShift);
+            __m128i bHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yuHi, k.yub), k.biasB), kShift);
+
+            // Saturate to bytes: rg = R0..R7 G0..G7, ba = B0..B7 A0..A7
+            __m128i rg = _mm_packus_epi16(_mm_packs_epi32(rLo, rHi), _mm_packs_epi32(gLo, gHi));
+            __m128i ba = _mm_packus_epi16(_mm_packs_epi32(bLo, bHi), k.alpha);
+
+            __m128i rgI = _mm_unpacklo_epi8(rg, _mm_srli_si128(rg, 8));
+            __m128i baI = _mm_unpacklo_epi8(ba, _mm_srli_si128(ba, 8));
+            _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(rgI, baI));
+            _mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi16(rgI, baI));
+        }
+
+        template <typename C, bool NV12>
+        void ConvertRow(const Coefs128<C> &k, const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                        uint8_t *dst, int width)
+        {
+            int x = 0;
+            for (; x + 8 <= width; x += 8)
+            {
+                __m128i y16 = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(y + x)));
+                __m128i u16, v16;
+                if constexpr (NV12)
+                {
+                    // u|v<<16 per lane for 4 chroma pairs
+                    __m128i uv = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(u + x)));
+                    u16 = Dup16(_mm_and_si128(uv, _mm_set1_epi32(0xFFFF)));
+                    v16 = Dup16(_mm_srli_epi32(uv, 16));
+                }
+                else
+                {
+                    u16 = Dup16(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(Load32(u + x / 2))));
+                    v16 = Dup16(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(Load32(v + x / 2))));
+                }
+                Convert8(k, y16, u16, v16, dst + x * 4);
+            }
+            ConvertRowScalar<C>(y, u, v, NV12 ? 2 : 1, dst, x, width);
+        }
+    }
+
+    namespace
+    {
+        template <ColorMatrix M, ColorRange R>
+        struct KernelsSSE41
+        {
+            using C = Coefs<M, R>;
+
+            static void NV12(const uint8_t *y, int yStride, const uint8_t *uv, int uvStride,
+                             uint8_t *dst, int dstStride, int width, int height)
+            {
+                Coefs128<C> k;
+                for (int row = 0; row < height; row++)
+                {
+                    const uint8_t *uvRow = uv + (row >> 1) * uvStride;
+                    ConvertRow<C, true>(k, y + row * yStride, uvRow, uvRow + 1, dst + row * dstStride, width);
+                }
+            }
+
+            static void I420(const uint8_t *y, int yStride, const uint8_t *u, int uStride,
+                             const uint8_t *v, int vStride, uint8_t *dst, int dstStride, int width, int height)
+            {
+                Coefs128<C> k;
+                for (int row = 0; row < height; row++)
+                {
+                    ConvertRow<C, false>(k, y + row * yStride, u + (row >> 1) * uStride, v + (row >> 1) * vStride,
+                                         dst + row * dstStride, width);
+                }
+            }
+        };
+    }
+
+    const KernelTable &GetSSE41Kernels()
+    {
+        static constexpr KernelTable table = MakeKernelTable<KernelsSSE41>();
+        return table;
+    }
+}
+
+#endif
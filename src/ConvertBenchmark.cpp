@@ -0,0 +1,511 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "ColorConvert.h"
+#include "ColorConvertKernels.h"
+#include "ScaleConvert.h"
+
+// Micro-benchmark for the CPU NV12/I420 -> RGBA kernels. For every matrix and range the
+// scalar specialization is checked against a double-precision conversion from the matrix
+// definition and against the float shader matrix, and every SIMD kernel for bit-exact
+// output against it; throughput is compared with an unspecialized run-time-coefficient
+// loop. --scale benchmarks the
+// fused scale + convert + letterbox pass instead, checked against a double-precision
+// separable filter followed by the shader math.
+
+struct TestImage
+{
+    int width, height;
+    std::vector<uint8_t> y, uv, u, v;
+
+    TestImage(int w, int h) : width(w), height(h)
+    {
+        int cw = (w + 1) / 2, ch = (h + 1) / 2;
+        y.resize((size_t)w * h);
+        uv.resize((size_t)cw * 2 * ch);
+        u.resize((size_t)cw * ch);
+        v.resize((size_t)cw * ch);
+
+        // Deterministic pseudo-random content covering the full 8-bit range
+        uint32_t seed = 12345;
+        auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return (uint8_t)(seed >> 24); };
+        for (auto &p : y)
+            p = next();
+        for (size_t i = 0; i < u.size(); i++)
+        {
+            u[i] = next();
+            v[i] = next();
+            uv[i * 2] = u[i];
+            uv[i * 2 + 1] = v[i];
+        }
+    }
+
+    int ChromaWidth() const { return (width + 1) / 2; }
+};
+
+// Double-precision conversion straight from the matrix definition: Y' and Pb/Pr normalised
+// per the range, R = Y' + 2(1 - Kr) Pr, B = Y' + 2(1 - Kb) Pb, G = (Y' - Kr R - Kb B) / Kg.
+// y, u, v on the 8-bit scale.
+static void RefPixel(ColorSpec spec, double y, double u, double v, uint8_t *p)
+{
+    static const double kr[] = {0.299, 0.2126, 0.2627}, kb[] = {0.114, 0.0722, 0.0593};
+    double r = kr[(int)spec.matrix], b = kb[(int)spec.matrix], g = 1.0 - r - b;
+    bool full = spec.range == ColorRange::Full;
+    double yn = full ? y / 255.0 : (y - 16.0) / 219.0;
+    double pb = (u - 128.0) / (full ? 255.0 : 224.0);
+    double pr = (v - 128.0) / (full ? 255.0 : 224.0);
+    double rgb[3];
+    rgb[0] = yn + 2.0 * (1.0 - r) * pr;
+    rgb[2] = yn + 2.0 * (1.0 - b) * pb;
+    rgb[1] = (yn - r * rgb[0] - b * rgb[2]) / g;
+    for (int c = 0; c < 3; c++)
+        p[c] = (uint8_t)std::lround(std::clamp(rgb[c], 0.0, 1.0) * 255.0);
+    p[3] = 255;
+}
+
+static void DoubleReference(const TestImage &img, ColorSpec spec, std::vector<uint8_t> &out)
+{
+    out.resize((size_t)img.width * img.height * 4);
+    for (int row = 0; row < img.height; row++)
+    {
+        for (int x = 0; x < img.width; x++)
+        {
+            size_t c = (size_t)(row / 2) * img.ChromaWidth() + x / 2;
+            RefPixel(spec, img.y[(size_t)row * img.width + x], img.u[c], img.v[c],
+                     &out[((size_t)row * img.width + x) * 4]);
+        }
+    }
+}
+
+// Float copy of the D3D11ShaderRenderer pixel shader with its GetFloatMatrix constants,
+// UNORM in / UNORM out
+static void ShaderReference(const TestImage &img, ColorSpec spec, std::vector<uint8_t> &out)
+{
+    float m[3][4];
+    ColorConverter::GetFloatMatrix(spec, m);
+    out.resize((size_t)img.width * img.height * 4);
+    for (int row = 0; row < img.height; row++)
+    {
+        for (int x = 0; x < img.width; x++)
+        {
+            size_t c = (size_t)(row / 2) * img.ChromaWidth() + x / 2;
+            float yuv[3] = {img.y[(size_t)row * img.width + x] / 255.0f, img.u[c] / 255.0f, img.v[c] / 255.0f};
+            uint8_t *p = &out[((size_t)row * img.width + x) * 4];
+            for (int i = 0; i < 3; i++)
+            {
+                float v = m[i][0] * yuv[0] + m[i][1] * yuv[1] + m[i][2] * yuv[2] + m[i][3];
+                p[i] = (uint8_t)std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f);
+            }
+            p[3] = 255;
+        }
+    }
+}
+
+// The conversion as it would be written without specialization: Q13 coefficients picked
+// at run time and read through a pointer on every pixel. Same integer math, so its output
+// must equal the scalar specialization.
+struct GenericCoefs
+{
+    int cy, crv, cgu, cgv, cbu, biasR, biasG, biasB;
+};
+
+template <ColorMatrix M, ColorRange R>
+static GenericCoefs MakeGenericCoefs()
+{
+    using C = ColorConvertDetail::Coefs<M, R>;
+    return {C::cy, C::crv, C::cgu, C::cgv, C::cbu, C::biasR, C::biasG, C::biasB};
+}
+
+static GenericCoefs GetGenericCoefs(ColorSpec spec)
+{
+    static const GenericCoefs table[3][2] = {
+        {MakeGenericCoefs<ColorMatrix::BT601, ColorRange::Limited>(), MakeGenericCoefs<ColorMatrix::BT601, ColorRange::Full>()},
+        {MakeGenericCoefs<ColorMatrix::BT709, ColorRange::Limited>(), MakeGenericCoefs<ColorMatrix::BT709, ColorRange::Full>()},
+        {MakeGenericCoefs<ColorMatrix::BT2020, ColorRange::Limited>(), MakeGenericCoefs<ColorMatrix::BT2020, ColorRange::Full>()}};
+    return table[(int)spec.matrix][(int)spec.range];
+}
+
+static void GenericConvert(const GenericCoefs *k, bool nv12, const TestImage &img, std::vector<uint8_t> &out)
+{
+    using ColorConvertDetail::Clamp8;
+    using ColorConvertDetail::kShift;
+    int cw = img.ChromaWidth();
+    for (int row = 0; row < img.height; row++)
+    {
+        const uint8_t *y = img.y.data() + (size_t)row * img.width;
+        const uint8_t *u = nv12 ? img.uv.data() + (size_t)(row / 2) * cw * 2 : img.u.data() + (size_t)(row / 2) * cw;
+        const uint8_t *v = nv12 ? u + 1 : img.v.data() + (size_t)(row / 2) * cw;
+        int step = nv12 ? 2 : 1;
+        uint8_t *dst = out.data() + (size_t)row * img.width * 4;
+        for (int x = 0; x < img.width; x++)
+        {
+            int c = (x >> 1) * step;
+            int yy = y[x], uu = u[c], vv = v[c];
+            dst[x * 4] = Clamp8((k->cy * yy + k->crv * vv + k->biasR) >> kShift);
+            dst[x * 4 + 1] = Clamp8((k->cy * yy - k->cgu * uu - k->cgv * vv + k->biasG) >> kShift);
+            dst[x * 4 + 2] = Clamp8((k->cy * yy + k->cbu * uu + k->biasB) >> kShift);
+            dst[x * 4 + 3] = 255;
+        }
+    }
+}
+
+static int MaxAbsDiff(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b)
+{
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); i++)
+        diff = std::max(diff, std::abs((int)a[i] - (int)b[i]));
+    return diff;
+}
+
+static void Convert(ConvertKernel kernel, bool nv12, const TestImage &img, std::vector<uint8_t> &out,
+                    ColorSpec spec = ColorSpec())
+{
+    int cw = img.ChromaWidth();
+    if (nv12)
+        ColorConverter::GetNV12ToRGBA(kernel, spec)(img.y.data(), img.width, img.uv.data(), cw * 2,
+                                                    out.data(), img.width * 4, img.width, img.height);
+    else
+        ColorConverter::GetI420ToRGBA(kernel, spec)(img.y.data(), img.width, img.u.data(), cw, img.v.data(), cw,
+                                                    out.data(), img.width * 4, img.width, img.height);
+}
+
+static double RefKernel(ScaleFilter filter, double x)
+{
+    x = std::fabs(x);
+    if (filter == ScaleFilter::Bilinear)
+        return std::max(0.0, 1.0 - x);
+    if (x < 1.0)
+        return 1.5 * x * x * x - 2.5 * x * x + 1.0;
+    if (x < 2.0)
+        return -0.5 * x * x * x + 2.5 * x * x - 4.0 * x + 2.0;
+    return 0.0;
+}
+
+// Normalised weights of source samples [first, first + w.size()) for a sample at source
+// position pos; the kernel is stretched by the ratio when downscaling, edges are clamped
+static int RefWeights(ScaleFilter filter, int srcSize, double pos, double ratio, std::vector<double> &w)
+{
+    double stretch = std::max(1.0, ratio);
+    double radius = (filter == ScaleFilter::Bicubic ? 2.0 : 1.0) * stretch;
+    int lo = (int)std::floor(pos - radius), hi = (int)std::ceil(pos + radius);
+    int first = std::clamp(lo, 0, srcSize - 1);
+    w.assign(std::clamp(hi, 0, srcSize - 1) - first + 1, 0.0);
+    double sum = 0.0;
+    for (int i = lo; i <= hi; i++)
+    {
+        double k = RefKernel(filter, (i - pos) / stretch);
+        w[std::clamp(i, 0, srcSize - 1) - first] += k;
+        sum += k;
+    }
+    for (double &x : w)
+        x /= sum;
+    return first;
+}
+
+// Output sample d of an axis sits at source position (d + 0.5) * ratio + bias
+struct RefAxis
+{
+    double ratio, bias;
+};
+
+// Double-precision separable scale of one plane
+static std::vector<double> RefScalePlane(const uint8_t *src, int stride, int srcWidth, int srcHeight,
+                                         int outWidth, int outHeight, ScaleFilter filter, RefAxis ax, RefAxis ay)
+{
+    std::vector<double> tmp((size_t)srcWidth * outHeight), out((size_t)outWidth * outHeight), w;
+    for (int dy = 0; dy < outHeight; dy++)
+    {
+        int first = RefWeights(filter, srcHeight, (dy + 0.5) * ay.ratio + ay.bias, ay.ratio, w);
+        for (int x = 0; x < srcWidth; x++)
+        {
+            double sum = 0.0;
+            for (size_t k = 0; k < w.size(); k++)
+                sum += w[k] * src[(first + k) * stride + x];
+            tmp[(size_t)dy * srcWidth + x] = sum;
+        }
+    }
+    for (int dx = 0; dx < outWidth; dx++)
+    {
+        int first = RefWeights(filter, srcWidth, (dx + 0.5) * ax.ratio + ax.bias, ax.ratio, w);
+        for (int dy = 0; dy < outHeight; dy++)
+        {
+            double sum = 0.0;
+            for (size_t k = 0; k < w.size(); k++)
+                sum += w[k] * tmp[(size_t)dy * srcWidth + first + k];
+            out[(size_t)dy * outWidth + dx] = sum;
+        }
+    }
+    return out;
+}
+
+// Reference for ScaleConverter with left-sited, vertically centred chroma and the default
+// ColorSpec: scale the planes in double precision, chroma to 4:2:0 at the output size,
+// convert with RefPixel (nearest chroma upsampling) and letterbox
+static void ScaleReference(const TestImage &img, ScaleFilter filter, int dstWidth, int dstHeight,
+                           std::vector<uint8_t> &out)
+{
+    VideoRect rect = FitVideoRect(img.width, img.height, 0, 1, dstWidth, dstHeight);
+    int cw = img.ChromaWidth(), ch = (img.height + 1) / 2;
+    RefAxis lx{(double)img.width / rect.width, -0.5}, ly{(double)img.height / rect.height, -0.5};
+    // Output chroma sample j is centred on output pixels 2j and 2j + 1
+    RefAxis cx{lx.ratio, -0.25}, cy{ly.ratio, -0.5};
+    int ocw = (rect.width + 1) / 2, och = (rect.height + 1) / 2;
+    // Filter overshoot is clamped before the conversion, as in ScaleConverter
+    auto clamp8 = [](std::vector<double> plane) {
+        for (double &x : plane)
+            x = std::clamp(x, 0.0, 255.0);
+        return plane;
+    };
+    std::vector<double> y = clamp8(RefScalePlane(img.y.data(), img.width, img.width, img.height, rect.width,
+                                                 rect.height, filter, lx, ly));
+    std::vector<double> u = clamp8(RefScalePlane(img.u.data(), cw, cw, ch, ocw, och, filter, cx, cy));
+    std::vector<double> v = clamp8(RefScalePlane(img.v.data(), cw, cw, ch, ocw, och, filter, cx, cy));
+
+    out.assign((size_t)dstWidth * dstHeight * 4, 0);
+    for (size_t i = 3; i < out.size(); i += 4)
+        out[i] = 255;
+    for (int dy = 0; dy < rect.height; dy++)
+    {
+        for (int dx = 0; dx < rect.width; dx++)
+        {
+            size_t c = (size_t)(dy / 2) * ocw + dx / 2;
+            RefPixel(ColorSpec(), y[(size_t)dy * rect.width + dx], u[c], v[c],
+                     &out[(((size_t)rect.y + dy) * dstWidth + rect.x + dx) * 4]);
+        }
+    }
+}
+
+static void ScaleConvert(ScaleConverter &converter, bool nv12, const TestImage &img, std::vector<uint8_t> &out,
+                         int dstWidth, int dstHeight)
+{
+    ScaleConverter::Source src;
+    src.y = img.y.data();
+    src.yStride = img.width;
+    src.width = img.width;
+    src.height = img.height;
+    src.nv12 = nv12;
+    if (nv12)
+    {
+        src.u = img.uv.data();
+        src.uStride = img.ChromaWidth() * 2;
+    }
+    else
+    {
+        src.u = img.u.data();
+        src.v = img.v.data();
+        src.uStride = src.vStride = img.ChromaWidth();
+    }
+    converter.Convert(src, out.data(), dstWidth * 4, dstWidth, dstHeight);
+}
+
+template <typename Func>
+static double MsPerRun(double minSeconds, Func func)
+{
+    int iterations = 0;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0.0;
+    do
+    {
+        func();
+        iterations++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < minSeconds);
+    return seconds * 1000.0 / iterations;
+}
+
+// Fused scale + convert + letterbox: accuracy against the double reference, single-thread
+// and pooled timing, and the cost of only converting the source at full size for scale
+static bool RunScale(double minSeconds, int threads)
+{
+    struct Case
+    {
+        const char *name;
+        int srcWidth, srcHeight, dstWidth, dstHeight;
+    };
+    const Case cases[] = {{"4K->1080p", 3840, 2160, 1920, 1080},   {"1080p->720p", 1920, 1080, 1280, 720},
+                          {"1080p->thumb", 1920, 1080, 192, 108},  {"720p->1440p", 1280, 720, 2560, 1440},
+                          {"4:3->1080p", 1440, 1080, 1920, 1080},  {"odd", 1917, 1079, 1001, 701}};
+    const ScaleFilter filters[] = {ScaleFilter::Bilinear, ScaleFilter::Bicubic};
+
+    ScaleConverter::Config pooledConfig;
+    pooledConfig.threads = threads;
+    int poolThreads = ScaleConverter(pooledConfig).GetThreadCount();
+    std::printf("Fused scale + convert, %d threads; max diff vs double reference, must be <= 2\n", poolThreads);
+    std::printf("%-13s %-8s %4s %5s %10s %10s %8s %12s\n", "case", "filter", "fmt", "diff", "1 thr ms",
+                "pool ms", "speedup", "src conv ms");
+
+    bool ok = true;
+    for (const Case &c : cases)
+    {
+        TestImage img(c.srcWidth, c.srcHeight);
+        std::vector<uint8_t> full((size_t)c.srcWidth * c.srcHeight * 4);
+        double fullMs = MsPerRun(minSeconds, [&] { Convert(ColorConverter::GetBestKernel(), true, img, full); });
+
+        for (ScaleFilter filter : filters)
+        {
+            const char *filterName = filter == ScaleFilter::Bicubic ? "bicubic" : "bilinear";
+            std::vector<uint8_t> reference;
+            ScaleReference(img, filter, c.dstWidth, c.dstHeight, reference);
+
+            ScaleConverter::Config config;
+            config.filter = filter;
+            config.threads = 1;
+            pooledConfig.filter = filter;
+            ScaleConverter single(config), pooled(pooledConfig);
+
+            for (int f = 0; f < 2; f++)
+            {
+                bool nv12 = f == 0;
+                std::vector<uint8_t> out(reference.size()), pooledOut(reference.size());
+                ScaleConvert(single, nv12, img, out, c.dstWidth, c.dstHeight);
+                ScaleConvert(pooled, nv12, img, pooledOut, c.dstWidth, c.dstHeight);
+                int diff = MaxAbsDiff(out, reference);
+                bool exact = out == pooledOut;
+                ok = ok && diff <= 2 && exact;
+
+                if (!nv12)
+                {
+                    std::printf("%-13s %-8s %4s %5d %10s %10s %8s %12s%s\n", c.name, filterName, "I420", diff, "", "",
+                                "", "", exact ? "" : "  POOL MISMATCH");
+                    continue;
+                }
+                double singleMs = MsPerRun(minSeconds, [&] { ScaleConvert(single, true, img, out, c.dstWidth, c.dstHeight); });
+                double pooledMs = MsPerRun(minSeconds, [&] { ScaleConvert(pooled, true, img, pooledOut, c.dstWidth, c.dstHeight); });
+                std::printf("%-13s %-8s %4s %5d %10.3f %10.3f %7.2fx %12.3f%s\n", c.name, filterName, "NV12", diff,
+                            singleMs, pooledMs, singleMs / pooledMs, fullMs, exact ? "" : "  POOL MISMATCH");
+            }
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    double minSeconds = 0.5;
+    bool scale = false;
+    int threads = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--seconds" && i + 1 < argc)
+            minSeconds = std::atof(argv[++i]);
+        else if (arg == "--scale")
+            scale = true;
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (arg == "--help" || arg == "-h")
+        {
+            std::cout << "Usage: H264_Convert_Bench [--seconds S] [--scale [--threads N]]\n"
+                      << "  --seconds S: minimum run time per kernel (default 0.5)\n"
+                      << "  --scale: fused scale + convert + letterbox (4K->1080p, 1080p->thumbnail, ...)\n"
+                      << "  --threads N: threads of the pooled scaler run (default: hardware threads)" << std::endl;
+            return 0;
+        }
+    }
+
+    if (scale)
+        return RunScale(minSeconds, threads) ? 0 : 1;
+
+    struct Size
+    {
+        const char *name;
+        int width, height;
+    };
+    const Size sizes[] = {{"1080p", 1920, 1080}, {"4K", 3840, 2160}, {"odd", 1917, 1079}};
+    const ConvertKernel kernels[] = {ConvertKernel::Scalar, ConvertKernel::SSE41, ConvertKernel::AVX2, ConvertKernel::AVX512};
+
+    const ColorMatrix matrices[] = {ColorMatrix::BT601, ColorMatrix::BT709, ColorMatrix::BT2020};
+    const ColorRange ranges[] = {ColorRange::Limited, ColorRange::Full};
+
+    std::printf("Best kernel: %s\n", ColorConverter::GetKernelName(ColorConverter::GetBestKernel()));
+    bool ok = true;
+
+    // Accuracy of every specialization; diffs must be <= 1
+    std::printf("%-5s %-4s %-15s %8s %11s  %s\n", "size", "fmt", "variant", "vs ref", "vs shader", "SIMD vs scalar");
+    for (const Size &size : sizes)
+    {
+        TestImage img(size.width, size.height);
+        for (ColorMatrix matrix : matrices)
+        {
+            for (ColorRange range : ranges)
+            {
+                ColorSpec spec{matrix, range};
+                std::vector<uint8_t> reference, shader;
+                DoubleReference(img, spec, reference);
+                ShaderReference(img, spec, shader);
+                char variant[32];
+                std::snprintf(variant, sizeof(variant), "%s/%s", ColorConverter::GetMatrixName(matrix),
+                              ColorConverter::GetRangeName(range));
+
+                for (int f = 0; f < 2; f++)
+                {
+                    bool nv12 = f == 0;
+                    std::vector<uint8_t> scalarOut(reference.size()), out(reference.size());
+                    Convert(ConvertKernel::Scalar, nv12, img, scalarOut, spec);
+                    int refDiff = MaxAbsDiff(scalarOut, reference);
+                    int shaderDiff = MaxAbsDiff(scalarOut, shader);
+                    ok = ok && refDiff <= 1 && shaderDiff <= 1;
+
+                    std::string simd;
+                    for (ConvertKernel kernel : kernels)
+                    {
+                        if (kernel == ConvertKernel::Scalar || !ColorConverter::IsKernelSupported(kernel))
+                            continue;
+                        std::fill(out.begin(), out.end(), 0);
+                        Convert(kernel, nv12, img, out, spec);
+                        bool exact = out == scalarOut;
+                        ok = ok && exact;
+                        simd += std::string(ColorConverter::GetKernelName(kernel)) + (exact ? " ok  " : " MISMATCH  ");
+                    }
+                    std::printf("%-5s %-4s %-15s %8d %11d  %s\n", size.name, nv12 ? "NV12" : "I420", variant,
+                                refDiff, shaderDiff, simd.c_str());
+                }
+            }
+        }
+    }
+
+    // Throughput of the default specialization against the run-time-coefficient loop
+    ColorSpec spec;
+    GenericCoefs generic = GetGenericCoefs(spec);
+    std::printf("\nThroughput, %s/%s\n", ColorConverter::GetMatrixName(spec.matrix),
+                ColorConverter::GetRangeName(spec.range));
+    for (const Size &size : sizes)
+    {
+        TestImage img(size.width, size.height);
+        for (int f = 0; f < 2; f++)
+        {
+            bool nv12 = f == 0;
+            std::vector<uint8_t> scalarOut((size_t)size.width * size.height * 4), out(scalarOut.size());
+            Convert(ConvertKernel::Scalar, nv12, img, scalarOut, spec);
+            std::printf("%-5s %-4s (%dx%d)\n", size.name, nv12 ? "NV12" : "I420", size.width, size.height);
+
+            double genericMs = MsPerRun(minSeconds, [&] { GenericConvert(&generic, nv12, img, out); });
+            bool exact = out == scalarOut;
+            ok = ok && exact;
+            std::printf("  %-7s %7.3f Gpixel/s  %8.3f ms/frame  %s\n", "generic",
+                        (double)size.width * size.height / genericMs / 1e6, genericMs, exact ? "bit-exact" : "MISMATCH");
+
+            for (ConvertKernel kernel : kernels)
+            {
+                if (!ColorConverter::IsKernelSupported(kernel))
+                {
+                    std::printf("  %-7s not supported on this CPU\n", ColorConverter::GetKernelName(kernel));
+                    continue;
+                }
+                double ms = MsPerRun(minSeconds, [&] { Convert(kernel, nv12, img, out, spec); });
+                std::printf("  %-7s %7.3f Gpixel/s  %8.3f ms/frame  %5.2fx generic\n",
+                            ColorConverter::GetKernelName(kernel), (double)size.width * size.height / ms / 1e6, ms,
+                            genericMs / ms);
+            }
+        }
+    }
+
+    return ok ? 0 : 1;
+}
@@ -6,18 +6,38 @@
 #include <dxgi1_2.h>
 #include <wrl/client.h>
 
+#include "ColorConvert.h"
+#include "VideoRect.h"
+
 using Microsoft::WRL::ComPtr;
 
-// Base renderer interface
+// Base renderer interface. The swap chain matches the window's client area; each frame is
+// scaled into the largest rectangle of its display aspect ratio, with black bars around it.
 class ID3D11RendererBase
 {
 public:
     virtual ~ID3D11RendererBase() = default;
-    virtual bool Initialize(HWND hwnd, int videoWidth, int videoHeight) = 0;
-    virtual void RenderFrame(ID3D11Texture2D *nv12Texture, int textureIndex) = 0;
+    // Window client size in pixels
+    virtual bool Initialize(HWND hwnd, int windowWidth, int windowHeight) = 0;
+    // Resize the back buffers after the window changed size; ignored while minimized
+    virtual void Resize(int windowWidth, int windowHeight) = 0;
+    // videoWidth x videoHeight: the visible picture, without the decoder's texture padding;
+    // sarNum/sarDen: sample aspect ratio, 0 for square pixels; color: YCbCr matrix and range
+    virtual void RenderFrame(ID3D11Texture2D *nv12Texture, int textureIndex, int videoWidth, int videoHeight,
+                             int sarNum, int sarDen, const ColorSpec &color) = 0;
     virtual void Present() = 0;  // Separated Present call for ImGui overlay
     virtual ID3D11Device *GetDevice() = 0;
     virtual ID3D11DeviceContext *GetContext() = 0;
+
+    // Rebuilds of size- or format-dependent resources because the video changed mid-stream
+    // (first-frame setup and window resizes are not counted)
+    struct ReconfigStats
+    {
+        uint64_t count = 0;
+        double lastMs = 0.0; // render thread time of the last rebuild
+        double maxMs = 0.0;
+    };
+    virtual ReconfigStats GetReconfigStats() const = 0;
 };
 
 // Factory for creating renderers
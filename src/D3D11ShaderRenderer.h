@@ -2,6 +2,8 @@
 
 #include "D3D11Renderer.h"
 #include <d3dcompiler.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 // Vertex Shader (NV12 to RGB conversion)
@@ -30,23 +32,25 @@ Texture2D<float> texY : register(t0);
 Texture2D<float2> texUV : register(t1);
 SamplerState samplerState : register(s0);
 
+// ColorConverter::GetFloatMatrix rows for the stream's matrix and range
+cbuffer ColorConvert : register(b0) {
+    float4 rowR;
+    float4 rowG;
+    float4 rowB;
+};
+
 struct PS_INPUT {
     float4 pos : SV_POSITION;
     float2 tex : TEXCOORD0;
 };
 
 float4 main(PS_INPUT input) : SV_Target {
-    float y = texY.Sample(samplerState, input.tex);
-    float2 uv = texUV.Sample(samplerState, input.tex);
-    
-    float u = uv.x - 0.5f;
-    float v = uv.y - 0.5f;
-    y = 1.164f * (y - 0.0625f);
-    
-    float r = y + 1.596f * v;
-    float g = y - 0.391f * u - 0.813f * v;
-    float b = y + 2.018f * u;
-    
+    float3 yuv = float3(texY.Sample(samplerState, input.tex), texUV.Sample(samplerState, input.tex));
+
+    float r = dot(rowR.xyz, yuv) + rowR.w;
+    float g = dot(rowG.xyz, yuv) + rowG.w;
+    float b = dot(rowB.xyz, yuv) + rowB.w;
+
     return float4(r, g, b, 1.0f);
 }
 )";
@@ -69,17 +73,32 @@ private:
     ComPtr<ID3D11PixelShader> pixelShader;
     ComPtr<ID3D11InputLayout> inputLayout;
     ComPtr<ID3D11Buffer> vertexBuffer;
+    ComPtr<ID3D11Buffer> colorBuffer;
     ComPtr<ID3D11SamplerState> samplerState;
+    // Copy of the current decoder surface and its luma / chroma views; rebuilt only when the
+    // surfaces change size or format
     ComPtr<ID3D11Texture2D> stagingTexture;
+    ComPtr<ID3D11ShaderResourceView> lumaView;
+    ComPtr<ID3D11ShaderResourceView> chromaView;
+    D3D11_TEXTURE2D_DESC stagingDesc = {};
+    ReconfigStats reconfigStats;
 
+    // Back buffer size
     int width = 0;
     int height = 0;
+    // Visible part of the staging texture in the vertex buffer's texture coordinates
+    float texRight = 1.0f;
+    float texBottom = 1.0f;
+    VideoRect viewportRect;
+    // Matrix currently in colorBuffer
+    ColorSpec colorSpec;
+    bool colorValid = false;
 
 public:
-    bool Initialize(HWND hwnd, int videoWidth, int videoHeight) override
+    bool Initialize(HWND hwnd, int windowWidth, int windowHeight) override
     {
-        width = videoWidth;
-        height = videoHeight;
+        width = windowWidth;
+        height = windowHeight;
 
         // Create D3D11 Device
         if (!CreateDevice())
@@ -97,7 +116,27 @@ public:
         return true;
     }
 
-    void RenderFrame(ID3D11Texture2D *nv12Texture, int textureIndex) override
+    void Resize(int windowWidth, int windowHeight) override
+    {
+        if (windowWidth <= 0 || windowHeight <= 0 || (windowWidth == width && windowHeight == height))
+            return;
+
+        // Every reference to the old back buffers must be gone before ResizeBuffers
+        context->OMSetRenderTargets(0, nullptr, nullptr);
+        renderTargetView.Reset();
+        HRESULT hr = swapChain->ResizeBuffers(0, windowWidth, windowHeight, DXGI_FORMAT_UNKNOWN, 0);
+        if (FAILED(hr))
+        {
+            std::cerr << "ResizeBuffers failed: 0x" << std::hex << hr << std::dec << std::endl;
+            return;
+        }
+        width = windowWidth;
+        height = windowHeight;
+        CreateRenderTargetView();
+    }
+
+    void RenderFrame(ID3D11Texture2D *nv12Texture, int textureIndex, int videoWidth, int videoHeight,
+                     int sarNum, int sarDen, const ColorSpec &color) override
     {
         if (!nv12Texture)
             return;
@@ -105,14 +144,12 @@ public:
         // Copy to staging texture
         if (!PrepareTexture(nv12Texture, textureIndex))
             return;
-
-        // Create shader resource views
-        ComPtr<ID3D11ShaderResourceView> srvY, srvUV;
-        if (!CreateShaderResourceViews(srvY, srvUV))
-            return;
+        UpdateTexCoords(videoWidth, videoHeight);
+        UpdateColorMatrix(color);
+        viewportRect = FitVideoRect(videoWidth, videoHeight, sarNum, sarDen, width, height);
 
         // Render (don't present yet, ImGui will render on top)
-        RenderToScreen(srvY.Get(), srvUV.Get());
+        RenderToScreen(lumaView.Get(), chromaView.Get());
     }
 
     void Present() override
@@ -122,6 +159,7 @@ public:
 
     ID3D11Device *GetDevice() override { return device.Get(); }
     ID3D11DeviceContext *GetContext() override { return context.Get(); }
+    ReconfigStats GetReconfigStats() const override { return reconfigStats; }
 
 private:
     bool CreateDevice()
@@ -173,11 +211,19 @@ private:
             return false;
         }
 
-        // Create render target view
+        return CreateRenderTargetView();
+    }
+
+    bool CreateRenderTargetView()
+    {
         ComPtr<ID3D11Texture2D> backBuffer;
         swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), &backBuffer);
-        device->CreateRenderTargetView(backBuffer.Get(), nullptr, &renderTargetView);
-
+        HRESULT hr = device->CreateRenderTargetView(backBuffer.Get(), nullptr, &renderTargetView);
+        if (FAILED(hr))
+        {
+            std::cerr << "Failed to create render target view" << std::endl;
+            return false;
+        }
         return true;
     }
 
@@ -230,6 +276,18 @@ private:
         D3D11_SUBRESOURCE_DATA initData = {vertices};
         device->CreateBuffer(&bufferDesc, &initData, &vertexBuffer);
 
+        // Constant buffer of the colour matrix, filled on the first frame
+        D3D11_BUFFER_DESC colorDesc = {};
+        colorDesc.Usage = D3D11_USAGE_DEFAULT;
+        colorDesc.ByteWidth = sizeof(float) * 12;
+        colorDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        hr = device->CreateBuffer(&colorDesc, nullptr, &colorBuffer);
+        if (FAILED(hr))
+        {
+            std::cerr << "Failed to create color constant buffer" << std::endl;
+            return false;
+        }
+
         // Create sampler state
         D3D11_SAMPLER_DESC samplerDesc = {};
         samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
@@ -249,25 +307,20 @@ private:
         D3D11_TEXTURE2D_DESC srcDesc;
         nv12Texture->GetDesc(&srcDesc);
 
-        // Create staging texture if needed
-        if (!stagingTexture)
+        // First frame, or the decoder reallocated its surfaces for a new size / bit depth
+        if (!stagingTexture || srcDesc.Width != stagingDesc.Width || srcDesc.Height != stagingDesc.Height ||
+            srcDesc.Format != stagingDesc.Format)
         {
-            D3D11_TEXTURE2D_DESC texDesc = {};
-            texDesc.Width = srcDesc.Width;
-            texDesc.Height = srcDesc.Height;
-            texDesc.MipLevels = 1;
-            texDesc.ArraySize = 1;
-            texDesc.Format = srcDesc.Format;
-            texDesc.SampleDesc.Count = 1;
-            texDesc.Usage = D3D11_USAGE_DEFAULT;
-            texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-            texDesc.CPUAccessFlags = 0;
-
-            HRESULT hr = device->CreateTexture2D(&texDesc, nullptr, &stagingTexture);
-            if (FAILED(hr))
-            {
-                std::cerr << "Failed to create staging texture" << std::endl;
+            bool rebuild = stagingTexture.Get() != nullptr;
+            auto start = std::chrono::steady_clock::now();
+            if (!CreateStagingTexture(srcDesc))
                 return false;
+            if (rebuild)
+            {
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                reconfigStats.count++;
+                reconfigStats.lastMs = ms;
+                reconfigStats.maxMs = std::max(reconfigStats.maxMs, ms);
             }
         }
 
@@ -279,45 +332,126 @@ private:
         return true;
     }
 
-    bool CreateShaderResourceViews(ComPtr<ID3D11ShaderResourceView> &srvY,
-                                    ComPtr<ID3D11ShaderResourceView> &srvUV)
+    // Staging texture in the decoder's surface size and format, with views of its planes:
+    // 8-bit NV12 as R8 / R8G8, 10/16-bit P010 / P016 as R16 / R16G16 (UNORM, so the shader
+    // and its matrix are the same)
+    bool CreateStagingTexture(const D3D11_TEXTURE2D_DESC &srcDesc)
     {
+        lumaView.Reset();
+        chromaView.Reset();
+        stagingTexture.Reset();
+        stagingDesc = {};
+
+        DXGI_FORMAT lumaFormat, chromaFormat;
+        if (srcDesc.Format == DXGI_FORMAT_NV12)
+        {
+            lumaFormat = DXGI_FORMAT_R8_UNORM;
+            chromaFormat = DXGI_FORMAT_R8G8_UNORM;
+        }
+        else if (srcDesc.Format == DXGI_FORMAT_P010 || srcDesc.Format == DXGI_FORMAT_P016)
+        {
+            lumaFormat = DXGI_FORMAT_R16_UNORM;
+            chromaFormat = DXGI_FORMAT_R16G16_UNORM;
+        }
+        else
+        {
+            std::cerr << "Unsupported decoder surface format " << srcDesc.Format << std::endl;
+            return false;
+        }
+
+        D3D11_TEXTURE2D_DESC texDesc = {};
+        texDesc.Width = srcDesc.Width;
+        texDesc.Height = srcDesc.Height;
+        texDesc.MipLevels = 1;
+        texDesc.ArraySize = 1;
+        texDesc.Format = srcDesc.Format;
+        texDesc.SampleDesc.Count = 1;
+        texDesc.Usage = D3D11_USAGE_DEFAULT;
+        texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        texDesc.CPUAccessFlags = 0;
+
+        HRESULT hr = device->CreateTexture2D(&texDesc, nullptr, &stagingTexture);
+        if (FAILED(hr))
+        {
+            std::cerr << "Failed to create staging texture" << std::endl;
+            return false;
+        }
+
         D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-        srvDesc.Format = DXGI_FORMAT_R8_UNORM;
+        srvDesc.Format = lumaFormat;
         srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
         srvDesc.Texture2D.MipLevels = 1;
 
-        HRESULT hr = device->CreateShaderResourceView(stagingTexture.Get(), &srvDesc, &srvY);
+        hr = device->CreateShaderResourceView(stagingTexture.Get(), &srvDesc, &lumaView);
         if (FAILED(hr))
         {
             std::cerr << "Failed to create Y SRV" << std::endl;
+            stagingTexture.Reset();
             return false;
         }
 
-        srvDesc.Format = DXGI_FORMAT_R8G8_UNORM;
-        hr = device->CreateShaderResourceView(stagingTexture.Get(), &srvDesc, &srvUV);
+        srvDesc.Format = chromaFormat;
+        hr = device->CreateShaderResourceView(stagingTexture.Get(), &srvDesc, &chromaView);
         if (FAILED(hr))
         {
             std::cerr << "Failed to create UV SRV" << std::endl;
+            lumaView.Reset();
+            stagingTexture.Reset();
             return false;
         }
 
+        stagingDesc = texDesc;
         return true;
     }
 
+    // Decoder textures are padded to the macroblock size (1080 -> 1088 rows); sample only
+    // the visible picture
+    void UpdateTexCoords(int videoWidth, int videoHeight)
+    {
+        float right = videoWidth > 0 ? std::min(1.0f, (float)videoWidth / stagingDesc.Width) : 1.0f;
+        float bottom = videoHeight > 0 ? std::min(1.0f, (float)videoHeight / stagingDesc.Height) : 1.0f;
+        if (right == texRight && bottom == texBottom)
+            return;
+
+        Vertex vertices[] = {
+            {{-1.0f, 1.0f}, {0.0f, 0.0f}},
+            {{1.0f, 1.0f}, {right, 0.0f}},
+            {{-1.0f, -1.0f}, {0.0f, bottom}},
+            {{1.0f, -1.0f}, {right, bottom}},
+        };
+        context->UpdateSubresource(vertexBuffer.Get(), 0, nullptr, vertices, 0, 0);
+        texRight = right;
+        texBottom = bottom;
+    }
+
+    // Upload the matrix only when the stream's colour metadata changes
+    void UpdateColorMatrix(const ColorSpec &color)
+    {
+        if (colorValid && color == colorSpec)
+            return;
+
+        float rows[3][4];
+        ColorConverter::GetFloatMatrix(color, rows);
+        context->UpdateSubresource(colorBuffer.Get(), 0, nullptr, rows, 0, 0);
+        colorSpec = color;
+        colorValid = true;
+    }
+
     void RenderToScreen(ID3D11ShaderResourceView *srvY, ID3D11ShaderResourceView *srvUV)
     {
         // Set render target
         context->OMSetRenderTargets(1, renderTargetView.GetAddressOf(), nullptr);
 
-        // Clear
+        // Clear (the bars around the picture)
         float clearColor[] = {0.0f, 0.0f, 0.0f, 1.0f};
         context->ClearRenderTargetView(renderTargetView.Get(), clearColor);
 
-        // Set viewport
+        // Viewport: the letterboxed picture rectangle
         D3D11_VIEWPORT viewport = {};
-        viewport.Width = (float)width;
-        viewport.Height = (float)height;
+        viewport.TopLeftX = (float)viewportRect.x;
+        viewport.TopLeftY = (float)viewportRect.y;
+        viewport.Width = (float)viewportRect.width;
+        viewport.Height = (float)viewportRect.height;
         viewport.MinDepth = 0.0f;
         viewport.MaxDepth = 1.0f;
         context->RSSetViewports(1, &viewport);
@@ -335,6 +469,7 @@ private:
         ID3D11ShaderResourceView *srvs[] = {srvY, srvUV};
         context->PSSetShaderResources(0, 2, srvs);
         context->PSSetSamplers(0, 1, samplerState.GetAddressOf());
+        context->PSSetConstantBuffers(0, 1, colorBuffer.GetAddressOf());
 
         // Draw
         context->Draw(4, 0);
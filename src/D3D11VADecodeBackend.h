@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Windows.h>
+#include <d3d11.h>
+#include <d3d11_4.h>
+#include <wrl/client.h>
+#include <iostream>
+
+#include "DecodeBackend.h"
+
+extern "C"
+{
+#include <libavutil/hwcontext.h>
+#include <libavutil/hwcontext_d3d11va.h>
+}
+
+// D3D11VA decoding on an existing device (the renderer's) for zero-copy presentation
+class D3D11VADecodeBackend : public IDecodeBackend
+{
+private:
+    ID3D11Device *device = nullptr;
+    ID3D11DeviceContext *context = nullptr;
+    AVBufferRef *hwDeviceCtx = nullptr;
+    int extraFrames = 0;
+
+public:
+    // extraSurfaces: decoder surfaces held outside the codec (frame queue depth + the
+    // frame on screen), added to the D3D11VA texture array so decoding never starves
+    D3D11VADecodeBackend(ID3D11Device *dev, ID3D11DeviceContext *ctx, int extraSurfaces = 0)
+        : device(dev), context(ctx), extraFrames(extraSurfaces)
+    {
+    }
+
+    ~D3D11VADecodeBackend() override
+    {
+        if (hwDeviceCtx)
+            av_buffer_unref(&hwDeviceCtx);
+    }
+
+    const char *GetName() const override { return "d3d11va"; }
+
+    bool ConfigureCodec(AVCodecContext *codecCtx) override
+    {
+        if (!hwDeviceCtx && !CreateDeviceContext())
+            return false;
+
+        codecCtx->hw_device_ctx = av_buffer_ref(hwDeviceCtx);
+        codecCtx->extra_hw_frames = extraFrames;
+        return true;
+    }
+
+private:
+    bool CreateDeviceContext()
+    {
+        // The renderer and the decode thread share the immediate context
+        Microsoft::WRL::ComPtr<ID3D11Multithread> multithread;
+        if (SUCCEEDED(context->QueryInterface(IID_PPV_ARGS(&multithread))))
+            multithread->SetMultithreadProtected(TRUE);
+
+        // Create D3D11VA hardware device context
+        AVBufferRef *deviceRef = av_hwdevice_ctx_alloc(AV_HWDEVICE_TYPE_D3D11VA);
+        AVHWDeviceContext *deviceCtx = (AVHWDeviceContext *)deviceRef->data;
+        AVD3D11VADeviceContext *d3d11DeviceCtx = (AVD3D11VADeviceContext *)deviceCtx->hwctx;
+
+        // Use the same D3D11 device as renderer for zero-copy
+        d3d11DeviceCtx->device = device;
+        d3d11DeviceCtx->device->AddRef();
+        d3d11DeviceCtx->device_context = context;
+        d3d11DeviceCtx->device_context->AddRef();
+
+        if (av_hwdevice_ctx_init(deviceRef) < 0)
+        {
+            std::cerr << "Failed to create D3D11VA device" << std::endl;
+            av_buffer_unref(&deviceRef);
+            return false;
+        }
+
+        hwDeviceCtx = deviceRef;
+        return true;
+    }
+};
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "D3D11Renderer.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <unordered_map>
 
@@ -15,21 +17,35 @@ private:
 
     ComPtr<ID3D11VideoDevice> videoDevice;
     ComPtr<ID3D11VideoContext> videoContext;
+    ComPtr<ID3D11VideoContext1> videoContext1; // DXGI colour spaces (BT.2020), Windows 10+
     ComPtr<ID3D11VideoProcessor> videoProcessor;
     ComPtr<ID3D11VideoProcessorEnumerator> videoProcessorEnum;
     ComPtr<ID3D11VideoProcessorOutputView> outputView;
 
-    // Input view cache for performance
+    // Input view cache for performance, per array slice of inputViewTexture (the decoder's
+    // surface array; it changes when the decoder reallocates it, or per frame for copies)
     std::unordered_map<int, ComPtr<ID3D11VideoProcessorInputView>> inputViewCache;
+    ID3D11Texture2D *inputViewTexture = nullptr;
+    DXGI_FORMAT inputFormat = DXGI_FORMAT_UNKNOWN;
 
+    // Back buffer size
     int width = 0;
     int height = 0;
+    // Input size the video processor was created for
+    int processorWidth = 0;
+    int processorHeight = 0;
+    DXGI_FORMAT processorFormat = DXGI_FORMAT_UNKNOWN;
+    // Processor rebuilds for a new video size or surface format (not window resizes)
+    ReconfigStats reconfigStats;
+    // Input colour space set on the current processor
+    ColorSpec streamColor;
+    bool streamColorValid = false;
 
 public:
-    bool Initialize(HWND hwnd, int videoWidth, int videoHeight) override
+    bool Initialize(HWND hwnd, int windowWidth, int windowHeight) override
     {
-        width = videoWidth;
-        height = videoHeight;
+        width = windowWidth;
+        height = windowHeight;
 
         // Create D3D11 Device
         if (!CreateDevice())
@@ -39,19 +55,70 @@ public:
         if (!CreateSwapChain(hwnd))
             return false;
 
-        // Initialize video processor
-        if (!InitializeVideoProcessor())
+        // Get video device and context; the processor itself needs the video size and is
+        // created with the first frame
+        if (!InitializeVideoDevice())
             return false;
 
         std::cout << "Initialized Hardware Video Processor for YUV to RGB conversion" << std::endl;
         return true;
     }
 
-    void RenderFrame(ID3D11Texture2D *nv12Texture, int textureIndex) override
+    void Resize(int windowWidth, int windowHeight) override
+    {
+        if (windowWidth <= 0 || windowHeight <= 0 || (windowWidth == width && windowHeight == height))
+            return;
+
+        // Every reference to the old back buffers must be gone before ResizeBuffers. The
+        // processor's output size changes too: recreate it with the next frame.
+        context->OMSetRenderTargets(0, nullptr, nullptr);
+        renderTargetView.Reset();
+        ReleaseVideoProcessor();
+        HRESULT hr = swapChain->ResizeBuffers(0, windowWidth, windowHeight, DXGI_FORMAT_UNKNOWN, 0);
+        if (FAILED(hr))
+        {
+            std::cerr << "ResizeBuffers failed: 0x" << std::hex << hr << std::dec << std::endl;
+            return;
+        }
+        width = windowWidth;
+        height = windowHeight;
+        CreateRenderTargetView();
+    }
+
+    void RenderFrame(ID3D11Texture2D *nv12Texture, int textureIndex, int videoWidth, int videoHeight,
+                     int sarNum, int sarDen, const ColorSpec &color) override
     {
         if (!nv12Texture)
             return;
 
+        // Views of another texture are stale: the decoder reallocated its surfaces
+        if (nv12Texture != inputViewTexture)
+        {
+            inputViewCache.clear();
+            D3D11_TEXTURE2D_DESC desc;
+            nv12Texture->GetDesc(&desc);
+            inputViewTexture = nv12Texture;
+            inputFormat = desc.Format;
+        }
+
+        if (!videoProcessor || videoWidth != processorWidth || videoHeight != processorHeight ||
+            inputFormat != processorFormat)
+        {
+            bool rebuild = videoProcessor.Get() != nullptr;
+            auto start = std::chrono::steady_clock::now();
+            if (!CreateVideoProcessor(videoWidth, videoHeight))
+                return;
+            if (rebuild)
+            {
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                reconfigStats.count++;
+                reconfigStats.lastMs = ms;
+                reconfigStats.maxMs = std::max(reconfigStats.maxMs, ms);
+            }
+        }
+        if (!streamColorValid || color != streamColor)
+            SetStreamColorSpace(color);
+
         // Get or create cached input view
         auto it = inputViewCache.find(textureIndex);
         if (it == inputViewCache.end())
@@ -64,7 +131,8 @@ public:
         }
 
         // Process to back buffer (don't present yet, ImGui will render on top)
-        ProcessVideoFrame(inputViewCache[textureIndex].Get());
+        ProcessVideoFrame(inputViewCache[textureIndex].Get(),
+                          FitVideoRect(videoWidth, videoHeight, sarNum, sarDen, width, height));
     }
 
     void Present() override
@@ -74,6 +142,7 @@ public:
 
     ID3D11Device *GetDevice() override { return device.Get(); }
     ID3D11DeviceContext *GetContext() override { return context.Get(); }
+    ReconfigStats GetReconfigStats() const override { return reconfigStats; }
 
 private:
     bool CreateDevice()
@@ -125,15 +194,23 @@ private:
             return false;
         }
 
-        // Create render target view
+        return CreateRenderTargetView();
+    }
+
+    bool CreateRenderTargetView()
+    {
         ComPtr<ID3D11Texture2D> backBuffer;
         swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), &backBuffer);
-        device->CreateRenderTargetView(backBuffer.Get(), nullptr, &renderTargetView);
-
+        HRESULT hr = device->CreateRenderTargetView(backBuffer.Get(), nullptr, &renderTargetView);
+        if (FAILED(hr))
+        {
+            std::cerr << "Failed to create render target view" << std::endl;
+            return false;
+        }
         return true;
     }
 
-    bool InitializeVideoProcessor()
+    bool InitializeVideoDevice()
     {
         // Get video device and context
         HRESULT hr = device.As(&videoDevice);
@@ -150,22 +227,53 @@ private:
             return false;
         }
 
+        // Optional: without it BT.2020 input is processed as BT.709
+        context.As(&videoContext1);
+        return true;
+    }
+
+    void ReleaseVideoProcessor()
+    {
+        inputViewCache.clear();
+        outputView.Reset();
+        videoProcessor.Reset();
+        videoProcessorEnum.Reset();
+        processorWidth = 0;
+        processorHeight = 0;
+        processorFormat = DXGI_FORMAT_UNKNOWN;
+        streamColorValid = false;
+    }
+
+    // Processor scaling videoWidth x videoHeight input to the back buffer
+    bool CreateVideoProcessor(int videoWidth, int videoHeight)
+    {
+        ReleaseVideoProcessor();
+
         // Create video processor enumerator
         D3D11_VIDEO_PROCESSOR_CONTENT_DESC contentDesc = {};
         contentDesc.InputFrameFormat = D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE;
-        contentDesc.InputWidth = width;
-        contentDesc.InputHeight = height;
+        contentDesc.InputWidth = videoWidth;
+        contentDesc.InputHeight = videoHeight;
         contentDesc.OutputWidth = width;
         contentDesc.OutputHeight = height;
         contentDesc.Usage = D3D11_VIDEO_USAGE_PLAYBACK_NORMAL;
 
-        hr = videoDevice->CreateVideoProcessorEnumerator(&contentDesc, &videoProcessorEnum);
+        HRESULT hr = videoDevice->CreateVideoProcessorEnumerator(&contentDesc, &videoProcessorEnum);
         if (FAILED(hr))
         {
             std::cerr << "Failed to create video processor enumerator" << std::endl;
             return false;
         }
 
+        // E.g. P010 after a switch to 10-bit on a driver that only converts NV12
+        UINT formatFlags = 0;
+        if (FAILED(videoProcessorEnum->CheckVideoProcessorFormat(inputFormat, &formatFlags)) ||
+            !(formatFlags & D3D11_VIDEO_PROCESSOR_FORMAT_SUPPORT_INPUT))
+        {
+            std::cerr << "Video processor does not accept surface format " << inputFormat << std::endl;
+            return false;
+        }
+
         // Create video processor
         hr = videoDevice->CreateVideoProcessor(videoProcessorEnum.Get(), 0, &videoProcessor);
         if (FAILED(hr))
@@ -190,9 +298,61 @@ private:
             return false;
         }
 
+        // Black bars outside the destination rectangle
+        D3D11_VIDEO_COLOR background = {};
+        background.RGBA.A = 1.0f;
+        videoContext->VideoProcessorSetOutputBackgroundColor(videoProcessor.Get(), FALSE, &background);
+
+        // Full-range sRGB back buffer
+        if (videoContext1)
+        {
+            videoContext1->VideoProcessorSetOutputColorSpace1(videoProcessor.Get(), DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709);
+        }
+        else
+        {
+            D3D11_VIDEO_PROCESSOR_COLOR_SPACE outputSpace = {};
+            outputSpace.RGB_Range = 0; // 0-255
+            videoContext->VideoProcessorSetOutputColorSpace(videoProcessor.Get(), &outputSpace);
+        }
+
+        processorWidth = videoWidth;
+        processorHeight = videoHeight;
+        processorFormat = inputFormat;
         return true;
     }
 
+    // YCbCr matrix and range of the input, from the frame's metadata
+    void SetStreamColorSpace(const ColorSpec &color)
+    {
+        bool full = color.range == ColorRange::Full;
+        if (videoContext1)
+        {
+            DXGI_COLOR_SPACE_TYPE space;
+            switch (color.matrix)
+            {
+            case ColorMatrix::BT2020:
+                space = full ? DXGI_COLOR_SPACE_YCBCR_FULL_G22_LEFT_P2020 : DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P2020;
+                break;
+            case ColorMatrix::BT709:
+                space = full ? DXGI_COLOR_SPACE_YCBCR_FULL_G22_LEFT_P709 : DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P709;
+                break;
+            default:
+                space = full ? DXGI_COLOR_SPACE_YCBCR_FULL_G22_NONE_P709_X601 : DXGI_COLOR_SPACE_YCBCR_STUDIO_G22_LEFT_P601;
+                break;
+            }
+            videoContext1->VideoProcessorSetStreamColorSpace1(videoProcessor.Get(), 0, space);
+        }
+        else
+        {
+            D3D11_VIDEO_PROCESSOR_COLOR_SPACE space = {};
+            space.YCbCr_Matrix = color.matrix == ColorMatrix::BT601 ? 0 : 1; // 1: BT.709
+            space.Nominal_Range = full ? D3D11_VIDEO_PROCESSOR_NOMINAL_RANGE_0_255 : D3D11_VIDEO_PROCESSOR_NOMINAL_RANGE_16_235;
+            videoContext->VideoProcessorSetStreamColorSpace(videoProcessor.Get(), 0, &space);
+        }
+        streamColor = color;
+        streamColorValid = true;
+    }
+
     bool CreateInputView(ID3D11Texture2D *nv12Texture, int textureIndex,
                          ComPtr<ID3D11VideoProcessorInputView> &inputView)
     {
@@ -213,8 +373,14 @@ private:
         return true;
     }
 
-    void ProcessVideoFrame(ID3D11VideoProcessorInputView *inputView)
+    void ProcessVideoFrame(ID3D11VideoProcessorInputView *inputView, const VideoRect &dest)
     {
+        // Visible picture (the decoder texture is padded) into the letterboxed rectangle
+        RECT sourceRect = {0, 0, processorWidth, processorHeight};
+        RECT destRect = {dest.x, dest.y, dest.x + dest.width, dest.y + dest.height};
+        videoContext->VideoProcessorSetStreamSourceRect(videoProcessor.Get(), 0, TRUE, &sourceRect);
+        videoContext->VideoProcessorSetStreamDestRect(videoProcessor.Get(), 0, TRUE, &destRect);
+
         // Setup stream
         D3D11_VIDEO_PROCESSOR_STREAM stream = {};
         stream.Enable = TRUE;
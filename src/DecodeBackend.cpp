@@ -0,0 +1,18 @@
+#include "DecodeBackend.h"
+#include "SoftwareDecodeBackend.h"
+#include "HwDeviceDecodeBackend.h"
+#include <cstring>
+
+IDecodeBackend *DecodeBackendFactory::Create(const char *name, int threads, const FramePool::Config *poolConfig)
+{
+    if (!name || std::strcmp(name, "sw") == 0 || std::strcmp(name, "software") == 0)
+        return new SoftwareDecodeBackend(threads, poolConfig);
+
+    AVHWDeviceType type = av_hwdevice_find_type_by_name(name);
+    if (type == AV_HWDEVICE_TYPE_NONE)
+    {
+        std::cerr << "Unknown decode backend: " << name << std::endl;
+        return nullptr;
+    }
+    return new HwDeviceDecodeBackend(type);
+}
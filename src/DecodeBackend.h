@@ -0,0 +1,31 @@
+#pragma once
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+#include "FramePool.h"
+
+// Decode backend interface: prepares a codec context for software or hardware decoding
+class IDecodeBackend
+{
+public:
+    virtual ~IDecodeBackend() = default;
+    virtual const char *GetName() const = 0;
+    // Called after codec parameters are applied and before avcodec_open2
+    virtual bool ConfigureCodec(AVCodecContext *codecCtx) = 0;
+    // Pool frame buffers are allocated from, or nullptr for the codec's default allocator
+    virtual FramePool *GetFramePool() const { return nullptr; }
+};
+
+// Factory for creating platform-neutral backends. Backends that need an existing device
+// (e.g. D3D11VADecodeBackend sharing the renderer device) are constructed directly.
+class DecodeBackendFactory
+{
+public:
+    // "sw"/"software" for multi-threaded libavcodec, otherwise an FFmpeg hwdevice type
+    // name ("d3d11va", "vaapi", "cuda", ...). threads and poolConfig are used by the
+    // software backend only; poolConfig enables the FramePool allocator.
+    static IDecodeBackend *Create(const char *name, int threads = 0, const FramePool::Config *poolConfig = nullptr);
+};
@@ -0,0 +1,756 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include "BenchFrameSink.h"
+#include "BenchStats.h"
+#include "DecoderCore.h"
+#include "MultiStreamDecoder.h"
+#include "PacketQueue.h"
+#include "ReadAheadIO.h"
+#include "RawFrameSink.h"
+#include "SegmentDecoder.h"
+#include "SharedFrameReader.h"
+#include "SharedFramePublisher.h"
+
+// Parse "1,4,16" or a single maximum N (expanded to 1, 2, 4, ... N)
+static std::vector<int> ParseStreamCounts(const std::string &arg)
+{
+    std::vector<int> counts;
+    if (arg.find(',') == std::string::npos)
+    {
+        int maxCount = std::atoi(arg.c_str());
+        for (int n = 1; n < maxCount; n *= 2)
+            counts.push_back(n);
+        if (maxCount > 0)
+            counts.push_back(maxCount);
+        return counts;
+    }
+
+    size_t pos = 0;
+    while (pos <= arg.size())
+    {
+        size_t comma = arg.find(',', pos);
+        if (comma == std::string::npos)
+            comma = arg.size();
+        int n = std::atoi(arg.substr(pos, comma - pos).c_str());
+        if (n > 0)
+            counts.push_back(n);
+        pos = comma + 1;
+    }
+    return counts;
+}
+
+// Decode the same file as N simultaneous streams on a shared worker pool, for each N
+static int RunMultiStream(const std::string &videoFile, const std::vector<int> &streamCounts, const std::string &backendName,
+                          int threads, int workers, const FramePool::Config *poolConfig)
+{
+    std::printf("File:    %s\n", videoFile.c_str());
+    std::printf("%8s %8s %10s %12s %12s %12s %12s %12s\n", "streams", "workers", "frames", "agg fps",
+                "min fps", "max fps", "decode ms", "sched ms");
+
+    bool software = backendName == "sw" || backendName == "software";
+    for (int count : streamCounts)
+    {
+        // Software streams each own a backend (and frame pool); hardware streams share one device
+        std::vector<IDecodeBackend *> backends;
+        MultiStreamDecoder *decoder = new MultiStreamDecoder(workers);
+        decoder->SetDiscardFrames(true);
+
+        bool ok = true;
+        for (int i = 0; i < count && ok; i++)
+        {
+            if (backends.empty() || software)
+            {
+                IDecodeBackend *backend = DecodeBackendFactory::Create(backendName.c_str(), threads, poolConfig);
+                if (!backend)
+                {
+                    ok = false;
+                    break;
+                }
+                backends.push_back(backend);
+            }
+            ok = decoder->AddStream(videoFile.c_str(), backends.back()) >= 0;
+        }
+
+        if (ok)
+        {
+            auto start = std::chrono::steady_clock::now();
+            decoder->Start();
+            decoder->WaitAll();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            uint64_t frames = 0;
+            double minFps = 0.0, maxFps = 0.0, decodeMs = 0.0, scheduleMs = 0.0;
+            for (int i = 0; i < decoder->GetStreamCount(); i++)
+            {
+                MultiStreamDecoder::StreamStats st = decoder->GetStreamStats(i);
+                frames += st.frames;
+                minFps = i == 0 || st.fps < minFps ? st.fps : minFps;
+                maxFps = st.fps > maxFps ? st.fps : maxFps;
+                decodeMs += st.avgDecodeMs / count;
+                scheduleMs += st.avgScheduleMs / count;
+            }
+            std::printf("%8d %8d %10llu %12.1f %12.1f %12.1f %12.2f %12.2f\n", count, decoder->GetWorkerCount(),
+                        (unsigned long long)frames, frames / seconds, minFps, maxFps, decodeMs, scheduleMs);
+        }
+        else
+        {
+            std::printf("%8d failed to open streams\n", count);
+        }
+
+        // Streams close their codecs before the backends go away
+        delete decoder;
+        for (IDecodeBackend *backend : backends)
+            delete backend;
+        if (!ok)
+            return -1;
+    }
+    return 0;
+}
+
+// Counts frames of a segmented decode; in display order mode it also checks the order
+class SegmentCountSink : public IFrameSink, public ISegmentFrameSink
+{
+public:
+    std::atomic<uint64_t> frames{0};
+    int64_t lastPts = AV_NOPTS_VALUE;
+    uint64_t outOfOrder = 0;
+
+    bool OnFrame(AVFrame *frame) override
+    {
+        int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+        if (pts != AV_NOPTS_VALUE && lastPts != AV_NOPTS_VALUE && pts <= lastPts)
+            outOfOrder++;
+        lastPts = pts != AV_NOPTS_VALUE ? pts : lastPts;
+        frames.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool OnSegmentFrame(int, AVFrame *) override
+    {
+        frames.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+// Whole-file decode on one codec context with libavcodec frame threading; frames/s
+static double FrameThreadedFps(const std::string &videoFile, const std::string &backendName, int threads,
+                               DecoderCore::InputMode inputMode, uint64_t &frames)
+{
+    IDecodeBackend *backend = DecodeBackendFactory::Create(backendName.c_str(), threads);
+    if (!backend)
+        return 0.0;
+
+    double fps = 0.0;
+    {
+        DecoderCore decoder;
+        decoder.SetInputMode(inputMode);
+        SegmentCountSink sink;
+        if (decoder.Open(videoFile.c_str(), backend))
+        {
+            auto start = std::chrono::steady_clock::now();
+            while (decoder.DecodeOneFrame(&sink))
+            {
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            frames = sink.frames;
+            fps = seconds > 0.0 ? frames / seconds : 0.0;
+        }
+    }
+    delete backend;
+    return fps;
+}
+
+// Segmented decoding with 1 ... N workers against frame threading with as many threads.
+// Every run must produce the frame count of the plain decode, in display order unless
+// unordered delivery was asked for.
+static int RunSegmentScaling(const std::string &videoFile, const std::vector<int> &threadCounts, const std::string &backendName,
+                             DecoderCore::InputMode inputMode, bool unordered, int segmentsPerWorker, bool indexSidecar,
+                             const FramePool::Config *poolConfig)
+{
+    bool software = backendName == "sw" || backendName == "software";
+    std::printf("File:    %s\n", videoFile.c_str());
+    std::printf("Output:  %s\n", unordered ? "unordered, segment-tagged" : "display order");
+    std::printf("%8s %9s %10s %14s %14s %9s %9s %10s %10s %10s\n", "threads", "segments", "frames", "frame-thr fps",
+                "segment fps", "speedup", "vs f-thr", "pre-roll", "buffered", "wait ms");
+
+    int result = 0;
+    double baseFps = 0.0;
+    for (int threads : threadCounts)
+    {
+        // Frame threading only exists in the software decoder
+        uint64_t referenceFrames = 0;
+        double frameThreadFps = software ? FrameThreadedFps(videoFile, backendName, threads, inputMode, referenceFrames) : 0.0;
+
+        SegmentDecoder::Config config;
+        config.workers = threads;
+        config.segmentsPerWorker = segmentsPerWorker;
+        config.backend = backendName;
+        config.poolConfig = poolConfig;
+        config.inputMode = inputMode;
+        config.indexSidecar = indexSidecar;
+        SegmentDecoder decoder(config);
+        SegmentCountSink sink;
+        bool ok = decoder.Open(videoFile.c_str()) && (unordered ? decoder.RunUnordered(&sink) : decoder.RunOrdered(&sink));
+        if (!ok)
+        {
+            std::printf("%8d segmented decode failed\n", threads);
+            return -1;
+        }
+
+        const SegmentDecoder::Stats &st = decoder.GetStats();
+        double fps = st.decodeSeconds > 0.0 ? sink.frames / st.decodeSeconds : 0.0;
+        baseFps = baseFps > 0.0 ? baseFps : fps;
+        std::printf("%8d %9zu %10llu %14.1f %14.1f %8.2fx %8.2fx %10llu %10zu %10.1f\n", st.workers, st.segments,
+                    (unsigned long long)sink.frames.load(), frameThreadFps, fps, baseFps > 0.0 ? fps / baseFps : 0.0,
+                    frameThreadFps > 0.0 ? fps / frameThreadFps : 0.0, (unsigned long long)st.preRollFrames,
+                    st.maxBufferedFrames, st.consumerWaitMs);
+
+        if (software && sink.frames != referenceFrames)
+        {
+            std::printf("FAIL: %llu frames, the plain decode has %llu\n", (unsigned long long)sink.frames.load(),
+                        (unsigned long long)referenceFrames);
+            result = 1;
+        }
+        if (sink.outOfOrder)
+        {
+            std::printf("FAIL: %llu frames out of display order\n", (unsigned long long)sink.outOfOrder);
+            result = 1;
+        }
+    }
+    return result;
+}
+
+// What one shared-ring reader process reports back to the benchmark
+struct RingReaderResult
+{
+    uint64_t frames = 0;
+    uint64_t lapped = 0;
+    uint64_t torn = 0;
+    uint64_t invalid = 0; // rewritten while being consumed
+    uint64_t bytes = 0;
+    double seconds = 0.0;
+    double p50Us = 0.0;
+    double p99Us = 0.0;
+    double maxUs = 0.0;
+};
+
+#ifndef _WIN32
+// Reader process: consume every frame in place (touch each cache line), then validate it.
+// Latency is publish to validated.
+static RingReaderResult RunRingReader(const std::string &name)
+{
+    RingReaderResult result;
+    SharedFrameReader reader;
+    if (!reader.Open(name.c_str(), 10000))
+        return result;
+
+    StageStats latency("ring");
+    SharedFrameReader::FrameView view;
+    volatile uint64_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (reader.Next(view, 5000))
+    {
+        uint64_t sum = 0;
+        for (int p = 0; p < view.planes; p++)
+        {
+            const uint8_t *plane = view.data[p];
+            size_t bytes = (p + 1 < view.planes ? view.data[p + 1] - plane : view.data[0] + view.dataBytes - plane);
+            for (size_t i = 0; i < bytes; i += 64)
+                sum += plane[i];
+        }
+        sink = sink + sum;
+        if (!reader.Validate(view))
+        {
+            result.invalid++;
+            continue;
+        }
+        latency.Add((SharedFrameReader::NowNs() - view.publishNs) / 1000.0);
+        result.bytes += view.dataBytes;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.frames = reader.GetStats().frames;
+    result.lapped = reader.GetStats().lapped;
+    result.torn = reader.GetStats().torn;
+    result.p50Us = latency.Percentile(50.0);
+    result.p99Us = latency.Percentile(99.0);
+    result.maxUs = latency.Percentile(100.0);
+    return result;
+}
+#endif
+
+// Publish the decode into a shared-memory ring read by N reader processes; per-reader
+// throughput, lost frames and publish-to-consumed latency
+static int RunSharedRing(const std::string &videoFile, int readers, int slots, double fps, const std::string &backendName,
+                         int threads, DecoderCore::InputMode inputMode)
+{
+#ifdef _WIN32
+    (void)videoFile, (void)readers, (void)slots, (void)fps, (void)backendName, (void)threads, (void)inputMode;
+    std::cerr << "Shared-memory frame rings are not supported on Windows" << std::endl;
+    return -1;
+#else
+    std::string name = "/h264ring-bench-" + std::to_string(getpid());
+
+    // Readers fork before the decoder starts any thread, then wait for the ring to appear
+    std::vector<pid_t> children;
+    std::vector<int> resultPipes;
+    for (int r = 0; r < readers; r++)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+            return -1;
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(fds[0]);
+            RingReaderResult result = RunRingReader(name);
+            ssize_t written = write(fds[1], &result, sizeof(result));
+            _exit(written == (ssize_t)sizeof(result) ? 0 : 1);
+        }
+        close(fds[1]);
+        if (pid < 0)
+        {
+            close(fds[0]);
+            break;
+        }
+        children.push_back(pid);
+        resultPipes.push_back(fds[0]);
+    }
+
+    IDecodeBackend *backend = DecodeBackendFactory::Create(backendName.c_str(), threads);
+    uint64_t published = 0;
+    double seconds = 0.0;
+    SharedFramePublisher::Stats publishStats;
+    if (backend)
+    {
+        DecoderCore decoder;
+        decoder.SetInputMode(inputMode);
+        if (decoder.Open(videoFile.c_str(), backend))
+        {
+            SharedFramePublisher::Config config;
+            config.name = name;
+            config.slots = slots;
+            config.timeBase = decoder.GetVideoStream()->time_base;
+            SharedFramePublisher publisher(config);
+
+            // Pacing, like a camera, when a rate is given; as fast as decoding otherwise
+            auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(fps > 0.0 ? 1.0 / fps : 0.0));
+            auto next = std::chrono::steady_clock::now();
+            auto start = next;
+            while (decoder.DecodeOneFrame(&publisher))
+            {
+                if (fps > 0.0)
+                {
+                    next += interval;
+                    std::this_thread::sleep_until(next);
+                }
+            }
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            publishStats = publisher.GetStats();
+            published = publishStats.frames;
+            publisher.Close();
+        }
+        decoder.Close();
+        delete backend;
+    }
+    // Without a published frame there is no ring: readers give up after their open timeout
+    std::printf("File:    %s\n", videoFile.c_str());
+    std::printf("Ring:    %s, %d slots, %llu frames published in %.3f s (%.1f frames/s), %.1f MB copied, %.3f ms per copy\n",
+                name.c_str(), slots, (unsigned long long)published, seconds, seconds > 0.0 ? published / seconds : 0.0,
+                publishStats.bytes / (1024.0 * 1024.0), published ? publishStats.copyMs / published : 0.0);
+    std::printf("%8s %10s %10s %8s %8s %12s %10s %10s %10s\n", "reader", "frames", "lapped", "torn", "invalid", "MB/s",
+                "p50 us", "p99 us", "max us");
+
+    int result = published > 0 ? 0 : -1;
+    for (size_t r = 0; r < children.size(); r++)
+    {
+        RingReaderResult rr;
+        ssize_t got = read(resultPipes[r], &rr, sizeof(rr));
+        close(resultPipes[r]);
+        int status = 0;
+        waitpid(children[r], &status, 0);
+        if (got != (ssize_t)sizeof(rr) || rr.frames == 0)
+        {
+            std::printf("%8zu failed\n", r);
+            result = 1;
+            continue;
+        }
+        std::printf("%8zu %10llu %10llu %8llu %8llu %12.1f %10.1f %10.1f %10.1f\n", r, (unsigned long long)rr.frames,
+                    (unsigned long long)rr.lapped, (unsigned long long)rr.torn, (unsigned long long)rr.invalid,
+                    rr.seconds > 0.0 ? rr.bytes / rr.seconds / (1024.0 * 1024.0) : 0.0, rr.p50Us, rr.p99Us, rr.maxUs);
+    }
+    return result;
+#endif
+}
+
+static void PrintUsage()
+{
+    std::cout << "Usage: H264_Decode_Bench <video_file> [--backend NAME] [--threads N] [--no-convert]\n"
+              << "                         [--pool] [--pool-cap MB] [--huge-pages] [--streams N|LIST] [--workers W]\n"
+              << "                         [--input auto|demux|es] [--param-cache] [--index-sidecar]\n"
+              << "                         [--telemetry] [--telemetry-dump FILE|unix:PATH] [--trace FILE]\n"
+              << "                         [--segments N|LIST] [--segments-per-worker K] [--unordered]\n"
+              << "                         [--output PATH] [--output-format y4m|native|i420|nv12]\n"
+              << "                         [--shm-readers N] [--shm-slots S] [--send-fps F]\n"
+              << "                         [--read-ahead MB] [--mmap-io] [--demux-queue N]\n"
+              << "  --backend NAME: sw (default), d3d11va, vaapi, cuda, ...\n"
+              << "  --threads N:  software decode threads (0 = auto, default)\n"
+              << "  --no-convert: skip the YUV->RGBA conversion stage\n"
+              << "  --pool:       software backend allocates frames from a preallocated FramePool\n"
+              << "  --pool-cap MB: hard cap on pool memory (implies --pool)\n"
+              << "  --huge-pages: back pool slabs with huge pages when available (implies --pool)\n"
+              << "  --streams N|LIST: decode the file as N simultaneous streams on a shared worker pool\n"
+              << "                for N = 1, 2, 4 ... N (or the given list, e.g. 1,16,64) and print aggregate frames/s\n"
+              << "  --workers W:  worker threads for --streams (0 = one per core, default);\n"
+              << "                software streams default to --threads 1\n"
+              << "  --input MODE: auto (default: mmap + parser for .h264/.264/.h265/.hevc), demux (avformat),\n"
+              << "                es (force the raw Annex-B reader)\n"
+              << "  --param-cache: reuse stream parameters from <file>.params instead of probing (written on first run)\n"
+              << "  --index-sidecar: --segments loads/stores the keyframe index in <file>.kfidx\n"
+              << "  --telemetry:  latency histograms of av_read_frame / send / receive\n"
+              << "  --telemetry-dump T: also write the JSON summary every second to a file or Unix socket\n"
+              << "  --trace FILE: also write a Chrome trace of every instrumented call\n"
+              << "  --segments N|LIST: split the file at keyframes and decode segments concurrently with\n"
+              << "                1, 2, 4 ... N workers (or the list), against frame threading with as many threads\n"
+              << "  --segments-per-worker K: segments planned per worker (default 4)\n"
+              << "  --unordered:  deliver segment-tagged frames as decoded instead of in display order\n"
+              << "  --output PATH: also write every frame to a file or pipe (decode + I/O throughput);\n"
+              << "                - writes to stdout and moves this report to stderr\n"
+              << "  --output-format F: y4m (default), native, i420, nv12\n"
+              << "  --shm-readers N: publish frames to a shared-memory ring read by N reader processes\n"
+              << "  --shm-slots S: ring slots (default 8)\n"
+              << "  --send-fps F: --shm-readers publish rate (default: as fast as decoding)\n"
+              << "  --read-ahead MB: demuxed files read through an I/O thread keeping MB ahead of the demuxer\n"
+              << "  --mmap-io:    read-ahead from a memory mapping of the file instead of read() into buffers\n"
+              << "  --demux-queue N: demux on a separate thread into a queue of N packets" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string videoFile;
+    std::string backendName = "sw";
+    int threads = 0;
+    bool convert = true;
+    bool usePool = false;
+    bool threadsSet = false;
+    std::string streamsArg;
+    int workers = 0;
+    DecoderCore::InputMode inputMode = DecoderCore::InputMode::Auto;
+    bool paramCache = false;
+    bool indexSidecar = false;
+    bool useTelemetry = false;
+    const char *telemetryDump = nullptr;
+    const char *tracePath = nullptr;
+    double sendFps = 0.0;
+    std::string segmentsArg;
+    int segmentsPerWorker = 4;
+    bool unordered = false;
+    const char *outputPath = nullptr;
+    RawFrameSink::Format outputFormat = RawFrameSink::Format::Y4M;
+    int shmReaders = 0;
+    int shmSlots = 8;
+    ReadAheadIO::Config readAheadConfig;
+    bool readAhead = false;
+    size_t demuxQueue = 0;
+    FramePool::Config poolConfig;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--backend" && i + 1 < argc)
+            backendName = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+            threadsSet = true;
+        }
+        else if (arg == "--no-convert")
+            convert = false;
+        else if (arg == "--pool")
+            usePool = true;
+        else if (arg == "--pool-cap" && i + 1 < argc)
+        {
+            poolConfig.maxBytes = (size_t)std::atoll(argv[++i]) * 1024 * 1024;
+            usePool = true;
+        }
+        else if (arg == "--huge-pages")
+        {
+            poolConfig.hugePages = true;
+            usePool = true;
+        }
+        else if (arg == "--streams" && i + 1 < argc)
+            streamsArg = argv[++i];
+        else if (arg == "--workers" && i + 1 < argc)
+            workers = std::atoi(argv[++i]);
+        else if (arg == "--input" && i + 1 < argc)
+        {
+            std::string mode = argv[++i];
+            if (mode == "demux")
+                inputMode = DecoderCore::InputMode::Demuxer;
+            else if (mode == "es")
+                inputMode = DecoderCore::InputMode::ElementaryStream;
+            else
+                inputMode = DecoderCore::InputMode::Auto;
+        }
+        else if (arg == "--send-fps" && i + 1 < argc)
+            sendFps = std::atof(argv[++i]);
+        else if (arg == "--param-cache")
+            paramCache = true;
+        else if (arg == "--index-sidecar")
+            indexSidecar = true;
+        else if (arg == "--telemetry")
+            useTelemetry = true;
+        else if (arg == "--telemetry-dump" && i + 1 < argc)
+        {
+            telemetryDump = argv[++i];
+            useTelemetry = true;
+        }
+        else if (arg == "--trace" && i + 1 < argc)
+        {
+            tracePath = argv[++i];
+            useTelemetry = true;
+        }
+        else if (arg == "--segments" && i + 1 < argc)
+            segmentsArg = argv[++i];
+        else if (arg == "--segments-per-worker" && i + 1 < argc)
+            segmentsPerWorker = std::atoi(argv[++i]);
+        else if (arg == "--unordered")
+            unordered = true;
+        else if (arg == "--shm-readers" && i + 1 < argc)
+            shmReaders = std::atoi(argv[++i]);
+        else if (arg == "--shm-slots" && i + 1 < argc)
+            shmSlots = std::atoi(argv[++i]);
+        else if (arg == "--read-ahead" && i + 1 < argc)
+        {
+            readAheadConfig.prefetchBytes = (size_t)(std::atof(argv[++i]) * 1024 * 1024);
+            readAhead = true;
+        }
+        else if (arg == "--mmap-io")
+        {
+            readAheadConfig.source = ReadAheadIO::Source::Mmap;
+            readAhead = true;
+        }
+        else if (arg == "--demux-queue" && i + 1 < argc)
+            demuxQueue = (size_t)std::atoi(argv[++i]);
+        else if (arg == "--output" && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (arg == "--output-format" && i + 1 < argc)
+        {
+            if (!RawFrameSink::ParseFormat(argv[++i], outputFormat))
+            {
+                std::cerr << "Unknown output format " << argv[i] << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--help" || arg == "-h")
+        {
+            PrintUsage();
+            return 0;
+        }
+        else if (arg[0] != '-')
+            videoFile = arg;
+    }
+
+    if (videoFile.empty())
+    {
+        PrintUsage();
+        return -1;
+    }
+
+    if (shmReaders > 0)
+        return RunSharedRing(videoFile, shmReaders, shmSlots, sendFps, backendName, threads, inputMode);
+
+    if (!segmentsArg.empty())
+    {
+        return RunSegmentScaling(videoFile, ParseStreamCounts(segmentsArg), backendName, inputMode, unordered,
+                                 segmentsPerWorker, indexSidecar, usePool ? &poolConfig : nullptr);
+    }
+
+    if (!streamsArg.empty())
+    {
+        // The worker pool provides the parallelism; per-codec threads would oversubscribe it
+        return RunMultiStream(videoFile, ParseStreamCounts(streamsArg), backendName, threadsSet ? threads : 1, workers,
+                              usePool ? &poolConfig : nullptr);
+    }
+
+    IDecodeBackend *backend = DecodeBackendFactory::Create(backendName.c_str(), threads, usePool ? &poolConfig : nullptr);
+    if (!backend)
+        return -1;
+
+    Telemetry::Config telemetryConfig;
+    if (tracePath)
+        telemetryConfig.traceCapacity = 1 << 22;
+    Telemetry telemetry(telemetryConfig);
+    if (useTelemetry && !telemetry.Start(telemetryDump))
+    {
+        delete backend;
+        return -1;
+    }
+
+    DecoderCore decoder;
+    decoder.SetInputMode(inputMode);
+    decoder.SetParamCache(paramCache);
+    decoder.SetReadAhead(readAhead ? &readAheadConfig : nullptr);
+    decoder.SetDemuxThread(demuxQueue);
+    decoder.SetTelemetry(useTelemetry ? &telemetry : nullptr);
+    if (!decoder.Open(videoFile.c_str(), backend))
+    {
+        delete backend;
+        return -1;
+    }
+
+    BenchFrameSink sink;
+    sink.convert = convert;
+    RawFrameSink output;
+    if (outputPath)
+    {
+        if (!output.Open(outputPath, outputFormat, decoder.GetVideoStream()->avg_frame_rate))
+        {
+            delete backend;
+            return -1;
+        }
+        sink.output = &output;
+    }
+    StageStats demuxStats("demux");
+    int64_t bytesRead = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    while (true)
+    {
+        {
+            ScopedStageTimer t(demuxStats);
+            if (!decoder.ReadPacket())
+                break;
+        }
+        bytesRead += decoder.GetPacket()->size;
+        sink.BeginDecode();
+        bool decoded = decoder.DecodePacket(&sink);
+        sink.EndDecode();
+        if (!decoded)
+            break;
+    }
+    // Flush frames held back for reordering / frame threading
+    sink.BeginDecode();
+    decoder.Drain(&sink);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Frames written to stdout must not be interleaved with the report
+    FILE *report = outputPath && std::strcmp(outputPath, "-") == 0 ? stderr : stdout;
+    std::fprintf(report, "File:    %s\n", videoFile.c_str());
+    std::fprintf(report, "Backend: %s\n", backend->GetName());
+    if (const AnnexBReader *reader = decoder.GetElementaryReader())
+    {
+        const AnnexBReader::Stats &rs = reader->GetStats();
+        std::fprintf(report, "Input:   elementary stream (mmap %.1f MB), %llu zero-copy / %llu copied packets\n",
+                    rs.mappedBytes / (1024.0 * 1024.0), (unsigned long long)rs.zeroCopyPackets,
+                    (unsigned long long)rs.copiedPackets);
+    }
+    else
+    {
+        std::fprintf(report, "Input:   avformat demuxer\n");
+    }
+    if (ReadAheadIO *readAhead = decoder.GetReadAhead())
+    {
+        ReadAheadIO::Stats io = readAhead->GetStats();
+        std::fprintf(report, "         read-ahead %.1f MB window: %llu storage reads, demuxer waited %.1f ms (max %.1f ms)\n",
+                    readAhead->GetConfig().prefetchBytes / (1024.0 * 1024.0), (unsigned long long)io.ioRequests,
+                    io.waitMs, io.maxWaitMs);
+    }
+    if (PacketQueue *queue = decoder.GetDemuxQueue())
+    {
+        PacketQueue::Stats ps = queue->GetStats();
+        std::fprintf(report, "         demux thread: decoder waited for packets %llu times / %.1f ms\n",
+                    (unsigned long long)ps.underruns, ps.underrunMs);
+    }
+    // Time to first frame, phase by phase, from the start of Open
+    const DecoderCore::StartupTimes &startup = decoder.GetStartupTimes();
+    std::fprintf(report, "Startup: open %.2f ms, probe %.2f ms%s, codec open %.2f ms, first packet %.2f ms, first frame %.2f ms\n",
+                startup.openMs, startup.probeMs, startup.paramCacheHit ? " (param cache hit)" : "", startup.codecOpenMs,
+                startup.firstPacketMs, startup.firstFrameMs);
+    std::fprintf(report, "Frames:  %lld in %.3f s (%llu packets)\n", (long long)sink.framesDecoded, seconds,
+                (unsigned long long)decoder.GetPacketsRead());
+    std::fprintf(report, "Rate:    %.1f frames/s, %.2f MB/s (compressed input)\n",
+                sink.framesDecoded / seconds, bytesRead / seconds / (1024.0 * 1024.0));
+    std::fprintf(report, "Stages:\n");
+    demuxStats.Print(report);
+    sink.decodeStats.Print(report);
+    if (convert)
+        sink.convertStats.Print(report);
+    if (outputPath)
+    {
+        sink.outputStats.Print(report);
+        const RawFrameSink::Stats &os = output.GetStats();
+        std::fprintf(report, "Output:  %s, %.1f MB at %.1f MB/s, %.1f write calls per frame, %llu frames repacked\n", outputPath,
+                    os.bytes / (1024.0 * 1024.0), os.bytes / seconds / (1024.0 * 1024.0),
+                    os.frames ? (double)os.writeCalls / os.frames : 0.0, (unsigned long long)os.repackedFrames);
+    }
+
+    if (FramePool *pool = backend->GetFramePool())
+    {
+        FramePool::Stats ps = pool->GetStats();
+        std::fprintf(report, "Frame pool: %zu KB/frame, %d preallocated, high water %d frames / %.1f MB%s\n",
+                    ps.bufferSize / 1024, ps.preallocated, ps.highWater, ps.bytesHighWater / (1024.0 * 1024.0),
+                    ps.hugePages ? ", huge pages" : "");
+        std::fprintf(report, "            %llu acquisitions, %llu slab allocations, %llu cap rejects\n",
+                    (unsigned long long)ps.acquisitions, (unsigned long long)ps.slabAllocations,
+                    (unsigned long long)ps.capRejects);
+        if (ps.relayouts > 0)
+            std::fprintf(report, "            %llu relayouts, %llu idle slabs reused\n", (unsigned long long)ps.relayouts,
+                        (unsigned long long)ps.slabsReused);
+    }
+
+    // Mid-stream switches: decode time of the first frame in each new format against the mean
+    const DecoderCore::FormatChangeStats &formats = decoder.GetFormatChangeStats();
+    if (formats.changes > 0)
+    {
+        const char *name = av_get_pix_fmt_name((AVPixelFormat)formats.format);
+        std::fprintf(report, "Formats: %llu changes, ending at %dx%d %s; decode stall last %.2f ms, max %.2f ms, mean %.2f ms "
+                    "(mean frame %.2f ms)\n",
+                    (unsigned long long)formats.changes, formats.width, formats.height, name ? name : "?",
+                    formats.lastStallMs, formats.maxStallMs,
+                    formats.changes ? formats.totalStallMs / formats.changes : 0.0, formats.meanFrameMs);
+    }
+
+    if (useTelemetry)
+    {
+        telemetry.Stop();
+        std::fprintf(report, "Telemetry (us):\n");
+        for (int stage = Telemetry::ReadPacket; stage <= Telemetry::ReceiveFrame; stage++)
+        {
+            Telemetry::Summary ts = telemetry.GetSummary((Telemetry::Stage)stage);
+            std::fprintf(report, "  %-13s n=%-7llu mean=%8.1f  p50=%8.1f  p90=%8.1f  p99=%8.1f  p99.9=%8.1f  max=%8.1f\n",
+                        Telemetry::StageName(stage), (unsigned long long)ts.count, ts.meanUs, ts.p50Us, ts.p90Us,
+                        ts.p99Us, ts.p999Us, ts.maxUs);
+        }
+        std::fprintf(report, "  %llu samples (%llu dropped)\n", (unsigned long long)telemetry.GetSampleCount(),
+                    (unsigned long long)telemetry.GetDroppedSamples());
+        if (tracePath && telemetry.WriteChromeTrace(tracePath))
+            std::fprintf(report, "  trace written to %s\n", tracePath);
+    }
+
+    decoder.Close();
+    delete backend;
+    return 0;
+}
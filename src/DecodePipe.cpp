@@ -0,0 +1,168 @@
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "DecoderCore.h"
+#include "RawFrameSink.h"
+#include "SharedFramePublisher.h"
+
+static void PrintUsage()
+{
+    std::cerr << "Usage: H264_Decode_Pipe <video_file> [-o PATH] [-f y4m|native|i420|nv12] [--backend NAME]\n"
+              << "                        [--threads N] [--input auto|demux|es] [--pool] [--shm NAME] [--shm-slots S]\n"
+              << "                        [--shm-remove-stale]\n"
+              << "  -o PATH:      output file or pipe, - for stdout (default)\n"
+              << "  -f FORMAT:    y4m (default), native (planes as decoded), i420, nv12\n"
+              << "  --backend NAME: sw (default), d3d11va, vaapi, cuda, ... (frames are downloaded)\n"
+              << "  --threads N:  software decode threads (0 = auto, default)\n"
+              << "  --input MODE: auto (default), demux, es\n"
+              << "  --pool:       software backend allocates frames from a FramePool\n"
+              << "  --shm NAME:   publish frames to the shared-memory ring /NAME instead of writing a stream\n"
+              << "  --shm-slots S: ring slots (default 8)\n"
+              << "  --shm-remove-stale: replace a ring /NAME left by a publisher that is no longer running\n"
+              << "Statistics go to stderr, e.g.: H264_Decode_Pipe in.mp4 | ffmpeg -i - out.mkv" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string videoFile;
+    std::string outputPath = "-";
+    std::string backendName = "sw";
+    int threads = 0;
+    bool usePool = false;
+    std::string shmName;
+    int shmSlots = 8;
+    bool shmRemoveStale = false;
+    RawFrameSink::Format format = RawFrameSink::Format::Y4M;
+    DecoderCore::InputMode inputMode = DecoderCore::InputMode::Auto;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (arg == "-f" && i + 1 < argc)
+        {
+            if (!RawFrameSink::ParseFormat(argv[++i], format))
+            {
+                std::cerr << "Unknown output format " << argv[i] << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--backend" && i + 1 < argc)
+            backendName = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (arg == "--input" && i + 1 < argc)
+        {
+            std::string mode = argv[++i];
+            if (mode == "demux")
+                inputMode = DecoderCore::InputMode::Demuxer;
+            else if (mode == "es")
+                inputMode = DecoderCore::InputMode::ElementaryStream;
+            else
+                inputMode = DecoderCore::InputMode::Auto;
+        }
+        else if (arg == "--pool")
+            usePool = true;
+        else if (arg == "--shm" && i + 1 < argc)
+            shmName = argv[++i];
+        else if (arg == "--shm-slots" && i + 1 < argc)
+            shmSlots = std::atoi(argv[++i]);
+        else if (arg == "--shm-remove-stale")
+            shmRemoveStale = true;
+        else if (arg == "--help" || arg == "-h")
+        {
+            PrintUsage();
+            return 0;
+        }
+        else if (arg[0] != '-' || arg == "-")
+            videoFile = arg;
+    }
+
+    if (videoFile.empty())
+    {
+        PrintUsage();
+        return -1;
+    }
+
+#ifndef _WIN32
+    // A reader that goes away shows up as EPIPE from the write instead of killing the process
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+    FramePool::Config poolConfig;
+    IDecodeBackend *backend = DecodeBackendFactory::Create(backendName.c_str(), threads, usePool ? &poolConfig : nullptr);
+    if (!backend)
+        return -1;
+
+    int result = 0;
+    {
+        DecoderCore decoder;
+        decoder.SetInputMode(inputMode);
+        if (!decoder.Open(videoFile.c_str(), backend))
+        {
+            delete backend;
+            return -1;
+        }
+
+        if (!shmName.empty())
+        {
+            SharedFramePublisher::Config config;
+            config.name = shmName[0] == '/' ? shmName : "/" + shmName;
+            config.slots = shmSlots;
+            config.removeStale = shmRemoveStale;
+            config.timeBase = decoder.GetVideoStream()->time_base;
+            SharedFramePublisher publisher(config);
+
+            auto start = std::chrono::steady_clock::now();
+            while (decoder.DecodeOneFrame(&publisher))
+            {
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            const SharedFramePublisher::Stats &ps = publisher.GetStats();
+            std::fprintf(stderr, "Frames:  %llu published to %s in %.3f s (%.1f frames/s), %.3f ms per copy, %llu too large\n",
+                         (unsigned long long)ps.frames, config.name.c_str(), seconds, seconds > 0.0 ? ps.frames / seconds : 0.0,
+                         ps.frames ? ps.copyMs / ps.frames : 0.0, (unsigned long long)ps.tooLarge);
+            if (decoder.GetState() != DecoderCore::State::Finished)
+                result = 1;
+        }
+        else
+        {
+            RawFrameSink sink;
+            if (!sink.Open(outputPath.c_str(), format, decoder.GetVideoStream()->avg_frame_rate))
+            {
+                decoder.Close();
+                delete backend;
+                return -1;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            while (decoder.DecodeOneFrame(&sink))
+            {
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            sink.Close();
+
+            const RawFrameSink::Stats &st = sink.GetStats();
+            std::fprintf(stderr, "Frames:  %llu decoded, %llu written in %.3f s (%.1f frames/s)\n",
+                         (unsigned long long)decoder.GetFramesDecoded(), (unsigned long long)st.frames, seconds,
+                         seconds > 0.0 ? st.frames / seconds : 0.0);
+            std::fprintf(stderr, "Output:  %.1f MB at %.1f MB/s, %llu write calls (%.1f per frame), %.1f%% of the time in write\n",
+                         st.bytes / (1024.0 * 1024.0), seconds > 0.0 ? st.bytes / seconds / (1024.0 * 1024.0) : 0.0,
+                         (unsigned long long)st.writeCalls, st.frames ? (double)st.writeCalls / st.frames : 0.0,
+                         seconds > 0.0 ? st.writeMs / (seconds * 10.0) : 0.0);
+            std::fprintf(stderr, "         %llu frames repacked, %llu downloaded from the GPU\n",
+                         (unsigned long long)st.repackedFrames, (unsigned long long)st.downloadedFrames);
+            // Stopped early: write error or the reader closed the pipe
+            if (decoder.GetState() != DecoderCore::State::Finished)
+                result = 1;
+        }
+        decoder.Close();
+    }
+    delete backend;
+    return result;
+}
@@ -0,0 +1,188 @@
+#include "DecodeThread.h"
+#include <algorithm>
+#include <iostream>
+
+void DecodeThread::Start()
+{
+    if (thread.joinable())
+        return;
+
+    stopRequested = false;
+    finished = false;
+
+    AVStream *stream = core->GetVideoStream();
+    AVRational frameRate = stream->avg_frame_rate;
+    if (frameRate.num <= 0 || frameRate.den <= 0)
+        frameRate = av_make_q(30, 1);
+    defaultDuration = av_rescale_q(1, av_inv_q(frameRate), stream->time_base);
+    nextPts = AV_NOPTS_VALUE;
+
+    passFromStart = !resumeAfterSeek;
+    resumeAfterSeek = false;
+    passStarted = false;
+    filling = loop && cache && passFromStart && !cache->IsComplete() && !cache->IsOverBudget();
+    replayIndex = 0;
+    loopOffset = 0;
+    replaying = false;
+
+    thread = std::thread(&DecodeThread::Run, this);
+}
+
+void DecodeThread::Stop()
+{
+    stopRequested = true;
+    queue.Close();
+    if (thread.joinable())
+        thread.join();
+    queue.Clear();
+}
+
+bool DecodeThread::Seek(int64_t pts)
+{
+    Stop();
+    bool seeked = core->Seek(pts);
+    queue.Reopen();
+    // A pass cut short by the seek cannot be replayed
+    if (cache)
+        cache->Abandon();
+    resumeAfterSeek = true;
+    Start();
+    return seeked;
+}
+
+bool DecodeThread::OnFrame(AVFrame *frame)
+{
+    if (core->IsLowLatency() && core->GetState() == DecoderCore::State::Decoding)
+    {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - core->GetPacketArrivalTime()).count();
+        latencyLastMs.store(ms, std::memory_order_relaxed);
+        latencyTotalMs.store(latencyTotalMs.load(std::memory_order_relaxed) + ms, std::memory_order_relaxed);
+        if (ms > latencyMaxMs.load(std::memory_order_relaxed))
+            latencyMaxMs.store(ms, std::memory_order_relaxed);
+        latencyFrames.fetch_add(1, std::memory_order_release);
+    }
+
+    // Take a reference so the frame (and its decoder surface) outlives the decode call
+    AVFrame *ref = av_frame_clone(frame);
+    if (!ref)
+    {
+        std::cerr << "Failed to reference decoded frame" << std::endl;
+        return false;
+    }
+
+    if (ref->best_effort_timestamp == AV_NOPTS_VALUE)
+        ref->best_effort_timestamp = ref->pts != AV_NOPTS_VALUE ? ref->pts : (nextPts != AV_NOPTS_VALUE ? nextPts : 0);
+    nextPts = ref->best_effort_timestamp + (ref->duration > 0 ? ref->duration : defaultDuration);
+
+    if (loop)
+    {
+        if (!passStarted && passFromStart)
+            clipStartPts = ref->best_effort_timestamp;
+        passStarted = true;
+        if (filling)
+            filling = cache->Add(ref);
+        if (ref->pts != AV_NOPTS_VALUE)
+            ref->pts += loopOffset;
+        ref->best_effort_timestamp += loopOffset;
+    }
+    return PushFrame(ref);
+}
+
+bool DecodeThread::PushFrame(AVFrame *frame)
+{
+    auto pushStart = std::chrono::steady_clock::now();
+    bool pushed = queue.Push(frame);
+    pushWaitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pushStart).count();
+    if (!pushed)
+    {
+        av_frame_free(&frame);
+        return false;
+    }
+    return !stopRequested.load(std::memory_order_relaxed);
+}
+
+bool DecodeThread::StartNextPass()
+{
+    // Nothing decoded in this pass, or the clip start is unknown: looping would spin
+    if (!passStarted || nextPts == AV_NOPTS_VALUE || clipStartPts == AV_NOPTS_VALUE || nextPts <= clipStartPts)
+        return false;
+
+    // The next pass starts where this one's last frame ends
+    int64_t period = nextPts - clipStartPts;
+    if (filling)
+        cache->Complete(period);
+    filling = false;
+    loopPeriod.store(period, std::memory_order_relaxed);
+    loopOffset += period;
+    loops.fetch_add(1, std::memory_order_relaxed);
+
+    nextPts = AV_NOPTS_VALUE;
+    passFromStart = true;
+    passStarted = false;
+    if (cache && cache->IsComplete())
+    {
+        replayIndex = 0;
+        replaying = true;
+        return true;
+    }
+    filling = cache && !cache->IsOverBudget();
+    return core->Rewind();
+}
+
+bool DecodeThread::ReplayFrame()
+{
+    AVFrame *frame = cache->CloneFrame(replayIndex, loopOffset);
+    if (!frame)
+    {
+        std::cerr << "Failed to reference cached frame" << std::endl;
+        return false;
+    }
+    if (++replayIndex == cache->GetFrameCount())
+    {
+        replayIndex = 0;
+        loopOffset += cache->GetPeriod();
+        loops.fetch_add(1, std::memory_order_relaxed);
+    }
+    return PushFrame(frame);
+}
+
+DecodeThread::LatencyStats DecodeThread::GetLatencyStats() const
+{
+    LatencyStats s;
+    s.frames = latencyFrames.load(std::memory_order_acquire);
+    s.lastMs = latencyLastMs.load(std::memory_order_relaxed);
+    s.avgMs = s.frames ? latencyTotalMs.load(std::memory_order_relaxed) / s.frames : 0.0;
+    s.maxMs = latencyMaxMs.load(std::memory_order_relaxed);
+    return s;
+}
+
+void DecodeThread::Run()
+{
+    if (Telemetry *telemetry = core->GetTelemetry())
+        telemetry->SetThreadName("decode");
+    while (!stopRequested.load(std::memory_order_relaxed))
+    {
+        if (discardChanged.exchange(false, std::memory_order_acquire))
+        {
+            core->SetSkipLoopFilter((AVDiscard)pendingSkipLoopFilter.load(std::memory_order_relaxed));
+            core->SetSkipFrame((AVDiscard)pendingSkipFrame.load(std::memory_order_relaxed));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        pushWaitMs = 0.0;
+        bool more = replaying ? ReplayFrame() : core->DecodeOneFrame(this);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        decodeBusyMs.store(decodeBusyMs.load(std::memory_order_relaxed) + std::max(ms - pushWaitMs, 0.0),
+                           std::memory_order_relaxed);
+        if (!more)
+        {
+            // Only a clean end of the clip loops, not a stop request
+            if (loop && !replaying && !stopRequested.load(std::memory_order_relaxed) &&
+                core->GetState() == DecoderCore::State::Finished && StartNextPass())
+                continue;
+            break;
+        }
+    }
+    finished.store(true, std::memory_order_release);
+}
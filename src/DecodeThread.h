@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "DecoderCore.h"
+#include "FrameCache.h"
+#include "FrameQueue.h"
+
+// Runs DecoderCore on its own thread and decodes ahead into a bounded FrameQueue.
+// The present thread only pops frames; demux/decode stalls never block it.
+// Every queued frame carries a best_effort_timestamp (synthesized from the previous
+// frame and the frame rate when the stream has none) for PresentationClock.
+// In loop mode EOF rewinds the core instead of ending, and every pass continues the
+// timestamps of the previous one, so the present side sees one gapless stream.
+class DecodeThread : public IFrameSink
+{
+public:
+    // Arrival-to-decoded latency of low-latency (live) inputs
+    struct LatencyStats
+    {
+        uint64_t frames = 0;
+        double lastMs = 0.0;
+        double avgMs = 0.0;
+        double maxMs = 0.0;
+    };
+
+private:
+    DecoderCore *core = nullptr;
+    FrameQueue queue;
+    std::thread thread;
+    std::atomic<bool> stopRequested{false};
+    std::atomic<bool> finished{false};
+    // Timestamp synthesis for frames without one (decode thread only)
+    int64_t nextPts = AV_NOPTS_VALUE;
+    int64_t defaultDuration = 0;
+    // Looping (decode thread only while running)
+    bool loop = false;
+    FrameCache *cache = nullptr;
+    bool resumeAfterSeek = false; // next Start continues from a seek, not from the first frame
+    bool passFromStart = false;   // the current pass began with the first frame of the clip
+    bool passStarted = false;     // the current pass delivered a frame
+    bool filling = false;         // the current pass goes into the cache
+    size_t replayIndex = 0;
+    int64_t clipStartPts = AV_NOPTS_VALUE; // first timestamp of the clip, before the offset
+    int64_t loopOffset = 0;                // added to the timestamps of the current pass
+    std::atomic<bool> replaying{false};
+    std::atomic<int64_t> loopPeriod{0};
+    std::atomic<uint64_t> loops{0};
+    // Written by the decode thread only, read by the present thread
+    std::atomic<uint64_t> latencyFrames{0};
+    std::atomic<double> latencyLastMs{0.0};
+    std::atomic<double> latencyTotalMs{0.0};
+    std::atomic<double> latencyMaxMs{0.0};
+    // Decode time without waiting for queue space (written by the decode thread only)
+    std::atomic<double> decodeBusyMs{0.0};
+    double pushWaitMs = 0.0;
+    // Requested by the present thread, applied by the decode thread between frames so
+    // codecCtx is only touched from one thread
+    std::atomic<bool> discardChanged{false};
+    std::atomic<int> pendingSkipFrame{AVDISCARD_DEFAULT};
+    std::atomic<int> pendingSkipLoopFilter{AVDISCARD_DEFAULT};
+
+public:
+    // The core must be opened before Start() and outlive this object
+    DecodeThread(DecoderCore *decoder, size_t queueDepth) : core(decoder), queue(queueDepth) {}
+    ~DecodeThread() override { Stop(); }
+
+    void Start();
+    void Stop();
+    // Present thread: stop decoding, drop the queued frames, reposition the core at pts
+    // (stream time base) and decode from there; also restarts a finished thread. The
+    // timestamps of a loop start over from the clip's.
+    bool Seek(int64_t pts);
+
+    // Before Start: rewind at EOF (DecoderCore::Rewind, the codec stays open) and go on
+    // decoding; needs a seekable file input
+    void SetLoop(bool enable) { loop = enable; }
+    // Before Start, with SetLoop: keep the first whole pass in cache; once complete, later
+    // passes replay it instead of decoding. The cache must outlive this object.
+    void SetFrameCache(FrameCache *frameCache) { cache = frameCache; }
+
+    // Present thread: next decoded frame (caller frees it with av_frame_free), or nullptr
+    AVFrame *PopFrame() { return queue.Pop(); }
+    // Present thread: next decoded frame without removing it, or nullptr
+    AVFrame *PeekFrame() const { return queue.Peek(); }
+    // Present thread: a frame was due but the queue was empty
+    void RecordUnderrun() { queue.RecordUnderrun(); }
+
+    // Decoding reached EOF/error; frames may still be queued
+    bool IsFinished() const { return finished.load(std::memory_order_acquire); }
+    // Decoding finished and every frame has been consumed
+    bool IsDrained() const { return IsFinished() && queue.Size() == 0; }
+
+    // Loop mode: passes completed, the length of one in the stream time base (0 until the
+    // first EOF), and whether frames now come from the cache
+    uint64_t GetLoops() const { return loops.load(std::memory_order_relaxed); }
+    int64_t GetLoopPeriod() const { return loopPeriod.load(std::memory_order_relaxed); }
+    bool IsReplayingCache() const { return replaying.load(std::memory_order_relaxed); }
+
+    FrameQueue::Stats GetQueueStats() const { return queue.GetStats(); }
+    LatencyStats GetLatencyStats() const;
+    // Cumulative time spent in demux/decode calls, excluding waits for a full queue; its
+    // growth over a window divided by the window is the decoder's load (1: saturated)
+    double GetDecodeBusyMs() const { return decodeBusyMs.load(std::memory_order_relaxed); }
+
+    // Any thread: DecoderCore::SetSkipFrame / SetSkipLoopFilter before the next packet
+    void SetDiscard(AVDiscard skipFrame, AVDiscard skipLoopFilter)
+    {
+        pendingSkipLoopFilter.store((int)skipLoopFilter, std::memory_order_relaxed);
+        pendingSkipFrame.store((int)skipFrame, std::memory_order_relaxed);
+        discardChanged.store(true, std::memory_order_release);
+    }
+
+private:
+    bool OnFrame(AVFrame *frame) override;
+    bool PushFrame(AVFrame *frame);
+    bool StartNextPass();
+    bool ReplayFrame();
+    void Run();
+};
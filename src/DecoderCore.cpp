@@ -0,0 +1,1051 @@
+#include "DecoderCore.h"
+#include "StreamParamCache.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+extern "C"
+{
+#include <libavutil/dict.h>
+#include <libavutil/hwcontext.h>
+}
+
+bool DecoderCore::IsLiveSource(const char *url)
+{
+    static const char *const kLiveProtocols[] = {"tcp:", "udp:", "rtp:", "srt:", "pipe:"};
+    for (const char *protocol : kLiveProtocols)
+    {
+        if (std::strncmp(url, protocol, std::strlen(protocol)) == 0)
+            return true;
+    }
+    if (std::strcmp(url, "-") == 0)
+        return true;
+#ifdef _WIN32
+    return std::strncmp(url, "\\\\.\\pipe\\", 9) == 0;
+#else
+    struct stat st;
+    return stat(url, &st) == 0 && S_ISFIFO(st.st_mode);
+#endif
+}
+
+bool DecoderCore::Open(const char *filename, IDecodeBackend *decodeBackend)
+{
+    Close();
+    backend = decodeBackend;
+    sourceName = filename;
+    openStart = std::chrono::steady_clock::now();
+
+    lowLatency = forceLowLatency || IsLiveSource(filename);
+    if (lowLatency)
+        return OpenLive(std::strcmp(filename, "-") == 0 ? "pipe:0" : filename);
+
+    AVCodecID elementaryCodec = AnnexBReader::ProbeExtension(filename);
+    if (inputMode == InputMode::ElementaryStream && elementaryCodec == AV_CODEC_ID_NONE)
+        elementaryCodec = AV_CODEC_ID_H264;
+    if (inputMode != InputMode::Demuxer && elementaryCodec != AV_CODEC_ID_NONE)
+        return OpenElementaryStream(filename, elementaryCodec);
+
+    // Local paths only; URLs keep their protocol's own I/O
+    if (useReadAhead && !std::strstr(filename, "://"))
+    {
+        readAhead = new ReadAheadIO(readAheadConfig);
+        formatCtx = avformat_alloc_context();
+        if (!formatCtx || !readAhead->Open(filename))
+            return false;
+        formatCtx->pb = readAhead->GetAVIOContext();
+        formatCtx->flags |= AVFMT_FLAG_CUSTOM_IO;
+    }
+
+    // Open input file
+    const AVInputFormat *inputFormat = forcedFormat ? av_find_input_format(forcedFormat) : nullptr;
+    if (avformat_open_input(&formatCtx, filename, inputFormat, nullptr) < 0)
+    {
+        std::cerr << "Could not open input file: " << filename << std::endl;
+        return false;
+    }
+    startup.openMs = MsSinceOpen();
+
+    if (!ProbeStreams(filename))
+        return false;
+    startup.probeMs = MsSinceOpen();
+
+    if (!FindVideoStream() || !OpenCodec())
+        return false;
+    StartDemuxThread();
+    return true;
+}
+
+void DecoderCore::SetSkipFrame(AVDiscard discard)
+{
+    // Leaving keyframe-only mid-stream: the frames in between were never decoded, so
+    // keep dropping until the next keyframe instead of decoding from missing references
+    if (skipFrame >= AVDISCARD_NONKEY && discard < AVDISCARD_NONKEY && codecCtx)
+        awaitKeyframe = true;
+    skipFrame = discard;
+    if (codecCtx)
+        codecCtx->skip_frame = discard;
+}
+
+void DecoderCore::SetSkipLoopFilter(AVDiscard discard)
+{
+    skipLoopFilter = discard;
+    if (codecCtx)
+        codecCtx->skip_loop_filter = discard;
+}
+
+bool DecoderCore::ProbeStreams(const char *filename)
+{
+    if (useParamCache)
+    {
+        StreamParamCache::Entry entry;
+        if (StreamParamCache::Load(filename, entry) && entry.streamIndex < (int)formatCtx->nb_streams &&
+            formatCtx->streams[entry.streamIndex]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+        {
+            StreamParamCache::Apply(entry, formatCtx->streams[entry.streamIndex]);
+            startup.paramCacheHit = true;
+            return true;
+        }
+    }
+
+    if (avformat_find_stream_info(formatCtx, nullptr) < 0)
+    {
+        std::cerr << "Could not find stream info" << std::endl;
+        return false;
+    }
+
+    if (useParamCache)
+    {
+        for (unsigned i = 0; i < formatCtx->nb_streams; i++)
+        {
+            if (formatCtx->streams[i]->codecpar->codec_type != AVMEDIA_TYPE_VIDEO)
+                continue;
+            // Read-only media still plays, it just probes every time
+            if (!StreamParamCache::Store(filename, formatCtx->streams[i]))
+                std::cerr << "Could not write " << StreamParamCache::SidecarPath(filename) << std::endl;
+            break;
+        }
+    }
+    return true;
+}
+
+double DecoderCore::MsSinceOpen() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - openStart).count();
+}
+
+bool DecoderCore::OpenLive(const char *url)
+{
+    AVDictionary *options = nullptr;
+    // Start from the first bytes instead of buffering seconds of input for probing
+    av_dict_set_int(&options, "probesize", 32, 0);
+    av_dict_set_int(&options, "analyzeduration", 0, 0);
+    av_dict_set(&options, "fflags", "nobuffer", 0);
+
+    const AVInputFormat *inputFormat = av_find_input_format(forcedFormat ? forcedFormat : "h264");
+    int ret = avformat_open_input(&formatCtx, url, inputFormat, &options);
+    av_dict_free(&options);
+    if (ret < 0)
+    {
+        std::cerr << "Could not open live input: " << url << std::endl;
+        return false;
+    }
+    startup.openMs = MsSinceOpen();
+
+    // Raw streams declare their stream in the header; only formats that create streams
+    // on the fly (e.g. MPEG-TS) need probing. With nobuffer the probed packets are
+    // dropped, so decoding then starts at the next keyframe.
+    if (formatCtx->nb_streams == 0 && avformat_find_stream_info(formatCtx, nullptr) < 0)
+    {
+        std::cerr << "Could not find stream info" << std::endl;
+        return false;
+    }
+    startup.probeMs = MsSinceOpen();
+
+    return FindVideoStream() && OpenCodec();
+}
+
+bool DecoderCore::FindVideoStream()
+{
+    // Find video stream
+    for (unsigned i = 0; i < formatCtx->nb_streams; i++)
+    {
+        if (formatCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+        {
+            videoStreamIndex = i;
+            break;
+        }
+    }
+
+    if (videoStreamIndex == -1)
+    {
+        std::cerr << "Could not find video stream" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool DecoderCore::OpenElementaryStream(const char *filename, AVCodecID codecId)
+{
+    elementaryReader = new AnnexBReader();
+    if (!elementaryReader->Open(filename, codecId))
+        return false;
+    startup.openMs = MsSinceOpen();
+
+    formatCtx = avformat_alloc_context();
+    AVStream *stream = formatCtx ? avformat_new_stream(formatCtx, nullptr) : nullptr;
+    if (!stream)
+    {
+        std::cerr << "Failed to allocate stream" << std::endl;
+        return false;
+    }
+    videoStreamIndex = stream->index;
+    // Same time base as libavformat's raw H.264/HEVC demuxers
+    stream->time_base = av_make_q(1, 1200000);
+    stream->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+    stream->codecpar->codec_id = codecId;
+
+    // Parse the first access unit so the SPS (size, frame rate) is known before decoding
+    packet = av_packet_alloc();
+    if (!packet || !elementaryReader->ReadPacket(packet))
+    {
+        std::cerr << "No access unit found in " << filename << std::endl;
+        return false;
+    }
+    packetPending = true;
+    startup.probeMs = MsSinceOpen();
+    startup.firstPacketMs = startup.probeMs;
+
+    stream->codecpar->width = elementaryReader->GetWidth();
+    stream->codecpar->height = elementaryReader->GetHeight();
+    stream->codecpar->format = elementaryReader->GetPixelFormat();
+    AVRational frameRate = elementaryReader->GetFrameRate();
+    // 25 fps like the raw demuxer when the SPS carries no timing info
+    if (frameRate.num <= 0 || frameRate.den <= 0)
+        frameRate = av_make_q(25, 1);
+    stream->avg_frame_rate = frameRate;
+    stream->r_frame_rate = frameRate;
+
+    return OpenCodec();
+}
+
+bool DecoderCore::OpenCodec()
+{
+    // Find decoder
+    const AVCodec *codec = avcodec_find_decoder(formatCtx->streams[videoStreamIndex]->codecpar->codec_id);
+    if (!codec)
+    {
+        std::cerr << "Codec not found" << std::endl;
+        return false;
+    }
+
+    codecCtx = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(codecCtx, formatCtx->streams[videoStreamIndex]->codecpar);
+    codecCtx->pkt_timebase = formatCtx->streams[videoStreamIndex]->time_base;
+
+    if (backend && !backend->ConfigureCodec(codecCtx))
+    {
+        std::cerr << "Failed to configure " << backend->GetName() << " backend" << std::endl;
+        return false;
+    }
+
+    if (lowLatency)
+    {
+        // Output each frame as soon as it is decoded, without reorder delay; frame threading
+        // would hold thread_count - 1 frames back, so keep slice threading only
+        codecCtx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        codecCtx->thread_type &= FF_THREAD_SLICE;
+    }
+
+    codecCtx->skip_frame = skipFrame;
+    codecCtx->skip_loop_filter = skipLoopFilter;
+    // The stand-in context of the elementary stream reader has no input format
+    numberedTimestamps = elementaryReader || (formatCtx->iformat && (formatCtx->iformat->flags & AVFMT_NOTIMESTAMPS));
+    if (frameAnalysis)
+        codecCtx->export_side_data |= AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS;
+    if (frameAnalysis || numberedTimestamps)
+        codecCtx->flags |= AV_CODEC_FLAG_COPY_OPAQUE;
+
+    // Open codec
+    if (avcodec_open2(codecCtx, codec, nullptr) < 0)
+    {
+        std::cerr << "Could not open codec" << std::endl;
+        return false;
+    }
+    startup.codecOpenMs = MsSinceOpen();
+
+    AVStream *stream = formatCtx->streams[videoStreamIndex];
+    AVRational frameRate = stream->avg_frame_rate;
+    if (frameRate.num <= 0 || frameRate.den <= 0)
+        frameRate = stream->r_frame_rate;
+    if (frameRate.num <= 0 || frameRate.den <= 0)
+        frameRate = av_make_q(25, 1);
+    frameDuration = av_rescale_q(1, av_inv_q(frameRate), stream->time_base);
+    if (frameDuration < 1)
+        frameDuration = 1;
+    keyframeIndex.SetTimeBase(stream->time_base);
+
+    if (numberedTimestamps && codecCtx->codec_id == AV_CODEC_ID_H264)
+    {
+        // Packets arrive whole: the parser only reads the slice headers of each
+        orderParser = av_parser_init(AV_CODEC_ID_H264);
+        orderCtx = avcodec_alloc_context3(nullptr);
+        if (!orderParser || !orderCtx)
+        {
+            std::cerr << "Could not create bitstream parser" << std::endl;
+            return false;
+        }
+        orderParser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+        orderCtx->codec_id = AV_CODEC_ID_H264;
+        orderCtx->codec_type = AVMEDIA_TYPE_VIDEO;
+    }
+    ResetPacketOrder(0);
+
+    // Allocate reusable packet/frame
+    if (!packet)
+        packet = av_packet_alloc();
+    frame = av_frame_alloc();
+    if (!packet || !frame)
+    {
+        std::cerr << "Failed to allocate packet/frame" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void DecoderCore::Close()
+{
+    StopDemuxThread();
+    delete demuxQueue;
+    demuxQueue = nullptr;
+    if (frame)
+        av_frame_free(&frame);
+    if (packet)
+        av_packet_free(&packet);
+    if (codecCtx)
+        avcodec_free_context(&codecCtx);
+    if (orderParser)
+    {
+        av_parser_close(orderParser);
+        orderParser = nullptr;
+    }
+    if (orderCtx)
+        avcodec_free_context(&orderCtx);
+    if (formatCtx)
+        avformat_close_input(&formatCtx);
+    // After the format context, which reads through it
+    delete readAhead;
+    readAhead = nullptr;
+    delete elementaryReader;
+    elementaryReader = nullptr;
+    packetPending = false;
+    lowLatency = false;
+    startup = StartupTimes();
+    sourceName.clear();
+    keyframeIndex.Clear();
+    seekedSinceOpen = false;
+    indexEndPts = AV_NOPTS_VALUE;
+    numberedTimestamps = false;
+    frameDuration = 1;
+    nextPacketNumber = 0;
+    packetNumber = 0;
+    ResetPacketOrder(0);
+    seekTarget = AV_NOPTS_VALUE;
+    awaitKeyframe = false;
+    seekStats = SeekStats();
+    videoStreamIndex = -1;
+    backend = nullptr;
+    state = State::Decoding;
+    packetsRead = 0;
+    framesDecoded = 0;
+    formatStats = FormatChangeStats();
+    lastFrameDone = std::chrono::steady_clock::time_point();
+    frameDecodeMs = 0.0;
+    frameIntervals = 0;
+}
+
+bool DecoderCore::ReadPacket()
+{
+    if (!formatCtx || !packet)
+        return false;
+
+    if (elementaryReader)
+    {
+        if (packetPending)
+        {
+            packetPending = false;
+            packetsRead++;
+            IndexPacket();
+            return true;
+        }
+        av_packet_unref(packet);
+        bool read;
+        {
+            TelemetryScope scope(telemetry, Telemetry::ReadPacket);
+            read = elementaryReader->ReadPacket(packet);
+        }
+        if (!read)
+        {
+            if (!seekedSinceOpen && !keyframeIndex.IsComplete())
+                keyframeIndex.SetComplete(indexEndPts, nextPacketNumber);
+            return false;
+        }
+        packet->stream_index = videoStreamIndex;
+        packetsRead++;
+        IndexPacket();
+        return true;
+    }
+
+    av_packet_unref(packet);
+    int ret;
+    while ((ret = ReadFrame()) >= 0)
+    {
+        if (packet->stream_index == videoStreamIndex)
+        {
+            if (lowLatency)
+                packetArrival = std::chrono::steady_clock::now();
+            if (packetsRead++ == 0)
+                startup.firstPacketMs = MsSinceOpen();
+            IndexPacket();
+            return true;
+        }
+        av_packet_unref(packet);
+    }
+
+    // EOF or error; only a clean EOF after reading from the start completes the index
+    if (ret == AVERROR_EOF && !lowLatency && !seekedSinceOpen && !keyframeIndex.IsComplete())
+        keyframeIndex.SetComplete(indexEndPts, nextPacketNumber);
+    return false;
+}
+
+int DecoderCore::ReadFrame()
+{
+    TelemetryScope scope(telemetry, Telemetry::ReadPacket);
+    if (demuxQueue)
+        return demuxQueue->Pop(packet);
+    return av_read_frame(formatCtx, packet);
+}
+
+void DecoderCore::StartDemuxThread()
+{
+    if (demuxQueueDepth == 0 || lowLatency || elementaryReader || demuxThread.joinable())
+        return;
+    if (!demuxQueue)
+        demuxQueue = new PacketQueue(demuxQueueDepth);
+    demuxQueue->Reopen();
+    demuxThread = std::thread(&DecoderCore::RunDemux, this);
+}
+
+void DecoderCore::StopDemuxThread()
+{
+    if (!demuxThread.joinable())
+        return;
+    demuxQueue->Close();
+    demuxThread.join();
+    demuxQueue->Clear();
+}
+
+// ReadFrame's telemetry times the wait for the queue: the stall the decoder sees
+void DecoderCore::RunDemux()
+{
+    AVPacket *pkt = av_packet_alloc();
+    int ret = pkt ? 0 : AVERROR(ENOMEM);
+    while (ret >= 0)
+    {
+        ret = av_read_frame(formatCtx, pkt);
+        if (ret < 0)
+            break;
+        // Only the video stream is decoded; don't let other streams take queue slots
+        if (pkt->stream_index != videoStreamIndex)
+        {
+            av_packet_unref(pkt);
+            continue;
+        }
+        if (!demuxQueue->Push(pkt))
+        {
+            ret = AVERROR_EXIT;
+            break;
+        }
+    }
+    if (ret != AVERROR_EXIT)
+        demuxQueue->PushEnd(ret);
+    av_packet_free(&pkt);
+}
+
+int DecoderCore::SendPacket(const AVPacket *pkt)
+{
+    TelemetryScope scope(telemetry, Telemetry::SendPacket);
+    return avcodec_send_packet(codecCtx, pkt);
+}
+
+int DecoderCore::ReceiveFrame()
+{
+    TelemetryScope scope(telemetry, Telemetry::ReceiveFrame);
+    return avcodec_receive_frame(codecCtx, frame);
+}
+
+int64_t DecoderCore::PacketTimestamp(const AVPacket *pkt, int64_t number) const
+{
+    if (numberedTimestamps)
+        return number * frameDuration;
+    return pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+}
+
+void DecoderCore::IndexPacket()
+{
+    packetNumber = nextPacketNumber++;
+    if (frameAnalysis || numberedTimestamps)
+        packet->opaque = (void *)(intptr_t)packetNumber;
+    if (numberedTimestamps)
+    {
+        // Frames get their timestamps at output, from the packet number they carry
+        packet->pts = AV_NOPTS_VALUE;
+        packet->dts = AV_NOPTS_VALUE;
+        RecordPacketOrder();
+    }
+    if (lowLatency || seekedSinceOpen || keyframeIndex.IsComplete())
+        return;
+
+    int64_t ts = PacketTimestamp(packet, packetNumber);
+    if (ts == AV_NOPTS_VALUE)
+        return;
+    if (packet->flags & AV_PKT_FLAG_KEY)
+        keyframeIndex.Add(ts, packet->pos, packetNumber);
+    int64_t end = ts + (packet->duration > 0 && !numberedTimestamps ? packet->duration : frameDuration);
+    if (indexEndPts == AV_NOPTS_VALUE || end > indexEndPts)
+        indexEndPts = end;
+}
+
+bool DecoderCore::ScanElementaryStream(KeyframeIndex &index)
+{
+    // A second mapping of the same file; the playback reader keeps its position
+    AnnexBReader reader;
+    AVPacket *pkt = av_packet_alloc();
+    if (!pkt || !reader.Open(sourceName.c_str(), elementaryReader->GetCodecId()))
+    {
+        av_packet_free(&pkt);
+        return false;
+    }
+
+    int64_t number = 0;
+    while (reader.ReadPacket(pkt))
+    {
+        if (pkt->flags & AV_PKT_FLAG_KEY)
+            index.Add(number * frameDuration, pkt->pos, number);
+        number++;
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    index.SetComplete(number * frameDuration, number);
+    return true;
+}
+
+bool DecoderCore::ScanContainer(KeyframeIndex &index)
+{
+    AVFormatContext *scanCtx = nullptr;
+    if (avformat_open_input(&scanCtx, sourceName.c_str(), formatCtx->iformat, nullptr) < 0)
+        return false;
+    // Formats that create streams while reading need probing to number them the same way
+    if ((int)scanCtx->nb_streams <= videoStreamIndex && avformat_find_stream_info(scanCtx, nullptr) < 0)
+    {
+        avformat_close_input(&scanCtx);
+        return false;
+    }
+    if ((int)scanCtx->nb_streams <= videoStreamIndex)
+    {
+        avformat_close_input(&scanCtx);
+        return false;
+    }
+    // Demux only: no decoding, other streams are not even read where the format allows it
+    for (unsigned i = 0; i < scanCtx->nb_streams; i++)
+        scanCtx->streams[i]->discard = (int)i == videoStreamIndex ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+    AVPacket *pkt = av_packet_alloc();
+    int64_t number = 0, end = AV_NOPTS_VALUE;
+    int ret = pkt ? 0 : AVERROR(ENOMEM);
+    while (pkt && (ret = av_read_frame(scanCtx, pkt)) >= 0)
+    {
+        if (pkt->stream_index == videoStreamIndex)
+        {
+            int64_t ts = PacketTimestamp(pkt, number);
+            if (ts != AV_NOPTS_VALUE)
+            {
+                if (pkt->flags & AV_PKT_FLAG_KEY)
+                    index.Add(ts, pkt->pos, number);
+                int64_t frameEnd = ts + (pkt->duration > 0 && !numberedTimestamps ? pkt->duration : frameDuration);
+                if (end == AV_NOPTS_VALUE || frameEnd > end)
+                    end = frameEnd;
+            }
+            number++;
+        }
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    avformat_close_input(&scanCtx);
+    if (ret != AVERROR_EOF)
+        return false;
+    index.SetComplete(end, number);
+    return true;
+}
+
+bool DecoderCore::BuildKeyframeIndex()
+{
+    if (keyframeIndex.IsComplete())
+        return true;
+    if (!codecCtx || lowLatency)
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+    AVRational timeBase = formatCtx->streams[videoStreamIndex]->time_base;
+    KeyframeIndex scanned;
+    if (useIndexSidecar && scanned.Load(sourceName.c_str()) && av_cmp_q(scanned.GetTimeBase(), timeBase) == 0)
+    {
+        seekStats.indexFromSidecar = true;
+    }
+    else
+    {
+        scanned.Clear();
+        scanned.SetTimeBase(timeBase);
+        if (!(elementaryReader ? ScanElementaryStream(scanned) : ScanContainer(scanned)) || scanned.Size() == 0)
+        {
+            std::cerr << "Could not index keyframes of " << sourceName << std::endl;
+            return false;
+        }
+        if (useIndexSidecar && !scanned.Store(sourceName.c_str()))
+            std::cerr << "Could not write " << KeyframeIndex::SidecarPath(sourceName.c_str()) << std::endl;
+    }
+    keyframeIndex = std::move(scanned);
+    seekStats.indexBuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void DecoderCore::SetKeyframeIndex(const KeyframeIndex &index)
+{
+    if (index.IsComplete() && formatCtx && av_cmp_q(index.GetTimeBase(), formatCtx->streams[videoStreamIndex]->time_base) == 0)
+        keyframeIndex = index;
+}
+
+bool DecoderCore::Seek(int64_t pts)
+{
+    if (!codecCtx || lowLatency)
+    {
+        std::cerr << "Seeking needs an opened file input" << std::endl;
+        return false;
+    }
+    if (!BuildKeyframeIndex())
+        return false;
+    // Past the end: show the last frame
+    if (keyframeIndex.GetEndPts() != AV_NOPTS_VALUE && pts > keyframeIndex.GetEndPts() - frameDuration)
+        pts = keyframeIndex.GetEndPts() - frameDuration;
+    const KeyframeIndex::Entry *keyframe = keyframeIndex.Find(pts);
+    if (!keyframe)
+    {
+        std::cerr << "No keyframe to seek to in " << sourceName << std::endl;
+        return false;
+    }
+
+    bool seeked;
+    if (elementaryReader)
+    {
+        seeked = elementaryReader->Seek(keyframe->pos);
+    }
+    else
+    {
+        // The demux thread reads formatCtx; queued packets belong to the old position
+        StopDemuxThread();
+        // Raw and timestamp-discontinuous formats only find timestamps by guessing from the
+        // bitrate; the indexed byte offset is exact. Everything else seeks by timestamp.
+        const AVInputFormat *format = formatCtx->iformat;
+        bool byteSeek = keyframe->pos >= 0 && (format->flags & (AVFMT_NOTIMESTAMPS | AVFMT_TS_DISCONT)) &&
+                        !(format->flags & AVFMT_NO_BYTE_SEEK);
+        if (byteSeek)
+            seeked = av_seek_frame(formatCtx, videoStreamIndex, keyframe->pos, AVSEEK_FLAG_BYTE) >= 0;
+        else
+            seeked = av_seek_frame(formatCtx, videoStreamIndex, keyframe->pts, AVSEEK_FLAG_BACKWARD) >= 0;
+        StartDemuxThread();
+    }
+    if (!seeked)
+    {
+        std::cerr << "Seek to keyframe at " << keyframe->pts << " failed" << std::endl;
+        return false;
+    }
+
+    // Drop everything buffered for the old position: reorder queue, frame threads, references
+    avcodec_flush_buffers(codecCtx);
+    av_packet_unref(packet);
+    packetPending = false;
+    state = State::Decoding;
+    nextPacketNumber = keyframe->packet;
+    ResetPacketOrder(keyframe->packet);
+    seekTarget = pts;
+    awaitKeyframe = false;
+    seekedSinceOpen = true;
+    lastFrameDone = std::chrono::steady_clock::time_point();
+    seekStats.seeks++;
+    return true;
+}
+
+bool DecoderCore::Rewind()
+{
+    if (!codecCtx || lowLatency)
+    {
+        std::cerr << "Rewinding needs an opened file input" << std::endl;
+        return false;
+    }
+
+    bool seeked;
+    if (elementaryReader)
+    {
+        seeked = elementaryReader->Seek(0);
+    }
+    else
+    {
+        StopDemuxThread();
+        const AVInputFormat *format = formatCtx->iformat;
+        AVStream *stream = formatCtx->streams[videoStreamIndex];
+        if ((format->flags & (AVFMT_NOTIMESTAMPS | AVFMT_TS_DISCONT)) && !(format->flags & AVFMT_NO_BYTE_SEEK))
+            seeked = av_seek_frame(formatCtx, videoStreamIndex, 0, AVSEEK_FLAG_BYTE) >= 0;
+        else
+            seeked = av_seek_frame(formatCtx, videoStreamIndex, stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0,
+                                   AVSEEK_FLAG_BACKWARD) >= 0;
+        StartDemuxThread();
+    }
+    if (!seeked)
+    {
+        std::cerr << "Rewind of " << sourceName << " failed" << std::endl;
+        return false;
+    }
+
+    // Same as a seek: the open codec (and its hardware surfaces) survives the flush
+    avcodec_flush_buffers(codecCtx);
+    av_packet_unref(packet);
+    packetPending = false;
+    state = State::Decoding;
+    nextPacketNumber = 0;
+    ResetPacketOrder(0);
+    seekTarget = AV_NOPTS_VALUE;
+    awaitKeyframe = false;
+    // A pass that ended in an error left the index incomplete; the next one must not add to it
+    if (!keyframeIndex.IsComplete())
+        seekedSinceOpen = true;
+    lastFrameDone = std::chrono::steady_clock::time_point();
+    seekStats.rewinds++;
+    return true;
+}
+
+// NAL header byte of the first VCL NAL unit of an H.264 packet (Annex-B or avcC
+// length-prefixed), -1 without one
+static int FirstH264SliceHeader(const AVPacket *pkt, const AVCodecContext *codecCtx)
+{
+    const uint8_t *p = pkt->data, *end = pkt->data + pkt->size;
+    bool annexB = pkt->size >= 4 && p[0] == 0 && p[1] == 0 && (p[2] == 1 || (p[2] == 0 && p[3] == 1));
+    int lengthSize = 4;
+    if (codecCtx->extradata_size >= 5 && codecCtx->extradata[0] == 1)
+        lengthSize = (codecCtx->extradata[4] & 3) + 1;
+
+    while (p < end)
+    {
+        const uint8_t *nal;
+        const uint8_t *next;
+        if (annexB)
+        {
+            while (p + 3 <= end && !(p[0] == 0 && p[1] == 0 && p[2] == 1))
+                p++;
+            if (p + 3 >= end)
+                return -1;
+            nal = p + 3;
+            next = nal;
+        }
+        else
+        {
+            if (end - p < lengthSize)
+                return -1;
+            uint32_t length = 0;
+            for (int i = 0; i < lengthSize; i++)
+                length = length << 8 | p[i];
+            nal = p + lengthSize;
+            if (length == 0 || length > (uint32_t)(end - nal))
+                return -1;
+            next = nal + length;
+        }
+
+        int type = nal[0] & 0x1F;
+        if (type == 1 || type == 5)
+            return nal[0];
+        p = next;
+    }
+    return -1;
+}
+
+// First slice has nal_ref_idc 0
+static bool IsH264NonReference(const AVPacket *pkt, const AVCodecContext *codecCtx)
+{
+    int header = FirstH264SliceHeader(pkt, codecCtx);
+    return header >= 0 && (header & 0x60) == 0;
+}
+
+void DecoderCore::RecordPacketOrder()
+{
+    PacketOrder order = {packetNumber, orderBase, INT_MIN, (packet->flags & AV_PKT_FLAG_KEY) != 0};
+    if (orderParser && packet->size > 0)
+    {
+        // An IDR picture restarts the order counts and everything before it is shown first
+        int header = FirstH264SliceHeader(packet, codecCtx);
+        if (header >= 0 && (header & 0x1F) == 5)
+            orderBase = order.base = packetNumber;
+        uint8_t *out = nullptr;
+        int outSize = 0;
+        orderParser->output_picture_number = INT_MIN;
+        av_parser_parse2(orderParser, orderCtx, &out, &outSize, packet->data, packet->size, AV_NOPTS_VALUE,
+                         AV_NOPTS_VALUE, packet->pos);
+        order.poc = orderParser->output_picture_number;
+    }
+    pendingOrder.push_back(order);
+    if (pendingOrder.size() > kMaxPendingOrder)
+        pendingOrder.pop_front();
+}
+
+int64_t DecoderCore::DisplayNumber(int64_t number)
+{
+    auto it = std::find_if(pendingOrder.begin(), pendingOrder.end(),
+                           [number](const PacketOrder &p) { return p.number == number; });
+    if (it == pendingOrder.end() || it->poc == INT_MIN)
+    {
+        // No order count: a keyframe starts a closed GOP, anything else follows the last frame
+        lastDisplayNumber = it != pendingOrder.end() && it->key ? number : lastDisplayNumber + 1;
+        if (it != pendingOrder.end())
+            pendingOrder.erase(pendingOrder.begin(), it + 1);
+        return lastDisplayNumber;
+    }
+
+    // Frames leave the decoder in display order, so every packet of the same sequence with a
+    // lower order count was read before this one was shown: it is shown, skipped or discarded
+    int64_t base = it->base;
+    int poc = it->poc;
+    if (base != shownBase)
+    {
+        shownBase = base;
+        shownInBase = 0;
+    }
+    int64_t before = shownInBase;
+    for (const PacketOrder &p : pendingOrder)
+    {
+        if (p.base == base && p.poc < poc)
+            before++;
+    }
+    pendingOrder.erase(std::remove_if(pendingOrder.begin(), pendingOrder.end(),
+                                      [base, poc](const PacketOrder &p)
+                                      { return p.base < base || (p.base == base && p.poc <= poc); }),
+                       pendingOrder.end());
+    shownInBase = before + 1;
+    lastDisplayNumber = base + before;
+    return lastDisplayNumber;
+}
+
+void DecoderCore::ResetPacketOrder(int64_t base)
+{
+    // Decoding restarts at a keyframe with this packet number, exact when it is an IDR picture
+    pendingOrder.clear();
+    orderBase = base;
+    shownBase = -1;
+    shownInBase = 0;
+    lastDisplayNumber = base - 1;
+}
+
+bool DecoderCore::CanSkipBeforeTarget() const
+{
+    if (seekTarget == AV_NOPTS_VALUE || codecCtx->codec_id != AV_CODEC_ID_H264 || packet->size <= 0)
+        return false;
+
+    int64_t end;
+    if (numberedTimestamps)
+    {
+        // Decode order only bounds the display position: allow for the reorder depth
+        end = (packetNumber + codecCtx->has_b_frames + 1) * frameDuration;
+    }
+    else
+    {
+        if (packet->pts == AV_NOPTS_VALUE)
+            return false;
+        end = packet->pts + (packet->duration > 0 ? packet->duration : frameDuration);
+    }
+    return end <= seekTarget && IsH264NonReference(packet, codecCtx);
+}
+
+void DecoderCore::TrackFormat(const AVFrame *decoded)
+{
+    auto now = std::chrono::steady_clock::now();
+    double ms = -1.0;
+    if (lastFrameDone != std::chrono::steady_clock::time_point())
+    {
+        ms = std::chrono::duration<double, std::milli>(now - lastFrameDone).count();
+        frameDecodeMs += ms;
+        frameIntervals++;
+        formatStats.meanFrameMs = frameDecodeMs / frameIntervals;
+    }
+
+    int format = decoded->format;
+    if (decoded->hw_frames_ctx)
+        format = ((AVHWFramesContext *)decoded->hw_frames_ctx->data)->sw_format;
+    if (decoded->width == formatStats.width && decoded->height == formatStats.height && format == formatStats.format)
+        return;
+
+    // The first frame sets the format; later switches are changes
+    if (formatStats.format >= 0)
+    {
+        formatStats.changes++;
+        if (ms >= 0.0)
+        {
+            formatStats.lastStallMs = ms;
+            formatStats.totalStallMs += ms;
+            formatStats.maxStallMs = std::max(formatStats.maxStallMs, ms);
+        }
+    }
+    formatStats.width = decoded->width;
+    formatStats.height = decoded->height;
+    formatStats.format = format;
+}
+
+bool DecoderCore::ReceiveFrames(IFrameSink *sink)
+{
+    int errors = 0;
+    while (true)
+    {
+        int ret = ReceiveFrame();
+        if (ret == AVERROR(EAGAIN))
+            return true; // needs more input
+        if (ret == AVERROR_EOF)
+        {
+            state = State::Finished;
+            return true;
+        }
+        if (ret < 0)
+        {
+            // A frame that failed to decode is dropped and later frames are still delivered,
+            // but a codec that keeps failing without output will not recover
+            std::cerr << "Error receiving frame: " << ret << std::endl;
+            if (++errors >= kMaxReceiveErrors)
+            {
+                std::cerr << "Decoding stopped after " << errors << " consecutive errors" << std::endl;
+                state = State::Failed;
+                return false;
+            }
+            continue;
+        }
+        errors = 0;
+
+        if (framesDecoded++ == 0)
+            startup.firstFrameMs = MsSinceOpen();
+        TrackFormat(frame);
+
+        if (numberedTimestamps)
+        {
+            frame->pts = DisplayNumber((int64_t)(intptr_t)frame->opaque) * frameDuration;
+            frame->best_effort_timestamp = frame->pts;
+        }
+        if (seekTarget != AV_NOPTS_VALUE)
+        {
+            // Pre-roll after a seek: the frame was needed as a reference only
+            int64_t ts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+            if (ts != AV_NOPTS_VALUE && ts + (frame->duration > 0 ? frame->duration : frameDuration) <= seekTarget)
+            {
+                seekStats.preRollFrames++;
+                av_frame_unref(frame);
+                lastFrameDone = std::chrono::steady_clock::now();
+                continue;
+            }
+            seekTarget = AV_NOPTS_VALUE;
+        }
+
+        bool keepGoing = !sink || sink->OnFrame(frame);
+        av_frame_unref(frame);
+        lastFrameDone = std::chrono::steady_clock::now();
+        if (!keepGoing)
+            return false;
+    }
+}
+
+bool DecoderCore::DecodePacket(IFrameSink *sink)
+{
+    if (!codecCtx || !frame || state != State::Decoding)
+        return false;
+
+    if (packet->flags & AV_PKT_FLAG_KEY)
+        awaitKeyframe = false;
+    if ((skipFrame >= AVDISCARD_NONKEY || awaitKeyframe) && !(packet->flags & AV_PKT_FLAG_KEY))
+    {
+        // The decoder would discard it after parsing; its display position was recorded on read
+        av_packet_unref(packet);
+        return true;
+    }
+
+    if (CanSkipBeforeTarget())
+    {
+        // Its frame would have been dropped as pre-roll; it still takes a display position
+        av_packet_unref(packet);
+        seekStats.skippedPackets++;
+        return true;
+    }
+
+    int ret;
+    while ((ret = SendPacket(packet)) == AVERROR(EAGAIN))
+    {
+        // Output queue is full: drain it, then resend the same packet
+        uint64_t before = framesDecoded;
+        if (!ReceiveFrames(sink))
+        {
+            av_packet_unref(packet);
+            return false;
+        }
+        if (framesDecoded == before)
+        {
+            std::cerr << "Decoder rejected packet without producing output" << std::endl;
+            break;
+        }
+    }
+    av_packet_unref(packet);
+
+    // A corrupt packet is skipped; decoding continues with the next one
+    if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+        std::cerr << "Error sending packet: " << ret << std::endl;
+
+    return ReceiveFrames(sink);
+}
+
+bool DecoderCore::Drain(IFrameSink *sink)
+{
+    if (!codecCtx || !frame || state == State::Finished || state == State::Failed)
+        return false;
+
+    if (state == State::Decoding)
+    {
+        state = State::Draining;
+        // A null packet enters draining mode
+        SendPacket(nullptr);
+    }
+
+    // In draining mode receive runs until EOF (never EAGAIN)
+    if (!ReceiveFrames(sink))
+        return false;
+    state = State::Finished;
+    return true;
+}
+
+bool DecoderCore::DecodeOneFrame(IFrameSink *sink)
+{
+    if (state != State::Decoding)
+        return false;
+
+    if (!ReadPacket())
+    {
+        // EOF (or read error): flush the frames still inside the codec
+        Drain(sink);
+        return false;
+    }
+    return DecodePacket(sink);
+}
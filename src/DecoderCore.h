@@ -0,0 +1,312 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#include "AnnexBReader.h"
+#include "DecodeBackend.h"
+#include "FrameSink.h"
+#include "KeyframeIndex.h"
+#include "PacketQueue.h"
+#include "ReadAheadIO.h"
+#include "Telemetry.h"
+
+// Platform-neutral demux + decode loop. The backend decides where frames are decoded
+// (software, D3D11VA, other hwaccels); every decoded frame is handed to an IFrameSink.
+//
+// Send/receive state machine: every packet is followed by receiving all frames the codec
+// has ready, a packet rejected with EAGAIN is resent after draining output, and at end
+// of stream a null packet flushes the frames still held for reordering/frame threading.
+//
+// Raw Annex-B elementary streams can bypass avformat and read through AnnexBReader
+// (mmap + av_parser_parse2, zero-copy packets); the video stream is then a stand-in
+// AVStream carrying the time base, frame rate and size found in the SPS.
+//
+// Live sources (tcp://, udp://, rtp://, pipe:, "-" for stdin, named pipes) open in
+// low-latency mode: minimal probing, no demuxer buffering, AV_CODEC_FLAG_LOW_DELAY and no
+// frame threading, so a frame leaves the decoder as soon as its access unit arrived.
+//
+// File inputs can seek: a KeyframeIndex (built while reading, by a demux-only pass or
+// loaded from a sidecar) gives the keyframe at or before the target, the input jumps to
+// it (by byte offset for raw streams, where av_seek_frame only guesses) and decoding runs
+// forward from there. Frames before the target are decoded but never reach the sink, and
+// non-reference H.264 pictures before it are not decoded at all.
+//
+// For slow or hiccuping storage, demuxed files can read through ReadAheadIO (an I/O
+// thread keeping a prefetch window of the file loaded) and demux on their own thread into
+// a bounded PacketQueue, so neither a storage stall nor av_read_frame run on the thread
+// that decodes.
+class DecoderCore
+{
+public:
+    enum class InputMode
+    {
+        Auto,            // elementary stream reader for .h264/.264/.h265/.265/.hevc, avformat otherwise
+        Demuxer,         // always avformat
+        ElementaryStream // always AnnexBReader (raw H.264 unless the extension says HEVC)
+    };
+
+    // Startup phases in ms since Open() was called; negative until the phase completed
+    struct StartupTimes
+    {
+        double openMs = -1.0;        // input opened (avformat_open_input / mmap)
+        double probeMs = -1.0;       // stream parameters known (probe, cache or first access unit)
+        double codecOpenMs = -1.0;   // avcodec_open2 done
+        double firstPacketMs = -1.0; // first video packet read
+        double firstFrameMs = -1.0;  // first frame decoded
+        bool paramCacheHit = false;
+    };
+
+    struct SeekStats
+    {
+        uint64_t seeks = 0;
+        uint64_t rewinds = 0;
+        uint64_t preRollFrames = 0;  // decoded between keyframe and target, not delivered
+        uint64_t skippedPackets = 0; // non-reference pictures before the target, never decoded
+        double indexBuildMs = 0.0;   // first pass or sidecar load
+        bool indexFromSidecar = false;
+    };
+
+    // Picture size / pixel format switches in the decoded frames (an SPS change, e.g. in an
+    // adaptive-bitrate stream). Decode time is measured from the end of one sink call to the
+    // next decoded frame, so it excludes what the sink does with the frame.
+    struct FormatChangeStats
+    {
+        uint64_t changes = 0;
+        double lastStallMs = 0.0;  // decode time of the first frame in the new format
+        double maxStallMs = 0.0;
+        double totalStallMs = 0.0;
+        double meanFrameMs = 0.0;  // decode time per frame over the whole stream, for comparison
+        int width = 0;             // format of the last decoded frame
+        int height = 0;
+        int format = -1;           // software format (the surface format of hardware frames)
+    };
+
+    enum class State
+    {
+        Decoding, // reading packets
+        Draining, // input exhausted, flushing delayed frames
+        Finished, // codec returned EOF
+        Failed    // the codec kept failing (kMaxReceiveErrors errors in a row); reopen or seek
+    };
+
+    // Consecutive avcodec_receive_frame errors without a frame in between before decoding stops
+    static constexpr int kMaxReceiveErrors = 4;
+
+private:
+    AVFormatContext *formatCtx = nullptr;
+    AVCodecContext *codecCtx = nullptr;
+    IDecodeBackend *backend = nullptr;
+    InputMode inputMode = InputMode::Auto;
+    AnnexBReader *elementaryReader = nullptr;
+    bool packetPending = false; // first access unit, parsed during Open
+    bool forceLowLatency = false;
+    const char *forcedFormat = nullptr;
+    bool lowLatency = false; // active for the current input
+    std::chrono::steady_clock::time_point packetArrival;
+    bool useParamCache = false;
+    std::chrono::steady_clock::time_point openStart;
+    StartupTimes startup;
+    std::string sourceName;
+    KeyframeIndex keyframeIndex;
+    bool useIndexSidecar = false;
+    bool seekedSinceOpen = false; // the lazily built index is only complete after reading straight through
+    int64_t indexEndPts = AV_NOPTS_VALUE;
+    // Raw streams carry no usable timestamps: frames and keyframes are numbered instead
+    bool numberedTimestamps = false;
+    int64_t frameDuration = 1; // stream time base
+    int64_t nextPacketNumber = 0;
+    int64_t packetNumber = 0;  // decode-order number of the packet in `packet`
+    // Every numbered packet carries its packet number to its frame in opaque; the frame's
+    // display number comes from the picture order counts of the packets read so far
+    struct PacketOrder
+    {
+        int64_t number;
+        int64_t base; // packet number of the IDR picture that restarted the order counts
+        int poc;      // INT_MIN: unknown
+        bool key;
+    };
+    static constexpr size_t kMaxPendingOrder = 4096;
+    AVCodecParserContext *orderParser = nullptr; // H.264 only: slice headers for the order counts
+    AVCodecContext *orderCtx = nullptr;
+    std::deque<PacketOrder> pendingOrder; // read, not yet shown
+    int64_t orderBase = 0;
+    int64_t shownBase = -1; // sequence of the last frame shown and its frames shown or skipped
+    int64_t shownInBase = 0;
+    int64_t lastDisplayNumber = -1;
+    int64_t seekTarget = AV_NOPTS_VALUE; // frames ending before it are not delivered
+    SeekStats seekStats;
+    Telemetry *telemetry = nullptr;
+    AVDiscard skipFrame = AVDISCARD_DEFAULT;
+    AVDiscard skipLoopFilter = AVDISCARD_DEFAULT;
+    bool awaitKeyframe = false; // keyframe-only just ended: references are missing until the next key
+    bool frameAnalysis = false;
+    int videoStreamIndex = -1;
+    // Reusable decode objects
+    AVPacket *packet = nullptr;
+    AVFrame *frame = nullptr;
+    State state = State::Decoding;
+    uint64_t packetsRead = 0;
+    uint64_t framesDecoded = 0;
+    // Format change tracking; lastFrameDone is unset after Open, seeks and rewinds
+    FormatChangeStats formatStats;
+    std::chrono::steady_clock::time_point lastFrameDone;
+    double frameDecodeMs = 0.0;
+    uint64_t frameIntervals = 0;
+    // Read-ahead input and demux thread (demuxed file inputs only)
+    bool useReadAhead = false;
+    ReadAheadIO::Config readAheadConfig;
+    ReadAheadIO *readAhead = nullptr;
+    size_t demuxQueueDepth = 0;
+    PacketQueue *demuxQueue = nullptr;
+    std::thread demuxThread;
+
+public:
+    DecoderCore() = default;
+    DecoderCore(const DecoderCore &) = delete;
+    DecoderCore &operator=(const DecoderCore &) = delete;
+    ~DecoderCore() { Close(); }
+
+    // Take effect on the next Open
+    void SetInputMode(InputMode mode) { inputMode = mode; }
+    // Low-latency mode for inputs IsLiveSource does not recognize
+    void SetLowLatency(bool enable) { forceLowLatency = enable; }
+    // Demuxer short name ("h264", "mpegts"...); live inputs default to raw "h264" since
+    // minimal probing cannot detect the format. The string must outlive Open.
+    void SetInputFormat(const char *name) { forcedFormat = name; }
+
+    // Skip avformat_find_stream_info for files probed before, using a StreamParamCache sidecar
+    void SetParamCache(bool enable) { useParamCache = enable; }
+
+    // Load/store the complete keyframe index in a KeyframeIndex sidecar ("<file>.kfidx")
+    void SetIndexSidecar(bool enable) { useIndexSidecar = enable; }
+
+    // Read demuxed files through a ReadAheadIO with this configuration (null: avformat's own
+    // file I/O, the default). Takes effect on the next Open.
+    void SetReadAhead(const ReadAheadIO::Config *config)
+    {
+        useReadAhead = config != nullptr;
+        if (config)
+            readAheadConfig = *config;
+    }
+    // Demux demuxed files on a separate thread into a queue of this many packets (0: demux
+    // on the decoding thread, the default). Takes effect on the next Open.
+    void SetDemuxThread(size_t queueDepth) { demuxQueueDepth = queueDepth; }
+
+    // codecCtx->skip_frame, applied now and on every Open. From AVDISCARD_NONKEY on, packets
+    // without the key flag are dropped before they reach the decoder.
+    void SetSkipFrame(AVDiscard discard);
+    AVDiscard GetSkipFrame() const { return skipFrame; }
+    // codecCtx->skip_loop_filter (deblocking), applied now and on every Open
+    void SetSkipLoopFilter(AVDiscard discard);
+    AVDiscard GetSkipLoopFilter() const { return skipLoopFilter; }
+
+    // Export per-frame encoding parameters (AV_FRAME_DATA_VIDEO_ENC_PARAMS: QP) and tag every
+    // frame with the decode-order number of its packet in frame->opaque. Takes effect on the
+    // next Open.
+    void SetFrameAnalysis(bool enable) { frameAnalysis = enable; }
+
+    // Time av_read_frame / avcodec_send_packet / avcodec_receive_frame calls; not owned,
+    // null (the default) disables it
+    void SetTelemetry(Telemetry *t) { telemetry = t; }
+    Telemetry *GetTelemetry() const { return telemetry; }
+
+    static bool IsLiveSource(const char *url);
+
+    // The backend is not owned and must outlive the decoder
+    bool Open(const char *filename, IDecodeBackend *decodeBackend);
+    void Close();
+
+    // Read the next video packet; return false on EOF/error
+    bool ReadPacket();
+    // Decode the packet from ReadPacket and hand every available frame to the sink;
+    // return false when the sink asks to stop
+    bool DecodePacket(IFrameSink *sink);
+    // Send the end-of-stream packet and hand every remaining frame to the sink
+    bool Drain(IFrameSink *sink);
+    // ReadPacket + DecodePacket, draining the codec once input runs out;
+    // return false once every frame has been delivered (EOF) or on error
+    bool DecodeOneFrame(IFrameSink *sink);
+
+    // Complete the keyframe index with a demux-only pass over the file (parser-only for raw
+    // streams) unless reading already went straight to EOF or the sidecar is current
+    bool BuildKeyframeIndex();
+    // Use the complete index of another decoder of the same file instead of building one
+    // (e.g. to seek time ranges of one file in parallel)
+    void SetKeyframeIndex(const KeyframeIndex &index);
+    // Reposition so the next frame handed to a sink is the one showing at pts (stream time
+    // base); builds the index first if needed. Not available for live inputs.
+    bool Seek(int64_t pts);
+    // Back to the first packet after EOF, for looping: the codec context is flushed, not
+    // reopened, and the keyframe index is kept. Not available for live inputs.
+    bool Rewind();
+
+    State GetState() const { return state; }
+    bool IsLowLatency() const { return lowLatency; }
+    // Written by the decoding thread; complete once the first frame was handed to a sink
+    const StartupTimes &GetStartupTimes() const { return startup; }
+    // Low-latency mode: when the demuxer returned the packet being decoded. Frames leave a
+    // low-delay decoder during the DecodePacket call of their last packet, so a sink gets
+    // arrival-to-decoded latency as now - GetPacketArrivalTime().
+    std::chrono::steady_clock::time_point GetPacketArrivalTime() const { return packetArrival; }
+    uint64_t GetPacketsRead() const { return packetsRead; }
+    uint64_t GetFramesDecoded() const { return framesDecoded; }
+    const KeyframeIndex &GetKeyframeIndex() const { return keyframeIndex; }
+    const SeekStats &GetSeekStats() const { return seekStats; }
+    // Written by the decoding thread, like GetStartupTimes
+    const FormatChangeStats &GetFormatChangeStats() const { return formatStats; }
+    // Duration of one frame in the stream time base, from the frame rate
+    int64_t GetFrameDuration() const { return frameDuration; }
+
+    AVFormatContext *GetFormatContext() const { return formatCtx; }
+    AVCodecContext *GetCodecContext() const { return codecCtx; }
+    AVStream *GetVideoStream() const { return formatCtx ? formatCtx->streams[videoStreamIndex] : nullptr; }
+    const AVPacket *GetPacket() const { return packet; }
+    IDecodeBackend *GetBackend() const { return backend; }
+    // Non-null when reading a raw elementary stream without avformat
+    const AnnexBReader *GetElementaryReader() const { return elementaryReader; }
+    // Non-null when the input reads through ReadAheadIO / demuxes on its own thread
+    ReadAheadIO *GetReadAhead() const { return readAhead; }
+    PacketQueue *GetDemuxQueue() const { return demuxQueue; }
+
+private:
+    // Stand-in format context for the elementary stream reader
+    bool OpenElementaryStream(const char *filename, AVCodecID codecId);
+    bool OpenLive(const char *url);
+    bool FindVideoStream();
+    // avformat_find_stream_info, or the cached result of an earlier probe
+    bool ProbeStreams(const char *filename);
+    double MsSinceOpen() const;
+    bool OpenCodec();
+    // Demux thread: av_read_frame into demuxQueue until EOF/error or StopDemuxThread
+    void StartDemuxThread();
+    void StopDemuxThread();
+    void RunDemux();
+    // Timed libav calls
+    int ReadFrame();
+    int SendPacket(const AVPacket *pkt);
+    int ReceiveFrame();
+    // Timestamp used for the index: the packet number for numbered streams
+    int64_t PacketTimestamp(const AVPacket *pkt, int64_t number) const;
+    void IndexPacket();
+    // Display order of numbered streams: recorded as packets are read, applied at output
+    void RecordPacketOrder();
+    int64_t DisplayNumber(int64_t number);
+    void ResetPacketOrder(int64_t base);
+    bool ScanElementaryStream(KeyframeIndex &index);
+    bool ScanContainer(KeyframeIndex &index);
+    // Non-reference picture that ends before the seek target: decoding it changes nothing
+    bool CanSkipBeforeTarget() const;
+    // Decode time since the previous frame; counts a change of size or pixel format
+    void TrackFormat(const AVFrame *decoded);
+    // Receive every frame the codec has ready; false when the sink asks to stop
+    bool ReceiveFrames(IFrameSink *sink);
+};
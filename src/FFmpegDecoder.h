@@ -3,192 +3,470 @@
 #include <Windows.h>
 #include <iostream>
 #include <chrono>
+#include <string>
+#include <vector>
 #include <SDL3/SDL.h>
 
-extern "C"
-{
-#include <libavcodec/avcodec.h>
-#include <libavformat/avformat.h>
-#include <libavutil/hwcontext.h>
-#include <libavutil/hwcontext_d3d11va.h>
-}
-
 #include "D3D11Renderer.h"
+#include "D3D11VADecodeBackend.h"
+#include "DecodeThread.h"
+#include "DecoderCore.h"
+#include "LoadGovernor.h"
+#include "PlaylistSequencer.h"
+#include "PresentationClock.h"
 
+// D3D11VA zero-copy player decoder. Demux and decode run on a DecodeThread that fills a
+// bounded frame queue; the SDL/UI thread only picks the frame due for display according
+// to the PTS-driven PresentationClock, dropping frames that are already late. Live inputs
+// skip the clock and show the newest decoded frame immediately. When decoding cannot keep
+// up, a LoadGovernor skips decode work (deblocking, non-reference frames, all but keyframes)
+// until it can again.
+// Playlists switch without a gap through a PlaylistSequencer: the next item is opened,
+// probed and decoding ahead on a background thread while the current one plays. A single
+// looped item rewinds its decoder at EOF instead of reopening it, and replays from a frame
+// cache when the clip fits.
 class FFmpegD3D11Decoder
 {
 private:
-    AVFormatContext *formatCtx = nullptr;
-    AVCodecContext *codecCtx = nullptr;
-    AVBufferRef *hwDeviceCtx = nullptr;
-    int videoStreamIndex = -1;
+    PlaylistSequencer playlist;
+    DecodeThread *decodeThread = nullptr; // the playing item's
     ID3D11RendererBase *renderer = nullptr;
-    // Reusable decode objects and timing for SDL-driven loop
-    AVPacket *packet = nullptr;
-    AVFrame *frame = nullptr;
+    // Applied to every item
+    int queueDepth = 8;
+    bool liveInput = false;
+    std::string inputFormat;
+    bool paramCache = false;
+    bool indexSidecar = false;
+    bool useReadAhead = false;
+    ReadAheadIO::Config readAheadConfig;
+    size_t demuxQueueDepth = 0;
+    bool loop = false;
+    size_t frameCacheBytes = 0;
+    // Frame currently on screen; re-rendered every UI iteration until the next one is due
+    AVFrame *currentFrame = nullptr;
+    PresentationClock clock;
     double frameDurationMs = 0.0;
-    std::chrono::high_resolution_clock::time_point lastFrameTime;
+    int64_t frameDurationPts = 0; // in stream time_base, for frames without a duration
+    bool underrunCounted = false;  // one underrun per late successor of currentFrame
+    bool liveMode = false;
+    bool startupReported = false;
+    double lastSeekMs = -1.0;
+    // Size and surface format (DXGI) of the last rendered frame, to report mid-stream changes
+    int shownWidth = 0;
+    int shownHeight = 0;
+    int shownFormat = -1;
+    uint64_t formatChanges = 0;
+    Telemetry *telemetry = nullptr;
+    LoadGovernor governor;
+    bool governorEnabled = true;
 
 public:
-    bool Initialize(const char *filename, ID3D11RendererBase *render)
+    // Time decoder calls and RenderFrame; call before Initialize, not owned
+    void SetTelemetry(Telemetry *t) { telemetry = t; }
+
+    // Degrade decoding under overload instead of falling behind (default on; paced playback
+    // only, live input already shows just the newest frame). Call before Initialize.
+    void SetLoadGovernor(bool enable) { governorEnabled = enable; }
+
+    // Read files through a ReadAheadIO prefetch window and demux them on their own thread,
+    // for storage that stalls (network shares); null keeps avformat's file I/O. Call before
+    // Initialize.
+    void SetReadAhead(const ReadAheadIO::Config *config, size_t demuxQueue)
+    {
+        useReadAhead = config != nullptr;
+        if (config)
+            readAheadConfig = *config;
+        demuxQueueDepth = config ? demuxQueue : 0;
+    }
+
+    // Start over at the end instead of stopping: a single file rewinds its decoder (the codec
+    // stays open), a playlist wraps to its first entry. Call before Initialize.
+    void SetLoop(bool enable) { loop = enable; }
+
+    // Looping a single file: when one pass fits in this many bytes of video memory, decode it
+    // once and replay the decoded frames (0: always decode). Call before Initialize.
+    void SetFrameCache(size_t bytes) { frameCacheBytes = bytes; }
+
+    // depth: frames decoded ahead of presentation. live forces low-latency input (it is
+    // automatic for tcp://, udp://, pipes and stdin); format forces a demuxer for live input.
+    // cacheParams skips stream probing on repeated opens of the same file; sidecar keeps the
+    // keyframe index built for the first seek in "<file>.kfidx".
+    bool Initialize(const char *filename, ID3D11RendererBase *render, int depth = 8, double rate = 1.0,
+                    bool live = false, const char *format = nullptr, bool cacheParams = false, bool sidecar = false)
     {
+        return Initialize(std::vector<std::string>{filename}, render, depth, rate, live, format, cacheParams, sidecar);
+    }
+
+    // Play files one after the other; each is opened while its predecessor plays. A live
+    // input plays alone.
+    bool Initialize(const std::vector<std::string> &files, ID3D11RendererBase *render, int depth = 8, double rate = 1.0,
+                    bool live = false, const char *format = nullptr, bool cacheParams = false, bool sidecar = false)
+    {
+        if (files.empty())
+            return false;
         renderer = render;
+        queueDepth = depth;
+        liveInput = live;
+        inputFormat = format ? format : "";
+        paramCache = cacheParams;
+        indexSidecar = sidecar;
 
-        // Open input file
-        if (avformat_open_input(&formatCtx, filename, nullptr, nullptr) < 0)
-        {
-            std::cerr << "Could not open input file: " << filename << std::endl;
+        PlaylistSequencer::Config config;
+        config.prepare = PrepareItem;
+        config.prepareOpaque = this;
+        config.queueDepth = queueDepth;
+        config.loop = loop;
+        config.frameCacheBytes = frameCacheBytes;
+        config.copyFrame = CopySurface;
+        config.copyOpaque = renderer;
+        if (!playlist.Open(files, config))
             return false;
-        }
+        decodeThread = playlist.GetItem()->decodeThread;
+        liveMode = playlist.GetItem()->core.IsLowLatency();
 
-        if (avformat_find_stream_info(formatCtx, nullptr) < 0)
-        {
-            std::cerr << "Could not find stream info" << std::endl;
+        UseItemTiming();
+        clock.Reset(playlist.GetItem()->core.GetVideoStream()->time_base);
+        clock.SetRate(rate);
+
+        std::cout << "Decoder initialized with D3D11VA hardware acceleration\n"
+                  << "Frame duration: " << frameDurationMs << " ms/frame, rate " << clock.GetRate() << "x\n"
+                  << "Decode-ahead queue: " << queueDepth << " frames"
+                  << (playlist.GetSize() > 1 ? "\nPlaylist: " + std::to_string(playlist.GetSize()) + " files" : "")
+                  << (loop ? "\nLooping" : "")
+                  << (liveMode ? "\nLive input: low-latency decode, frame pacing disabled" : "") << std::endl;
+        return true;
+    }
+
+    // Called once per UI iteration: advance to the newest queued frame whose display time
+    // has come, dropping the late ones it supersedes, and render the current frame.
+    // Never blocks; return false on EOF/error.
+    bool RenderDueFrame(bool paused = false)
+    {
+        if (!decodeThread)
             return false;
-        }
 
-        // Find video stream
-        for (unsigned i = 0; i < formatCtx->nb_streams; i++)
+        auto now = PresentationClock::Clock::now();
+        if (paused)
+            clock.Pause(now);
+        else
+            clock.Resume(now);
+
+        while (!paused && liveMode)
         {
-            if (formatCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+            // Live: no pacing, show the newest decoded frame as soon as it arrives
+            AVFrame *next = decodeThread->PopFrame();
+            if (!next)
             {
-                videoStreamIndex = i;
+                if (decodeThread->IsDrained())
+                    return false;
                 break;
             }
+            if (decodeThread->PeekFrame())
+            {
+                av_frame_free(&next);
+                clock.OnDropped();
+                continue;
+            }
+            av_frame_free(&currentFrame);
+            currentFrame = next;
+            clock.OnPresented(PresentationClock::FrameTimestamp(next), now);
         }
 
-        if (videoStreamIndex == -1)
-        {
-            std::cerr << "Could not find video stream" << std::endl;
-            return false;
-        }
-
-        // Find decoder
-        const AVCodec *codec = avcodec_find_decoder(formatCtx->streams[videoStreamIndex]->codecpar->codec_id);
-        if (!codec)
+        while (!paused && !liveMode)
         {
-            std::cerr << "Codec not found" << std::endl;
-            return false;
-        }
+            AVFrame *next = decodeThread->PeekFrame();
+            if (!next)
+            {
+                if (decodeThread->IsDrained())
+                {
+                    // EOF or error: the next playlist item takes over when the last frame ends
+                    if (!AdvanceItem(now))
+                        return false;
+                    if (decodeThread->PeekFrame())
+                        continue;
+                    break;
+                }
+                // Count an underrun when the frame after the current one is overdue
+                if (currentFrame && !underrunCounted)
+                {
+                    int64_t duration = currentFrame->duration > 0 ? currentFrame->duration : frameDurationPts;
+                    if (clock.IsDue(PresentationClock::FrameTimestamp(currentFrame) + duration, now))
+                    {
+                        decodeThread->RecordUnderrun();
+                        underrunCounted = true;
+                    }
+                }
+                break;
+            }
 
-        codecCtx = avcodec_alloc_context3(codec);
-        avcodec_parameters_to_context(codecCtx, formatCtx->streams[videoStreamIndex]->codecpar);
+            int64_t pts = PresentationClock::FrameTimestamp(next);
+            if (!clock.IsDue(pts, now))
+                break;
 
-        // Create D3D11VA hardware device context
-        AVBufferRef *deviceRef = av_hwdevice_ctx_alloc(AV_HWDEVICE_TYPE_D3D11VA);
-        AVHWDeviceContext *deviceCtx = (AVHWDeviceContext *)deviceRef->data;
-        AVD3D11VADeviceContext *d3d11DeviceCtx = (AVD3D11VADeviceContext *)deviceCtx->hwctx;
+            next = decodeThread->PopFrame();
+            AVFrame *after = decodeThread->PeekFrame();
+            if (after && clock.IsDue(PresentationClock::FrameTimestamp(after), now))
+            {
+                // A later frame is already due: this one is late, skip it
+                av_frame_free(&next);
+                clock.OnDropped();
+                governor.OnDropped();
+                continue;
+            }
 
-        // Use the same D3D11 device as renderer for zero-copy
-        d3d11DeviceCtx->device = renderer->GetDevice();
-        d3d11DeviceCtx->device->AddRef();
-        d3d11DeviceCtx->device_context = renderer->GetContext();
-        d3d11DeviceCtx->device_context->AddRef();
+            av_frame_free(&currentFrame);
+            currentFrame = next;
+            underrunCounted = false;
+            clock.OnPresented(pts, now);
+            governor.OnPresented(clock.GetStats().lastLatenessMs);
+            break;
+        }
 
-        if (av_hwdevice_ctx_init(deviceRef) < 0)
+        if (governorEnabled && !liveMode)
         {
-            std::cerr << "Failed to create D3D11VA device" << std::endl;
-            av_buffer_unref(&deviceRef);
-            return false;
+            double busyMs = decodeThread->GetDecodeBusyMs();
+            if (paused)
+                governor.Restart(now, busyMs);
+            else if (governor.Update(now, busyMs, frameDurationMs / clock.GetRate()))
+            {
+                governor.PrintChange(std::cout, frameDurationMs / clock.GetRate());
+                decodeThread->SetDiscard(LoadGovernor::SkipFrameFor(governor.GetLevel()),
+                                         LoadGovernor::SkipLoopFilterFor(governor.GetLevel()));
+            }
         }
 
-        hwDeviceCtx = deviceRef;
-        codecCtx->hw_device_ctx = av_buffer_ref(hwDeviceCtx);
-
-        // Open codec
-        if (avcodec_open2(codecCtx, codec, nullptr) < 0)
+        if (currentFrame && !startupReported)
         {
-            std::cerr << "Could not open codec" << std::endl;
-            return false;
+            // Safe to read: the first frame was published through the frame queue
+            const PlaylistSequencer::Item *item = playlist.GetItem();
+            const DecoderCore::StartupTimes &t = item->core.GetStartupTimes();
+            std::cout << item->filename << " startup: open " << t.openMs << " ms, probe " << t.probeMs << " ms"
+                      << (t.paramCacheHit ? " (param cache hit)" : "") << ", codec open " << t.codecOpenMs
+                      << " ms, first packet " << t.firstPacketMs << " ms, first frame " << t.firstFrameMs << " ms" << std::endl;
+            startupReported = true;
         }
 
-        // Setup frame timing
-        AVStream *videoStream = formatCtx->streams[videoStreamIndex];
-        AVRational frameRate = videoStream->avg_frame_rate;
-        if (frameRate.num > 0 && frameRate.den > 0)
-            frameDurationMs = 1000.0 * frameRate.den / frameRate.num;
-        else
-            frameDurationMs = 1000.0 / 30.0;
-        lastFrameTime = std::chrono::high_resolution_clock::now();
-
-        // Allocate reusable packet/frame
-        packet = av_packet_alloc();
-        frame = av_frame_alloc();
-        if (!packet || !frame)
+        if (currentFrame && currentFrame->format == AV_PIX_FMT_D3D11)
         {
-            std::cerr << "Failed to allocate packet/frame" << std::endl;
-            return false;
+            ID3D11Texture2D *texture = (ID3D11Texture2D *)currentFrame->data[0];
+            int textureIndex = (int)(intptr_t)currentFrame->data[1];
+            {
+                TelemetryScope scope(telemetry, Telemetry::RenderFrame);
+                renderer->RenderFrame(texture, textureIndex, currentFrame->width, currentFrame->height,
+                                      currentFrame->sample_aspect_ratio.num, currentFrame->sample_aspect_ratio.den,
+                                      ColorConverter::GetColorSpec(currentFrame));
+            }
+            TrackFormat(currentFrame, texture);
         }
-
-        std::cout << "Decoder initialized with D3D11VA hardware acceleration\n"
-                  << "Frame duration: " << frameDurationMs << " ms/frame" << std::endl;
         return true;
     }
 
-    // Decode and render at most one frame; return false on EOF/error
-    bool DecodeOneFrame()
+    void SetPlaybackRate(double rate) { clock.SetRate(rate); }
+    double GetPlaybackRate() const { return clock.GetRate(); }
+    PresentationClock::Stats GetClockStats() const { return clock.GetStats(); }
+    LoadGovernor::Stats GetGovernorStats() const { return governor.GetStats(); }
+    bool IsLoadGovernorEnabled() const { return governorEnabled && !liveMode; }
+
+    bool IsLive() const { return liveMode; }
+
+    // Jump to a media position in seconds; the frame showing there is presented next. The
+    // first seek of a file builds the keyframe index unless playback already reached EOF.
+    bool SeekTo(double seconds)
     {
-        if (!formatCtx || !codecCtx || !packet || !frame)
+        if (!decodeThread || liveMode)
             return false;
 
-        int r = av_read_frame(formatCtx, packet);
-        if (r < 0)
-        {
-            // EOF or error
-            return false;
-        }
+        AVStream *stream = playlist.GetItem()->core.GetVideoStream();
+        int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        int64_t pts = start + (int64_t)std::llround((seconds > 0.0 ? seconds : 0.0) / av_q2d(stream->time_base));
 
-        if (packet->stream_index == videoStreamIndex)
-        {
-            if (avcodec_send_packet(codecCtx, packet) == 0)
-            {
-                if (avcodec_receive_frame(codecCtx, frame) == 0)
-                {
-                    if (frame->format == AV_PIX_FMT_D3D11)
-                    {
-                        ID3D11Texture2D *texture = (ID3D11Texture2D *)frame->data[0];
-                        int textureIndex = (int)(intptr_t)frame->data[1];
-                        renderer->RenderFrame(texture, textureIndex);
-
-                        // Pace to frame rate using SDL_Delay
-                        auto now = std::chrono::high_resolution_clock::now();
-                        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastFrameTime).count();
-                        double delay = frameDurationMs - elapsed;
-                        if (delay > 0)
-                            SDL_Delay((Uint32)delay);
-                        lastFrameTime = std::chrono::high_resolution_clock::now();
-                    }
-                    av_frame_unref(frame);
-                }
-            }
-        }
+        auto begin = PresentationClock::Clock::now();
+        bool seeked = decodeThread->Seek(pts);
+        lastSeekMs = std::chrono::duration<double, std::milli>(PresentationClock::Clock::now() - begin).count();
+        // The old frame stays on screen until the first one at the new position is decoded
+        clock.Unanchor();
+        governor.Restart(PresentationClock::Clock::now(), decodeThread->GetDecodeBusyMs());
+        underrunCounted = false;
+        return seeked;
+    }
 
-        av_packet_unref(packet);
-        return true;
+    // Media position of the frame on screen in seconds, within the current pass of a loop
+    double GetPosition() const
+    {
+        if (!currentFrame)
+            return 0.0;
+        AVStream *stream = playlist.GetItem()->core.GetVideoStream();
+        int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        int64_t offset = PresentationClock::FrameTimestamp(currentFrame) - start;
+        int64_t period = decodeThread->GetLoopPeriod();
+        if (period > 0 && offset >= period)
+            offset %= period;
+        return offset * av_q2d(stream->time_base);
+    }
+
+    const std::string &GetCurrentFile() const { return playlist.GetItem()->filename; }
+    size_t GetPlaylistIndex() const { return playlist.GetIndex(); }
+    size_t GetPlaylistSize() const { return playlist.GetSize(); }
+    // Completed passes of a looped file / playlist switches so far
+    uint64_t GetLoops() const { return decodeThread ? decodeThread->GetLoops() : 0; }
+    uint64_t GetItemSwitches() const { return playlist.GetStats().switches; }
+    // Frame cache of a looped file: bytes held, and whether passes now replay from it
+    size_t GetFrameCacheBytes() const
+    {
+        const PlaylistSequencer::Item *item = playlist.GetItem();
+        return item && item->cache ? item->cache->GetBytes() : 0;
+    }
+    bool IsReplayingCache() const { return decodeThread && decodeThread->IsReplayingCache(); }
+
+    // Mid-stream size / surface format changes shown so far, and the renderer's rebuilds for them
+    uint64_t GetFormatChanges() const { return formatChanges; }
+    ID3D11RendererBase::ReconfigStats GetRendererReconfigStats() const { return renderer->GetReconfigStats(); }
+
+    // Wall time of the last SeekTo call (stop, index lookup, reposition); -1 before the first
+    double GetLastSeekMs() const { return lastSeekMs; }
+    // Complete once a frame has been presented
+    const DecoderCore::StartupTimes &GetStartupTimes() const { return playlist.GetItem()->core.GetStartupTimes(); }
+
+    DecodeThread::LatencyStats GetLatencyStats() const
+    {
+        return decodeThread ? decodeThread->GetLatencyStats() : DecodeThread::LatencyStats();
+    }
+
+    FrameQueue::Stats GetQueueStats() const
+    {
+        return decodeThread ? decodeThread->GetQueueStats() : FrameQueue::Stats();
     }
 
     bool DecodeAndRender()
     {
         // Backward-compatible blocking loop without Win32 message pump
-        while (DecodeOneFrame())
+        while (RenderDueFrame())
         {
             // Let SDL update internal state; event handling is done in main
             SDL_PumpEvents();
+            SDL_Delay(1);
         }
         return true;
     }
 
     ~FFmpegD3D11Decoder()
     {
+        av_frame_free(&currentFrame);
+        playlist.Close();
+    }
+
+private:
+    // PlaylistSequencer::PrepareFunc: the player's input options and a D3D11VA backend for
+    // a playlist entry; runs on the pre-warm thread for all but the first
+    static IDecodeBackend *PrepareItem(DecoderCore &core, void *opaque)
+    {
+        FFmpegD3D11Decoder *self = (FFmpegD3D11Decoder *)opaque;
+        core.SetTelemetry(self->telemetry);
+        core.SetLowLatency(self->liveInput);
+        core.SetParamCache(self->paramCache);
+        core.SetIndexSidecar(self->indexSidecar);
+        core.SetInputFormat(self->inputFormat.empty() ? nullptr : self->inputFormat.c_str());
+        core.SetReadAhead(self->useReadAhead ? &self->readAheadConfig : nullptr);
+        core.SetDemuxThread(self->demuxQueueDepth);
+        // The queued frames and the one on screen hold decoder surfaces
+        return new D3D11VADecodeBackend(self->renderer->GetDevice(), self->renderer->GetContext(), self->queueDepth + 1);
+    }
+
+    // The current item is drained: once its last frame has been shown for its duration,
+    // continue with the pre-warmed next one. False at the end of the playlist.
+    bool AdvanceItem(PresentationClock::Clock::time_point now)
+    {
+        PlaylistSequencer::Step step = playlist.Advance(clock, currentFrame, now);
+        if (step == PlaylistSequencer::Step::End)
+            return false;
+        if (step != PlaylistSequencer::Step::Switched)
+            return true;
+
+        // currentFrame stays on screen until its successor is presented
+        decodeThread = playlist.GetItem()->decodeThread;
+        startupReported = false;
+        underrunCounted = false;
+        UseItemTiming();
+        // The new decoder starts at full quality; keep the degradation the old one needed
+        if (governorEnabled)
+            decodeThread->SetDiscard(LoadGovernor::SkipFrameFor(governor.GetLevel()),
+                                     LoadGovernor::SkipLoopFilterFor(governor.GetLevel()));
+        governor.Restart(now, decodeThread->GetDecodeBusyMs());
+        return true;
+    }
+
+    void UseItemTiming()
+    {
+        const AVStream *stream = playlist.GetItem()->core.GetVideoStream();
+        frameDurationMs = PlaylistSequencer::FrameDurationMs(stream);
+        frameDurationPts = PlaylistSequencer::FrameDurationPts(stream);
+    }
+
+    static void ReleaseTexture(void *opaque, uint8_t *data)
+    {
+        (void)opaque;
+        ((ID3D11Texture2D *)data)->Release();
+    }
+
+    // Log a switch in picture size or surface format (a new SPS, a playlist item) with the
+    // time the renderer spent rebuilding its resources for it. The format comes from the
+    // texture: frames replayed from the cache carry no frames context.
+    void TrackFormat(const AVFrame *frame, ID3D11Texture2D *texture)
+    {
+        D3D11_TEXTURE2D_DESC desc;
+        texture->GetDesc(&desc);
+        int format = (int)desc.Format;
+        if (frame->width == shownWidth && frame->height == shownHeight && format == shownFormat)
+            return;
+        if (shownFormat >= 0)
+        {
+            formatChanges++;
+            ID3D11RendererBase::ReconfigStats reconfig = renderer->GetReconfigStats();
+            const char *name = desc.Format == DXGI_FORMAT_NV12   ? "NV12"
+                               : desc.Format == DXGI_FORMAT_P010 ? "P010"
+                               : desc.Format == DXGI_FORMAT_P016 ? "P016"
+                                                                 : "other";
+            std::cout << "Format change: " << shownWidth << "x" << shownHeight << " -> " << frame->width << "x"
+                      << frame->height << " " << name << ", renderer rebuild " << reconfig.lastMs << " ms" << std::endl;
+        }
+        shownWidth = frame->width;
+        shownHeight = frame->height;
+        shownFormat = format;
+    }
+
+    // FrameCache copy: the decoder surface into a texture of its own, so cached frames do not
+    // pin the decoder's surface pool. Runs on the decode thread; the backend made the
+    // immediate context multithread protected.
+    static AVFrame *CopySurface(const AVFrame *src, void *opaque)
+    {
+        ID3D11RendererBase *render = (ID3D11RendererBase *)opaque;
+        if (src->format != AV_PIX_FMT_D3D11)
+            return nullptr;
+        ID3D11Texture2D *source = (ID3D11Texture2D *)src->data[0];
+        D3D11_TEXTURE2D_DESC desc;
+        source->GetDesc(&desc);
+        desc.ArraySize = 1;
+        desc.MiscFlags = 0;
+        ID3D11Texture2D *texture = nullptr;
+        if (FAILED(render->GetDevice()->CreateTexture2D(&desc, nullptr, &texture)))
+            return nullptr;
+        render->GetContext()->CopySubresourceRegion(texture, 0, 0, 0, 0, source, (UINT)(intptr_t)src->data[1], nullptr);
+
+        AVFrame *frame = av_frame_alloc();
         if (frame)
+            frame->buf[0] = av_buffer_create((uint8_t *)texture, 0, ReleaseTexture, nullptr, 0);
+        if (!frame || !frame->buf[0])
+        {
+            texture->Release();
             av_frame_free(&frame);
-        if (packet)
-            av_packet_free(&packet);
-        if (codecCtx)
-            avcodec_free_context(&codecCtx);
-        if (formatCtx)
-            avformat_close_input(&formatCtx);
-        if (hwDeviceCtx)
-            av_buffer_unref(&hwDeviceCtx);
+            return nullptr;
+        }
+        av_frame_copy_props(frame, src);
+        frame->format = src->format;
+        frame->width = src->width;
+        frame->height = src->height;
+        frame->data[0] = (uint8_t *)texture;
+        frame->data[1] = 0;
+        return frame;
     }
 };
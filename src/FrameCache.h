@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/hwcontext.h>
+#include <libavutil/imgutils.h>
+}
+
+// One pass of a short clip kept in memory, in display order, so a loop can replay it
+// without decoding. Frames are copies that do not hold decoder pool surfaces (copy
+// makes them; the default, av_frame_clone, only suits software frames from pools that
+// grow). Filling stops for good once the clip is larger than the budget.
+class FrameCache
+{
+public:
+    // New frame with the picture of src that outlives the decoder's pool, or nullptr
+    using CopyFunc = AVFrame *(*)(const AVFrame *src, void *opaque);
+
+private:
+    std::vector<AVFrame *> frames;
+    size_t budget;
+    size_t bytes = 0;
+    CopyFunc copy;
+    void *copyOpaque;
+    bool complete = false;
+    bool overBudget = false;
+    int64_t period = 0;
+
+public:
+    explicit FrameCache(size_t budgetBytes, CopyFunc copyFunc = nullptr, void *opaque = nullptr)
+        : budget(budgetBytes), copy(copyFunc), copyOpaque(opaque)
+    {
+    }
+    FrameCache(const FrameCache &) = delete;
+    FrameCache &operator=(const FrameCache &) = delete;
+    ~FrameCache() { Clear(); }
+
+    // Decode thread: append a copy of the next frame of the pass; false (and the cache is
+    // emptied) once the clip does not fit
+    bool Add(const AVFrame *frame)
+    {
+        if (complete || overBudget)
+            return false;
+        size_t size = FrameBytes(frame);
+        if (bytes + size > budget)
+        {
+            Clear();
+            overBudget = true;
+            return false;
+        }
+        AVFrame *copied = copy ? copy(frame, copyOpaque) : av_frame_clone(frame);
+        if (!copied)
+        {
+            Clear();
+            overBudget = true;
+            return false;
+        }
+        frames.push_back(copied);
+        bytes += size;
+        return true;
+    }
+
+    // The pass ended: every frame of the clip is cached; periodPts is its length in the
+    // stream time base (first timestamp to the end of the last frame)
+    void Complete(int64_t periodPts)
+    {
+        if (overBudget || frames.empty())
+            return;
+        complete = true;
+        period = periodPts;
+    }
+
+    // New reference to frame i with its timestamps moved by offset; caller frees it
+    AVFrame *CloneFrame(size_t i, int64_t offset) const
+    {
+        if (i >= frames.size())
+            return nullptr;
+        AVFrame *frame = av_frame_clone(frames[i]);
+        if (!frame)
+            return nullptr;
+        if (frame->pts != AV_NOPTS_VALUE)
+            frame->pts += offset;
+        frame->best_effort_timestamp += offset;
+        return frame;
+    }
+
+    // Drop a partial pass (e.g. a seek interrupted it); a complete one is kept
+    void Abandon()
+    {
+        if (!complete)
+            Clear();
+    }
+
+    void Clear()
+    {
+        for (AVFrame *frame : frames)
+            av_frame_free(&frame);
+        frames.clear();
+        bytes = 0;
+        complete = false;
+        period = 0;
+    }
+
+    bool IsComplete() const { return complete; }
+    bool IsOverBudget() const { return overBudget; }
+    size_t GetFrameCount() const { return frames.size(); }
+    size_t GetBytes() const { return bytes; }
+    size_t GetBudget() const { return budget; }
+    int64_t GetPeriod() const { return period; }
+
+    // Picture size of a frame in its software format (hardware frames: the pool's)
+    static size_t FrameBytes(const AVFrame *frame)
+    {
+        AVPixelFormat format = (AVPixelFormat)frame->format;
+        if (frame->hw_frames_ctx)
+            format = ((AVHWFramesContext *)frame->hw_frames_ctx->data)->sw_format;
+        int size = av_image_get_buffer_size(format, frame->width, frame->height, 1);
+        // Copies of hardware surfaces without a frames context: assume 4:2:0 8-bit
+        return size > 0 ? (size_t)size : (size_t)frame->width * frame->height * 3 / 2;
+    }
+};
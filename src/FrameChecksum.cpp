@@ -0,0 +1,261 @@
+#include "FrameChecksum.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+extern "C"
+{
+#include <libavutil/crc.h>
+#include <libavutil/hwcontext.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/md5.h>
+#include <libavutil/mem.h>
+#include <libavutil/pixdesc.h>
+}
+
+std::string FrameDigest::ToLine() const
+{
+    char buf[64];
+    std::ostringstream line;
+    line << index << " " << pts << " " << width << "x" << height << " " << format << " " << md5;
+    for (int p = 0; p < planes; p++)
+    {
+        std::snprintf(buf, sizeof(buf), " %08" PRIx32, crc[p]);
+        line << buf;
+    }
+    return line.str();
+}
+
+bool FrameDigest::Parse(const std::string &line, FrameDigest &digest)
+{
+    std::istringstream in(line);
+    std::string size;
+    digest = FrameDigest();
+    if (!(in >> digest.index >> digest.pts >> size >> digest.format >> digest.md5))
+        return false;
+    if (std::sscanf(size.c_str(), "%dx%d", &digest.width, &digest.height) != 2)
+        return false;
+
+    std::string crc;
+    while (digest.planes < 4 && in >> crc)
+        digest.crc[digest.planes++] = (uint32_t)std::strtoul(crc.c_str(), nullptr, 16);
+    return digest.planes > 0;
+}
+
+FrameChecksumSink::FrameChecksumSink() : swFrame(av_frame_alloc()) {}
+
+FrameChecksumSink::~FrameChecksumSink()
+{
+    av_frame_free(&swFrame);
+}
+
+bool FrameChecksumSink::Compute(const AVFrame *frame, int64_t index, FrameDigest &digest)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+    int rowBytes[4];
+    if (!desc || (desc->flags & AV_PIX_FMT_FLAG_HWACCEL) ||
+        av_image_fill_linesizes(rowBytes, (AVPixelFormat)frame->format, frame->width) < 0)
+        return false;
+
+    digest = FrameDigest();
+    digest.index = index;
+    digest.pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    digest.width = frame->width;
+    digest.height = frame->height;
+    digest.format = desc->name;
+    digest.planes = av_pix_fmt_count_planes((AVPixelFormat)frame->format);
+
+    AVMD5 *md5 = av_md5_alloc();
+    if (!md5)
+        return false;
+    av_md5_init(md5);
+    const AVCRC *table = av_crc_get_table(AV_CRC_32_IEEE_LE);
+    for (int p = 0; p < digest.planes; p++)
+    {
+        bool chroma = (p == 1 || p == 2) && !(desc->flags & AV_PIX_FMT_FLAG_RGB);
+        int rows = chroma ? -((-frame->height) >> desc->log2_chroma_h) : frame->height;
+        uint32_t crc = 0xFFFFFFFFu;
+        for (int row = 0; row < rows; row++)
+        {
+            const uint8_t *data = frame->data[p] + (ptrdiff_t)row * frame->linesize[p];
+            av_md5_update(md5, data, rowBytes[p]);
+            crc = av_crc(table, crc, data, rowBytes[p]);
+        }
+        digest.crc[p] = crc ^ 0xFFFFFFFFu;
+    }
+
+    uint8_t sum[16];
+    av_md5_final(md5, sum);
+    av_free(md5);
+    char hex[33];
+    for (int i = 0; i < 16; i++)
+        std::snprintf(hex + i * 2, 3, "%02x", sum[i]);
+    digest.md5 = hex;
+    return true;
+}
+
+bool FrameChecksumSink::OnFrame(AVFrame *frame)
+{
+    const AVFrame *src = frame;
+    if (frame->hw_frames_ctx)
+    {
+        av_frame_unref(swFrame);
+        if (av_hwframe_transfer_data(swFrame, frame, 0) < 0)
+        {
+            std::cerr << "Failed to download hardware frame" << std::endl;
+            return false;
+        }
+        av_frame_copy_props(swFrame, frame);
+        src = swFrame;
+    }
+
+    FrameDigest digest;
+    if (!Compute(src, (int64_t)digests.size(), digest))
+    {
+        std::cerr << "Cannot checksum " << av_get_pix_fmt_name((AVPixelFormat)src->format) << " frames" << std::endl;
+        return false;
+    }
+    digests.push_back(digest);
+    return true;
+}
+
+bool FrameChecksumSink::WriteGolden(const char *path, const std::vector<FrameDigest> &frames, const std::string &comment)
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+    {
+        std::cerr << "Cannot write golden file " << path << std::endl;
+        return false;
+    }
+    out << "# " << comment << "\n";
+    out << "# index pts size format md5 crc32-per-plane\n";
+    for (const FrameDigest &d : frames)
+        out << d.ToLine() << "\n";
+    return (bool)out;
+}
+
+bool FrameChecksumSink::ReadGolden(const char *path, std::vector<FrameDigest> &frames)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+
+    frames.clear();
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        FrameDigest digest;
+        if (!FrameDigest::Parse(line, digest))
+        {
+            std::cerr << "Malformed golden line in " << path << ": " << line << std::endl;
+            return false;
+        }
+        frames.push_back(digest);
+    }
+    return true;
+}
+
+FrameChecksumSink::Comparison FrameChecksumSink::Compare(const std::vector<FrameDigest> &expected,
+                                                         const std::vector<FrameDigest> &actual)
+{
+    Comparison result;
+    result.expectedFrames = expected.size();
+    result.actualFrames = actual.size();
+    result.compared = std::min(expected.size(), actual.size());
+
+    for (size_t i = 0; i < result.compared; i++)
+    {
+        const FrameDigest &e = expected[i], &a = actual[i];
+        if (e.ToLine() == a.ToLine())
+            continue;
+        if (result.mismatched++ > 0)
+            continue;
+
+        // Name the first field that differs: output order, geometry, then content
+        std::ostringstream what;
+        what << "frame " << i << ": ";
+        if (e.pts != a.pts)
+            what << "pts " << a.pts << ", expected " << e.pts << " (output order)";
+        else if (e.width != a.width || e.height != a.height || e.format != a.format)
+            what << a.width << "x" << a.height << " " << a.format << ", expected " << e.width << "x" << e.height << " "
+                 << e.format;
+        else
+        {
+            what << "content differs in plane";
+            for (int p = 0; p < std::max(e.planes, a.planes) && p < 4; p++)
+            {
+                if (e.crc[p] != a.crc[p])
+                    what << " " << p;
+            }
+        }
+        result.firstMismatch = what.str();
+    }
+
+    if (result.firstMismatch.empty() && expected.size() != actual.size())
+    {
+        std::ostringstream what;
+        what << actual.size() << " frames, expected " << expected.size();
+        result.firstMismatch = what.str();
+    }
+    return result;
+}
+
+bool FrameChecksumSink::ReadFrameMd5(const char *path, std::vector<std::string> &md5s)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+
+    // "stream, dts, pts, duration, size, hash"
+    md5s.clear();
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        size_t comma = line.rfind(',');
+        size_t start = line.find_first_not_of(' ', comma == std::string::npos ? 0 : comma + 1);
+        size_t end = line.find_last_not_of(" \r");
+        if (comma == std::string::npos || start == std::string::npos || end - start + 1 != 32)
+        {
+            std::cerr << "Malformed framemd5 line in " << path << ": " << line << std::endl;
+            return false;
+        }
+        md5s.push_back(line.substr(start, 32));
+    }
+    return true;
+}
+
+FrameChecksumSink::Comparison FrameChecksumSink::CompareMd5(const std::vector<std::string> &expected,
+                                                            const std::vector<FrameDigest> &actual)
+{
+    Comparison result;
+    result.expectedFrames = expected.size();
+    result.actualFrames = actual.size();
+    result.compared = std::min(expected.size(), actual.size());
+
+    for (size_t i = 0; i < result.compared; i++)
+    {
+        if (expected[i] == actual[i].md5)
+            continue;
+        if (result.mismatched++ > 0)
+            continue;
+        std::ostringstream what;
+        what << "frame " << i << ": md5 " << actual[i].md5 << ", expected " << expected[i];
+        result.firstMismatch = what.str();
+    }
+
+    if (result.firstMismatch.empty() && expected.size() != actual.size())
+    {
+        std::ostringstream what;
+        what << actual.size() << " frames, expected " << expected.size();
+        result.firstMismatch = what.str();
+    }
+    return result;
+}
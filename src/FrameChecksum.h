@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FrameSink.h"
+
+// Checksums of one decoded picture: MD5 over every plane plus a CRC-32 per plane, both
+// over the visible bytes only (width x height of each plane, row by row), so the result
+// does not depend on linesize, padding or the frame allocator
+struct FrameDigest
+{
+    int64_t index = 0; // output order
+    int64_t pts = 0;   // best effort; AV_NOPTS_VALUE when unknown
+    int width = 0;
+    int height = 0;
+    std::string format;
+    std::string md5; // 32 hex digits
+    int planes = 0;
+    uint32_t crc[4] = {};
+
+    // "index pts WxH format md5 crc0 [crc1 ...]"
+    std::string ToLine() const;
+    static bool Parse(const std::string &line, FrameDigest &digest);
+};
+
+// Frame sink recording a FrameDigest per frame, for golden-output regression checks.
+// Hardware frames are downloaded first.
+class FrameChecksumSink : public IFrameSink
+{
+public:
+    struct Comparison
+    {
+        size_t compared = 0;   // frames present in both lists
+        size_t mismatched = 0; // of those, frames whose line differs
+        size_t expectedFrames = 0;
+        size_t actualFrames = 0;
+        std::string firstMismatch; // description of the first difference, empty if none
+
+        bool Passed() const { return mismatched == 0 && expectedFrames == actualFrames; }
+    };
+
+private:
+    AVFrame *swFrame = nullptr;
+    std::vector<FrameDigest> digests;
+
+public:
+    FrameChecksumSink();
+    FrameChecksumSink(const FrameChecksumSink &) = delete;
+    FrameChecksumSink &operator=(const FrameChecksumSink &) = delete;
+    ~FrameChecksumSink() override;
+
+    bool OnFrame(AVFrame *frame) override;
+
+    const std::vector<FrameDigest> &GetDigests() const { return digests; }
+    void Reset() { digests.clear(); }
+
+    // False for hardware or bitstream formats without a plane layout
+    static bool Compute(const AVFrame *frame, int64_t index, FrameDigest &digest);
+
+    // Golden files: '#' comment lines, then one ToLine() per frame
+    static bool WriteGolden(const char *path, const std::vector<FrameDigest> &frames, const std::string &comment);
+    static bool ReadGolden(const char *path, std::vector<FrameDigest> &frames);
+    static Comparison Compare(const std::vector<FrameDigest> &expected, const std::vector<FrameDigest> &actual);
+
+    // Reference from ffmpeg itself ("ffmpeg -i clip -f framemd5 clip.framemd5"): the hash of each
+    // raw picture equals FrameDigest::md5. Its timestamps are in the muxer's time base, so only
+    // the MD5 column is read and the comparison covers frame count, order and content.
+    static bool ReadFrameMd5(const char *path, std::vector<std::string> &md5s);
+    static Comparison CompareMd5(const std::vector<std::string> &expected, const std::vector<FrameDigest> &actual);
+};
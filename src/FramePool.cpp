@@ -0,0 +1,327 @@
+#include "FramePool.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+extern "C"
+{
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+static constexpr size_t kAlignment = 64;
+// Decoders may read slightly past the end of a plane
+static constexpr size_t kPlanePadding = 64;
+static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+static size_t AlignUp(size_t v, size_t a) { return (v + a - 1) & ~(a - 1); }
+
+FramePool::~FramePool()
+{
+    for (Slab *slab : freeSlabs)
+        FreeSlab(slab);
+}
+
+void FramePool::Release()
+{
+    bool destroy;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        released = true;
+        for (Slab *slab : freeSlabs)
+            FreeSlab(slab);
+        freeSlabs.clear();
+        destroy = outstanding == 0;
+    }
+    if (destroy)
+        delete this;
+}
+
+void FramePool::Attach(AVCodecContext *codecCtx)
+{
+    codecCtx->opaque = this;
+    codecCtx->get_buffer2 = GetBuffer2;
+}
+
+FramePool::Stats FramePool::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+int FramePool::GetBuffer2(AVCodecContext *codecCtx, AVFrame *frame, int flags)
+{
+    FramePool *pool = (FramePool *)codecCtx->opaque;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+
+    // Hardware surfaces and decoders that cannot use custom buffers keep the default allocator
+    if (!pool || !desc || (desc->flags & AV_PIX_FMT_FLAG_HWACCEL) || !(codecCtx->codec->capabilities & AV_CODEC_CAP_DR1))
+        return avcodec_default_get_buffer2(codecCtx, frame, flags);
+
+    return pool->Allocate(codecCtx, frame);
+}
+
+// AVBuffer free callback; data is slab->data
+void FramePool::ReturnSlab(void *opaque, uint8_t *)
+{
+    Slab *slab = (Slab *)opaque;
+    FramePool *pool = slab->pool;
+    bool destroy = false;
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->stats.inUse--;
+        pool->outstanding--;
+        // Slabs from an older frame geometry or a released pool are not recycled
+        if (pool->released || slab->generation != pool->generation)
+            pool->FreeSlab(slab);
+        else
+            pool->freeSlabs.push_back(slab);
+        destroy = pool->released && pool->outstanding == 0;
+    }
+    if (destroy)
+        delete pool;
+}
+
+int FramePool::Allocate(AVCodecContext *codecCtx, AVFrame *frame)
+{
+    Slab *slab = nullptr;
+    Layout current;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (frame->format != layout.format || frame->width != layout.width || frame->height != layout.height)
+        {
+            Layout next;
+            if (!ComputeLayout(codecCtx, frame->format, frame->width, frame->height, next))
+                return avcodec_default_get_buffer2(codecCtx, frame, 0);
+
+            // New geometry (mid-stream SPS change): idle slabs big enough for it move to the new
+            // generation, the rest are dropped and outstanding ones are freed as they return
+            if (layout.format >= 0)
+                stats.relayouts++;
+            layout = next;
+            generation++;
+            stats.bufferSize = layout.size;
+            stats.preallocated = TargetSlabCount(codecCtx);
+            std::vector<Slab *> idle;
+            idle.swap(freeSlabs);
+            for (Slab *s : idle)
+            {
+                if (s->size >= layout.size && (int)freeSlabs.size() < stats.preallocated)
+                {
+                    s->generation = generation;
+                    freeSlabs.push_back(s);
+                    stats.slabsReused++;
+                }
+                else
+                {
+                    FreeSlab(s);
+                }
+            }
+
+            for (int i = (int)freeSlabs.size(); i < stats.preallocated; i++)
+            {
+                if (config.maxBytes && stats.bytesReserved + layout.size > config.maxBytes)
+                    break;
+                Slab *s = NewSlab();
+                if (!s)
+                    break;
+                freeSlabs.push_back(s);
+            }
+        }
+
+        if (!freeSlabs.empty())
+        {
+            slab = freeSlabs.back();
+            freeSlabs.pop_back();
+        }
+        else
+        {
+            if (config.maxBytes && stats.bytesReserved + layout.size > config.maxBytes)
+            {
+                stats.capRejects++;
+                return AVERROR(ENOMEM);
+            }
+            slab = NewSlab();
+            if (!slab)
+                return AVERROR(ENOMEM);
+        }
+
+        outstanding++;
+        stats.inUse++;
+        stats.acquisitions++;
+        if (stats.inUse > stats.highWater)
+            stats.highWater = stats.inUse;
+        current = layout;
+    }
+
+    frame->buf[0] = av_buffer_create(slab->data, slab->size, ReturnSlab, slab, 0);
+    if (!frame->buf[0])
+    {
+        ReturnSlab(slab, slab->data);
+        return AVERROR(ENOMEM);
+    }
+
+    for (int i = 0; i < current.planes; i++)
+    {
+        frame->data[i] = slab->data + current.offset[i];
+        frame->linesize[i] = current.linesize[i];
+    }
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+bool FramePool::ComputeLayout(AVCodecContext *codecCtx, int format, int width, int height, Layout &out)
+{
+    AVPixelFormat fmt = (AVPixelFormat)format;
+    int w = width, h = height;
+    int strideAlign[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(codecCtx, &w, &h, strideAlign);
+
+    int linesize[4];
+    if (av_image_fill_linesizes(linesize, fmt, w) < 0)
+        return false;
+
+    out.planes = av_pix_fmt_count_planes(fmt);
+    if (out.planes <= 0 || out.planes > 4)
+        return false;
+
+    ptrdiff_t alignedLinesize[4] = {};
+    for (int i = 0; i < out.planes; i++)
+    {
+        size_t align = strideAlign[i] > (int)kAlignment ? (size_t)strideAlign[i] : kAlignment;
+        out.linesize[i] = (int)AlignUp((size_t)linesize[i], align);
+        alignedLinesize[i] = out.linesize[i];
+    }
+
+    size_t planeSize[4] = {};
+    if (av_image_fill_plane_sizes(planeSize, fmt, h, alignedLinesize) < 0)
+        return false;
+
+    size_t offset = 0;
+    for (int i = 0; i < out.planes; i++)
+    {
+        out.offset[i] = offset;
+        offset = AlignUp(offset + planeSize[i] + kPlanePadding, kAlignment);
+    }
+
+    out.format = format;
+    out.width = width;
+    out.height = height;
+    out.size = offset;
+    return true;
+}
+
+int FramePool::TargetSlabCount(const AVCodecContext *codecCtx) const
+{
+    // DPB references + reorder delay + one frame in flight per frame thread + frames
+    // held downstream + the frame being decoded and the one being output
+    int refs = codecCtx->refs > 0 ? codecCtx->refs : 1;
+    int threads = (codecCtx->thread_type & FF_THREAD_FRAME) ? codecCtx->thread_count : 0;
+    return refs + codecCtx->has_b_frames + threads + config.extraFrames + 2;
+}
+
+FramePool::Slab *FramePool::NewSlab()
+{
+    Slab *slab = new Slab();
+    slab->pool = this;
+    slab->size = layout.size;
+    slab->generation = generation;
+
+    if (config.hugePages)
+    {
+        size_t rounded = AlignUp(layout.size, kHugePageSize);
+#ifdef _WIN32
+        // Needs SeLockMemoryPrivilege; falls back to regular pages otherwise
+        SIZE_T largePage = GetLargePageMinimum();
+        if (largePage)
+        {
+            rounded = AlignUp(layout.size, largePage);
+            void *p = VirtualAlloc(nullptr, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (p)
+            {
+                slab->data = (uint8_t *)p;
+                slab->mappedSize = rounded;
+                stats.hugePages = true;
+            }
+        }
+#else
+        void *p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            stats.hugePages = true;
+        }
+        else
+        {
+            // No reserved hugetlbfs pages: ask for transparent huge pages instead
+            p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p != MAP_FAILED)
+                madvise(p, rounded, MADV_HUGEPAGE);
+        }
+        if (p != MAP_FAILED)
+        {
+            slab->data = (uint8_t *)p;
+            slab->mappedSize = rounded;
+        }
+#endif
+    }
+
+    if (!slab->data)
+    {
+#ifdef _WIN32
+        slab->data = (uint8_t *)_aligned_malloc(layout.size, kAlignment);
+#else
+        void *p = nullptr;
+        if (posix_memalign(&p, kAlignment, layout.size) == 0)
+            slab->data = (uint8_t *)p;
+#endif
+    }
+
+    if (!slab->data)
+    {
+        std::cerr << "FramePool: failed to allocate " << layout.size << " bytes" << std::endl;
+        delete slab;
+        return nullptr;
+    }
+
+    // Pre-fault every page now rather than inside the decoder
+    std::memset(slab->data, 0, slab->size);
+
+    stats.allocated++;
+    stats.slabAllocations++;
+    stats.bytesReserved += slab->size;
+    if (stats.bytesReserved > stats.bytesHighWater)
+        stats.bytesHighWater = stats.bytesReserved;
+    return slab;
+}
+
+void FramePool::FreeSlab(Slab *slab)
+{
+    if (slab->mappedSize)
+    {
+#ifdef _WIN32
+        VirtualFree(slab->data, 0, MEM_RELEASE);
+#else
+        munmap(slab->data, slab->mappedSize);
+#endif
+    }
+    else
+    {
+#ifdef _WIN32
+        _aligned_free(slab->data);
+#else
+        std::free(slab->data);
+#endif
+    }
+
+    stats.allocated--;
+    stats.bytesReserved -= slab->size;
+    delete slab;
+}
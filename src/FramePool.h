@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+// get_buffer2 allocator for software decoding. Frame buffers are 64-byte aligned slabs
+// (optionally huge-page backed and pre-faulted) recycled through a free list, so steady
+// state decoding does no malloc/free and takes no page faults. The pool is sized from
+// the SPS on the first frame (reference frames + reorder delay + frame threads + extra
+// frames held downstream) and never grows past a hard byte cap. A mid-stream size or
+// format change re-lays out the pool, keeping idle slabs that are large enough.
+//
+// Frames may outlive the decoder (e.g. in a FrameQueue): the pool is reference counted
+// and deletes itself once the owner released it and the last buffer came back.
+class FramePool
+{
+public:
+    struct Config
+    {
+        size_t maxBytes = 0;  // hard cap on slab memory, 0 = unlimited
+        int extraFrames = 0;  // frames held outside the codec (queue depth, frame on screen)
+        bool hugePages = false;
+    };
+
+    struct Stats
+    {
+        size_t bufferSize = 0;    // bytes per slab
+        int preallocated = 0;     // slabs sized from the SPS
+        int allocated = 0;        // slabs currently owned by the pool
+        int inUse = 0;
+        int highWater = 0;        // max slabs in use at once
+        size_t bytesReserved = 0;
+        size_t bytesHighWater = 0;
+        uint64_t acquisitions = 0;
+        uint64_t slabAllocations = 0; // should stop growing once warmed up
+        uint64_t capRejects = 0;      // get_buffer2 calls refused by the byte cap
+        uint64_t relayouts = 0;       // frame size / format changes after the first frame
+        uint64_t slabsReused = 0;     // idle slabs large enough to carry over a relayout
+        bool hugePages = false;       // slabs are backed by huge pages
+    };
+
+    static FramePool *Create(const Config &config) { return new FramePool(config); }
+
+    // Owner is done with the pool; it is freed when the last frame buffer returns
+    void Release();
+
+    // Install on a codec context before avcodec_open2
+    void Attach(AVCodecContext *codecCtx);
+
+    Stats GetStats();
+
+private:
+    struct Slab
+    {
+        FramePool *pool = nullptr;
+        uint8_t *data = nullptr;
+        size_t size = 0;
+        size_t mappedSize = 0; // non-zero when mmap'ed
+        int generation = 0;
+    };
+
+    // Frame layout shared by every slab of the current generation
+    struct Layout
+    {
+        int format = -1;
+        int width = 0;
+        int height = 0;
+        int linesize[4] = {};
+        size_t offset[4] = {};
+        int planes = 0;
+        size_t size = 0;
+    };
+
+    Config config;
+    std::mutex mutex;
+    Layout layout;
+    int generation = 0;
+    std::vector<Slab *> freeSlabs;
+    int outstanding = 0; // slabs handed to frames
+    bool released = false;
+    Stats stats;
+
+    explicit FramePool(const Config &cfg) : config(cfg) {}
+    ~FramePool();
+
+    static int GetBuffer2(AVCodecContext *codecCtx, AVFrame *frame, int flags);
+    static void ReturnSlab(void *opaque, uint8_t *data);
+
+    int Allocate(AVCodecContext *codecCtx, AVFrame *frame);
+    bool ComputeLayout(AVCodecContext *codecCtx, int format, int width, int height, Layout &out);
+    int TargetSlabCount(const AVCodecContext *codecCtx) const;
+    Slab *NewSlab();
+    void FreeSlab(Slab *slab);
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+}
+
+// Bounded single-producer / single-consumer ring of refcounted AVFrames.
+// The producer (decode thread) blocks when the ring is full; the consumer
+// (present thread) never blocks and counts an underrun when it finds it empty.
+class FrameQueue
+{
+public:
+    struct Stats
+    {
+        size_t capacity = 0;
+        size_t occupancy = 0;
+        uint64_t pushed = 0;
+        uint64_t popped = 0;
+        uint64_t overruns = 0;  // pushes that had to wait for a free slot
+        uint64_t underruns = 0; // pops that found the ring empty
+    };
+
+private:
+    std::vector<AVFrame *> slots;
+    size_t capacity;
+    // Monotonic indices; slot = index % capacity
+    alignas(64) std::atomic<uint64_t> writeIndex{0};
+    alignas(64) std::atomic<uint64_t> readIndex{0};
+    // Bumped on every pop and on Close() so a blocked producer can wait on it
+    alignas(64) std::atomic<uint32_t> popSignal{0};
+    std::atomic<bool> closed{false};
+    std::atomic<uint64_t> overruns{0};
+    std::atomic<uint64_t> underruns{0};
+
+public:
+    explicit FrameQueue(size_t depth) : slots(depth < 1 ? 1 : depth, nullptr), capacity(depth < 1 ? 1 : depth) {}
+
+    FrameQueue(const FrameQueue &) = delete;
+    FrameQueue &operator=(const FrameQueue &) = delete;
+
+    ~FrameQueue() { Clear(); }
+
+    // Producer: take ownership of frame; false if the ring is full
+    bool TryPush(AVFrame *frame)
+    {
+        uint64_t w = writeIndex.load(std::memory_order_relaxed);
+        if (w - readIndex.load(std::memory_order_acquire) >= capacity)
+            return false;
+        slots[w % capacity] = frame;
+        writeIndex.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer: wait for a free slot (backpressure); false if the queue was closed,
+    // in which case the caller still owns frame
+    bool Push(AVFrame *frame)
+    {
+        bool waited = false;
+        while (!TryPush(frame))
+        {
+            if (closed.load(std::memory_order_acquire))
+                return false;
+            if (!waited)
+            {
+                overruns.fetch_add(1, std::memory_order_relaxed);
+                waited = true;
+            }
+            uint32_t seen = popSignal.load(std::memory_order_acquire);
+            if (Size() < capacity || closed.load(std::memory_order_acquire))
+                continue;
+            popSignal.wait(seen, std::memory_order_acquire);
+        }
+        return true;
+    }
+
+    // Consumer: oldest frame without removing it, or nullptr
+    AVFrame *Peek() const
+    {
+        uint64_t r = readIndex.load(std::memory_order_relaxed);
+        if (r == writeIndex.load(std::memory_order_acquire))
+            return nullptr;
+        return slots[r % capacity];
+    }
+
+    // Consumer: remove the oldest frame and transfer ownership, or nullptr (underrun)
+    AVFrame *Pop()
+    {
+        uint64_t r = readIndex.load(std::memory_order_relaxed);
+        if (r == writeIndex.load(std::memory_order_acquire))
+        {
+            underruns.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        AVFrame *frame = slots[r % capacity];
+        readIndex.store(r + 1, std::memory_order_release);
+        popSignal.fetch_add(1, std::memory_order_release);
+        popSignal.notify_one();
+        return frame;
+    }
+
+    // Consumer: a frame was due but none was queued (for consumers that only Peek)
+    void RecordUnderrun() { underruns.fetch_add(1, std::memory_order_relaxed); }
+
+    // Wake a blocked producer and make further Push calls fail
+    void Close()
+    {
+        closed.store(true, std::memory_order_release);
+        popSignal.fetch_add(1, std::memory_order_release);
+        popSignal.notify_all();
+    }
+
+    // With the producer stopped (e.g. for a seek): accept frames again after Close
+    void Reopen() { closed.store(false, std::memory_order_release); }
+
+    // Consumer (or after the producer stopped): free every queued frame
+    void Clear()
+    {
+        AVFrame *frame;
+        while ((frame = Peek()) != nullptr)
+        {
+            readIndex.fetch_add(1, std::memory_order_release);
+            av_frame_free(&frame);
+        }
+        popSignal.fetch_add(1, std::memory_order_release);
+        popSignal.notify_all();
+    }
+
+    size_t Size() const
+    {
+        return (size_t)(writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire));
+    }
+
+    size_t Capacity() const { return capacity; }
+
+    Stats GetStats() const
+    {
+        Stats s;
+        s.capacity = capacity;
+        s.pushed = writeIndex.load(std::memory_order_relaxed);
+        s.popped = readIndex.load(std::memory_order_relaxed);
+        s.occupancy = (size_t)(s.pushed - s.popped);
+        s.overruns = overruns.load(std::memory_order_relaxed);
+        s.underruns = underruns.load(std::memory_order_relaxed);
+        return s;
+    }
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+extern "C"
+{
+#include <libavutil/frame.h>
+}
+
+// Receives decoded frames from DecoderCore
+class IFrameSink
+{
+public:
+    virtual ~IFrameSink() = default;
+
+    // Called once per decoded frame. The frame is unreferenced after the call returns,
+    // so a sink that keeps it must take its own reference (av_frame_ref / av_frame_clone).
+    // Return false to stop decoding.
+    virtual bool OnFrame(AVFrame *frame) = 0;
+};
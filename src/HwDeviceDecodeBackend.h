@@ -0,0 +1,41 @@
+#pragma once
+
+#include "DecodeBackend.h"
+#include <iostream>
+
+extern "C"
+{
+#include <libavutil/hwcontext.h>
+}
+
+// Hardware decoding on a device created by FFmpeg itself (VAAPI, CUDA, standalone D3D11VA...).
+// Frames stay in device memory; sinks that need pixels call av_hwframe_transfer_data.
+class HwDeviceDecodeBackend : public IDecodeBackend
+{
+private:
+    AVHWDeviceType deviceType;
+    AVBufferRef *hwDeviceCtx = nullptr;
+
+public:
+    explicit HwDeviceDecodeBackend(AVHWDeviceType type) : deviceType(type) {}
+
+    ~HwDeviceDecodeBackend() override
+    {
+        if (hwDeviceCtx)
+            av_buffer_unref(&hwDeviceCtx);
+    }
+
+    const char *GetName() const override { return av_hwdevice_get_type_name(deviceType); }
+
+    bool ConfigureCodec(AVCodecContext *codecCtx) override
+    {
+        if (!hwDeviceCtx && av_hwdevice_ctx_create(&hwDeviceCtx, deviceType, nullptr, nullptr, 0) < 0)
+        {
+            std::cerr << "Failed to create " << GetName() << " device" << std::endl;
+            return false;
+        }
+
+        codecCtx->hw_device_ctx = av_buffer_ref(hwDeviceCtx);
+        return true;
+    }
+};
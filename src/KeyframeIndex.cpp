@@ -0,0 +1,102 @@
+#include "KeyframeIndex.h"
+#include "StreamParamCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+static const char *const kMagic = "H264HW-KFINDEX 1";
+
+void KeyframeIndex::Clear()
+{
+    entries.clear();
+    endPts = AV_NOPTS_VALUE;
+    packetCount = 0;
+    complete = false;
+}
+
+void KeyframeIndex::Add(int64_t pts, int64_t pos, int64_t packet)
+{
+    if (pts == AV_NOPTS_VALUE || (!entries.empty() && pts <= entries.back().pts))
+        return;
+    entries.push_back({pts, pos, packet});
+}
+
+const KeyframeIndex::Entry *KeyframeIndex::Find(int64_t pts) const
+{
+    if (entries.empty())
+        return nullptr;
+    auto it = std::upper_bound(entries.begin(), entries.end(), pts,
+                               [](int64_t value, const Entry &entry) { return value < entry.pts; });
+    return it == entries.begin() ? &entries.front() : &*(it - 1);
+}
+
+void KeyframeIndex::SetComplete(int64_t streamEndPts, int64_t packets)
+{
+    endPts = streamEndPts;
+    packetCount = packets;
+    complete = true;
+}
+
+std::string KeyframeIndex::SidecarPath(const char *filename)
+{
+    return std::string(filename) + ".kfidx";
+}
+
+bool KeyframeIndex::Load(const char *filename)
+{
+    std::ifstream in(SidecarPath(filename));
+    std::string line, identity;
+    if (!in || !std::getline(in, line) || line != kMagic || !StreamParamCache::FileIdentity(filename, identity))
+        return false;
+
+    Clear();
+    bool identityMatches = false;
+    int64_t end = AV_NOPTS_VALUE, packets = 0;
+    while (std::getline(in, line))
+    {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+        std::string rest;
+        std::getline(fields >> std::ws, rest);
+
+        if (key == "identity")
+            identityMatches = rest == identity;
+        else if (key == "time_base")
+            std::sscanf(rest.c_str(), "%d/%d", &timeBase.num, &timeBase.den);
+        else if (key == "end")
+            std::sscanf(rest.c_str(), "%lld %lld", (long long *)&end, (long long *)&packets);
+        else if (key == "k")
+        {
+            long long pts, pos, packet;
+            if (std::sscanf(rest.c_str(), "%lld %lld %lld", &pts, &pos, &packet) != 3)
+                return false;
+            Add(pts, pos, packet);
+        }
+    }
+
+    if (!identityMatches || entries.empty() || timeBase.num <= 0 || timeBase.den <= 0)
+    {
+        Clear();
+        return false;
+    }
+    SetComplete(end, packets);
+    return true;
+}
+
+bool KeyframeIndex::Store(const char *filename) const
+{
+    std::string identity;
+    if (!complete || !StreamParamCache::FileIdentity(filename, identity))
+        return false;
+
+    std::ostringstream out;
+    out << kMagic << "\n"
+        << "identity " << identity << "\n"
+        << "time_base " << timeBase.num << "/" << timeBase.den << "\n"
+        << "end " << (long long)endPts << " " << (long long)packetCount << "\n";
+    for (const Entry &entry : entries)
+        out << "k " << (long long)entry.pts << " " << (long long)entry.pos << " " << (long long)entry.packet << "\n";
+    return StreamParamCache::WriteSidecar(SidecarPath(filename), out.str());
+}
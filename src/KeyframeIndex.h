@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+}
+
+// Sorted table of keyframes (timestamp, byte offset, decode-order packet number) of one
+// video stream, filled lazily while DecoderCore reads packets or completely by a
+// demux-only first pass. Optionally persisted next to the media file as "<file>.kfidx",
+// keyed by the same file identity as StreamParamCache.
+//
+// Timestamps are in the stream time base. Raw elementary streams carry none: their
+// keyframes are indexed at packet number * frame duration, which is also the timestamp
+// DecoderCore gives their frames.
+class KeyframeIndex
+{
+public:
+    struct Entry
+    {
+        int64_t pts = 0;
+        int64_t pos = -1;   // byte offset of the packet, -1 when unknown
+        int64_t packet = 0; // decode-order packet number
+    };
+
+private:
+    std::vector<Entry> entries;
+    AVRational timeBase = {0, 1};
+    int64_t endPts = AV_NOPTS_VALUE; // end of the last frame, once known
+    int64_t packetCount = 0;
+    bool complete = false;
+
+public:
+    void Clear();
+    void SetTimeBase(AVRational tb) { timeBase = tb; }
+    AVRational GetTimeBase() const { return timeBase; }
+
+    // Keyframes must arrive in stream order; earlier or repeated timestamps are ignored
+    void Add(int64_t pts, int64_t pos, int64_t packet);
+    // Keyframe at or before pts (the first one when pts precedes it), nullptr when empty
+    const Entry *Find(int64_t pts) const;
+
+    // The whole stream was scanned: every keyframe is present and the end is known
+    void SetComplete(int64_t streamEndPts, int64_t packets);
+    bool IsComplete() const { return complete; }
+    int64_t GetEndPts() const { return endPts; }
+    int64_t GetPacketCount() const { return packetCount; }
+
+    size_t Size() const { return entries.size(); }
+    const std::vector<Entry> &GetEntries() const { return entries; }
+
+    static std::string SidecarPath(const char *filename);
+    // Only complete indexes are stored; Load fails when the file changed since
+    bool Load(const char *filename);
+    bool Store(const char *filename) const;
+};
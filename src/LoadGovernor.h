@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+// Trades picture quality for keeping up with the presentation clock on an overloaded host.
+// The present thread reports every presented/dropped frame and, once per window, the decode
+// thread's busy time; when decoding is saturated and frames are late or dropped the level
+// steps up (skip deblocking, skip non-reference frames, keyframes only), and it steps back
+// down one level at a time only after several healthy windows at the level, so a transient
+// spike does not make it oscillate. It never prints; the caller logs changes with PrintChange.
+class LoadGovernor
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Level
+    {
+        Full,           // decode everything
+        SkipLoopFilter, // skip_loop_filter = AVDISCARD_ALL
+        SkipNonRef,     // + skip_frame = AVDISCARD_NONREF
+        KeyframesOnly   // skip_frame = AVDISCARD_NONKEY, non-key packets never reach the decoder
+    };
+    static constexpr int kLevelCount = 4;
+
+    struct Config
+    {
+        double windowMs = 500.0;         // evaluation period
+        double overloadBusy = 0.9;       // share of the window the decode thread spent decoding
+        double overloadDropRatio = 0.05; // dropped / (presented + dropped)
+        double overloadLateFrames = 1.0; // mean lateness, in frame intervals
+        double healthyBusy = 0.6;
+        int healthyWindows = 4;          // consecutive healthy windows before stepping down
+        double escalateDwellMs = 1000.0; // let the queued late frames drain before going further
+        double recoverDwellMs = 2000.0;  // minimum time at a level before stepping down;
+                                         // doubled each time a step down is undone quickly
+        double maxRecoverDwellMs = 30000.0;
+        Level maxLevel = Level::KeyframesOnly;
+    };
+
+    struct Stats
+    {
+        Level level = Level::Full;
+        Level previousLevel = Level::Full; // before the last change
+        uint64_t escalations = 0;
+        uint64_t deescalations = 0;
+        uint64_t entered[kLevelCount] = {}; // transitions into each level
+        double secondsAt[kLevelCount] = {};
+        // Last evaluated window
+        double busy = 0.0;
+        double dropRatio = 0.0;
+        double meanLateMs = 0.0;
+    };
+
+private:
+    Config config;
+    Level level = Level::Full;
+    bool started = false;
+    Clock::time_point windowStart;
+    Clock::time_point levelSince;
+    Clock::time_point accountedAt; // secondsAt is complete up to here
+    Clock::time_point lastDeescalation;
+    bool deescalatedOnce = false;
+    double windowBusyStartMs = 0.0;
+    double recoverDwellMs = 0.0;
+    int healthyCount = 0;
+    // Current window
+    uint64_t presented = 0;
+    uint64_t dropped = 0;
+    double lateSumMs = 0.0;
+    Stats stats;
+
+public:
+    LoadGovernor() : LoadGovernor(Config()) {}
+    explicit LoadGovernor(const Config &cfg) : config(cfg), recoverDwellMs(cfg.recoverDwellMs) {}
+
+    static const char *LevelName(Level l)
+    {
+        switch (l)
+        {
+        case Level::Full:
+            return "full";
+        case Level::SkipLoopFilter:
+            return "skip loop filter";
+        case Level::SkipNonRef:
+            return "skip non-reference";
+        case Level::KeyframesOnly:
+            return "keyframes only";
+        }
+        return "?";
+    }
+
+    // Codec settings of a level, for DecoderCore::SetSkipFrame / SetSkipLoopFilter
+    static AVDiscard SkipFrameFor(Level l)
+    {
+        return l == Level::KeyframesOnly ? AVDISCARD_NONKEY
+                                         : (l == Level::SkipNonRef ? AVDISCARD_NONREF : AVDISCARD_DEFAULT);
+    }
+
+    static AVDiscard SkipLoopFilterFor(Level l) { return l == Level::Full ? AVDISCARD_DEFAULT : AVDISCARD_ALL; }
+
+    // Frame outcomes of the current window; latenessMs as in PresentationClock::Stats
+    void OnPresented(double latenessMs)
+    {
+        presented++;
+        lateSumMs += std::max(latenessMs, 0.0);
+    }
+
+    void OnDropped() { dropped++; }
+
+    // Discard the current window (after a seek, while paused): its stall says nothing about load
+    void Restart(Clock::time_point now, double decodeBusyMs)
+    {
+        AccountTime(now);
+        windowStart = now;
+        windowBusyStartMs = decodeBusyMs;
+        presented = dropped = 0;
+        lateSumMs = 0.0;
+    }
+
+    // Call every present iteration. decodeBusyMs: the decode thread's cumulative busy time
+    // (DecodeThread::GetDecodeBusyMs); frameIntervalMs: wall time per frame at the current
+    // rate. Return true when the level changed; apply GetLevel() then.
+    bool Update(Clock::time_point now, double decodeBusyMs, double frameIntervalMs)
+    {
+        if (!started)
+        {
+            started = true;
+            levelSince = accountedAt = now;
+            Restart(now, decodeBusyMs);
+            return false;
+        }
+
+        double elapsedMs = std::chrono::duration<double, std::milli>(now - windowStart).count();
+        if (elapsedMs < config.windowMs)
+            return false;
+
+        uint64_t frames = presented + dropped;
+        stats.busy = std::clamp((decodeBusyMs - windowBusyStartMs) / elapsedMs, 0.0, 1.0);
+        stats.dropRatio = frames ? (double)dropped / frames : 0.0;
+        stats.meanLateMs = presented ? lateSumMs / presented : 0.0;
+        Restart(now, decodeBusyMs);
+
+        // Late frames with an idle decoder are a render/GPU problem that skipping decode
+        // work would not fix
+        bool late = stats.dropRatio >= config.overloadDropRatio ||
+                    stats.meanLateMs >= config.overloadLateFrames * frameIntervalMs;
+        bool overloaded = late && stats.busy >= config.overloadBusy;
+        bool healthy = stats.busy <= config.healthyBusy && dropped == 0 && stats.meanLateMs < 0.5 * frameIntervalMs;
+        healthyCount = healthy ? healthyCount + 1 : 0;
+
+        double atLevelMs = std::chrono::duration<double, std::milli>(now - levelSince).count();
+        if (overloaded && level < config.maxLevel && atLevelMs >= config.escalateDwellMs)
+        {
+            // Back up soon after stepping down: that level is not sustainable yet, wait longer next time
+            if (deescalatedOnce &&
+                std::chrono::duration<double, std::milli>(now - lastDeescalation).count() < 2.0 * recoverDwellMs)
+                recoverDwellMs = std::min(recoverDwellMs * 2.0, config.maxRecoverDwellMs);
+            SetLevel((Level)((int)level + 1), now);
+            stats.escalations++;
+            return true;
+        }
+        if (healthyCount >= config.healthyWindows && level > Level::Full && atLevelMs >= recoverDwellMs)
+        {
+            SetLevel((Level)((int)level - 1), now);
+            stats.deescalations++;
+            lastDeescalation = now;
+            deescalatedOnce = true;
+            return true;
+        }
+        return false;
+    }
+
+    Level GetLevel() const { return level; }
+
+    Stats GetStats() const { return stats; }
+
+    // One line on the last change and the window that caused it, after Update returned true
+    void PrintChange(std::ostream &out, double frameIntervalMs) const
+    {
+        out << "Load governor: " << LevelName(stats.previousLevel) << " -> " << LevelName(stats.level)
+            << " (decode busy " << (int)(stats.busy * 100.0 + 0.5) << "%, " << (int)(stats.dropRatio * 100.0 + 0.5)
+            << "% dropped, late " << stats.meanLateMs << " ms at " << frameIntervalMs << " ms/frame)" << std::endl;
+    }
+
+private:
+    void AccountTime(Clock::time_point now)
+    {
+        if (started)
+        {
+            stats.secondsAt[(int)level] += std::chrono::duration<double>(now - accountedAt).count();
+            accountedAt = now;
+        }
+    }
+
+    void SetLevel(Level next, Clock::time_point now)
+    {
+        AccountTime(now);
+        stats.previousLevel = level;
+        level = next;
+        levelSince = now;
+        stats.level = next;
+        stats.entered[(int)next]++;
+        healthyCount = 0;
+    }
+};
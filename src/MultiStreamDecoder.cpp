@@ -0,0 +1,238 @@
+#include "MultiStreamDecoder.h"
+#include <iostream>
+
+static double ElapsedMs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+MultiStreamDecoder::Stream::~Stream()
+{
+    for (AVFrame *frame : overflow)
+        av_frame_free(&frame);
+}
+
+bool MultiStreamDecoder::Stream::OnFrame(AVFrame *frame)
+{
+    if (owner->stopRequested.load(std::memory_order_relaxed))
+        return false;
+
+    auto now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        double ms = ElapsedMs(decodeStart, now);
+        frames++;
+        decodeMsTotal += ms;
+        if (ms > decodeMsMax)
+            decodeMsMax = ms;
+    }
+    decodeStart = now;
+
+    if (owner->discardFrames)
+        return true;
+
+    AVFrame *ref = av_frame_clone(frame);
+    if (!ref)
+    {
+        std::cerr << "Failed to reference decoded frame" << std::endl;
+        return false;
+    }
+
+    // Never block a shared worker: keep the frame until the consumer makes room
+    if (!overflow.empty() || !queue.TryPush(ref))
+        overflow.push_back(ref);
+    return true;
+}
+
+MultiStreamDecoder::~MultiStreamDecoder()
+{
+    Stop();
+    for (Stream *stream : streams)
+        delete stream;
+}
+
+int MultiStreamDecoder::AddStream(const char *filename, IDecodeBackend *backend)
+{
+    bool started;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        started = pool != nullptr;
+    }
+    if (started)
+    {
+        std::cerr << "Streams must be added before Start()" << std::endl;
+        return -1;
+    }
+
+    Stream *stream = new Stream(queueDepth);
+    stream->owner = this;
+    stream->index = (int)streams.size();
+    stream->source = filename;
+    if (!stream->core.Open(filename, backend))
+    {
+        delete stream;
+        return -1;
+    }
+
+    streams.push_back(stream);
+    return stream->index;
+}
+
+void MultiStreamDecoder::Start()
+{
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (pool)
+            return;
+
+        stopRequested = false;
+        finishedCount = 0;
+        startTime = Clock::now();
+        pool = new ThreadPool(workerCount);
+    }
+    for (Stream *stream : streams)
+        Schedule(stream);
+}
+
+void MultiStreamDecoder::Stop()
+{
+    ThreadPool *stopping;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (!pool)
+            return;
+
+        // From here on Schedule() submits nothing, so the pool can be joined unlocked
+        stopRequested = true;
+        stopping = pool;
+        pool = nullptr;
+    }
+    // Queued slices see the stop flag and return immediately
+    delete stopping;
+    finishCv.notify_all();
+
+    for (Stream *stream : streams)
+        stream->queue.Clear();
+}
+
+AVFrame *MultiStreamDecoder::PopFrame(int index)
+{
+    Stream *stream = streams[index];
+    AVFrame *frame = stream->queue.Pop();
+    // A slot just freed up: resume a stream that parked on a full queue
+    if (frame && stream->parked.exchange(false, std::memory_order_acq_rel))
+        Schedule(stream);
+    return frame;
+}
+
+void MultiStreamDecoder::WaitAll()
+{
+    std::unique_lock<std::mutex> lock(finishMutex);
+    finishCv.wait(lock, [this] { return finishedCount == (int)streams.size() || stopRequested.load(); });
+}
+
+MultiStreamDecoder::StreamStats MultiStreamDecoder::GetStreamStats(int index)
+{
+    Stream *stream = streams[index];
+    StreamStats s;
+    s.source = stream->source;
+    s.finished = stream->finished.load(std::memory_order_acquire);
+    s.queue = stream->queue.GetStats();
+
+    std::lock_guard<std::mutex> lock(stream->statsMutex);
+    s.packets = stream->packets;
+    s.frames = stream->frames;
+    s.slices = stream->slices;
+    s.parks = stream->parks;
+    double seconds = ElapsedMs(startTime, s.finished ? stream->finishTime : Clock::now()) / 1000.0;
+    s.fps = seconds > 0.0 ? s.frames / seconds : 0.0;
+    s.avgDecodeMs = s.frames ? stream->decodeMsTotal / s.frames : 0.0;
+    s.maxDecodeMs = stream->decodeMsMax;
+    s.avgScheduleMs = s.slices ? stream->scheduleMsTotal / s.slices : 0.0;
+    return s;
+}
+
+void MultiStreamDecoder::Schedule(Stream *stream)
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (!pool || stopRequested.load(std::memory_order_relaxed))
+        return;
+
+    stream->submitTime = Clock::now();
+    pool->Submit([this, stream] { RunSlice(stream); });
+}
+
+void MultiStreamDecoder::RunSlice(Stream *stream)
+{
+    if (stopRequested.load(std::memory_order_relaxed))
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(stream->statsMutex);
+        stream->slices++;
+        stream->scheduleMsTotal += ElapsedMs(stream->submitTime, Clock::now());
+    }
+
+    bool room = FlushOverflow(stream);
+    for (int i = 0; room && i < packetsPerSlice && !stream->inputDone; i++)
+    {
+        stream->decodeStart = Clock::now();
+        if (!stream->core.DecodeOneFrame(stream))
+            stream->inputDone = true;
+        room = stream->overflow.empty();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stream->statsMutex);
+        stream->packets = stream->core.GetPacketsRead();
+    }
+
+    if (stopRequested.load(std::memory_order_relaxed))
+        return;
+
+    if (stream->overflow.empty() && stream->inputDone)
+    {
+        MarkFinished(stream);
+        return;
+    }
+
+    if (room)
+    {
+        // Yield so other streams get a turn
+        Schedule(stream);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stream->statsMutex);
+        stream->parks++;
+    }
+    stream->parked.store(true, std::memory_order_release);
+    // The consumer may have popped between the full queue and parking
+    if (stream->queue.Size() < stream->queue.Capacity() && stream->parked.exchange(false, std::memory_order_acq_rel))
+        Schedule(stream);
+}
+
+bool MultiStreamDecoder::FlushOverflow(Stream *stream)
+{
+    while (!stream->overflow.empty())
+    {
+        if (!stream->queue.TryPush(stream->overflow.front()))
+            return false;
+        stream->overflow.pop_front();
+    }
+    return true;
+}
+
+void MultiStreamDecoder::MarkFinished(Stream *stream)
+{
+    {
+        std::lock_guard<std::mutex> lock(stream->statsMutex);
+        stream->finishTime = Clock::now();
+    }
+    stream->finished.store(true, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(finishMutex);
+    finishedCount++;
+    finishCv.notify_all();
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "DecoderCore.h"
+#include "FrameQueue.h"
+#include "ThreadPool.h"
+
+// Decodes many streams (video wall, camera grid) on one shared ThreadPool sized to the
+// core count instead of one decode thread per stream. Each stream is decoded in short
+// slices (a few packets) that are queued round-robin on the pool; a stream whose frame
+// queue is full is parked and rescheduled by the consumer's PopFrame, so a slow viewer
+// never ties up a worker. A stream is never decoded by two workers at once.
+//
+// Backends are not owned and may be shared between streams: a hwdevice backend shared by
+// every stream creates one device for all of them.
+class MultiStreamDecoder
+{
+public:
+    struct StreamStats
+    {
+        std::string source;
+        uint64_t packets = 0;
+        uint64_t frames = 0;
+        double fps = 0.0;           // frames / seconds since Start()
+        double avgDecodeMs = 0.0;   // packet send to frame out, per frame
+        double maxDecodeMs = 0.0;
+        double avgScheduleMs = 0.0; // slice queued to slice running on a worker
+        uint64_t slices = 0;
+        uint64_t parks = 0;         // slices that ended on a full frame queue
+        bool finished = false;
+        FrameQueue::Stats queue;
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stream : public IFrameSink
+    {
+        MultiStreamDecoder *owner = nullptr;
+        int index = 0;
+        std::string source;
+        DecoderCore core;
+        FrameQueue queue;
+        // Frames produced after the queue filled up within a slice (worker only)
+        std::deque<AVFrame *> overflow;
+        std::atomic<bool> parked{false};
+        std::atomic<bool> finished{false};
+        bool inputDone = false;
+        Clock::time_point submitTime;
+        Clock::time_point decodeStart;
+        Clock::time_point finishTime;
+
+        std::mutex statsMutex;
+        uint64_t packets = 0;
+        uint64_t frames = 0;
+        uint64_t slices = 0;
+        uint64_t parks = 0;
+        double decodeMsTotal = 0.0;
+        double decodeMsMax = 0.0;
+        double scheduleMsTotal = 0.0;
+
+        explicit Stream(size_t queueDepth) : queue(queueDepth) {}
+        ~Stream() override;
+
+        bool OnFrame(AVFrame *frame) override;
+    };
+
+    std::vector<Stream *> streams;
+    // Guards pool: consumers (PopFrame) and workers reschedule through it while Stop() tears
+    // it down. Never held while the pool is destroyed, since its workers take it to reschedule.
+    mutable std::mutex poolMutex;
+    ThreadPool *pool = nullptr;
+    int workerCount = 0;
+    size_t queueDepth = 8;
+    int packetsPerSlice = 4;
+    bool discardFrames = false;
+    std::atomic<bool> stopRequested{false};
+    Clock::time_point startTime;
+    std::mutex finishMutex;
+    std::condition_variable finishCv;
+    int finishedCount = 0;
+
+public:
+    // workers = 0: one per hardware thread. queueDepth: decoded frames buffered per stream.
+    explicit MultiStreamDecoder(int workers = 0, size_t depth = 8, int sliceSize = 4)
+        : workerCount(workers), queueDepth(depth), packetsPerSlice(sliceSize < 1 ? 1 : sliceSize) {}
+    MultiStreamDecoder(const MultiStreamDecoder &) = delete;
+    MultiStreamDecoder &operator=(const MultiStreamDecoder &) = delete;
+    ~MultiStreamDecoder();
+
+    // Open a stream before Start(); returns its index or -1
+    int AddStream(const char *filename, IDecodeBackend *backend);
+
+    // Headless mode: frames are counted and released instead of queued
+    void SetDiscardFrames(bool discard) { discardFrames = discard; }
+
+    void Start();
+    void Stop();
+
+    // Consumer of one stream: next decoded frame (caller frees it), or nullptr
+    AVFrame *PopFrame(int stream);
+    bool IsFinished(int stream) const { return streams[stream]->finished.load(std::memory_order_acquire); }
+    // Block until every stream reached EOF (discard mode, or with active consumers)
+    void WaitAll();
+
+    int GetStreamCount() const { return (int)streams.size(); }
+    int GetWorkerCount() const
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        return pool ? pool->Size() : workerCount;
+    }
+    StreamStats GetStreamStats(int stream);
+
+private:
+    // Queue a slice of the stream on the pool; a no-op once Stop() has begun
+    void Schedule(Stream *stream);
+    void RunSlice(Stream *stream);
+    // Move overflow frames into the queue; false if the queue filled up
+    bool FlushOverflow(Stream *stream);
+    void MarkFinished(Stream *stream);
+};
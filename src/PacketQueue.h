@@ -0,0 +1,144 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavutil/error.h>
+}
+
+// Bounded queue of demuxed packets between a demux thread and the decoder. Both sides
+// block: the demuxer when it is a full queue ahead, the decoder when the demuxer fell
+// behind (an underrun: the input could not keep up). The av_read_frame result that ended
+// demuxing (EOF or an error) is queued after the last packet.
+class PacketQueue
+{
+public:
+    struct Stats
+    {
+        size_t capacity = 0;
+        size_t occupancy = 0;
+        uint64_t pushed = 0;
+        uint64_t popped = 0;
+        uint64_t overruns = 0;  // pushes that waited for space: demux is ahead
+        uint64_t underruns = 0; // pops that waited for a packet: demux is behind
+        double underrunMs = 0.0;
+        double maxUnderrunMs = 0.0;
+    };
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<AVPacket *> packets;
+    size_t capacity;
+    bool closed = false;
+    bool ended = false;
+    int endResult = AVERROR_EOF;
+    Stats stats;
+
+public:
+    explicit PacketQueue(size_t depth) : capacity(depth < 1 ? 1 : depth) {}
+    PacketQueue(const PacketQueue &) = delete;
+    PacketQueue &operator=(const PacketQueue &) = delete;
+    ~PacketQueue() { Clear(); }
+
+    // Demux thread: move the packet's reference into the queue, waiting for space;
+    // false once closed (pkt is left untouched)
+    bool Push(AVPacket *pkt)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (packets.size() >= capacity && !closed)
+        {
+            stats.overruns++;
+            changed.wait(lock, [this] { return packets.size() < capacity || closed; });
+        }
+        if (closed)
+            return false;
+        AVPacket *queued = av_packet_alloc();
+        if (!queued)
+            return false;
+        av_packet_move_ref(queued, pkt);
+        packets.push_back(queued);
+        stats.pushed++;
+        changed.notify_all();
+        return true;
+    }
+
+    // Demux thread: no more packets; Pop returns result once the queue is empty
+    void PushEnd(int result)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ended = true;
+        endResult = result;
+        changed.notify_all();
+    }
+
+    // Decoder: next packet into pkt (0), waiting for the demuxer; the end result after the
+    // last packet, AVERROR_EXIT once closed
+    int Pop(AVPacket *pkt)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (packets.empty() && !ended && !closed)
+        {
+            auto start = std::chrono::steady_clock::now();
+            changed.wait(lock, [this] { return !packets.empty() || ended || closed; });
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            stats.underruns++;
+            stats.underrunMs += ms;
+            if (ms > stats.maxUnderrunMs)
+                stats.maxUnderrunMs = ms;
+        }
+        if (packets.empty())
+            return closed ? AVERROR_EXIT : endResult;
+
+        AVPacket *queued = packets.front();
+        packets.pop_front();
+        av_packet_move_ref(pkt, queued);
+        av_packet_free(&queued);
+        stats.popped++;
+        changed.notify_all();
+        return 0;
+    }
+
+    // Wake both sides; Push fails and Pop returns AVERROR_EXIT until Reopen
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        changed.notify_all();
+    }
+
+    // With the demux thread stopped (e.g. for a seek): drop queued packets and the end
+    // marker, accept packets again
+    void Reopen()
+    {
+        Clear();
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = false;
+        ended = false;
+        endResult = AVERROR_EOF;
+    }
+
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (AVPacket *queued : packets)
+            av_packet_free(&queued);
+        packets.clear();
+        changed.notify_all();
+    }
+
+    Stats GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Stats s = stats;
+        s.capacity = capacity;
+        s.occupancy = packets.size();
+        return s;
+    }
+};
@@ -0,0 +1,149 @@
+#include "PlaylistSequencer.h"
+#include <iostream>
+
+PlaylistSequencer::Item::~Item()
+{
+    delete decodeThread;
+    delete cache;
+    core.Close();
+    delete backend;
+}
+
+bool PlaylistSequencer::Open(const std::vector<std::string> &files, const Config &cfg)
+{
+    Close();
+    if (files.empty() || !cfg.prepare)
+        return false;
+    config = cfg;
+    playlist = files;
+    itemIndex = 0;
+    failedItems = 0;
+    stats = Stats();
+
+    item = new Item();
+    item->filename = playlist[0];
+    OpenItem(item);
+    if (!item->opened)
+    {
+        delete item;
+        item = nullptr;
+        return false;
+    }
+    if (!item->core.IsLowLatency())
+        PrewarmNext();
+    return true;
+}
+
+void PlaylistSequencer::Close()
+{
+    if (prewarmThread.joinable())
+        prewarmThread.join();
+    delete nextItem;
+    nextItem = nullptr;
+    delete item;
+    item = nullptr;
+}
+
+// Runs on prewarmThread for all but the first entry. Only touches entry, which no other
+// thread uses until the thread is joined.
+void PlaylistSequencer::OpenItem(Item *entry)
+{
+    entry->backend = config.prepare(entry->core, config.prepareOpaque);
+    if (!entry->backend || !entry->core.Open(entry->filename.c_str(), entry->backend))
+        return;
+
+    entry->decodeThread = new DecodeThread(&entry->core, config.queueDepth);
+    if (config.loop && playlist.size() == 1 && !entry->core.IsLowLatency())
+    {
+        entry->decodeThread->SetLoop(true);
+        if (config.frameCacheBytes > 0)
+        {
+            entry->cache = new FrameCache(config.frameCacheBytes, config.copyFrame, config.copyOpaque);
+            entry->decodeThread->SetFrameCache(entry->cache);
+        }
+    }
+    entry->decodeThread->Start();
+    entry->opened = true;
+}
+
+// Open the entry after the current one in the background, so its first frames are decoded
+// before the current one ends
+void PlaylistSequencer::PrewarmNext()
+{
+    size_t next = itemIndex + 1;
+    if (next >= playlist.size())
+    {
+        if (!config.loop || playlist.size() == 1)
+            return;
+        next = 0;
+    }
+    nextItem = new Item();
+    nextItem->filename = playlist[next];
+    prewarmThread = std::thread(&PlaylistSequencer::OpenItem, this, nextItem);
+}
+
+PlaylistSequencer::Step PlaylistSequencer::Advance(PresentationClock &clock, const AVFrame *lastShown,
+                                                   PresentationClock::Clock::time_point now)
+{
+    if (!item || !nextItem)
+        return Step::End;
+    // Where the last frame ends, the next item's first frame is due
+    auto due = now;
+    if (lastShown)
+    {
+        int64_t duration = lastShown->duration > 0 ? lastShown->duration : FrameDurationPts(item->core.GetVideoStream());
+        int64_t end = PresentationClock::FrameTimestamp(lastShown) + duration;
+        if (!clock.IsDue(end, now))
+            return Step::Wait;
+        due = clock.DueTime(end);
+    }
+    // Normally long done; blocks only when the next file opens slower than this one plays
+    prewarmThread.join();
+
+    size_t next = itemIndex + 1 < playlist.size() ? itemIndex + 1 : 0;
+    if (!nextItem->opened)
+    {
+        std::cerr << "Skipping " << nextItem->filename << ": failed to open" << std::endl;
+        delete nextItem;
+        nextItem = nullptr;
+        stats.skipped++;
+        if (++failedItems >= playlist.size())
+            return Step::End;
+        itemIndex = next;
+        PrewarmNext();
+        return nextItem ? Step::Skipped : Step::End;
+    }
+
+    // lastShown stays on screen until its successor is presented; it keeps the old item's
+    // surface pool alive by reference
+    delete item;
+    item = nextItem;
+    nextItem = nullptr;
+    itemIndex = next;
+    failedItems = 0;
+    stats.switches++;
+
+    AVFrame *first = item->decodeThread->PeekFrame();
+    if (!first)
+        stats.notReady++;
+    clock.Rebase(item->core.GetVideoStream()->time_base, first ? PresentationClock::FrameTimestamp(first) : AV_NOPTS_VALUE,
+                 due);
+    PrewarmNext();
+    return Step::Switched;
+}
+
+int64_t PlaylistSequencer::FrameDurationPts(const AVStream *stream)
+{
+    AVRational frameRate = stream->avg_frame_rate;
+    if (frameRate.num <= 0 || frameRate.den <= 0)
+        frameRate = av_make_q(30, 1);
+    return av_rescale_q(1, av_inv_q(frameRate), stream->time_base);
+}
+
+double PlaylistSequencer::FrameDurationMs(const AVStream *stream)
+{
+    AVRational frameRate = stream->avg_frame_rate;
+    if (frameRate.num <= 0 || frameRate.den <= 0)
+        frameRate = av_make_q(30, 1);
+    return 1000.0 * frameRate.den / frameRate.num;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DecodeBackend.h"
+#include "DecodeThread.h"
+#include "DecoderCore.h"
+#include "FrameCache.h"
+#include "PresentationClock.h"
+
+// Plays files one after the other without a gap: while an item plays, the next one is
+// opened, probed and decoding ahead on a background thread. Once the playing item is drained
+// and its last frame has been shown for its duration, the pre-warmed item takes over and the
+// PresentationClock is rebased so its first frame is due where the last one ended. Entries
+// that fail to open are skipped. A single looped entry is never reopened: its DecodeThread
+// rewinds at EOF and replays from a FrameCache when the clip fits.
+// Present thread only; the pre-warm thread touches nothing but the item it opens.
+class PlaylistSequencer
+{
+public:
+    // One opened playlist entry: its own decoder, backend, decode-ahead queue and frame cache
+    struct Item
+    {
+        std::string filename;
+        DecoderCore core;
+        IDecodeBackend *backend = nullptr;
+        DecodeThread *decodeThread = nullptr;
+        FrameCache *cache = nullptr;
+        bool opened = false;
+
+        ~Item();
+    };
+
+    // Configures core for the entry (input options, telemetry) and returns a new backend for
+    // it, or nullptr. Runs on the pre-warm thread for all but the first entry.
+    using PrepareFunc = IDecodeBackend *(*)(DecoderCore &core, void *opaque);
+
+    struct Config
+    {
+        PrepareFunc prepare = nullptr;
+        void *prepareOpaque = nullptr;
+        size_t queueDepth = 8;
+        // Wrap to the first entry after the last; a single entry rewinds instead
+        bool loop = false;
+        // Single looped entry: replay from a FrameCache of this size (0: decode every pass)
+        size_t frameCacheBytes = 0;
+        FrameCache::CopyFunc copyFrame = nullptr;
+        void *copyOpaque = nullptr;
+    };
+
+    enum class Step
+    {
+        Wait,     // the last frame of the item is still on screen
+        Switched, // the next item plays; rebase any per-item state on GetItem()
+        Skipped,  // the next entry failed to open, the one after it is being opened
+        End       // end of the playlist, or no entry could be opened
+    };
+
+    struct Stats
+    {
+        uint64_t switches = 0;
+        uint64_t notReady = 0; // switches that found the next item's first frame not decoded yet
+        uint64_t skipped = 0;  // entries that failed to open
+    };
+
+private:
+    Config config;
+    std::vector<std::string> playlist;
+    Item *item = nullptr;     // playing
+    Item *nextItem = nullptr; // opening / decoding ahead on prewarmThread
+    std::thread prewarmThread;
+    size_t itemIndex = 0;
+    size_t failedItems = 0; // consecutive entries that could not be opened
+    Stats stats;
+
+public:
+    PlaylistSequencer() = default;
+    PlaylistSequencer(const PlaylistSequencer &) = delete;
+    PlaylistSequencer &operator=(const PlaylistSequencer &) = delete;
+    ~PlaylistSequencer() { Close(); }
+
+    // Open the first entry (false when it cannot be opened) and start pre-warming the
+    // second. A low-latency (live) input plays alone.
+    bool Open(const std::vector<std::string> &files, const Config &cfg);
+    void Close();
+
+    // The playing item's decode thread is drained: continue with the next item once
+    // lastShown (the frame on screen, may be null) has been shown for its duration
+    Step Advance(PresentationClock &clock, const AVFrame *lastShown, PresentationClock::Clock::time_point now);
+
+    Item *GetItem() const { return item; }
+    size_t GetIndex() const { return itemIndex; }
+    size_t GetSize() const { return playlist.size(); }
+    Stats GetStats() const { return stats; }
+
+    // Frame interval of a stream in its time base, from its average frame rate (30 fps
+    // when unknown), for frames without a duration
+    static int64_t FrameDurationPts(const AVStream *stream);
+    static double FrameDurationMs(const AVStream *stream);
+
+private:
+    void OpenItem(Item *entry);
+    void PrewarmNext();
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+#include <libavutil/frame.h>
+}
+
+// Master clock mapping stream timestamps (best_effort_timestamp in the stream time_base)
+// to steady_clock display times. Anchored on the first presented frame, re-anchored on
+// rate changes, pause/resume and after stalls longer than the resync threshold.
+class PresentationClock
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats
+    {
+        uint64_t presented = 0;
+        uint64_t dropped = 0;
+        uint64_t resyncs = 0;
+        double meanJitterMs = 0.0; // mean |actual - scheduled| of presented frames
+        double maxJitterMs = 0.0;
+        double lastLatenessMs = 0.0; // > 0 when the last frame was shown late
+    };
+
+    static constexpr double kMinRate = 0.5;
+    static constexpr double kMaxRate = 4.0;
+
+private:
+    double timeBase = 1.0 / 90000.0; // seconds per timestamp unit
+    double rate = 1.0;
+    double resyncThresholdMs = 1000.0;
+    bool anchored = false;
+    int64_t anchorPts = 0;
+    Clock::time_point anchorTime;
+    bool paused = false;
+    Clock::time_point pauseStart;
+    double jitterSumMs = 0.0;
+    Stats stats;
+
+public:
+    void Reset(AVRational streamTimeBase)
+    {
+        timeBase = streamTimeBase.num > 0 && streamTimeBase.den > 0 ? av_q2d(streamTimeBase) : 1.0 / 90000.0;
+        anchored = false;
+        paused = false;
+        jitterSumMs = 0.0;
+        stats = Stats();
+    }
+
+    // Playback speed, clamped to [0.5, 4]; takes effect from the current media position
+    void SetRate(double newRate, Clock::time_point now = Clock::now())
+    {
+        newRate = std::clamp(newRate, kMinRate, kMaxRate);
+        if (anchored && !paused)
+        {
+            // Re-anchor so the media position does not jump
+            double mediaSec = std::chrono::duration<double>(now - anchorTime).count() * rate;
+            anchorPts += (int64_t)std::llround(mediaSec / timeBase);
+            anchorTime = now;
+        }
+        rate = newRate;
+    }
+
+    double GetRate() const { return rate; }
+
+    void SetResyncThreshold(double ms) { resyncThresholdMs = ms; }
+
+    void Pause(Clock::time_point now = Clock::now())
+    {
+        if (paused)
+            return;
+        paused = true;
+        pauseStart = now;
+    }
+
+    void Resume(Clock::time_point now = Clock::now())
+    {
+        if (!paused)
+            return;
+        paused = false;
+        anchorTime += now - pauseStart;
+    }
+
+    bool IsPaused() const { return paused; }
+    bool IsAnchored() const { return anchored; }
+
+    // Display time of a frame; before the first frame is presented everything is due now
+    Clock::time_point DueTime(int64_t pts) const
+    {
+        if (!anchored)
+            return Clock::time_point::min();
+        double offsetSec = (double)(pts - anchorPts) * timeBase / rate;
+        return anchorTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(offsetSec));
+    }
+
+    bool IsDue(int64_t pts, Clock::time_point now) const { return !paused && DueTime(pts) <= now; }
+
+    void OnPresented(int64_t pts, Clock::time_point now)
+    {
+        if (!anchored)
+        {
+            anchored = true;
+            anchorPts = pts;
+            anchorTime = now;
+        }
+
+        double latenessMs = std::chrono::duration<double, std::milli>(now - DueTime(pts)).count();
+        stats.presented++;
+        stats.lastLatenessMs = latenessMs;
+        jitterSumMs += std::fabs(latenessMs);
+        stats.meanJitterMs = jitterSumMs / stats.presented;
+        stats.maxJitterMs = std::max(stats.maxJitterMs, std::fabs(latenessMs));
+
+        // After a long stall catching up would drop too much; restart the clock here
+        if (latenessMs > resyncThresholdMs)
+        {
+            anchorPts = pts;
+            anchorTime = now;
+            stats.resyncs++;
+        }
+    }
+
+    void OnDropped() { stats.dropped++; }
+
+    // After a seek: the next presented frame anchors the clock again, stats are kept
+    void Unanchor() { anchored = false; }
+
+    // Continue with another stream (the next playlist item): its pts, in its own time base,
+    // becomes due at dueTime, e.g. when the last frame of the previous stream ends; stats,
+    // rate and pause state are kept. With pts AV_NOPTS_VALUE (nothing decoded yet) the next
+    // presented frame anchors the clock.
+    void Rebase(AVRational streamTimeBase, int64_t pts, Clock::time_point dueTime)
+    {
+        timeBase = streamTimeBase.num > 0 && streamTimeBase.den > 0 ? av_q2d(streamTimeBase) : 1.0 / 90000.0;
+        anchored = pts != AV_NOPTS_VALUE;
+        anchorPts = pts;
+        anchorTime = dueTime;
+    }
+
+    Stats GetStats() const { return stats; }
+
+    // Timestamp used for scheduling (DecodeThread fills in missing ones)
+    static int64_t FrameTimestamp(const AVFrame *frame)
+    {
+        return frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    }
+};
@@ -0,0 +1,347 @@
+#include "RawFrameSink.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+extern "C"
+{
+#include <libavutil/hwcontext.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+// writev takes at most IOV_MAX (1024 on Linux) chunks per call
+static const int kMaxChunksPerWrite = 1024;
+
+RawFrameSink::RawFrameSink() : swFrame(av_frame_alloc())
+{
+}
+
+RawFrameSink::~RawFrameSink()
+{
+    Close();
+    av_frame_free(&swFrame);
+}
+
+bool RawFrameSink::ParseFormat(const std::string &name, Format &out)
+{
+    if (name == "y4m")
+        out = Format::Y4M;
+    else if (name == "native" || name == "raw")
+        out = Format::Native;
+    else if (name == "i420" || name == "yuv420p")
+        out = Format::I420;
+    else if (name == "nv12")
+        out = Format::NV12;
+    else
+        return false;
+    return true;
+}
+
+bool RawFrameSink::Open(const char *outputPath, Format outputFormat, AVRational rate)
+{
+    Close();
+    path = outputPath;
+    format = outputFormat;
+    frameRate = rate.num > 0 && rate.den > 0 ? rate : AVRational{25, 1};
+    headerWritten = false;
+    pixelFormat = -1;
+    stats = Stats();
+
+    if (path == "-")
+    {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        std::fflush(stdout);
+        fd = 1;
+        ownsFd = false;
+        return true;
+    }
+
+#ifdef _WIN32
+    fd = _open(outputPath, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#else
+    fd = open(outputPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+    if (fd < 0)
+    {
+        std::cerr << "Could not open output " << outputPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    ownsFd = true;
+    return true;
+}
+
+void RawFrameSink::Close()
+{
+    if (fd >= 0 && ownsFd)
+    {
+#ifdef _WIN32
+        _close(fd);
+#else
+        close(fd);
+#endif
+    }
+    fd = -1;
+    ownsFd = false;
+}
+
+// Y4M colorspace tag of a planar layout, nullptr if Y4M cannot carry it
+static const char *Y4MColorspace(int pixelFormat, AVChromaLocation location)
+{
+    switch (pixelFormat)
+    {
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_NV12: // written as I420
+        return location == AVCHROMA_LOC_LEFT ? "420mpeg2" : (location == AVCHROMA_LOC_TOPLEFT ? "420paldv" : "420jpeg");
+    case AV_PIX_FMT_YUV422P:
+    case AV_PIX_FMT_YUVJ422P:
+        return "422";
+    case AV_PIX_FMT_YUV444P:
+    case AV_PIX_FMT_YUVJ444P:
+        return "444";
+    case AV_PIX_FMT_YUV420P10LE:
+        return "420p10";
+    case AV_PIX_FMT_YUV422P10LE:
+        return "422p10";
+    case AV_PIX_FMT_YUV444P10LE:
+        return "444p10";
+    case AV_PIX_FMT_GRAY8:
+        return "mono";
+    default:
+        return nullptr;
+    }
+}
+
+bool RawFrameSink::WriteHeader(const AVFrame *frame)
+{
+    const char *colorspace = Y4MColorspace(frame->format, frame->chroma_location);
+    if (!colorspace)
+    {
+        std::cerr << "Y4M cannot carry " << av_get_pix_fmt_name((AVPixelFormat)frame->format)
+                  << " frames, use native output" << std::endl;
+        return false;
+    }
+
+    AVRational aspect = frame->sample_aspect_ratio.num > 0 ? frame->sample_aspect_ratio : AVRational{0, 0};
+    bool full = frame->color_range == AVCOL_RANGE_JPEG || frame->format == AV_PIX_FMT_YUVJ420P ||
+                frame->format == AV_PIX_FMT_YUVJ422P || frame->format == AV_PIX_FMT_YUVJ444P;
+    char header[160];
+    int length = std::snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:%d Ip A%d:%d C%s XCOLORRANGE=%s\n",
+                               frame->width, frame->height, frameRate.num, frameRate.den, aspect.num, aspect.den,
+                               colorspace, full ? "FULL" : "LIMITED");
+    AddChunk((const uint8_t *)header, (size_t)length);
+    if (!Flush())
+        return false;
+    headerWritten = true;
+    return true;
+}
+
+void RawFrameSink::AddChunk(const uint8_t *data, size_t size)
+{
+    if (size == 0)
+        return;
+    // Rows or planes that follow each other in memory become one write
+    if (!chunks.empty() && chunks.back().data + chunks.back().size == data)
+        chunks.back().size += size;
+    else
+        chunks.push_back({data, size});
+}
+
+void RawFrameSink::AddPlane(const uint8_t *data, int linesize, size_t rowBytes, int rows)
+{
+    if (linesize == (int)rowBytes)
+    {
+        AddChunk(data, rowBytes * rows);
+        return;
+    }
+    for (int y = 0; y < rows; y++)
+        AddChunk(data + (ptrdiff_t)y * linesize, rowBytes);
+}
+
+bool RawFrameSink::AddFrame(const AVFrame *frame)
+{
+    int chromaWidth = (frame->width + 1) / 2;
+    int chromaHeight = (frame->height + 1) / 2;
+    bool nv12 = frame->format == AV_PIX_FMT_NV12;
+    bool i420 = frame->format == AV_PIX_FMT_YUV420P || frame->format == AV_PIX_FMT_YUVJ420P;
+
+    if (format == Format::NV12 && !nv12)
+    {
+        if (!i420)
+        {
+            std::cerr << "NV12 output needs 4:2:0 8-bit frames, got " << av_get_pix_fmt_name((AVPixelFormat)frame->format)
+                      << std::endl;
+            return false;
+        }
+        // Interleave U and V
+        scratch.resize((size_t)chromaWidth * 2 * chromaHeight);
+        for (int y = 0; y < chromaHeight; y++)
+        {
+            const uint8_t *u = frame->data[1] + (ptrdiff_t)y * frame->linesize[1];
+            const uint8_t *v = frame->data[2] + (ptrdiff_t)y * frame->linesize[2];
+            uint8_t *dst = scratch.data() + (size_t)y * chromaWidth * 2;
+            for (int x = 0; x < chromaWidth; x++)
+            {
+                dst[2 * x] = u[x];
+                dst[2 * x + 1] = v[x];
+            }
+        }
+        AddPlane(frame->data[0], frame->linesize[0], frame->width, frame->height);
+        AddChunk(scratch.data(), scratch.size());
+        stats.repackedFrames++;
+        return true;
+    }
+
+    if ((format == Format::Y4M || format == Format::I420) && nv12)
+    {
+        // Split the interleaved chroma plane into U and V
+        size_t chromaPlane = (size_t)chromaWidth * chromaHeight;
+        scratch.resize(chromaPlane * 2);
+        for (int y = 0; y < chromaHeight; y++)
+        {
+            const uint8_t *uv = frame->data[1] + (ptrdiff_t)y * frame->linesize[1];
+            uint8_t *u = scratch.data() + (size_t)y * chromaWidth;
+            uint8_t *v = u + chromaPlane;
+            for (int x = 0; x < chromaWidth; x++)
+            {
+                u[x] = uv[2 * x];
+                v[x] = uv[2 * x + 1];
+            }
+        }
+        AddPlane(frame->data[0], frame->linesize[0], frame->width, frame->height);
+        AddChunk(scratch.data(), scratch.size());
+        stats.repackedFrames++;
+        return true;
+    }
+
+    if (format == Format::I420 && !i420)
+    {
+        std::cerr << "I420 output needs 4:2:0 8-bit frames, got " << av_get_pix_fmt_name((AVPixelFormat)frame->format)
+                  << std::endl;
+        return false;
+    }
+
+    // Planes as they are: the Y4M layouts are the planar formats themselves
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+    int rowBytes[4];
+    if (!desc || (desc->flags & AV_PIX_FMT_FLAG_HWACCEL) ||
+        av_image_fill_linesizes(rowBytes, (AVPixelFormat)frame->format, frame->width) < 0)
+    {
+        std::cerr << "Cannot write " << av_get_pix_fmt_name((AVPixelFormat)frame->format) << " frames" << std::endl;
+        return false;
+    }
+    int planes = av_pix_fmt_count_planes((AVPixelFormat)frame->format);
+    for (int p = 0; p < planes; p++)
+    {
+        bool chroma = (p == 1 || p == 2) && !(desc->flags & AV_PIX_FMT_FLAG_RGB);
+        int rows = chroma ? -((-frame->height) >> desc->log2_chroma_h) : frame->height;
+        AddPlane(frame->data[p], frame->linesize[p], rowBytes[p], rows);
+    }
+    return true;
+}
+
+bool RawFrameSink::Flush()
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t next = 0;
+    while (next < chunks.size())
+    {
+#ifdef _WIN32
+        Chunk &chunk = chunks[next];
+        int written = _write(fd, chunk.data, (unsigned)std::min<size_t>(chunk.size, 1u << 30));
+#else
+        iovec iov[kMaxChunksPerWrite];
+        int count = 0;
+        for (; count < kMaxChunksPerWrite && next + count < chunks.size(); count++)
+            iov[count] = {(void *)chunks[next + count].data, chunks[next + count].size};
+        ssize_t written = writev(fd, iov, count);
+#endif
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EPIPE)
+                std::cerr << "Output closed by the reader" << std::endl;
+            else
+                std::cerr << "Write to " << path << " failed: " << std::strerror(errno) << std::endl;
+            chunks.clear();
+            return false;
+        }
+        stats.writeCalls++;
+        stats.bytes += (uint64_t)written;
+
+        // Skip what was written; a pipe may take only part of it
+        size_t left = (size_t)written;
+        while (next < chunks.size() && left >= chunks[next].size)
+            left -= chunks[next++].size;
+        if (left)
+        {
+            chunks[next].data += left;
+            chunks[next].size -= left;
+        }
+    }
+    chunks.clear();
+    stats.writeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool RawFrameSink::OnFrame(AVFrame *frame)
+{
+    if (fd < 0)
+        return false;
+
+    const AVFrame *src = frame;
+    if (frame->hw_frames_ctx)
+    {
+        av_frame_unref(swFrame);
+        if (av_hwframe_transfer_data(swFrame, frame, 0) < 0)
+        {
+            std::cerr << "Failed to download hardware frame" << std::endl;
+            return false;
+        }
+        av_frame_copy_props(swFrame, frame);
+        src = swFrame;
+        stats.downloadedFrames++;
+    }
+
+    if (format == Format::Y4M)
+    {
+        // One header describes the whole stream
+        if (pixelFormat >= 0 && (src->width != width || src->height != height || src->format != pixelFormat))
+        {
+            std::cerr << "Y4M output cannot change to " << src->width << "x" << src->height << " "
+                      << av_get_pix_fmt_name((AVPixelFormat)src->format) << " mid-stream" << std::endl;
+            return false;
+        }
+        if (!headerWritten && !WriteHeader(src))
+            return false;
+        static const char kFrameHeader[] = "FRAME\n";
+        AddChunk((const uint8_t *)kFrameHeader, sizeof(kFrameHeader) - 1);
+    }
+    width = src->width;
+    height = src->height;
+    pixelFormat = src->format;
+
+    if (!AddFrame(src) || !Flush())
+    {
+        chunks.clear();
+        return false;
+    }
+    stats.frames++;
+    return true;
+}
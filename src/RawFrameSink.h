@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FrameSink.h"
+
+// Streams decoded frames to a file, pipe or stdout as YUV4MPEG2 or raw planes, for tools
+// downstream of the decoder. Planes are written with writev straight from the frame: a
+// plane whose stride equals its row size is one write chunk, a padded plane one chunk per
+// row, and chunks that happen to be contiguous are merged. Only layouts the output cannot
+// express are repacked through a scratch buffer (NV12 chroma for Y4M/I420, planar chroma
+// for NV12). Hardware frames are downloaded first.
+class RawFrameSink : public IFrameSink
+{
+public:
+    enum class Format
+    {
+        Y4M,    // YUV4MPEG2 stream header, then "FRAME\n" + planar data per frame
+        Native, // planes as decoded, no header
+        I420,   // planar 4:2:0, 8 bit
+        NV12    // 8-bit luma plane + interleaved chroma plane
+    };
+
+    struct Stats
+    {
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+        uint64_t writeCalls = 0;
+        uint64_t repackedFrames = 0; // frames that needed the scratch buffer
+        uint64_t downloadedFrames = 0;
+        double writeMs = 0.0;
+    };
+
+private:
+    struct Chunk
+    {
+        const uint8_t *data;
+        size_t size;
+    };
+
+    int fd = -1;
+    bool ownsFd = false;
+    std::string path;
+    Format format = Format::Y4M;
+    AVRational frameRate = {0, 1};
+    bool headerWritten = false;
+    int width = 0;
+    int height = 0;
+    int pixelFormat = -1;
+    AVFrame *swFrame = nullptr;
+    std::vector<uint8_t> scratch;
+    std::vector<Chunk> chunks;
+    Stats stats;
+
+public:
+    RawFrameSink();
+    RawFrameSink(const RawFrameSink &) = delete;
+    RawFrameSink &operator=(const RawFrameSink &) = delete;
+    ~RawFrameSink() override;
+
+    // "y4m", "native"/"raw", "i420"/"yuv420p", "nv12"
+    static bool ParseFormat(const std::string &name, Format &format);
+
+    // path "-" writes to stdout; frameRate goes into the Y4M header (0/0: 25 fps)
+    bool Open(const char *outputPath, Format outputFormat, AVRational rate);
+    void Close();
+
+    // Writes the frame; false (stop decoding) on a write error, a closed pipe, or a frame
+    // the output format cannot represent
+    bool OnFrame(AVFrame *frame) override;
+
+    const Stats &GetStats() const { return stats; }
+
+private:
+    bool WriteHeader(const AVFrame *frame);
+    void AddChunk(const uint8_t *data, size_t size);
+    void AddPlane(const uint8_t *data, int linesize, size_t rowBytes, int rows);
+    // Chunks for the frame in the output layout, repacking into scratch where needed
+    bool AddFrame(const AVFrame *frame);
+    bool Flush();
+};
@@ -0,0 +1,405 @@
+#include "ReadAheadIO.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+extern "C"
+{
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+static constexpr size_t kPageSize = 4096;
+static constexpr size_t kMinBlockSize = 64 * 1024;
+
+static double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+ReadAheadIO::ReadAheadIO(const Config &cfg) : config(cfg)
+{
+    // Whole pages, so block offsets in a mapping are page aligned for madvise
+    config.blockSize = std::max(kMinBlockSize, (config.blockSize + kPageSize - 1) / kPageSize * kPageSize);
+    config.ioBufferSize = std::max(config.ioBufferSize, 4096);
+}
+
+bool ReadAheadIO::OpenFile(const char *filename)
+{
+    if (config.storage)
+    {
+        fileSize = config.storage->GetSize();
+        return fileSize > 0;
+    }
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+    file = handle;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0)
+        return false;
+    fileSize = size.QuadPart;
+
+    if (config.source == Source::Mmap)
+    {
+        HANDLE section = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!section)
+            return false;
+        // The view keeps the section alive
+        mapping = (uint8_t *)MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(section);
+        if (!mapping)
+            return false;
+    }
+#else
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0)
+        return false;
+    fileSize = st.st_size;
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    if (config.source == Source::Mmap)
+    {
+        void *view = mmap(nullptr, (size_t)fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED)
+            return false;
+        mapping = (uint8_t *)view;
+    }
+#endif
+    return true;
+}
+
+void ReadAheadIO::CloseFile()
+{
+#ifdef _WIN32
+    if (mapping)
+        UnmapViewOfFile(mapping);
+    if (file)
+        CloseHandle((HANDLE)file);
+    file = nullptr;
+#else
+    if (mapping)
+        munmap(mapping, (size_t)fileSize);
+    if (fd >= 0)
+        close(fd);
+    fd = -1;
+#endif
+    mapping = nullptr;
+    fileSize = 0;
+}
+
+bool ReadAheadIO::Open(const char *filename)
+{
+    Close();
+    if (config.storage && config.source != Source::Read)
+    {
+        std::cerr << "ReadAheadIO: a custom storage cannot be mapped" << std::endl;
+        return false;
+    }
+    if (!OpenFile(filename))
+    {
+        std::cerr << "Could not open " << filename << " for read-ahead" << std::endl;
+        Close();
+        return false;
+    }
+
+    if (config.source == Source::Read)
+    {
+        // The prefetch window plus the block being loaded and one the demuxer may seek back into
+        size_t windowBlocks = (config.prefetchBytes + config.blockSize - 1) / config.blockSize;
+        slots = (int)windowBlocks + 2;
+        size_t bytes = (size_t)slots * config.blockSize;
+#ifdef _WIN32
+        ring = (uint8_t *)_aligned_malloc(bytes, kPageSize);
+#else
+        void *p = nullptr;
+        if (posix_memalign(&p, kPageSize, bytes) == 0)
+            ring = (uint8_t *)p;
+#endif
+        if (!ring)
+        {
+            std::cerr << "ReadAheadIO: failed to allocate " << bytes << " bytes" << std::endl;
+            Close();
+            return false;
+        }
+    }
+
+    uint8_t *buffer = (uint8_t *)av_malloc(config.ioBufferSize);
+    avio = buffer ? avio_alloc_context(buffer, config.ioBufferSize, 0, this, ReadCallback, nullptr, SeekCallback) : nullptr;
+    if (!avio)
+    {
+        av_free(buffer);
+        Close();
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation = 0;
+        fetchStart = readyEnd = position = 0;
+        ioError = false;
+        stats = Stats();
+        stats.fileSize = fileSize;
+    }
+    if (config.prefetchBytes > 0)
+        ioThread = std::thread(&ReadAheadIO::Run, this);
+    return true;
+}
+
+void ReadAheadIO::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cond.notify_all();
+    if (ioThread.joinable())
+        ioThread.join();
+    stopping = false;
+
+    if (avio)
+    {
+        // The demuxer may have replaced the buffer
+        av_freep(&avio->buffer);
+        avio_context_free(&avio);
+    }
+#ifdef _WIN32
+    _aligned_free(ring);
+#else
+    std::free(ring);
+#endif
+    ring = nullptr;
+    slots = 0;
+    CloseFile();
+}
+
+ReadAheadIO::Stats ReadAheadIO::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+uint8_t *ReadAheadIO::BlockData(int64_t blockStart) const
+{
+    if (mapping)
+        return mapping + blockStart;
+    return ring + (size_t)((blockStart / (int64_t)config.blockSize) % slots) * config.blockSize;
+}
+
+int64_t ReadAheadIO::ValidStart() const
+{
+    if (mapping)
+        return fetchStart;
+    // The ring slot after the newest loaded block is the one being (re)loaded next
+    int64_t bs = (int64_t)config.blockSize;
+    int64_t readyBlocks = (readyEnd + bs - 1) / bs;
+    return std::max(fetchStart, (readyBlocks + 1 - slots) * bs);
+}
+
+bool ReadAheadIO::CanLoad() const
+{
+    if (ioError || readyEnd >= fileSize || readyEnd - position >= (int64_t)config.prefetchBytes)
+        return false;
+    // Never overwrite the block the demuxer reads from or the one before it
+    int64_t bs = (int64_t)config.blockSize;
+    return mapping || readyEnd / bs <= position / bs + slots - 2;
+}
+
+int64_t ReadAheadIO::LoadBlock(int64_t offset, uint8_t *dst)
+{
+    size_t n = (size_t)std::min<int64_t>((int64_t)config.blockSize, fileSize - offset);
+    if (mapping)
+    {
+        // Fault the pages in here rather than in the demuxer's memcpy
+#ifndef _WIN32
+        madvise(mapping + offset, n, MADV_WILLNEED);
+#endif
+        volatile uint8_t touch = 0;
+        for (size_t i = 0; i < n; i += kPageSize)
+            touch = touch ^ mapping[offset + i];
+        (void)touch;
+        return (int64_t)n;
+    }
+
+    size_t done = 0;
+    while (done < n)
+    {
+        if (config.storage)
+        {
+            int64_t got = config.storage->ReadAt(offset + (int64_t)done, dst + done, n - done);
+            if (got <= 0)
+                return -1;
+            done += (size_t)got;
+            continue;
+        }
+#ifdef _WIN32
+        OVERLAPPED at = {};
+        at.Offset = (DWORD)(offset + done);
+        at.OffsetHigh = (DWORD)((uint64_t)(offset + done) >> 32);
+        DWORD got = 0;
+        if (!ReadFile((HANDLE)file, dst + done, (DWORD)(n - done), &got, &at) || got == 0)
+            return -1;
+#else
+        ssize_t got = pread(fd, dst + done, n - done, (off_t)(offset + done));
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return -1;
+#endif
+        done += (size_t)got;
+    }
+    return (int64_t)n;
+}
+
+void ReadAheadIO::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        cond.wait(lock, [this] { return stopping || CanLoad(); });
+        if (stopping)
+            break;
+
+        int64_t offset = readyEnd;
+        uint64_t loading = generation;
+        uint8_t *dst = BlockData(offset);
+        lock.unlock();
+        auto start = std::chrono::steady_clock::now();
+        int64_t n = LoadBlock(offset, dst);
+        double ms = MsSince(start);
+        lock.lock();
+
+        stats.ioRequests++;
+        stats.ioMs += ms;
+        stats.maxIoMs = std::max(stats.maxIoMs, ms);
+        if (loading != generation)
+            continue; // the demuxer seeked away meanwhile
+        if (n <= 0)
+            ioError = true;
+        else
+            readyEnd += n;
+        cond.notify_all();
+    }
+}
+
+int ReadAheadIO::Read(uint8_t *buf, int size)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (position >= fileSize)
+        return AVERROR_EOF;
+
+    int64_t bs = (int64_t)config.blockSize;
+    int64_t want = position;
+    if (want < ValidStart() || want >= readyEnd)
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (config.prefetchBytes == 0)
+        {
+            // No I/O thread: load the block on the demuxer's thread
+            int64_t block = want / bs * bs;
+            if (block != readyEnd)
+            {
+                fetchStart = readyEnd = block;
+                stats.refills++;
+            }
+            int64_t n = LoadBlock(block, BlockData(block));
+            stats.ioRequests++;
+            stats.ioMs += MsSince(start);
+            stats.maxIoMs = std::max(stats.maxIoMs, MsSince(start));
+            if (n <= 0)
+                return AVERROR(EIO);
+            readyEnd = block + n;
+        }
+        else
+        {
+            // Far outside the window: restart prefetching here instead of reading up to it
+            if (want < ValidStart() || want > readyEnd + (int64_t)config.prefetchBytes)
+            {
+                fetchStart = readyEnd = want / bs * bs;
+                generation++;
+                ioError = false;
+                stats.refills++;
+                cond.notify_all();
+            }
+            cond.wait(lock, [&] { return readyEnd > want || ioError || stopping; });
+            if (readyEnd <= want)
+                return stopping ? AVERROR_EXIT : AVERROR(EIO);
+        }
+
+        double ms = MsSince(start);
+        stats.waits++;
+        stats.waitMs += ms;
+        stats.maxWaitMs = std::max(stats.maxWaitMs, ms);
+    }
+
+    // Copy what is loaded, up to size, block by block (ring slots are not contiguous)
+    int64_t end = std::min(readyEnd, want + size);
+    int copied = 0;
+    while (position < end)
+    {
+        int64_t blockStart = position / bs * bs;
+        int64_t n = std::min(blockStart + bs, end) - position;
+        std::memcpy(buf + copied, BlockData(blockStart) + (position - blockStart), (size_t)n);
+        copied += (int)n;
+        position += n;
+    }
+    stats.bytesServed += copied;
+    // The I/O thread may have been waiting for the demuxer to move on
+    cond.notify_all();
+    return copied;
+}
+
+int64_t ReadAheadIO::Seek(int64_t offset, int whence)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    whence &= ~AVSEEK_FORCE;
+    if (whence == AVSEEK_SIZE)
+        return fileSize;
+
+    int64_t target = -1;
+    if (whence == SEEK_SET)
+        target = offset;
+    else if (whence == SEEK_CUR)
+        target = position + offset;
+    else if (whence == SEEK_END)
+        target = fileSize + offset;
+    if (target < 0)
+        return AVERROR(EINVAL);
+
+    position = target;
+    stats.seeks++;
+    cond.notify_all();
+    return position;
+}
+
+int ReadAheadIO::ReadCallback(void *opaque, uint8_t *buf, int size)
+{
+    return ((ReadAheadIO *)opaque)->Read(buf, size);
+}
+
+int64_t ReadAheadIO::SeekCallback(void *opaque, int64_t offset, int whence)
+{
+    return ((ReadAheadIO *)opaque)->Seek(offset, whence);
+}
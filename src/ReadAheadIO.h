@@ -0,0 +1,120 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+extern "C"
+{
+#include <libavformat/avio.h>
+}
+
+// Custom AVIOContext for local and network-share files that keeps a prefetch window of
+// the file ahead of the demuxer. A dedicated I/O thread reads large blocks into a ring of
+// page-aligned buffers (or, for Source::Mmap, faults in the mapped pages), so a storage
+// hiccup is absorbed by the window instead of stalling av_read_frame. Reads inside the
+// window are memcpy's; a seek outside it restarts prefetching at the new position.
+//
+// Install on an AVFormatContext before avformat_open_input (pb + AVFMT_FLAG_CUSTOM_IO);
+// the context must be closed before this object goes away.
+class ReadAheadIO
+{
+public:
+    enum class Source
+    {
+        Read, // read()/ReadFile into the buffer ring
+        Mmap  // serve straight from a read-only mapping of the whole file
+    };
+
+    // Blocks come from here instead of the file when set (Source::Read only), e.g. a client
+    // library for remote storage. Called by one thread at a time.
+    class Storage
+    {
+    public:
+        virtual ~Storage() = default;
+        virtual int64_t GetSize() = 0;
+        // Up to size bytes at offset into dst: bytes read, 0 past the end, < 0 on error
+        virtual int64_t ReadAt(int64_t offset, uint8_t *dst, size_t size) = 0;
+    };
+
+    struct Config
+    {
+        Source source = Source::Read;
+        size_t blockSize = 1 << 20;       // bytes per I/O request
+        size_t prefetchBytes = 16 << 20;  // read ahead of the demuxer; 0 = read on demand, no thread
+        int ioBufferSize = 64 * 1024;     // AVIOContext buffer the demuxer parses from
+        Storage *storage = nullptr;       // not owned, outlives the ReadAheadIO; null: the file
+    };
+
+    struct Stats
+    {
+        int64_t fileSize = 0;
+        uint64_t bytesServed = 0; // handed to the demuxer
+        uint64_t ioRequests = 0;  // blocks read (or faulted in) from storage
+        double ioMs = 0.0;        // time storage took for them
+        double maxIoMs = 0.0;
+        uint64_t waits = 0;       // demuxer reads that found their bytes not yet loaded
+        double waitMs = 0.0;      // demuxer time blocked on storage: the stalls read-ahead hides
+        double maxWaitMs = 0.0;
+        uint64_t seeks = 0;
+        uint64_t refills = 0; // seeks outside the window that restarted prefetching
+    };
+
+private:
+    Config config;
+    int64_t fileSize = 0;
+#ifdef _WIN32
+    void *file = nullptr; // HANDLE
+#else
+    int fd = -1;
+#endif
+    uint8_t *mapping = nullptr;
+    uint8_t *ring = nullptr;
+    int slots = 0;
+    AVIOContext *avio = nullptr;
+    std::thread ioThread;
+
+    // Everything below is guarded by mutex. Bytes [ValidStart(), readyEnd) are loaded;
+    // the I/O thread loads the block at readyEnd while it stays within the ring.
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool stopping = false;
+    bool ioError = false;
+    uint64_t generation = 0; // bumped on refill; blocks of older generations are discarded
+    int64_t fetchStart = 0;
+    int64_t readyEnd = 0;
+    int64_t position = 0; // demuxer's read position
+    Stats stats;
+
+public:
+    ReadAheadIO() : ReadAheadIO(Config()) {}
+    explicit ReadAheadIO(const Config &cfg);
+    ReadAheadIO(const ReadAheadIO &) = delete;
+    ReadAheadIO &operator=(const ReadAheadIO &) = delete;
+    ~ReadAheadIO() { Close(); }
+
+    // filename only names the input in messages when Config::storage is set
+    bool Open(const char *filename);
+    void Close();
+
+    AVIOContext *GetAVIOContext() const { return avio; }
+    const Config &GetConfig() const { return config; }
+    Stats GetStats();
+
+private:
+    static int ReadCallback(void *opaque, uint8_t *buf, int size);
+    static int64_t SeekCallback(void *opaque, int64_t offset, int whence);
+    int Read(uint8_t *buf, int size);
+    int64_t Seek(int64_t offset, int whence);
+    void Run();
+
+    bool OpenFile(const char *filename);
+    void CloseFile();
+    // Load bytes [offset, offset + blockSize) into dst (or fault in the mapping); bytes or -1
+    int64_t LoadBlock(int64_t offset, uint8_t *dst);
+    uint8_t *BlockData(int64_t blockStart) const;
+    int64_t ValidStart() const;
+    bool CanLoad() const;
+};
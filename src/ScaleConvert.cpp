@@ -0,0 +1,376 @@
+#include "ScaleConvert.h"
+#include "ColorConvert.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+extern "C"
+{
+#include <libavutil/frame.h>
+}
+
+// Filter weights are Q14; the vertical pass keeps 7 fractional bits of the filtered
+// samples, so the horizontal pass ends at Q21. Bicubic overshoot stays well inside int32.
+static const int kWeightShift = 14;
+static const int kRowShift = 7;
+static const int kOutShift = 2 * kWeightShift - kRowShift;
+
+// Output rows per band handed to a thread; small enough that every thread gets several
+static const int kMinBandRows = 8;
+static const int kBandsPerThread = 4;
+
+static double KernelRadius(ScaleFilter filter)
+{
+    return filter == ScaleFilter::Bicubic ? 2.0 : 1.0;
+}
+
+static double Kernel(ScaleFilter filter, double x)
+{
+    x = std::fabs(x);
+    if (filter == ScaleFilter::Bilinear)
+        return x < 1.0 ? 1.0 - x : 0.0;
+
+    // Catmull-Rom (Keys, a = -0.5)
+    const double a = -0.5;
+    if (x < 1.0)
+        return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+    if (x < 2.0)
+        return ((a * x - 5.0 * a) * x + 8.0 * a) * x - 4.0 * a;
+    return 0.0;
+}
+
+// Output sample d of dstSize sits at source position (d + 0.5) * ratio + bias. Downscaling
+// stretches the kernel by the ratio so every source sample contributes. Taps reaching past
+// an edge are folded onto the edge sample, which keeps each output's taps contiguous.
+static void BuildFilter(std::vector<int> &starts, std::vector<int32_t> &weights, int &taps, ScaleFilter filter,
+                        int srcSize, int dstSize, double ratio, double bias)
+{
+    double stretch = std::max(1.0, ratio);
+    double radius = KernelRadius(filter) * stretch;
+    taps = std::clamp((int)std::ceil(2.0 * radius), 1, srcSize);
+
+    starts.resize(dstSize);
+    weights.assign((size_t)dstSize * taps, 0);
+    std::vector<double> w(taps);
+    for (int d = 0; d < dstSize; d++)
+    {
+        double pos = (d + 0.5) * ratio + bias;
+        int first = (int)std::floor(pos - radius) + 1;
+        int start = std::clamp(first, 0, srcSize - taps);
+
+        std::fill(w.begin(), w.end(), 0.0);
+        double sum = 0.0;
+        for (int i = first; i < first + (int)std::ceil(2.0 * radius); i++)
+        {
+            double k = Kernel(filter, (i - pos) / stretch);
+            w[std::clamp(i, 0, srcSize - 1) - start] += k;
+            sum += k;
+        }
+
+        // Normalise to exactly 1 << kWeightShift, putting the rounding error on the largest tap
+        int32_t *out = &weights[(size_t)d * taps];
+        int total = 0, largest = 0;
+        for (int t = 0; t < taps; t++)
+        {
+            out[t] = (int32_t)std::lround(w[t] / sum * (1 << kWeightShift));
+            total += out[t];
+            if (out[t] > out[largest])
+                largest = t;
+        }
+        out[largest] += (1 << kWeightShift) - total;
+        starts[d] = start;
+    }
+}
+
+// count outputs of one row; src samples are Step apart (2 for interleaved chroma)
+template <int Taps, int Step>
+static void FilterRow(const int32_t *src, const int *starts, const int32_t *weights, int taps, uint8_t *dst,
+                      int count)
+{
+    const int n = Taps ? Taps : taps;
+    for (int i = 0; i < count; i++)
+    {
+        const int32_t *w = weights + (size_t)i * n;
+        const int32_t *s = src + (size_t)starts[i] * Step;
+        int32_t sum = 1 << (kOutShift - 1);
+        for (int t = 0; t < n; t++)
+            sum += w[t] * s[t * Step];
+        sum >>= kOutShift;
+        dst[i] = (uint8_t)(sum < 0 ? 0 : (sum > 255 ? 255 : sum));
+    }
+}
+
+template <int Step>
+static void FilterRow(const int32_t *src, const int *starts, const int32_t *weights, int taps, uint8_t *dst,
+                      int count)
+{
+    switch (taps)
+    {
+    case 2:
+        FilterRow<2, Step>(src, starts, weights, taps, dst, count);
+        break;
+    case 4:
+        FilterRow<4, Step>(src, starts, weights, taps, dst, count);
+        break;
+    case 6:
+        FilterRow<6, Step>(src, starts, weights, taps, dst, count);
+        break;
+    case 8:
+        FilterRow<8, Step>(src, starts, weights, taps, dst, count);
+        break;
+    default:
+        FilterRow<0, Step>(src, starts, weights, taps, dst, count);
+        break;
+    }
+}
+
+// acc[x] = sum over taps of w[t] * row t[x], rounded to Q7. Fixed tap counts keep the
+// taps in registers and read each source row once; wider filters accumulate row by row.
+template <int Taps>
+static void FilterColumns(const uint8_t *src, ptrdiff_t stride, const int32_t *w, int taps, int32_t *acc,
+                          int width)
+{
+    const int rounding = 1 << (kWeightShift - kRowShift - 1);
+    if (Taps)
+    {
+        const uint8_t *rows[Taps ? Taps : 1];
+        int32_t wt[Taps ? Taps : 1];
+        for (int t = 0; t < Taps; t++)
+        {
+            rows[t] = src + t * stride;
+            wt[t] = w[t];
+        }
+        for (int x = 0; x < width; x++)
+        {
+            int32_t sum = rounding;
+            for (int t = 0; t < Taps; t++)
+                sum += wt[t] * rows[t][x];
+            acc[x] = sum >> (kWeightShift - kRowShift);
+        }
+        return;
+    }
+
+    for (int x = 0; x < width; x++)
+        acc[x] = rounding + w[0] * src[x];
+    for (int t = 1; t < taps; t++)
+    {
+        const uint8_t *row = src + t * stride;
+        int32_t wt = w[t];
+        if (wt == 0)
+            continue;
+        for (int x = 0; x < width; x++)
+            acc[x] += wt * row[x];
+    }
+    for (int x = 0; x < width; x++)
+        acc[x] >>= kWeightShift - kRowShift;
+}
+
+// The taps of output row d: rows start..start + taps - 1 of a plane
+static void FilterColumns(const uint8_t *plane, int stride, int start, const int32_t *w, int taps, int32_t *acc,
+                          int width)
+{
+    const uint8_t *src = plane + (ptrdiff_t)start * stride;
+    switch (taps)
+    {
+    case 2:
+        FilterColumns<2>(src, stride, w, taps, acc, width);
+        break;
+    case 4:
+        FilterColumns<4>(src, stride, w, taps, acc, width);
+        break;
+    case 6:
+        FilterColumns<6>(src, stride, w, taps, acc, width);
+        break;
+    case 8:
+        FilterColumns<8>(src, stride, w, taps, acc, width);
+        break;
+    default:
+        FilterColumns<0>(src, stride, w, taps, acc, width);
+        break;
+    }
+}
+
+static void FillRow(uint8_t *dst, int pixels, const uint8_t rgba[4])
+{
+    for (int x = 0; x < pixels; x++)
+        std::memcpy(dst + x * 4, rgba, 4);
+}
+
+ScaleConverter::ScaleConverter() : ScaleConverter(Config())
+{
+}
+
+ScaleConverter::ScaleConverter(const Config &cfg) : config(cfg)
+{
+    threadCount = config.threads > 0 ? config.threads : (int)std::thread::hardware_concurrency();
+    if (threadCount < 1)
+        threadCount = 1;
+    // The calling thread works on bands too
+    if (threadCount > 1)
+        pool = std::make_unique<ThreadPool>(threadCount - 1);
+    scratch.resize(threadCount);
+}
+
+ScaleConverter::~ScaleConverter() = default;
+
+void ScaleConverter::UpdateGeometry(const Geometry &g)
+{
+    if (geometryValid && g == geometry)
+        return;
+    geometry = g;
+    geometryValid = true;
+
+    const VideoRect &r = g.rect;
+    int chromaWidth = (g.srcWidth + 1) / 2;
+    int chromaHeight = (g.srcHeight + 1) / 2;
+    double ratioX = (double)g.srcWidth / r.width;
+    double ratioY = (double)g.srcHeight / r.height;
+    BuildFilter(lumaX.start, lumaX.weights, lumaX.taps, g.filter, g.srcWidth, r.width, ratioX, -0.5);
+    BuildFilter(lumaY.start, lumaY.weights, lumaY.taps, g.filter, g.srcHeight, r.height, ratioY, -0.5);
+
+    // Output chroma is 4:2:0 again, sample j centred on output pixels 2j and 2j + 1, i.e. at
+    // source luma position (2j + 1) * ratio - 0.5. Source chroma sample i sits at luma
+    // position 2i + site: 0 when co-sited, 0.5 when centred.
+    double siteX = g.chromaCenteredX ? 0.5 : 0.0;
+    double siteY = g.chromaCositedY ? 0.0 : 0.5;
+    BuildFilter(chromaX.start, chromaX.weights, chromaX.taps, g.filter, chromaWidth, (r.width + 1) / 2, ratioX,
+                (-0.5 - siteX) / 2.0);
+    BuildFilter(chromaY.start, chromaY.weights, chromaY.taps, g.filter, chromaHeight, (r.height + 1) / 2, ratioY,
+                (-0.5 - siteY) / 2.0);
+}
+
+void ScaleConverter::ConvertBand(const Source &src, ColorConverter::I420Func convertRow, Scratch &rows, uint8_t *dst,
+                                 int dstStride, int dstWidth, int rowBegin, int rowEnd) const
+{
+    const VideoRect &r = geometry.rect;
+    int chromaWidth = (src.width + 1) / 2;
+    int outChromaWidth = (r.width + 1) / 2;
+    uint8_t *yOut = rows.out.data();
+    uint8_t *uOut = yOut + r.width;
+    uint8_t *vOut = uOut + outChromaWidth;
+    int chromaRow = -1; // output chroma row held in uOut / vOut
+
+    for (int row = rowBegin; row < rowEnd; row++)
+    {
+        uint8_t *out = dst + (ptrdiff_t)row * dstStride;
+        int dy = row - r.y;
+        if (dy < 0 || dy >= r.height)
+        {
+            FillRow(out, dstWidth, config.background);
+            continue;
+        }
+        FillRow(out, r.x, config.background);
+        FillRow(out + (size_t)(r.x + r.width) * 4, dstWidth - r.x - r.width, config.background);
+
+        // Vertical pass over the whole source width, then horizontal into the output row
+        FilterColumns(src.y, src.yStride, lumaY.start[dy], &lumaY.weights[(size_t)dy * lumaY.taps], lumaY.taps,
+                      rows.luma.data(), src.width);
+        FilterRow<1>(rows.luma.data(), lumaX.start.data(), lumaX.weights.data(), lumaX.taps, yOut, r.width);
+
+        // Chroma once per output row pair
+        if (chromaRow != dy / 2)
+        {
+            chromaRow = dy / 2;
+            int start = chromaY.start[chromaRow];
+            const int32_t *w = &chromaY.weights[(size_t)chromaRow * chromaY.taps];
+            const int *xStart = chromaX.start.data();
+            const int32_t *xWeights = chromaX.weights.data();
+            if (src.nv12)
+            {
+                FilterColumns(src.u, src.uStride, start, w, chromaY.taps, rows.chroma.data(), chromaWidth * 2);
+                FilterRow<2>(rows.chroma.data(), xStart, xWeights, chromaX.taps, uOut, outChromaWidth);
+                FilterRow<2>(rows.chroma.data() + 1, xStart, xWeights, chromaX.taps, vOut, outChromaWidth);
+            }
+            else
+            {
+                int32_t *u = rows.chroma.data(), *v = u + chromaWidth;
+                FilterColumns(src.u, src.uStride, start, w, chromaY.taps, u, chromaWidth);
+                FilterColumns(src.v, src.vStride, start, w, chromaY.taps, v, chromaWidth);
+                FilterRow<1>(u, xStart, xWeights, chromaX.taps, uOut, outChromaWidth);
+                FilterRow<1>(v, xStart, xWeights, chromaX.taps, vOut, outChromaWidth);
+            }
+        }
+
+        // One 4:2:0 row through the SIMD converter
+        convertRow(yOut, 0, uOut, 0, vOut, 0, out + (size_t)r.x * 4, 0, r.width, 1);
+    }
+}
+
+bool ScaleConverter::Convert(const Source &src, uint8_t *dst, int dstStride, int dstWidth, int dstHeight)
+{
+    if (!src.y || !src.u || (!src.nv12 && !src.v) || src.width <= 0 || src.height <= 0 || dstWidth <= 0 ||
+        dstHeight <= 0)
+        return false;
+
+    Geometry g;
+    g.srcWidth = src.width;
+    g.srcHeight = src.height;
+    g.rect = config.keepAspect ? FitVideoRect(src.width, src.height, src.sarNum, src.sarDen, dstWidth, dstHeight)
+                               : VideoRect{0, 0, dstWidth, dstHeight};
+    g.filter = config.filter;
+    g.chromaCenteredX = src.chromaCenteredX;
+    g.chromaCositedY = src.chromaCositedY;
+    UpdateGeometry(g);
+
+    ColorConverter::I420Func convertRow = ColorConverter::GetI420ToRGBA(ColorConverter::GetBestKernel(), src.color);
+    for (Scratch &rows : scratch)
+    {
+        rows.luma.resize(src.width);
+        rows.chroma.resize((size_t)(src.width + 1) / 2 * 2);
+        rows.out.resize((size_t)g.rect.width + (size_t)(g.rect.width + 1) / 2 * 2);
+    }
+
+    int bandRows = std::max(kMinBandRows, (dstHeight + threadCount * kBandsPerThread - 1) / (threadCount * kBandsPerThread));
+    int bandCount = (dstHeight + bandRows - 1) / bandRows;
+    std::atomic<int> nextBand{0};
+    auto work = [&](int worker)
+    {
+        for (int band = nextBand++; band < bandCount; band = nextBand++)
+        {
+            int begin = band * bandRows;
+            ConvertBand(src, convertRow, scratch[worker], dst, dstStride, dstWidth, begin,
+                        std::min(begin + bandRows, dstHeight));
+        }
+    };
+
+    int helpers = std::min(threadCount, bandCount) - 1;
+    for (int worker = 1; worker <= helpers; worker++)
+        pool->Submit([&work, worker] { work(worker); });
+    work(0);
+    if (helpers > 0)
+        pool->WaitIdle();
+    return true;
+}
+
+bool ScaleConverter::Convert(const AVFrame *frame, uint8_t *dst, int dstStride, int dstWidth, int dstHeight)
+{
+    Source src;
+    switch (frame->format)
+    {
+    case AV_PIX_FMT_NV12:
+        src.nv12 = true;
+        break;
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P:
+        src.v = frame->data[2];
+        src.vStride = frame->linesize[2];
+        break;
+    default:
+        return false;
+    }
+    src.y = frame->data[0];
+    src.yStride = frame->linesize[0];
+    src.u = frame->data[1];
+    src.uStride = frame->linesize[1];
+    src.width = frame->width;
+    src.height = frame->height;
+    src.sarNum = frame->sample_aspect_ratio.num;
+    src.sarDen = frame->sample_aspect_ratio.den;
+    src.chromaCenteredX = frame->chroma_location == AVCHROMA_LOC_CENTER || frame->chroma_location == AVCHROMA_LOC_TOP;
+    src.chromaCositedY = frame->chroma_location == AVCHROMA_LOC_TOPLEFT || frame->chroma_location == AVCHROMA_LOC_TOP;
+    src.color = ColorConverter::GetColorSpec(frame);
+    return Convert(src, dst, dstStride, dstWidth, dstHeight);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ColorConvert.h"
+#include "VideoRect.h"
+
+struct AVFrame;
+class ThreadPool;
+
+enum class ScaleFilter
+{
+    Bilinear,
+    Bicubic // Catmull-Rom
+};
+
+// Fused NV12/I420 -> RGBA scaler for frames in system memory: one pass scales to an
+// arbitrary output size, converts with the ColorConverter math and letterboxes into the
+// target buffer. Output rows are split into bands that the calling thread and a private
+// ThreadPool claim in turn; per output row a thread filters vertically into one
+// source-width row of scratch, then horizontally into one output-width row that is
+// converted straight into the target, so no intermediate full-size picture exists. When
+// downscaling the filters widen with the scale factor, so 4K -> 1080p or 1080p ->
+// thumbnail are antialiased rather than decimated.
+//
+// Chroma is filtered from its own plane at its sited position (left or centred per the
+// frame's chroma_location) to 4:2:0 at the output size, so each output row finishes in
+// the ColorConverter SIMD kernel specialized for the source's ColorSpec, with the same
+// math and chroma upsampling as an unscaled conversion. Filter taps are rebuilt only when
+// the geometry changes. One instance converts one frame at a time.
+class ScaleConverter
+{
+public:
+    struct Config
+    {
+        ScaleFilter filter = ScaleFilter::Bicubic;
+        int threads = 0;           // including the caller; 0: one per hardware thread, 1: no pool
+        bool keepAspect = true;    // false: stretch to the whole target
+        uint8_t background[4] = {0, 0, 0, 255}; // RGBA of the bars
+    };
+
+    // 8-bit 4:2:0 source planes; for NV12 u is the interleaved chroma plane and v unused
+    struct Source
+    {
+        const uint8_t *y = nullptr;
+        const uint8_t *u = nullptr;
+        const uint8_t *v = nullptr;
+        int yStride = 0;
+        int uStride = 0;
+        int vStride = 0;
+        int width = 0;
+        int height = 0;
+        bool nv12 = false;
+        int sarNum = 0; // sample aspect ratio, 0: square pixels
+        int sarDen = 1;
+        bool chromaCenteredX = false; // else co-sited with the left luma sample (MPEG-2/H.264 default)
+        bool chromaCositedY = false;  // else centred between two luma rows
+        ColorSpec color;              // matrix and range of the final conversion
+    };
+
+private:
+    // Per output sample along one axis: taps consecutive source samples from start
+    struct AxisFilter
+    {
+        int taps = 0;
+        std::vector<int> start;
+        std::vector<int32_t> weights; // Q14, taps per output sample, summing to 1 << 14
+    };
+
+    struct Geometry
+    {
+        int srcWidth = 0, srcHeight = 0;
+        VideoRect rect;
+        ScaleFilter filter = ScaleFilter::Bicubic;
+        bool chromaCenteredX = false, chromaCositedY = false;
+
+        bool operator==(const Geometry &o) const
+        {
+            return srcWidth == o.srcWidth && srcHeight == o.srcHeight && rect == o.rect && filter == o.filter &&
+                   chromaCenteredX == o.chromaCenteredX && chromaCositedY == o.chromaCositedY;
+        }
+    };
+
+    struct Scratch
+    {
+        std::vector<int32_t> luma;   // one vertically filtered source row, Q7
+        std::vector<int32_t> chroma; // one chroma row, Q7: interleaved U/V (NV12) or U then V
+        std::vector<uint8_t> out;    // Y, U and V of one output row, chroma at half width
+    };
+
+    Config config;
+    std::unique_ptr<ThreadPool> pool;
+    int threadCount = 1;
+    Geometry geometry;
+    bool geometryValid = false;
+    AxisFilter lumaX, lumaY, chromaX, chromaY;
+    std::vector<Scratch> scratch;
+
+public:
+    ScaleConverter();
+    explicit ScaleConverter(const Config &cfg);
+    ScaleConverter(const ScaleConverter &) = delete;
+    ScaleConverter &operator=(const ScaleConverter &) = delete;
+    ~ScaleConverter();
+
+    // Scale src into a dstWidth x dstHeight RGBA target, filling the bars with the background
+    bool Convert(const Source &src, uint8_t *dst, int dstStride, int dstWidth, int dstHeight);
+    // Same for a system-memory NV12 / YUV420P / YUVJ420P frame; false for other formats
+    bool Convert(const AVFrame *frame, uint8_t *dst, int dstStride, int dstWidth, int dstHeight);
+
+    // Where the picture went in the last converted target
+    const VideoRect &GetLastRect() const { return geometry.rect; }
+    int GetThreadCount() const { return threadCount; }
+    const Config &GetConfig() const { return config; }
+
+private:
+    void UpdateGeometry(const Geometry &g);
+    void ConvertBand(const Source &src, ColorConverter::I420Func convertRow, Scratch &rows, uint8_t *dst,
+                     int dstStride, int dstWidth, int rowBegin, int rowEnd) const;
+};
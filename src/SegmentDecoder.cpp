@@ -0,0 +1,314 @@
+#include "SegmentDecoder.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// Cuts one worker's output at the end of its segment and hands frames on
+class SegmentDecoder::WorkerSink : public IFrameSink
+{
+private:
+    SegmentDecoder *owner;
+    Worker *worker;
+    int segment;
+    int64_t endPts;
+
+public:
+    bool failed = false;
+
+    WorkerSink(SegmentDecoder *decoder, Worker *w, int s)
+        : owner(decoder), worker(w), segment(s), endPts(decoder->segments[s].endPts) {}
+
+    bool OnFrame(AVFrame *frame) override
+    {
+        if (owner->stopRequested.load(std::memory_order_relaxed))
+            return false;
+
+        // The next segment starts here
+        int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+        if (endPts != AV_NOPTS_VALUE && pts != AV_NOPTS_VALUE && pts >= endPts)
+            return false;
+        worker->frames++;
+
+        if (!owner->ordered)
+        {
+            if (owner->unorderedSink->OnSegmentFrame(segment, frame))
+                return true;
+            owner->stopRequested = true;
+            return false;
+        }
+
+        AVFrame *ref = av_frame_clone(frame);
+        if (!ref)
+        {
+            std::cerr << "Failed to reference decoded frame" << std::endl;
+            failed = true;
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(owner->mutex);
+            owner->outputs[segment].frames.push_back(ref);
+            owner->bufferedFrames++;
+            owner->stats.maxBufferedFrames = std::max(owner->stats.maxBufferedFrames, owner->bufferedFrames);
+        }
+        owner->outputReady.notify_one();
+        return true;
+    }
+};
+
+SegmentDecoder::Worker::~Worker()
+{
+    // The codec goes before its backend
+    core.Close();
+    delete backend;
+}
+
+SegmentDecoder::SegmentDecoder() : SegmentDecoder(Config())
+{
+}
+
+SegmentDecoder::SegmentDecoder(const Config &cfg) : config(cfg)
+{
+    if (config.workers <= 0)
+        config.workers = std::max(1, (int)std::thread::hardware_concurrency());
+    config.segmentsPerWorker = std::max(1, config.segmentsPerWorker);
+}
+
+SegmentDecoder::~SegmentDecoder()
+{
+    for (SegmentOutput &output : outputs)
+    {
+        for (AVFrame *frame : output.frames)
+            av_frame_free(&frame);
+    }
+}
+
+std::unique_ptr<SegmentDecoder::Worker> SegmentDecoder::CreateWorker() const
+{
+    auto worker = std::make_unique<Worker>();
+    worker->backend = DecodeBackendFactory::Create(config.backend.c_str(), config.decodeThreads, config.poolConfig);
+    if (!worker->backend)
+        return nullptr;
+    worker->core.SetInputMode(config.inputMode);
+    worker->core.SetIndexSidecar(config.indexSidecar);
+    if (!worker->core.Open(filename.c_str(), worker->backend))
+        return nullptr;
+    if (worker->core.IsLowLatency())
+    {
+        std::cerr << "Segmented decoding needs a file input: " << filename << std::endl;
+        return nullptr;
+    }
+    return worker;
+}
+
+bool SegmentDecoder::Open(const char *file)
+{
+    filename = file;
+    workers.clear();
+    workers.push_back(CreateWorker());
+    Worker *first = workers.back().get();
+    if (!first)
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+    if (!first->core.BuildKeyframeIndex())
+        return false;
+    stats.indexMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    index = first->core.GetKeyframeIndex();
+
+    PlanSegments(config.workers);
+    stats.segments = segments.size();
+    // More workers than segments would only open files
+    stats.workers = std::min(config.workers, (int)segments.size());
+    return !segments.empty();
+}
+
+void SegmentDecoder::PlanSegments(int workerCount)
+{
+    // Equal packet counts, cut at the keyframe that crosses each share
+    const std::vector<KeyframeIndex::Entry> &entries = index.GetEntries();
+    int64_t target = std::max<int64_t>(1, index.GetPacketCount() / ((int64_t)workerCount * config.segmentsPerWorker));
+    segments.clear();
+    for (const KeyframeIndex::Entry &entry : entries)
+    {
+        if (!segments.empty() && entry.packet - segments.back().firstPacket < target)
+            continue;
+        if (!segments.empty())
+            segments.back().endPts = entry.pts;
+        Segment segment;
+        segment.startPts = entry.pts;
+        segment.firstPacket = entry.packet;
+        segments.push_back(segment);
+    }
+    for (size_t i = 0; i < segments.size(); i++)
+    {
+        int64_t nextPacket = i + 1 < segments.size() ? segments[i + 1].firstPacket : index.GetPacketCount();
+        segments[i].packets = nextPacket - segments[i].firstPacket;
+    }
+}
+
+bool SegmentDecoder::RunOrdered(IFrameSink *sink)
+{
+    return Run(sink);
+}
+
+bool SegmentDecoder::RunUnordered(ISegmentFrameSink *sink)
+{
+    unorderedSink = sink;
+    return Run(nullptr);
+}
+
+bool SegmentDecoder::Run(IFrameSink *orderedSink)
+{
+    if (segments.empty())
+        return false;
+
+    ordered = orderedSink != nullptr;
+    stopRequested = false;
+    failed = false;
+    nextSegment = 0;
+    consumerSegment = 0;
+    bufferedFrames = 0;
+    stats.consumerWaitMs = 0.0;
+    stats.maxBufferedFrames = 0;
+    outputs = std::vector<SegmentOutput>(segments.size());
+    segmentsAhead = config.maxSegmentsAhead > 0 ? config.maxSegmentsAhead : 2 * stats.workers;
+    // Slots are filled by their own worker task, so the vector must not grow meanwhile
+    workers.resize(stats.workers);
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = true;
+    {
+        ThreadPool pool(stats.workers);
+        for (int i = 0; i < stats.workers; i++)
+        {
+            pool.Submit([this, i] {
+                // Workers beyond the first open the file concurrently on first use
+                if (!workers[i])
+                {
+                    workers[i] = CreateWorker();
+                    if (!workers[i])
+                    {
+                        Fail();
+                        return;
+                    }
+                    workers[i]->core.SetKeyframeIndex(index);
+                }
+                RunWorker(workers[i].get());
+            });
+        }
+
+        if (ordered)
+        {
+            for (int s = 0; s < (int)segments.size() && ok; s++)
+            {
+                while (ok)
+                {
+                    AVFrame *frame = nullptr;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        auto waitStart = std::chrono::steady_clock::now();
+                        outputReady.wait(lock, [&] { return !outputs[s].frames.empty() || outputs[s].done || failed; });
+                        stats.consumerWaitMs +=
+                            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+                        if (failed)
+                        {
+                            ok = false;
+                            break;
+                        }
+                        if (outputs[s].frames.empty())
+                            break;
+                        frame = outputs[s].frames.front();
+                        outputs[s].frames.pop_front();
+                        bufferedFrames--;
+                    }
+
+                    ok = orderedSink->OnFrame(frame);
+                    av_frame_free(&frame);
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    consumerSegment = s + 1;
+                }
+                slotFree.notify_all();
+            }
+
+            if (!ok)
+            {
+                // Release workers waiting for a slot; the pool joins them below
+                stopRequested = true;
+                slotFree.notify_all();
+            }
+        }
+    }
+    stats.decodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    stats.frames = stats.packetsRead = stats.preRollFrames = 0;
+    for (auto &worker : workers)
+    {
+        if (!worker)
+            continue;
+        stats.frames += worker->frames;
+        stats.packetsRead += worker->core.GetPacketsRead();
+        stats.preRollFrames += worker->core.GetSeekStats().preRollFrames;
+    }
+    return ok && !failed && !stopRequested;
+}
+
+void SegmentDecoder::RunWorker(Worker *worker)
+{
+    while (true)
+    {
+        int segment;
+        {
+            // Ordered mode: never run more than segmentsAhead segments past the consumer
+            std::unique_lock<std::mutex> lock(mutex);
+            slotFree.wait(lock, [this] {
+                return stopRequested || failed || !ordered || nextSegment < consumerSegment + segmentsAhead;
+            });
+            if (stopRequested || failed || nextSegment >= (int)segments.size())
+                return;
+            segment = nextSegment++;
+        }
+
+        bool ok = DecodeSegment(worker, segment);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            outputs[segment].done = true;
+            failed = failed || !ok;
+        }
+        outputReady.notify_one();
+        if (!ok)
+        {
+            slotFree.notify_all();
+            return;
+        }
+    }
+}
+
+bool SegmentDecoder::DecodeSegment(Worker *worker, int segment)
+{
+    // A freshly opened decoder already stands at the first keyframe
+    if (!(worker->fresh && segment == 0) && !worker->core.Seek(segments[segment].startPts))
+        return false;
+    worker->fresh = false;
+
+    WorkerSink sink(this, worker, segment);
+    while (worker->core.DecodeOneFrame(&sink))
+    {
+    }
+    return !sink.failed;
+}
+
+void SegmentDecoder::Fail()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        failed = true;
+    }
+    outputReady.notify_one();
+    slotFree.notify_all();
+}
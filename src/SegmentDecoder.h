@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "DecoderCore.h"
+#include "FramePool.h"
+
+// Receives the frames of a segmented decode as soon as any worker produced them
+class ISegmentFrameSink
+{
+public:
+    virtual ~ISegmentFrameSink() = default;
+
+    // Called concurrently from every worker thread; within one segment frames arrive in
+    // display order. Same ownership rules as IFrameSink::OnFrame. Return false to stop.
+    virtual bool OnSegmentFrame(int segment, AVFrame *frame) = 0;
+};
+
+// Offline throughput mode: the file is split at keyframes into segments that are decoded
+// concurrently, each worker with its own codec context seeking from segment to segment.
+// Frame threading is limited by the dependency chain between neighbouring frames; GOPs
+// are independent, so this keeps scaling with the core count.
+//
+// A segment runs from its first keyframe up to the next segment's first keyframe in
+// display order. The leading pictures of an open GOP are decoded by the segment before
+// it, which holds their references, and dropped as pre-roll by the segment they start.
+//
+// Frames either reach one sink in display order on the calling thread (RunOrdered:
+// completed segments are buffered, and workers stay at most maxSegmentsAhead segments
+// ahead of the consumer) or go straight from the workers to a sink, tagged with their
+// segment (RunUnordered). Ordered mode holds decoded frames, so it suits the software
+// backend; hardware surface pools are too small to buffer whole segments.
+class SegmentDecoder
+{
+public:
+    struct Config
+    {
+        int workers = 0;            // 0: one per hardware thread
+        int segmentsPerWorker = 4;  // more, smaller segments balance better but cost a seek each
+        int maxSegmentsAhead = 0;   // ordered mode look-ahead, 0: two per worker
+        std::string backend = "sw";
+        int decodeThreads = 1;      // libavcodec threads per worker
+        const FramePool::Config *poolConfig = nullptr;
+        DecoderCore::InputMode inputMode = DecoderCore::InputMode::Auto;
+        bool indexSidecar = false;
+    };
+
+    struct Segment
+    {
+        int64_t startPts = AV_NOPTS_VALUE; // first keyframe
+        int64_t endPts = AV_NOPTS_VALUE;   // next segment's first keyframe, none for the last
+        int64_t firstPacket = 0;
+        int64_t packets = 0;
+    };
+
+    struct Stats
+    {
+        int workers = 0;
+        size_t segments = 0;
+        uint64_t frames = 0;
+        uint64_t packetsRead = 0;    // including packets read again after seeking
+        uint64_t preRollFrames = 0;  // open-GOP leading pictures decoded twice
+        double indexMs = 0.0;
+        double decodeSeconds = 0.0;  // first worker started to last frame delivered
+        double consumerWaitMs = 0.0; // ordered mode: consumer waiting for the next frame
+        size_t maxBufferedFrames = 0;
+    };
+
+private:
+    struct Worker
+    {
+        IDecodeBackend *backend = nullptr;
+        DecoderCore core;
+        bool fresh = true; // opened and not moved yet
+        uint64_t frames = 0;
+
+        ~Worker();
+    };
+
+    struct SegmentOutput
+    {
+        std::deque<AVFrame *> frames;
+        bool done = false;
+    };
+
+    class WorkerSink;
+
+    Config config;
+    std::string filename;
+    KeyframeIndex index;
+    std::vector<Segment> segments;
+    std::vector<std::unique_ptr<Worker>> workers;
+    Stats stats;
+
+    // Run state
+    bool ordered = false;
+    ISegmentFrameSink *unorderedSink = nullptr;
+    std::atomic<bool> stopRequested{false};
+    std::mutex mutex;
+    std::condition_variable outputReady; // consumer: a frame or the end of a segment
+    std::condition_variable slotFree;    // workers: the consumer moved on
+    std::vector<SegmentOutput> outputs;
+    int nextSegment = 0;
+    int consumerSegment = 0;
+    int segmentsAhead = 0;
+    bool failed = false;
+    size_t bufferedFrames = 0;
+
+public:
+    SegmentDecoder();
+    explicit SegmentDecoder(const Config &cfg);
+    SegmentDecoder(const SegmentDecoder &) = delete;
+    SegmentDecoder &operator=(const SegmentDecoder &) = delete;
+    ~SegmentDecoder();
+
+    // Open the file, index its keyframes and plan the segments
+    bool Open(const char *file);
+
+    // Every frame of the file to sink, in display order, on the calling thread
+    bool RunOrdered(IFrameSink *sink);
+    // Every frame of the file to sink, from the workers, as soon as it is decoded
+    bool RunUnordered(ISegmentFrameSink *sink);
+
+    const std::vector<Segment> &GetSegments() const { return segments; }
+    const KeyframeIndex &GetKeyframeIndex() const { return index; }
+    int GetWorkerCount() const { return stats.workers; }
+    const Stats &GetStats() const { return stats; }
+
+private:
+    std::unique_ptr<Worker> CreateWorker() const;
+    void PlanSegments(int workerCount);
+    bool Run(IFrameSink *orderedSink);
+    void RunWorker(Worker *worker);
+    bool DecodeSegment(Worker *worker, int segment);
+    void Fail();
+};
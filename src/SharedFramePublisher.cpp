@@ -0,0 +1,244 @@
+#include "SharedFramePublisher.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+extern "C"
+{
+#include <libavutil/hwcontext.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#ifndef _WIN32
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Aligned stride and row count of each plane
+static int PlaneLayout(int width, int height, int format, int linesize[4], int rows[4])
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)format);
+    if (!desc || (desc->flags & AV_PIX_FMT_FLAG_HWACCEL) || av_image_fill_linesizes(linesize, (AVPixelFormat)format, width) < 0)
+        return 0;
+    int planes = av_pix_fmt_count_planes((AVPixelFormat)format);
+    for (int p = 0; p < planes; p++)
+    {
+        bool chroma = (p == 1 || p == 2) && !(desc->flags & AV_PIX_FMT_FLAG_RGB);
+        rows[p] = chroma ? -((-height) >> desc->log2_chroma_h) : height;
+        linesize[p] = (int)AlignUp((size_t)linesize[p], 64);
+    }
+    return planes;
+}
+
+size_t SharedFramePublisher::SlotBytesFor(int width, int height, int format)
+{
+    int linesize[4], rows[4];
+    int planes = PlaneLayout(width, height, format, linesize, rows);
+    size_t bytes = 0;
+    for (int p = 0; p < planes; p++)
+        bytes += (size_t)linesize[p] * rows[p];
+    return bytes;
+}
+
+SharedFramePublisher::SharedFramePublisher(const Config &cfg) : config(cfg), swFrame(av_frame_alloc())
+{
+    config.slots = std::max(2, config.slots);
+}
+
+SharedFramePublisher::~SharedFramePublisher()
+{
+    Close();
+    av_frame_free(&swFrame);
+}
+
+bool SharedFramePublisher::Create(size_t slotDataBytes)
+{
+#ifdef _WIN32
+    (void)slotDataBytes;
+    std::cerr << "Shared-memory frame rings are not supported on Windows" << std::endl;
+    return false;
+#else
+    size_t slotStride = AlignUp(SharedSlotHeader::kDataOffset + slotDataBytes, 4096);
+    size_t bytes = SharedRingHeader::kBytes + slotStride * config.slots;
+
+    // Never take over a name in use: readers of a running publisher would lose their ring
+    int fd = shm_open(config.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 && errno == EEXIST && config.removeStale && RemoveStale())
+        fd = shm_open(config.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        int error = errno;
+        std::cerr << "Could not create frame ring " << config.name << ": " << std::strerror(error) << std::endl;
+        if (error == EEXIST)
+            std::cerr << "Another publisher uses it, or one that crashed left it behind (remove /dev/shm"
+                      << config.name << ")" << std::endl;
+        return false;
+    }
+    void *mapping = MAP_FAILED;
+    if (ftruncate(fd, (off_t)bytes) == 0)
+        mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Could not map frame ring " << config.name << ": " << std::strerror(errno) << std::endl;
+        shm_unlink(config.name.c_str());
+        return false;
+    }
+
+    // The object starts zeroed: sequences 0, nothing published
+    base = (uint8_t *)mapping;
+    mappedBytes = bytes;
+    header = new (base) SharedRingHeader();
+    header->version = SharedRingHeader::kVersion;
+    header->slotCount = (uint32_t)config.slots;
+    header->timeBaseNum = config.timeBase.num;
+    header->timeBaseDen = config.timeBase.den;
+    header->ownerPid = (int32_t)getpid();
+    header->slotStride = slotStride;
+    header->slotDataBytes = slotDataBytes;
+    for (int i = 0; i < config.slots; i++)
+        new (base + SharedRingHeader::kBytes + (size_t)i * slotStride) SharedSlotHeader();
+    header->magic.store(SharedRingHeader::kMagic, std::memory_order_release);
+    return true;
+#endif
+}
+
+bool SharedFramePublisher::RemoveStale()
+{
+#ifdef _WIN32
+    return false;
+#else
+    int fd = shm_open(config.name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return errno == ENOENT; // gone in the meantime
+    struct stat st;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)SharedRingHeader::kBytes)
+        mapping = mmap(nullptr, SharedRingHeader::kBytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    // Only a complete header names its owner; a ring still being created is not stale
+    const SharedRingHeader *existing = (const SharedRingHeader *)mapping;
+    pid_t owner = existing->magic.load(std::memory_order_acquire) == SharedRingHeader::kMagic ? existing->ownerPid : 0;
+    munmap(mapping, SharedRingHeader::kBytes);
+    if (owner <= 0 || kill(owner, 0) == 0 || errno != ESRCH)
+        return false;
+
+    std::cerr << "Removing frame ring " << config.name << " left by process " << owner << std::endl;
+    return shm_unlink(config.name.c_str()) == 0 || errno == ENOENT;
+#endif
+}
+
+void SharedFramePublisher::Wake()
+{
+    header->wake.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+    syscall(SYS_futex, (void *)&header->wake, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+bool SharedFramePublisher::OnFrame(AVFrame *frame)
+{
+    const AVFrame *src = frame;
+    if (frame->hw_frames_ctx)
+    {
+        av_frame_unref(swFrame);
+        if (av_hwframe_transfer_data(swFrame, frame, 0) < 0)
+        {
+            std::cerr << "Failed to download hardware frame" << std::endl;
+            return false;
+        }
+        av_frame_copy_props(swFrame, frame);
+        src = swFrame;
+        stats.downloaded++;
+    }
+
+    int linesize[4], rows[4];
+    int planes = PlaneLayout(src->width, src->height, src->format, linesize, rows);
+    size_t needed = SlotBytesFor(src->width, src->height, src->format);
+    if (planes == 0)
+    {
+        std::cerr << "Cannot publish " << av_get_pix_fmt_name((AVPixelFormat)src->format) << " frames" << std::endl;
+        return false;
+    }
+    if (!header && !Create(config.slotBytes ? config.slotBytes : needed))
+        return false;
+    if (needed > header->slotDataBytes)
+    {
+        if (stats.tooLarge++ == 0)
+            std::cerr << "Frame of " << needed << " bytes does not fit the ring slots, dropped" << std::endl;
+        return true;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t number = header->published.load(std::memory_order_relaxed);
+    SharedSlotHeader *slot = (SharedSlotHeader *)(base + SharedRingHeader::kBytes + (number % header->slotCount) * header->slotStride);
+    uint8_t *data = (uint8_t *)slot + SharedSlotHeader::kDataOffset;
+
+    // Odd: readers holding a view of this slot will see it change
+    uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    int rowBytes[4];
+    av_image_fill_linesizes(rowBytes, (AVPixelFormat)src->format, src->width);
+    size_t offset = 0;
+    for (int p = 0; p < planes; p++)
+    {
+        av_image_copy_plane(data + offset, linesize[p], src->data[p], src->linesize[p], rowBytes[p], rows[p]);
+        slot->linesize[p] = linesize[p];
+        slot->offset[p] = offset;
+        offset += (size_t)linesize[p] * rows[p];
+    }
+    slot->frameNumber = number;
+    slot->pts = src->best_effort_timestamp != AV_NOPTS_VALUE ? src->best_effort_timestamp : src->pts;
+    slot->width = src->width;
+    slot->height = src->height;
+    slot->format = src->format;
+    slot->planes = planes;
+    slot->dataBytes = offset;
+    slot->publishNs =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+    header->published.store(number + 1, std::memory_order_release);
+    Wake();
+
+    stats.frames++;
+    stats.bytes += offset;
+    stats.copyMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void SharedFramePublisher::Close()
+{
+#ifndef _WIN32
+    if (!header)
+        return;
+    header->closed.store(1, std::memory_order_release);
+    Wake();
+    munmap(base, mappedBytes);
+    shm_unlink(config.name.c_str());
+#endif
+    base = nullptr;
+    mappedBytes = 0;
+    header = nullptr;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "FrameSink.h"
+#include "SharedFrameRing.h"
+
+// Publishes decoded frames into a shared-memory ring (SharedFrameRing.h) so that any number
+// of processes on the host can consume one decode through SharedFrameReader. Each frame is
+// copied once, plane by plane with 64-byte aligned strides, into the next slot under its
+// seqlock; readers then use it in place. The publisher never waits for readers.
+//
+// The ring is created on the first frame, with slots sized for it unless slotBytes is set;
+// later frames that do not fit are dropped and counted. A name already in use is an error
+// unless removeStale is set and its publisher process is gone. POSIX only.
+class SharedFramePublisher : public IFrameSink
+{
+public:
+    struct Config
+    {
+        std::string name;      // shared memory object name, "/h264ring-cam1"
+        int slots = 8;         // a reader may fall slots - 1 frames behind before losing any
+        size_t slotBytes = 0;  // frame data per slot, 0: what the first frame needs
+        AVRational timeBase = {1, 1000000}; // of the published pts
+        bool removeStale = false; // replace a ring whose publisher is no longer running
+    };
+
+    struct Stats
+    {
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+        uint64_t tooLarge = 0;   // frames that did not fit a slot
+        uint64_t downloaded = 0; // hardware frames copied to system memory first
+        double copyMs = 0.0;
+    };
+
+private:
+    Config config;
+    uint8_t *base = nullptr;
+    size_t mappedBytes = 0;
+    SharedRingHeader *header = nullptr;
+    AVFrame *swFrame = nullptr;
+    Stats stats;
+
+public:
+    explicit SharedFramePublisher(const Config &cfg);
+    SharedFramePublisher(const SharedFramePublisher &) = delete;
+    SharedFramePublisher &operator=(const SharedFramePublisher &) = delete;
+    ~SharedFramePublisher() override;
+
+    // Copy the frame into the next slot; false only if the ring cannot be created
+    bool OnFrame(AVFrame *frame) override;
+
+    // Mark the ring closed, wake readers waiting for a frame and remove the name; readers
+    // keep their mapping until they close it
+    void Close();
+
+    bool IsOpen() const { return header != nullptr; }
+    const Stats &GetStats() const { return stats; }
+
+    // Frame data bytes a frame needs in a slot
+    static size_t SlotBytesFor(int width, int height, int format);
+
+private:
+    bool Create(size_t slotDataBytes);
+    bool RemoveStale();
+    void Wake();
+};
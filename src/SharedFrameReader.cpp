@@ -0,0 +1,206 @@
+#include "SharedFrameReader.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+int64_t SharedFrameReader::NowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool SharedFrameReader::Open(const char *name, int timeoutMs)
+{
+    Close();
+#ifdef _WIN32
+    (void)name;
+    (void)timeoutMs;
+    std::cerr << "Shared-memory frame rings are not supported on Windows" << std::endl;
+    return false;
+#else
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs > 0 ? timeoutMs : 0);
+    while (true)
+    {
+        // The publisher may not have created or initialized the ring yet
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd >= 0)
+        {
+            struct stat st;
+            if (fstat(fd, &st) == 0 && (size_t)st.st_size >= SharedRingHeader::kBytes)
+            {
+                void *mapping = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+                if (mapping != MAP_FAILED)
+                {
+                    base = (const uint8_t *)mapping;
+                    mappedBytes = (size_t)st.st_size;
+                    header = (const SharedRingHeader *)base;
+                }
+            }
+            close(fd);
+        }
+
+        if (header && header->magic.load(std::memory_order_acquire) == SharedRingHeader::kMagic)
+        {
+            if (header->version != SharedRingHeader::kVersion ||
+                SharedRingHeader::kBytes + header->slotCount * header->slotStride > mappedBytes)
+            {
+                std::cerr << "Incompatible frame ring " << name << std::endl;
+                Close();
+                return false;
+            }
+            // Start at the oldest frame that cannot be rewritten right now
+            uint64_t published = header->published.load(std::memory_order_acquire);
+            cursor = published >= header->slotCount ? published - header->slotCount + 1 : 0;
+            stats = Stats();
+            return true;
+        }
+        Close();
+
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            std::cerr << "Frame ring " << name << " not found" << std::endl;
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+#endif
+}
+
+void SharedFrameReader::Close()
+{
+#ifndef _WIN32
+    if (base)
+        munmap((void *)base, mappedBytes);
+#endif
+    base = nullptr;
+    mappedBytes = 0;
+    header = nullptr;
+}
+
+void SharedFrameReader::GetTimeBase(int &num, int &den) const
+{
+    num = header ? header->timeBaseNum : 0;
+    den = header ? header->timeBaseDen : 1;
+}
+
+const SharedSlotHeader *SharedFrameReader::Slot(uint64_t frameNumber) const
+{
+    return (const SharedSlotHeader *)(base + SharedRingHeader::kBytes + (frameNumber % header->slotCount) * header->slotStride);
+}
+
+bool SharedFrameReader::TryRead(uint64_t frameNumber, FrameView &view) const
+{
+    const SharedSlotHeader *slot = Slot(frameNumber);
+    uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence & 1)
+        return false;
+
+    view.frameNumber = slot->frameNumber;
+    view.pts = slot->pts;
+    view.publishNs = slot->publishNs;
+    view.width = slot->width;
+    view.height = slot->height;
+    view.format = slot->format;
+    view.planes = slot->planes;
+    view.dataBytes = slot->dataBytes;
+    for (int p = 0; p < 4; p++)
+    {
+        view.linesize[p] = slot->linesize[p];
+        view.data[p] = p < view.planes ? (const uint8_t *)slot + SharedSlotHeader::kDataOffset + slot->offset[p] : nullptr;
+    }
+    view.sequence = sequence;
+    view.slot = slot;
+
+    // The header copy is only good if the slot was not rewritten meanwhile
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot->sequence.load(std::memory_order_relaxed) == sequence && view.frameNumber == frameNumber &&
+           view.planes <= 4 && view.dataBytes <= header->slotDataBytes;
+}
+
+bool SharedFrameReader::Validate(const FrameView &view) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return view.slot && view.slot->sequence.load(std::memory_order_relaxed) == view.sequence;
+}
+
+void SharedFrameReader::WaitForFrame(uint32_t wakeValue, int timeoutMs) const
+{
+#ifdef __linux__
+    // Shared (not private) futex: the publisher in another process wakes it
+    timespec timeout = {timeoutMs / 1000, (long)(timeoutMs % 1000) * 1000000};
+    syscall(SYS_futex, (const void *)&header->wake, FUTEX_WAIT, wakeValue, timeoutMs >= 0 ? &timeout : nullptr, nullptr, 0);
+#else
+    (void)wakeValue;
+    (void)timeoutMs;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+}
+
+bool SharedFrameReader::Next(FrameView &view, int timeoutMs)
+{
+    if (!header)
+        return false;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs > 0 ? timeoutMs : 0);
+    while (true)
+    {
+        // Wake value before the check, so a frame published in between is not slept through
+        uint32_t wakeValue = header->wake.load(std::memory_order_acquire);
+        uint64_t published = header->published.load(std::memory_order_acquire);
+        if (cursor >= published)
+        {
+            if (header->closed.load(std::memory_order_acquire))
+                return false;
+            int remainingMs = -1;
+            if (timeoutMs >= 0)
+            {
+                remainingMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                if (remainingMs <= 0)
+                    return false;
+            }
+            WaitForFrame(wakeValue, remainingMs);
+            continue;
+        }
+
+        // The slot of frame `published` may be being rewritten, taking frame published - slotCount
+        uint64_t oldest = published >= header->slotCount ? published - header->slotCount + 1 : 0;
+        if (cursor < oldest)
+        {
+            stats.lapped += oldest - cursor;
+            cursor = oldest;
+        }
+
+        if (TryRead(cursor, view))
+        {
+            cursor++;
+            stats.frames++;
+            return true;
+        }
+        // Rewritten while reading the slot header: that frame is gone
+        stats.torn++;
+        cursor++;
+    }
+}
+
+bool SharedFrameReader::Latest(FrameView &view)
+{
+    if (!header)
+        return false;
+    uint64_t published = header->published.load(std::memory_order_acquire);
+    if (published == 0 || !TryRead(published - 1, view))
+        return false;
+    cursor = published;
+    stats.frames++;
+    return true;
+}
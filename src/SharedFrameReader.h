@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+#include "SharedFrameRing.h"
+
+// Reader side of a SharedFramePublisher ring: maps the shared memory object read-only and
+// walks the published frames. Views point straight into the mapping, so consuming a frame
+// copies nothing; since the publisher never waits, check Validate after using the data and
+// drop the result if the slot was rewritten meanwhile. Has no FFmpeg dependency, so it
+// builds into consumers as the small frame_ring_reader library (POSIX only).
+class SharedFrameReader
+{
+public:
+    struct FrameView
+    {
+        uint64_t frameNumber = 0;
+        int64_t pts = 0;
+        int64_t publishNs = 0;
+        int width = 0;
+        int height = 0;
+        int format = -1; // AVPixelFormat
+        int planes = 0;
+        int linesize[4] = {};
+        const uint8_t *data[4] = {};
+        uint64_t dataBytes = 0;
+        uint64_t sequence = 0;
+        const SharedSlotHeader *slot = nullptr;
+    };
+
+    struct Stats
+    {
+        uint64_t frames = 0;
+        uint64_t lapped = 0; // overwritten before this reader got to them
+        uint64_t torn = 0;   // overwritten while being read, then skipped
+    };
+
+private:
+    const uint8_t *base = nullptr;
+    size_t mappedBytes = 0;
+    const SharedRingHeader *header = nullptr;
+    uint64_t cursor = 0; // next frame number to return
+    Stats stats;
+
+public:
+    SharedFrameReader() = default;
+    SharedFrameReader(const SharedFrameReader &) = delete;
+    SharedFrameReader &operator=(const SharedFrameReader &) = delete;
+    ~SharedFrameReader() { Close(); }
+
+    // Map the ring "/name"; waits up to timeoutMs for the publisher to create it. Reading
+    // starts at the oldest frame still in the ring.
+    bool Open(const char *name, int timeoutMs = 0);
+    void Close();
+
+    // Next frame in publish order, waiting up to timeoutMs (< 0: forever) for one; false on
+    // timeout or once the publisher closed and everything was read
+    bool Next(FrameView &view, int timeoutMs = -1);
+    // Skip the backlog: the newest frame, if any
+    bool Latest(FrameView &view);
+    // The view's data is still the frame it described; call after consuming it
+    bool Validate(const FrameView &view) const;
+
+    bool IsClosed() const { return header && header->closed.load(std::memory_order_acquire); }
+    uint64_t GetPublished() const { return header ? header->published.load(std::memory_order_acquire) : 0; }
+    int GetSlotCount() const { return header ? (int)header->slotCount : 0; }
+    void GetTimeBase(int &num, int &den) const;
+    const Stats &GetStats() const { return stats; }
+
+    // Same clock as SharedSlotHeader::publishNs
+    static int64_t NowNs();
+
+private:
+    const SharedSlotHeader *Slot(uint64_t frameNumber) const;
+    bool TryRead(uint64_t frameNumber, FrameView &view) const;
+    void WaitForFrame(uint32_t wakeValue, int timeoutMs) const;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Memory layout of a shared-memory frame ring, written by SharedFramePublisher and mapped
+// read-only by SharedFrameReader. The object is a POSIX shared memory object ("/name"): one
+// header page, then slotCount slots of slotStride bytes, each a slot header followed by the
+// frame planes. Frame n is written to slot n % slotCount; the publisher never waits for
+// readers, a reader that falls more than slotCount - 1 frames behind loses frames.
+//
+// Each slot is a seqlock: the sequence is odd while the publisher rewrites the slot and
+// advances by two per frame, so a reader's view is valid if the sequence was even and is
+// unchanged after the reader is done with the data.
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring needs address-free 64-bit atomics");
+
+struct SharedRingHeader
+{
+    static constexpr uint32_t kMagic = 0x474E5248; // "HRNG"
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kBytes = 4096;
+
+    std::atomic<uint32_t> magic; // stored last, once the rest of the header is valid
+    uint32_t version;
+    uint32_t slotCount;
+    int32_t timeBaseNum; // of SharedSlotHeader::pts
+    int32_t timeBaseDen;
+    int32_t ownerPid;       // publisher process, to tell a ring left by a crash from a live one
+    uint64_t slotStride;    // bytes from one slot to the next
+    uint64_t slotDataBytes; // frame data capacity of a slot
+
+    alignas(64) std::atomic<uint64_t> published; // frames completely written so far
+    std::atomic<uint32_t> wake;                  // futex word, bumped after every frame
+    std::atomic<uint32_t> closed;                // publisher finished or went away
+};
+
+struct SharedSlotHeader
+{
+    static constexpr size_t kDataOffset = 256; // frame data follows at this offset, 64-byte aligned
+
+    alignas(64) std::atomic<uint64_t> sequence;
+    uint64_t frameNumber;
+    int64_t pts;
+    int64_t publishNs; // steady clock (CLOCK_MONOTONIC), comparable between processes
+    int32_t width;
+    int32_t height;
+    int32_t format; // AVPixelFormat
+    int32_t planes;
+    int32_t linesize[4];
+    uint64_t offset[4]; // plane offsets from the slot data
+    uint64_t dataBytes;
+};
+
+static_assert(sizeof(SharedRingHeader) <= SharedRingHeader::kBytes, "ring header does not fit its page");
+static_assert(sizeof(SharedSlotHeader) <= SharedSlotHeader::kDataOffset, "slot header overlaps the frame data");
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "DecodeBackend.h"
+#include "FramePool.h"
+
+// Multi-threaded libavcodec software decoding into system memory, optionally allocating
+// frames from a FramePool instead of libavcodec's default allocator
+class SoftwareDecodeBackend : public IDecodeBackend
+{
+private:
+    int threadCount = 0;
+    FramePool *framePool = nullptr;
+
+public:
+    // threads = 0 lets libavcodec pick one thread per core
+    explicit SoftwareDecodeBackend(int threads = 0, const FramePool::Config *poolConfig = nullptr) : threadCount(threads)
+    {
+        if (poolConfig)
+            framePool = FramePool::Create(*poolConfig);
+    }
+
+    ~SoftwareDecodeBackend() override
+    {
+        // Frames still queued downstream keep the pool alive until they are freed
+        if (framePool)
+            framePool->Release();
+    }
+
+    const char *GetName() const override { return "software"; }
+
+    bool ConfigureCodec(AVCodecContext *codecCtx) override
+    {
+        codecCtx->thread_count = threadCount;
+        codecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        if (framePool)
+            framePool->Attach(codecCtx);
+        return true;
+    }
+
+    FramePool *GetFramePool() const override { return framePool; }
+};
@@ -0,0 +1,241 @@
+#include "StreamParamCache.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+extern "C"
+{
+#include <libavutil/mem.h>
+#include <libavutil/pixdesc.h>
+}
+
+static const char *const kMagic = "H264HW-PARAMS 1";
+// Bytes hashed into the identity, enough to tell re-encoded content apart
+static constexpr size_t kIdentityHashBytes = 4096;
+
+static uint64_t Fnv1a(const uint8_t *data, size_t size)
+{
+    uint64_t hash = 1469598103934665603ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static std::string ToHex(const uint8_t *data, int size)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve((size_t)size * 2);
+    for (int i = 0; i < size; i++)
+    {
+        hex.push_back(digits[data[i] >> 4]);
+        hex.push_back(digits[data[i] & 15]);
+    }
+    return hex;
+}
+
+static int HexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+static bool ParseRational(const std::string &text, AVRational &q)
+{
+    return std::sscanf(text.c_str(), "%d/%d", &q.num, &q.den) == 2;
+}
+
+std::string StreamParamCache::SidecarPath(const char *filename)
+{
+    return std::string(filename) + ".params";
+}
+
+bool StreamParamCache::FileIdentity(const char *filename, std::string &identity)
+{
+    std::error_code ec;
+    std::filesystem::path path(filename);
+    uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec)
+        return false;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return false;
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> head(kIdentityHashBytes);
+    file.read((char *)head.data(), (std::streamsize)head.size());
+    size_t headSize = (size_t)file.gcount();
+
+    char text[96];
+    std::snprintf(text, sizeof(text), "%llu %lld %016llx", (unsigned long long)size,
+                  (long long)mtime.time_since_epoch().count(), (unsigned long long)Fnv1a(head.data(), headSize));
+    identity = text;
+    return true;
+}
+
+bool StreamParamCache::Load(const char *filename, Entry &entry)
+{
+    std::ifstream in(SidecarPath(filename));
+    std::string line, identity;
+    if (!in || !std::getline(in, line) || line != kMagic || !FileIdentity(filename, identity))
+        return false;
+
+    avcodec_parameters_free(&entry.codecpar);
+    entry.codecpar = avcodec_parameters_alloc();
+    if (!entry.codecpar)
+        return false;
+    AVCodecParameters *par = entry.codecpar;
+    par->codec_type = AVMEDIA_TYPE_VIDEO;
+
+    bool identityMatches = false;
+    while (std::getline(in, line))
+    {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+        std::string rest;
+        std::getline(fields >> std::ws, rest);
+
+        if (key == "identity")
+            identityMatches = rest == identity;
+        else if (key == "stream")
+            entry.streamIndex = std::atoi(rest.c_str());
+        else if (key == "codec")
+        {
+            const AVCodecDescriptor *desc = avcodec_descriptor_get_by_name(rest.c_str());
+            if (!desc)
+                return false;
+            par->codec_id = desc->id;
+        }
+        else if (key == "format")
+            par->format = av_get_pix_fmt(rest.c_str());
+        else if (key == "size")
+            std::sscanf(rest.c_str(), "%d %d", &par->width, &par->height);
+        else if (key == "profile")
+            std::sscanf(rest.c_str(), "%d %d", &par->profile, &par->level);
+        else if (key == "sar")
+            ParseRational(rest, par->sample_aspect_ratio);
+        else if (key == "avg_frame_rate")
+            ParseRational(rest, entry.avgFrameRate);
+        else if (key == "r_frame_rate")
+            ParseRational(rest, entry.rFrameRate);
+        else if (key == "color")
+        {
+            int range, space, primaries, trc, chroma;
+            if (std::sscanf(rest.c_str(), "%d %d %d %d %d", &range, &space, &primaries, &trc, &chroma) == 5)
+            {
+                par->color_range = (AVColorRange)range;
+                par->color_space = (AVColorSpace)space;
+                par->color_primaries = (AVColorPrimaries)primaries;
+                par->color_trc = (AVColorTransferCharacteristic)trc;
+                par->chroma_location = (AVChromaLocation)chroma;
+            }
+        }
+        else if (key == "layout")
+        {
+            int fieldOrder;
+            if (std::sscanf(rest.c_str(), "%d %d %d", &fieldOrder, &par->video_delay, &par->bits_per_raw_sample) == 3)
+                par->field_order = (AVFieldOrder)fieldOrder;
+        }
+        else if (key == "extradata" && !rest.empty())
+        {
+            if (rest.size() % 2)
+                return false;
+            int size = (int)(rest.size() / 2);
+            par->extradata = (uint8_t *)av_mallocz((size_t)size + AV_INPUT_BUFFER_PADDING_SIZE);
+            if (!par->extradata)
+                return false;
+            for (int i = 0; i < size; i++)
+            {
+                int hi = HexValue(rest[2 * i]), lo = HexValue(rest[2 * i + 1]);
+                if (hi < 0 || lo < 0)
+                    return false;
+                par->extradata[i] = (uint8_t)(hi << 4 | lo);
+            }
+            par->extradata_size = size;
+        }
+    }
+
+    return identityMatches && entry.streamIndex >= 0 && par->codec_id != AV_CODEC_ID_NONE;
+}
+
+bool StreamParamCache::Store(const char *filename, const AVStream *stream)
+{
+    std::string identity;
+    if (!FileIdentity(filename, identity))
+        return false;
+
+    const AVCodecParameters *par = stream->codecpar;
+    const char *formatName = av_get_pix_fmt_name((AVPixelFormat)par->format);
+
+    std::ostringstream out;
+    out << kMagic << "\n"
+        << "identity " << identity << "\n"
+        << "stream " << stream->index << "\n"
+        << "codec " << avcodec_get_name(par->codec_id) << "\n"
+        << "format " << (formatName ? formatName : "none") << "\n"
+        << "size " << par->width << " " << par->height << "\n"
+        << "profile " << par->profile << " " << par->level << "\n"
+        << "sar " << par->sample_aspect_ratio.num << "/" << par->sample_aspect_ratio.den << "\n"
+        << "avg_frame_rate " << stream->avg_frame_rate.num << "/" << stream->avg_frame_rate.den << "\n"
+        << "r_frame_rate " << stream->r_frame_rate.num << "/" << stream->r_frame_rate.den << "\n"
+        << "color " << (int)par->color_range << " " << (int)par->color_space << " " << (int)par->color_primaries
+        << " " << (int)par->color_trc << " " << (int)par->chroma_location << "\n"
+        << "layout " << (int)par->field_order << " " << par->video_delay << " " << par->bits_per_raw_sample << "\n"
+        << "extradata " << ToHex(par->extradata, par->extradata_size) << "\n";
+    return WriteSidecar(SidecarPath(filename), out.str());
+}
+
+bool StreamParamCache::WriteSidecar(const std::string &path, const std::string &contents)
+{
+    std::random_device random;
+    // A clash with another writer's name is all but impossible; retry rather than share it
+    for (int attempt = 0; attempt < 4; attempt++)
+    {
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".%08x%08x.tmp", random(), random());
+        std::string tempPath = path + suffix;
+        FILE *out = std::fopen(tempPath.c_str(), "wx");
+        if (!out)
+        {
+            if (errno == EEXIST)
+                continue;
+            return false;
+        }
+        bool written = std::fwrite(contents.data(), 1, contents.size(), out) == contents.size();
+        written = std::fclose(out) == 0 && written;
+
+        std::error_code ec;
+        if (written)
+            std::filesystem::rename(tempPath, path, ec);
+        if (!written || ec)
+        {
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+void StreamParamCache::Apply(const Entry &entry, AVStream *stream)
+{
+    // Keep the container's codec tag, the cache does not store it
+    uint32_t codecTag = stream->codecpar->codec_tag;
+    avcodec_parameters_copy(stream->codecpar, entry.codecpar);
+    stream->codecpar->codec_tag = codecTag;
+    stream->avg_frame_rate = entry.avgFrameRate;
+    stream->r_frame_rate = entry.rFrameRate;
+}
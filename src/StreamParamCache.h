@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+// Sidecar cache of what avformat_find_stream_info learns about the video stream (codec,
+// extradata with SPS/PPS, dimensions, pixel format, frame rate, colorimetry), stored next
+// to the media file as "<file>.params". Entries are keyed by the file's size, mtime and a
+// hash of its first 4 KB, so a replaced file is probed again. A hit lets DecoderCore skip
+// probing on repeated opens of the same content.
+class StreamParamCache
+{
+public:
+    struct Entry
+    {
+        int streamIndex = -1;
+        AVCodecParameters *codecpar = nullptr;
+        AVRational avgFrameRate = {0, 1};
+        AVRational rFrameRate = {0, 1};
+
+        Entry() = default;
+        Entry(const Entry &) = delete;
+        Entry &operator=(const Entry &) = delete;
+        ~Entry() { avcodec_parameters_free(&codecpar); }
+    };
+
+    static std::string SidecarPath(const char *filename);
+
+    // false when there is no sidecar, it is unreadable or the file changed since it was written
+    static bool Load(const char *filename, Entry &entry);
+    static bool Store(const char *filename, const AVStream *stream);
+
+    // Copy a cached entry onto the demuxer's stream in place of probing
+    static void Apply(const Entry &entry, AVStream *stream);
+
+    // "size mtime hash" of the file, shared with other sidecars (KeyframeIndex)
+    static bool FileIdentity(const char *filename, std::string &identity);
+    // Replace a sidecar with contents through a temporary file of this writer's own, created
+    // exclusively next to it, and a rename: concurrent writers never share a temporary file and
+    // readers only ever see one complete entry
+    static bool WriteSidecar(const std::string &path, const std::string &contents);
+};
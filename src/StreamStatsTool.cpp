@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BitstreamStats.h"
+#include "ThreadPool.h"
+
+// Files analysed together; results are written in input order once a batch is done
+static constexpr size_t kBatchPerWorker = 4;
+
+static void PrintUsage()
+{
+    std::cout << "Usage: H264_Stream_Stats <file or directory>... [--mode headers|full] [--out FILE] [--summary FILE]\n"
+              << "                         [--jobs J] [--threads N] [--compare]\n"
+              << "  --mode:       headers: parse NAL and slice headers only, no decoding (default)\n"
+              << "                full:    also decode and add the decoder's picture type and QP\n"
+              << "  --out FILE:   per-frame CSV, - for stdout (default stream_stats.csv)\n"
+              << "  --summary FILE: per-file CSV (default <out>_files.csv, none for stdout)\n"
+              << "  --jobs J:     files analysed concurrently (0 = one per core, default)\n"
+              << "  --threads N:  decode threads per file in full mode (default 1)\n"
+              << "  --compare:    run both modes, check that header and decoder picture types agree and\n"
+              << "                that headers mode is at least 10x faster; the CSV holds the full run" << std::endl;
+}
+
+static bool IsVideoFile(const std::filesystem::path &path)
+{
+    static const char *extensions[] = {".h264", ".264", ".avc", ".h26l", ".jsv", ".h265", ".265", ".hevc",
+                                       ".mp4",  ".m4v", ".mov", ".mkv",  ".ts",  ".m2ts", ".mts", ".flv"};
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    for (const char *e : extensions)
+    {
+        if (ext == e)
+            return true;
+    }
+    return false;
+}
+
+// Directories contribute their video files, recursively and in a stable order
+static void CollectInputs(const std::string &arg, std::vector<std::string> &files)
+{
+    std::error_code ec;
+    if (!std::filesystem::is_directory(arg, ec))
+    {
+        files.push_back(arg);
+        return;
+    }
+    std::vector<std::string> found;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(arg, ec))
+    {
+        if (entry.is_regular_file(ec) && IsVideoFile(entry.path()))
+            found.push_back(entry.path().string());
+    }
+    std::sort(found.begin(), found.end());
+    files.insert(files.end(), found.begin(), found.end());
+}
+
+struct RunTotals
+{
+    double seconds = 0.0;
+    uint64_t frames = 0;
+    int failed = 0;
+    uint64_t typeMismatches = 0; // compare: header type != decoded type
+    uint64_t typesCompared = 0;
+};
+
+// Analyse all files with pool workers, a batch at a time; rows go to out/summary when set
+static RunTotals Run(const std::vector<std::string> &files, const BitstreamAnalyzer::Config &config, int jobs,
+                     std::ostream *out, std::ostream *summary)
+{
+    RunTotals totals;
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool pool(jobs);
+    size_t batch = (size_t)pool.Size() * kBatchPerWorker;
+
+    std::vector<BitstreamAnalyzer::Result> results;
+    for (size_t first = 0; first < files.size(); first += batch)
+    {
+        size_t count = std::min(batch, files.size() - first);
+        results.assign(count, BitstreamAnalyzer::Result());
+        for (size_t i = 0; i < count; i++)
+        {
+            pool.Submit([&results, &files, &config, first, i] {
+                results[i] = BitstreamAnalyzer::Analyze(files[first + i].c_str(), config);
+            });
+        }
+        pool.WaitIdle();
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const BitstreamAnalyzer::Result &r = results[i];
+            int fileId = (int)(first + i);
+            if (!r.ok)
+            {
+                std::cerr << files[first + i] << ": analysis failed" << std::endl;
+                totals.failed++;
+            }
+            totals.frames += r.frames.size();
+            for (const FrameStats &f : r.frames)
+            {
+                if (f.type == '?' || f.decodedType == '?')
+                    continue;
+                // SP/SI and BI come back as lower case
+                totals.typesCompared++;
+                if ((char)std::toupper(f.decodedType) != f.type)
+                    totals.typeMismatches++;
+            }
+            if (out)
+                BitstreamAnalyzer::WriteCsvRows(*out, fileId, r);
+            if (summary)
+                BitstreamAnalyzer::WriteSummaryRow(*summary, fileId, files[first + i], r);
+        }
+    }
+    totals.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return totals;
+}
+
+static void PrintTotals(FILE *report, const char *mode, size_t files, const RunTotals &totals)
+{
+    std::fprintf(report, "%-8s %zu files, %llu frames in %.2f s (%.0f frames/s)%s\n", mode, files,
+                 (unsigned long long)totals.frames, totals.seconds, totals.seconds > 0.0 ? totals.frames / totals.seconds : 0.0,
+                 totals.failed ? " - some files failed" : "");
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> files;
+    BitstreamAnalyzer::Config config;
+    std::string outPath = "stream_stats.csv";
+    std::string summaryPath;
+    int jobs = 0;
+    bool compare = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--mode" && i + 1 < argc)
+        {
+            std::string mode = argv[++i];
+            if (mode == "headers")
+                config.mode = BitstreamAnalyzer::Mode::Headers;
+            else if (mode == "full")
+                config.mode = BitstreamAnalyzer::Mode::Full;
+            else
+            {
+                std::cerr << "Invalid --mode, expected headers or full" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--out" && i + 1 < argc)
+            outPath = argv[++i];
+        else if (arg == "--summary" && i + 1 < argc)
+            summaryPath = argv[++i];
+        else if (arg == "--jobs" && i + 1 < argc)
+            jobs = std::atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc)
+            config.decodeThreads = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--compare")
+            compare = true;
+        else if (arg == "--help" || arg == "-h")
+        {
+            PrintUsage();
+            return 0;
+        }
+        else if (arg[0] != '-')
+            CollectInputs(arg, files);
+    }
+
+    if (files.empty())
+    {
+        PrintUsage();
+        return -1;
+    }
+
+    // Frame rows can run to millions of lines: a large stream buffer keeps writes cheap
+    std::vector<char> outBuffer(1 << 20);
+    std::ofstream outFile, summaryFile;
+    std::ostream *out = &std::cout;
+    if (outPath != "-")
+    {
+        outFile.rdbuf()->pubsetbuf(outBuffer.data(), (std::streamsize)outBuffer.size());
+        outFile.open(outPath, std::ios::trunc);
+        if (!outFile)
+        {
+            std::cerr << "Cannot write " << outPath << std::endl;
+            return -1;
+        }
+        out = &outFile;
+        if (summaryPath.empty())
+            summaryPath = (std::filesystem::path(outPath).replace_extension().string()) + "_files.csv";
+    }
+    std::ostream *summary = nullptr;
+    if (!summaryPath.empty())
+    {
+        summaryFile.open(summaryPath, std::ios::trunc);
+        if (!summaryFile)
+        {
+            std::cerr << "Cannot write " << summaryPath << std::endl;
+            return -1;
+        }
+        summary = &summaryFile;
+    }
+
+    BitstreamAnalyzer::WriteCsvHeader(*out);
+    if (summary)
+        BitstreamAnalyzer::WriteSummaryHeader(*summary);
+
+    // The report goes to stderr when the CSV is on stdout
+    FILE *report = out == &std::cout ? stderr : stdout;
+    if (!compare)
+    {
+        RunTotals totals = Run(files, config, jobs, out, summary);
+        PrintTotals(report, config.mode == BitstreamAnalyzer::Mode::Full ? "Full:" : "Headers:", files.size(), totals);
+        return totals.failed ? 1 : 0;
+    }
+
+    // Same files, same parallelism: only the per-file work differs
+    BitstreamAnalyzer::Config headersConfig = config;
+    headersConfig.mode = BitstreamAnalyzer::Mode::Headers;
+    BitstreamAnalyzer::Config fullConfig = config;
+    fullConfig.mode = BitstreamAnalyzer::Mode::Full;
+    RunTotals headers = Run(files, headersConfig, jobs, nullptr, nullptr);
+    RunTotals full = Run(files, fullConfig, jobs, out, summary);
+
+    out->flush();
+    PrintTotals(report, "Headers:", files.size(), headers);
+    PrintTotals(report, "Full:", files.size(), full);
+    double speedup = headers.seconds > 0.0 ? full.seconds / headers.seconds : 0.0;
+    std::fprintf(report, "Speedup: %.1fx (headers vs full decode)\n", speedup);
+    std::fprintf(report, "Types:   %llu of %llu decoded frames disagree with the slice headers\n",
+                 (unsigned long long)full.typeMismatches, (unsigned long long)full.typesCompared);
+
+    bool pass = headers.failed == 0 && full.failed == 0 && full.typeMismatches == 0 && speedup >= 10.0;
+    std::fprintf(report, "%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
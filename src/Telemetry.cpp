@@ -0,0 +1,330 @@
+#include "Telemetry.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<uint64_t> nextTelemetryId{1};
+
+// Per-thread cache of the ring registered with the last Telemetry instance used
+struct LocalRingCache
+{
+    uint64_t owner = 0;
+    void *ring = nullptr;
+};
+static thread_local LocalRingCache localRing;
+
+static size_t RoundUpPow2(size_t n)
+{
+    size_t p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+Telemetry::Telemetry() : Telemetry(Config())
+{
+}
+
+Telemetry::Telemetry(const Config &cfg) : config(cfg), id(nextTelemetryId.fetch_add(1)), baseNs(NowNs())
+{
+    config.ringCapacity = RoundUpPow2(config.ringCapacity < 64 ? 64 : config.ringCapacity);
+    trace.reserve(config.traceCapacity);
+}
+
+Telemetry::~Telemetry()
+{
+    Stop();
+}
+
+const char *Telemetry::StageName(int stage)
+{
+    static const char *const kNames[StageCount] = {"read_packet", "send_packet", "receive_frame", "render_frame", "present"};
+    return stage >= 0 && stage < StageCount ? kNames[stage] : "unknown";
+}
+
+Telemetry::ThreadRing *Telemetry::LocalRing()
+{
+    if (localRing.owner == id)
+        return (ThreadRing *)localRing.ring;
+
+    // The cache holds one instance: a thread switching between instances finds its ring again,
+    // only its first sample registers one (the only locking on the recording side)
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    ThreadRing *ring = nullptr;
+    for (auto &r : rings)
+    {
+        if (r->owner == std::this_thread::get_id())
+            ring = r.get();
+    }
+    if (!ring)
+    {
+        rings.push_back(std::make_unique<ThreadRing>(config.ringCapacity, (int)rings.size() + 1));
+        ring = rings.back().get();
+    }
+    localRing.owner = id;
+    localRing.ring = ring;
+    return ring;
+}
+
+void Telemetry::Record(Stage stage, int64_t startNs, int64_t endNs)
+{
+    ThreadRing *ring = LocalRing();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) > ring->mask)
+    {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring->samples[head & ring->mask] = {startNs, endNs - startNs, (int)stage};
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void Telemetry::SetThreadName(const char *name)
+{
+    ThreadRing *ring = LocalRing();
+    std::lock_guard<std::mutex> lock(collectMutex);
+    ring->name = name;
+}
+
+void Telemetry::Collect()
+{
+    std::vector<ThreadRing *> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (auto &ring : rings)
+            snapshot.push_back(ring.get());
+    }
+
+    std::lock_guard<std::mutex> lock(collectMutex);
+    for (ThreadRing *ring : snapshot)
+    {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; tail++)
+        {
+            const Sample &sample = ring->samples[tail & ring->mask];
+            histograms[sample.stage].Record(sample.durationNs);
+            if (trace.size() < config.traceCapacity)
+                trace.push_back({sample.startNs, sample.durationNs, sample.stage, ring->tid});
+            else if (config.traceCapacity)
+                traceDropped++;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+}
+
+Telemetry::Summary Telemetry::GetSummary(Stage stage)
+{
+    Collect();
+    std::lock_guard<std::mutex> lock(collectMutex);
+    const LatencyHistogram &h = histograms[stage];
+    Summary s;
+    s.count = h.Count();
+    s.meanUs = h.Mean() / 1000.0;
+    s.p50Us = h.Percentile(50.0) / 1000.0;
+    s.p90Us = h.Percentile(90.0) / 1000.0;
+    s.p99Us = h.Percentile(99.0) / 1000.0;
+    s.p999Us = h.Percentile(99.9) / 1000.0;
+    s.maxUs = h.Max() / 1000.0;
+    return s;
+}
+
+uint64_t Telemetry::GetDroppedSamples()
+{
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    uint64_t dropped = 0;
+    for (auto &ring : rings)
+        dropped += ring->dropped.load(std::memory_order_relaxed);
+    return dropped;
+}
+
+uint64_t Telemetry::GetSampleCount()
+{
+    Collect();
+    std::lock_guard<std::mutex> lock(collectMutex);
+    uint64_t count = 0;
+    for (const LatencyHistogram &h : histograms)
+        count += h.Count();
+    return count;
+}
+
+size_t Telemetry::GetThreadCount()
+{
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    return rings.size();
+}
+
+std::string Telemetry::ToJson()
+{
+    std::ostringstream json;
+    char number[64];
+    std::snprintf(number, sizeof(number), "%.3f", (NowNs() - baseNs) / 1e9);
+    json << "{\"time_s\":" << number << ",\"dropped\":" << GetDroppedSamples() << ",\"stages\":{";
+    for (int i = 0; i < StageCount; i++)
+    {
+        Summary s = GetSummary((Stage)i);
+        std::snprintf(number, sizeof(number), "%.3f", s.meanUs);
+        json << (i ? "," : "") << "\"" << StageName(i) << "\":{\"count\":" << s.count << ",\"mean_us\":" << number;
+        const double values[] = {s.p50Us, s.p90Us, s.p99Us, s.p999Us, s.maxUs};
+        const char *const keys[] = {"p50_us", "p90_us", "p99_us", "p999_us", "max_us"};
+        for (int k = 0; k < 5; k++)
+        {
+            std::snprintf(number, sizeof(number), "%.3f", values[k]);
+            json << ",\"" << keys[k] << "\":" << number;
+        }
+        json << "}";
+    }
+    json << "}}";
+    return json.str();
+}
+
+bool Telemetry::WriteChromeTrace(const char *path)
+{
+    Collect();
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+    {
+        std::cerr << "Could not write trace: " << path << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(collectMutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    {
+        std::lock_guard<std::mutex> ringsLock(ringsMutex);
+        for (auto &ring : rings)
+        {
+            std::string name = ring->name.empty() ? "thread " + std::to_string(ring->tid) : ring->name;
+            out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->tid
+                << ",\"args\":{\"name\":\"" << name << "\"}}";
+            first = false;
+        }
+    }
+    char times[64];
+    for (const TraceEvent &e : trace)
+    {
+        // Complete events, microseconds since the Telemetry was created
+        std::snprintf(times, sizeof(times), "%.3f,\"dur\":%.3f", (e.startNs - baseNs) / 1000.0, e.durationNs / 1000.0);
+        out << (first ? "" : ",") << "\n{\"name\":\"" << StageName(e.stage) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.tid
+            << ",\"ts\":" << times << "}";
+        first = false;
+    }
+    out << "\n]}\n";
+    if (traceDropped)
+        std::cerr << "Trace buffer full, " << traceDropped << " events not traced" << std::endl;
+    return (bool)out;
+}
+
+bool Telemetry::Start(const char *dumpTo, int dumpMs)
+{
+    if (collector.joinable())
+        return true;
+#ifdef _WIN32
+    if (dumpTo && std::strncmp(dumpTo, "unix:", 5) == 0)
+    {
+        std::cerr << "Unix socket telemetry dumps are not supported on Windows" << std::endl;
+        return false;
+    }
+#endif
+    dumpTarget = dumpTo ? dumpTo : "";
+    dumpIntervalMs = dumpMs > 0 ? dumpMs : 1000;
+    collectorStop = false;
+    collector = std::thread(&Telemetry::CollectorLoop, this);
+    return true;
+}
+
+void Telemetry::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(collectorMutex);
+        collectorStop = true;
+    }
+    collectorWake.notify_all();
+    if (collector.joinable())
+        collector.join();
+#ifndef _WIN32
+    if (dumpSocket >= 0)
+    {
+        close(dumpSocket);
+        dumpSocket = -1;
+    }
+#endif
+}
+
+void Telemetry::CollectorLoop()
+{
+    auto nextDump = std::chrono::steady_clock::now() + std::chrono::milliseconds(dumpIntervalMs);
+    std::unique_lock<std::mutex> lock(collectorMutex);
+    while (!collectorStop)
+    {
+        collectorWake.wait_for(lock, std::chrono::milliseconds(config.collectIntervalMs));
+        lock.unlock();
+        Collect();
+        if (!dumpTarget.empty() && std::chrono::steady_clock::now() >= nextDump)
+        {
+            WriteDump(ToJson());
+            nextDump += std::chrono::milliseconds(dumpIntervalMs);
+        }
+        lock.lock();
+    }
+    lock.unlock();
+    // Final summary so short runs still leave one
+    if (!dumpTarget.empty())
+        WriteDump(ToJson());
+}
+
+bool Telemetry::WriteDump(const std::string &json)
+{
+#ifndef _WIN32
+    if (dumpTarget.compare(0, 5, "unix:") == 0)
+    {
+        // One JSON object per line on a stream socket; reconnect after the reader went away
+        if (dumpSocket < 0)
+        {
+            sockaddr_un addr = {};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, dumpTarget.c_str() + 5, sizeof(addr.sun_path) - 1);
+            dumpSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (dumpSocket < 0 || connect(dumpSocket, (sockaddr *)&addr, sizeof(addr)) < 0)
+            {
+                if (dumpSocket >= 0)
+                    close(dumpSocket);
+                dumpSocket = -1;
+                return false;
+            }
+        }
+        std::string line = json + "\n";
+        if (send(dumpSocket, line.data(), line.size(), MSG_NOSIGNAL) != (ssize_t)line.size())
+        {
+            close(dumpSocket);
+            dumpSocket = -1;
+            return false;
+        }
+        return true;
+    }
+#endif
+
+    // Temporary file + rename: a reader polling the file never sees half a dump
+    std::string tempPath = dumpTarget + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::trunc);
+        if (!out)
+            return false;
+        out << json << "\n";
+        if (!out)
+            return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tempPath, dumpTarget, ec);
+    return !ec;
+}
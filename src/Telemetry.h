@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Log-linear latency histogram in the style of HdrHistogram: exact below 64 ns, then 32
+// sub-buckets per power of two (about 3% relative error), up to 2^40 ns.
+class LatencyHistogram
+{
+public:
+    static constexpr int kSubBits = 5;
+    static constexpr int kLinear = 2 << kSubBits; // values below this get their own bucket
+    static constexpr int kMaxShift = 40 - kSubBits;
+    static constexpr int kBuckets = kLinear + kMaxShift * (1 << kSubBits);
+
+private:
+    std::vector<uint64_t> counts = std::vector<uint64_t>(kBuckets);
+    uint64_t total = 0;
+    int64_t sum = 0;
+    int64_t minValue = 0;
+    int64_t maxValue = 0;
+
+    static int BucketIndex(int64_t value)
+    {
+        uint64_t v = value < 0 ? 0 : (uint64_t)value;
+        if (v < (uint64_t)kLinear)
+            return (int)v;
+        int msb = 63;
+        while (!(v >> msb))
+            msb--;
+        int shift = msb - kSubBits;
+        if (shift > kMaxShift)
+            return kBuckets - 1;
+        return kLinear + (shift - 1) * (1 << kSubBits) + (int)((v >> shift) - (1u << kSubBits));
+    }
+
+    // Midpoint of a bucket
+    static int64_t BucketValue(int index)
+    {
+        if (index < kLinear)
+            return index;
+        int shift = (index - kLinear) / (1 << kSubBits) + 1;
+        int64_t top = (index - kLinear) % (1 << kSubBits) + (1 << kSubBits);
+        return (top << shift) + (((int64_t)1 << shift) >> 1);
+    }
+
+public:
+    void Record(int64_t value)
+    {
+        counts[BucketIndex(value)]++;
+        minValue = total == 0 || value < minValue ? value : minValue;
+        maxValue = value > maxValue ? value : maxValue;
+        total++;
+        sum += value;
+    }
+
+    void Reset()
+    {
+        std::fill(counts.begin(), counts.end(), 0);
+        total = 0;
+        sum = 0;
+        minValue = maxValue = 0;
+    }
+
+    uint64_t Count() const { return total; }
+    int64_t Min() const { return minValue; }
+    int64_t Max() const { return maxValue; }
+    double Mean() const { return total ? (double)sum / total : 0.0; }
+
+    // p in [0, 100]; clamped to the recorded min/max
+    int64_t Percentile(double p) const
+    {
+        if (total == 0)
+            return 0;
+        uint64_t rank = (uint64_t)(p / 100.0 * (total - 1) + 0.5) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; i++)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+            {
+                int64_t value = BucketValue(i);
+                return value < minValue ? minValue : (value > maxValue ? maxValue : value);
+            }
+        }
+        return maxValue;
+    }
+};
+
+// Hot-path latency telemetry. Instrumented threads append (stage, start, duration) samples
+// to their own lock-free single-producer ring; recording never blocks and never allocates
+// after a thread's first sample. A collector thread (or any reader) drains the rings into
+// one LatencyHistogram per stage, keeps raw events for a Chrome trace when asked to, and
+// can dump JSON summaries periodically to a file or a Unix socket.
+class Telemetry
+{
+public:
+    enum Stage
+    {
+        ReadPacket,   // av_read_frame / elementary stream reader
+        SendPacket,   // avcodec_send_packet
+        ReceiveFrame, // avcodec_receive_frame
+        RenderFrame,  // renderer RenderFrame
+        Present,      // swap chain Present
+        StageCount
+    };
+
+    struct Config
+    {
+        size_t ringCapacity = 1 << 16; // samples per thread, rounded up to a power of two
+        size_t traceCapacity = 0;      // raw events kept for WriteChromeTrace, 0 = none
+        int collectIntervalMs = 50;
+    };
+
+    struct Summary
+    {
+        uint64_t count = 0;
+        double meanUs = 0.0;
+        double p50Us = 0.0;
+        double p90Us = 0.0;
+        double p99Us = 0.0;
+        double p999Us = 0.0;
+        double maxUs = 0.0;
+    };
+
+private:
+    struct Sample
+    {
+        int64_t startNs;
+        int64_t durationNs;
+        int stage;
+    };
+
+    // Single producer (the owning thread), single consumer (Collect, under collectMutex)
+    struct ThreadRing
+    {
+        std::vector<Sample> samples;
+        size_t mask;
+        std::atomic<uint64_t> head{0};
+        std::atomic<uint64_t> tail{0};
+        std::atomic<uint64_t> dropped{0};
+        int tid;
+        std::thread::id owner;
+        std::string name;
+
+        ThreadRing(size_t capacity, int id) : samples(capacity), mask(capacity - 1), tid(id), owner(std::this_thread::get_id()) {}
+    };
+
+    struct TraceEvent
+    {
+        int64_t startNs;
+        int64_t durationNs;
+        int stage;
+        int tid;
+    };
+
+    Config config;
+    uint64_t id; // tells instances apart in the per-thread ring cache
+    int64_t baseNs;
+
+    std::mutex ringsMutex; // thread registration
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+
+    std::mutex collectMutex; // histograms, trace, ring consumers
+    LatencyHistogram histograms[StageCount];
+    std::vector<TraceEvent> trace;
+    uint64_t traceDropped = 0;
+
+    std::thread collector;
+    std::mutex collectorMutex;
+    std::condition_variable collectorWake;
+    bool collectorStop = false;
+    std::string dumpTarget;
+    int dumpIntervalMs = 0;
+#ifndef _WIN32
+    int dumpSocket = -1;
+#endif
+
+public:
+    Telemetry();
+    explicit Telemetry(const Config &cfg);
+    Telemetry(const Telemetry &) = delete;
+    Telemetry &operator=(const Telemetry &) = delete;
+    ~Telemetry();
+
+    static const char *StageName(int stage);
+    static int64_t NowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Hot path: any thread, wait-free; the sample is dropped when the thread's ring is full
+    void Record(Stage stage, int64_t startNs, int64_t endNs);
+    // Label the calling thread in the Chrome trace
+    void SetThreadName(const char *name);
+
+    // Background collection every collectIntervalMs; with a dump target ("unix:/path" for a
+    // Unix stream socket, anything else is a file replaced atomically) a JSON summary is
+    // written every dumpMs
+    bool Start(const char *dumpTo = nullptr, int dumpMs = 1000);
+    void Stop();
+
+    // Drain every thread's ring into the histograms (also done by the collector)
+    void Collect();
+    Summary GetSummary(Stage stage);
+    uint64_t GetDroppedSamples();
+    uint64_t GetSampleCount();
+    // Threads that recorded a sample
+    size_t GetThreadCount();
+    std::string ToJson();
+    // Chrome trace event format (chrome://tracing, Perfetto); needs traceCapacity > 0
+    bool WriteChromeTrace(const char *path);
+
+private:
+    ThreadRing *LocalRing();
+    void CollectorLoop();
+    bool WriteDump(const std::string &json);
+};
+
+// Times one scope into a Telemetry stage; does nothing when telemetry is null
+class TelemetryScope
+{
+private:
+    Telemetry *telemetry;
+    Telemetry::Stage stage;
+    int64_t startNs;
+
+public:
+    TelemetryScope(Telemetry *t, Telemetry::Stage s) : telemetry(t), stage(s), startNs(t ? Telemetry::NowNs() : 0) {}
+    ~TelemetryScope()
+    {
+        if (telemetry)
+            telemetry->Record(stage, startNs, Telemetry::NowNs());
+    }
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads running tasks in FIFO order.
+// Tasks still queued when the pool is destroyed are run before the workers exit.
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskReady;
+    std::condition_variable idle;
+    size_t active = 0;
+    bool stopping = false;
+
+public:
+    // threads = 0 uses one worker per hardware thread
+    explicit ThreadPool(int threads = 0)
+    {
+        if (threads <= 0)
+            threads = (int)std::thread::hardware_concurrency();
+        if (threads <= 0)
+            threads = 1;
+
+        workers.reserve(threads);
+        for (int i = 0; i < threads; i++)
+            workers.emplace_back(&ThreadPool::Run, this);
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskReady.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    void Submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        taskReady.notify_one();
+    }
+
+    // Block until the queue is empty and no task is running
+    void WaitIdle()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return tasks.empty() && active == 0; });
+    }
+
+    int Size() const { return (int)workers.size(); }
+
+private:
+    void Run()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+                active++;
+            }
+
+            task();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                active--;
+                if (tasks.empty() && active == 0)
+                    idle.notify_all();
+            }
+        }
+    }
+};
@@ -0,0 +1,267 @@
+#include "ThumbnailExtractor.h"
+#include "DecoderCore.h"
+#include "SoftwareDecodeBackend.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+extern "C"
+{
+#include <libswscale/swscale.h>
+}
+
+// Downscales every delivered keyframe into a letterboxed thumbnail
+class ThumbnailSink : public IFrameSink
+{
+private:
+    const ThumbnailExtractor::Config &config;
+    std::vector<ThumbnailExtractor::Thumbnail> &thumbnails;
+    SwsContext *swsCtx = nullptr;
+    AVRational timeBase;
+    int64_t startTime;
+
+public:
+    int64_t startPts = AV_NOPTS_VALUE; // earlier frames belong to the previous range
+    int64_t endPts = AV_NOPTS_VALUE;   // stop at the first frame from here on
+    int limit = 0;                     // stop after this many thumbnails, 0 = no limit
+    int delivered = 0;
+
+    ThumbnailSink(const ThumbnailExtractor::Config &cfg, std::vector<ThumbnailExtractor::Thumbnail> &out, AVRational tb,
+                  int64_t start)
+        : config(cfg), thumbnails(out), timeBase(tb), startTime(start) {}
+
+    ~ThumbnailSink() override
+    {
+        if (swsCtx)
+            sws_freeContext(swsCtx);
+    }
+
+    bool OnFrame(AVFrame *frame) override
+    {
+        int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+        if (endPts != AV_NOPTS_VALUE && pts != AV_NOPTS_VALUE && pts >= endPts)
+            return false;
+        if (startPts != AV_NOPTS_VALUE && pts != AV_NOPTS_VALUE && pts < startPts)
+            return true;
+
+        // Fit the display aspect ratio into the cell
+        double displayWidth = frame->width;
+        if (frame->sample_aspect_ratio.num > 0 && frame->sample_aspect_ratio.den > 0)
+            displayWidth *= av_q2d(frame->sample_aspect_ratio);
+        double scale = std::min(config.width / displayWidth, (double)config.height / frame->height);
+        int fitWidth = std::max(1, std::min(config.width, (int)std::lround(displayWidth * scale)));
+        int fitHeight = std::max(1, std::min(config.height, (int)std::lround(frame->height * scale)));
+
+        swsCtx = sws_getCachedContext(swsCtx, frame->width, frame->height, (AVPixelFormat)frame->format, fitWidth,
+                                      fitHeight, AV_PIX_FMT_RGB24, SWS_AREA, nullptr, nullptr, nullptr);
+        if (!swsCtx)
+            return false;
+
+        ThumbnailExtractor::Thumbnail thumbnail;
+        thumbnail.pts = pts;
+        thumbnail.seconds = pts != AV_NOPTS_VALUE ? (pts - startTime) * av_q2d(timeBase) : 0.0;
+        thumbnail.rgb.assign((size_t)config.width * config.height * 3, 0);
+
+        // Scale straight into the centered area of the black cell
+        int stride = config.width * 3;
+        uint8_t *dst[4] = {thumbnail.rgb.data() + (size_t)((config.height - fitHeight) / 2) * stride +
+                               (size_t)((config.width - fitWidth) / 2) * 3,
+                           nullptr, nullptr, nullptr};
+        int dstStride[4] = {stride, 0, 0, 0};
+        sws_scale(swsCtx, frame->data, frame->linesize, 0, frame->height, dst, dstStride);
+
+        thumbnails.push_back(std::move(thumbnail));
+        delivered++;
+        return limit == 0 || delivered < limit;
+    }
+};
+
+static int64_t StreamStartTime(const AVStream *stream)
+{
+    return stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+}
+
+bool ThumbnailExtractor::BuildIndex(const char *filename, const Config &config, KeyframeIndex &index, double &durationSec)
+{
+    SoftwareDecodeBackend backend(1);
+    DecoderCore decoder;
+    decoder.SetIndexSidecar(config.indexSidecar);
+    if (!decoder.Open(filename, &backend) || !decoder.BuildKeyframeIndex())
+        return false;
+
+    index = decoder.GetKeyframeIndex();
+    const AVStream *stream = decoder.GetVideoStream();
+    durationSec = (index.GetEndPts() - StreamStartTime(stream)) * av_q2d(stream->time_base);
+    return true;
+}
+
+ThumbnailExtractor::Result ThumbnailExtractor::Extract(const char *filename, const Range &range, const Config &config,
+                                                       const KeyframeIndex *index)
+{
+    Result result;
+    auto begin = std::chrono::steady_clock::now();
+
+    SoftwareDecodeBackend backend(config.decodeThreads);
+    DecoderCore decoder;
+    decoder.SetSkipFrame(AVDISCARD_NONKEY);
+    decoder.SetIndexSidecar(config.indexSidecar);
+    if (!decoder.Open(filename, &backend))
+        return result;
+    if (index)
+        decoder.SetKeyframeIndex(*index);
+
+    const AVStream *stream = decoder.GetVideoStream();
+    double timeBase = av_q2d(stream->time_base);
+    int64_t startTime = StreamStartTime(stream);
+    int64_t startPts = startTime + (int64_t)std::llround(range.startSec / timeBase);
+    int64_t endPts = range.endSec >= 0.0 ? startTime + (int64_t)std::llround(range.endSec / timeBase) : AV_NOPTS_VALUE;
+
+    ThumbnailSink sink(config, result.thumbnails, stream->time_base, startTime);
+    bool ok = true;
+    if (config.intervalSec > 0.0)
+    {
+        // Sparse: seek to the keyframe at or before each interval and decode only that frame
+        ok = decoder.BuildKeyframeIndex();
+        const KeyframeIndex &keyframes = decoder.GetKeyframeIndex();
+        int64_t stop = endPts != AV_NOPTS_VALUE ? endPts : keyframes.GetEndPts();
+        int64_t step = std::max<int64_t>(1, (int64_t)std::llround(config.intervalSec / timeBase));
+        const KeyframeIndex::Entry *previous = nullptr;
+        for (int64_t t = startPts; ok && t < stop; t += step)
+        {
+            const KeyframeIndex::Entry *keyframe = keyframes.Find(t);
+            if (!keyframe || keyframe == previous)
+                continue;
+            previous = keyframe;
+            if (!decoder.Seek(keyframe->pts))
+            {
+                ok = false;
+                break;
+            }
+
+            sink.delivered = 0;
+            sink.limit = 1;
+            while (sink.delivered == 0 && decoder.ReadPacket())
+            {
+                bool key = decoder.GetPacket()->flags & AV_PKT_FLAG_KEY;
+                decoder.DecodePacket(&sink);
+                if (key)
+                {
+                    // Nothing else of this GOP is needed: flush the frame held for reordering
+                    if (sink.delivered == 0)
+                        decoder.Drain(&sink);
+                    break;
+                }
+            }
+        }
+    }
+    else
+    {
+        // Dense: every keyframe of the range
+        sink.startPts = range.startSec > 0.0 ? startPts : AV_NOPTS_VALUE;
+        sink.endPts = endPts;
+        if (range.startSec > 0.0)
+            ok = decoder.Seek(startPts);
+        while (ok && decoder.DecodeOneFrame(&sink))
+        {
+        }
+    }
+
+    const KeyframeIndex &keyframes = decoder.GetKeyframeIndex();
+    if (keyframes.IsComplete())
+        result.durationSec = (keyframes.GetEndPts() - startTime) * timeBase;
+    else if (decoder.GetFormatContext()->duration > 0)
+        result.durationSec = decoder.GetFormatContext()->duration / (double)AV_TIME_BASE;
+    result.packetsRead = decoder.GetPacketsRead();
+    result.framesDecoded = decoder.GetFramesDecoded();
+    result.ok = ok;
+    result.elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+std::vector<uint8_t> ThumbnailExtractor::ComposeSheet(const std::vector<const Thumbnail *> &thumbnails, const Config &config,
+                                                      int columns, int &sheetWidth, int &sheetHeight)
+{
+    int count = (int)thumbnails.size();
+    columns = std::max(1, std::min(columns, count));
+    int rows = count ? (count + columns - 1) / columns : 0;
+    sheetWidth = columns * config.width;
+    sheetHeight = rows * config.height;
+
+    std::vector<uint8_t> sheet((size_t)sheetWidth * sheetHeight * 3, 0);
+    size_t rowBytes = (size_t)config.width * 3;
+    for (int i = 0; i < count; i++)
+    {
+        uint8_t *cell = sheet.data() + ((size_t)(i / columns) * config.height * sheetWidth + (size_t)(i % columns) * config.width) * 3;
+        for (int y = 0; y < config.height; y++)
+            std::memcpy(cell + (size_t)y * sheetWidth * 3, thumbnails[i]->rgb.data() + y * rowBytes, rowBytes);
+    }
+    return sheet;
+}
+
+static bool WritePpm(const std::string &path, const uint8_t *rgb, int width, int height)
+{
+    FILE *file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+    size_t bytes = (size_t)width * height * 3;
+    bool ok = std::fwrite(rgb, 1, bytes, file) == bytes;
+    return std::fclose(file) == 0 && ok;
+}
+
+static bool WritePng(const std::string &path, const uint8_t *rgb, int width, int height)
+{
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_PNG);
+    if (!codec)
+    {
+        std::cerr << "PNG encoder not available, use .ppm output" << std::endl;
+        return false;
+    }
+
+    AVCodecContext *ctx = avcodec_alloc_context3(codec);
+    AVFrame *frame = av_frame_alloc();
+    AVPacket *packet = av_packet_alloc();
+    bool ok = false;
+    if (ctx && frame && packet)
+    {
+        ctx->width = width;
+        ctx->height = height;
+        ctx->pix_fmt = AV_PIX_FMT_RGB24;
+        ctx->time_base = av_make_q(1, 1);
+        if (avcodec_open2(ctx, codec, nullptr) >= 0)
+        {
+            // The encoder only reads the frame: point it at the caller's pixels
+            frame->format = AV_PIX_FMT_RGB24;
+            frame->width = width;
+            frame->height = height;
+            frame->data[0] = (uint8_t *)rgb;
+            frame->linesize[0] = width * 3;
+            if (avcodec_send_frame(ctx, frame) >= 0 && avcodec_send_frame(ctx, nullptr) >= 0 &&
+                avcodec_receive_packet(ctx, packet) >= 0)
+            {
+                FILE *file = std::fopen(path.c_str(), "wb");
+                if (file)
+                {
+                    ok = std::fwrite(packet->data, 1, packet->size, file) == (size_t)packet->size;
+                    ok = std::fclose(file) == 0 && ok;
+                }
+            }
+        }
+    }
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    avcodec_free_context(&ctx);
+    return ok;
+}
+
+bool ThumbnailExtractor::WriteImage(const std::string &path, const uint8_t *rgb, int width, int height)
+{
+    bool ppm = path.size() >= 4 && path.compare(path.size() - 4, 4, ".ppm") == 0;
+    bool ok = ppm ? WritePpm(path, rgb, width, height) : WritePng(path, rgb, width, height);
+    if (!ok)
+        std::cerr << "Could not write " << path << std::endl;
+    return ok;
+}
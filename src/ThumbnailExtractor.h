@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "KeyframeIndex.h"
+
+// Keyframe-only thumbnail extraction. The decoder runs with skip_frame = AVDISCARD_NONKEY
+// and non-key packets never reach it, so the cost follows the keyframe rate instead of the
+// frame rate. Each keyframe is downscaled (aspect preserved, letterboxed) to a fixed size.
+//
+// Extract works on one time range of one file and is safe to run concurrently; splitting
+// a file into ranges needs its KeyframeIndex, built once with BuildIndex and shared.
+class ThumbnailExtractor
+{
+public:
+    struct Config
+    {
+        int width = 192;
+        int height = 108;
+        double intervalSec = 0.0; // > 0: only the keyframe at or before every interval, seeking between them
+        int decodeThreads = 1;    // per range; parallelism normally comes from running ranges concurrently
+        bool indexSidecar = false;
+    };
+
+    struct Range
+    {
+        double startSec = 0.0;
+        double endSec = -1.0; // < 0: to the end
+    };
+
+    struct Thumbnail
+    {
+        int64_t pts = 0;
+        double seconds = 0.0;
+        std::vector<uint8_t> rgb; // width * height * 3
+    };
+
+    struct Result
+    {
+        bool ok = false;
+        std::vector<Thumbnail> thumbnails;
+        uint64_t packetsRead = 0;
+        uint64_t framesDecoded = 0;
+        double durationSec = 0.0; // of the whole file, when known
+        double elapsedSec = 0.0;
+    };
+
+    // Complete keyframe index of a file (demux-only pass, or the sidecar) and its duration
+    static bool BuildIndex(const char *filename, const Config &config, KeyframeIndex &index, double &durationSec);
+
+    // Thumbnails of the keyframes in [range.startSec, range.endSec); index may be null
+    static Result Extract(const char *filename, const Range &range, const Config &config, const KeyframeIndex *index);
+
+    // Grid of thumbnails, columns wide, on a black background (RGB24)
+    static std::vector<uint8_t> ComposeSheet(const std::vector<const Thumbnail *> &thumbnails, const Config &config,
+                                             int columns, int &sheetWidth, int &sheetHeight);
+
+    // RGB24 image: binary PPM for ".ppm", PNG (libavcodec encoder) otherwise
+    static bool WriteImage(const std::string &path, const uint8_t *rgb, int width, int height);
+};
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "ThumbnailExtractor.h"
+
+// One input file: its index (when it is split or sampled sparsely) and per-range results
+struct FileWork
+{
+    std::string path;
+    KeyframeIndex index;
+    bool indexed = false;
+    double durationSec = 0.0;
+    std::vector<ThumbnailExtractor::Result> results;
+};
+
+static void PrintUsage()
+{
+    std::cout << "Usage: H264_Thumbnails <video_file>... [--size WxH] [--interval S] [--ranges N] [--jobs J]\n"
+              << "                       [--out DIR] [--sequence] [--columns C] [--ppm] [--index-sidecar]\n"
+              << "  --size WxH:   thumbnail size, aspect preserved with black bars (default 192x108)\n"
+              << "  --interval S: one thumbnail per S seconds (the keyframe at or before it), seeking\n"
+              << "                between them; default: every keyframe\n"
+              << "  --ranges N:   split each file into N time ranges decoded concurrently (default 1)\n"
+              << "  --jobs J:     worker threads (0 = one per core, default)\n"
+              << "  --out DIR:    output directory (default .)\n"
+              << "  --sequence:   write <name>_NNNNN.png per thumbnail instead of a <name>_sheet.png contact sheet\n"
+              << "  --columns C:  contact sheet columns (default 8)\n"
+              << "  --ppm:        write binary PPM instead of PNG\n"
+              << "  --index-sidecar: load/store keyframe indexes in <file>.kfidx" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> files;
+    ThumbnailExtractor::Config config;
+    int ranges = 1;
+    int jobs = 0;
+    int columns = 8;
+    bool sequence = false;
+    std::string extension = ".png";
+    std::string outDir = ".";
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc)
+        {
+            if (std::sscanf(argv[++i], "%dx%d", &config.width, &config.height) != 2 || config.width < 1 || config.height < 1)
+            {
+                std::cerr << "Invalid --size, expected WxH" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--interval" && i + 1 < argc)
+            config.intervalSec = std::atof(argv[++i]);
+        else if (arg == "--ranges" && i + 1 < argc)
+            ranges = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--jobs" && i + 1 < argc)
+            jobs = std::atoi(argv[++i]);
+        else if (arg == "--out" && i + 1 < argc)
+            outDir = argv[++i];
+        else if (arg == "--sequence")
+            sequence = true;
+        else if (arg == "--columns" && i + 1 < argc)
+            columns = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--ppm")
+            extension = ".ppm";
+        else if (arg == "--index-sidecar")
+            config.indexSidecar = true;
+        else if (arg == "--help" || arg == "-h")
+        {
+            PrintUsage();
+            return 0;
+        }
+        else if (arg[0] != '-')
+            files.push_back(arg);
+    }
+
+    if (files.empty())
+    {
+        PrintUsage();
+        return -1;
+    }
+
+    std::vector<FileWork> work(files.size());
+    for (size_t f = 0; f < files.size(); f++)
+    {
+        work[f].path = files[f];
+        work[f].results.resize(ranges);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(jobs);
+
+        // Ranges and sparse sampling seek, so every file is indexed once up front
+        if (ranges > 1 || config.intervalSec > 0.0)
+        {
+            for (FileWork &file : work)
+            {
+                pool.Submit([&file, &config] {
+                    file.indexed = ThumbnailExtractor::BuildIndex(file.path.c_str(), config, file.index, file.durationSec);
+                    if (!file.indexed)
+                        std::cerr << "Could not index " << file.path << std::endl;
+                });
+            }
+            pool.WaitIdle();
+        }
+
+        for (FileWork &file : work)
+        {
+            if ((ranges > 1 || config.intervalSec > 0.0) && !file.indexed)
+                continue;
+            int fileRanges = file.indexed && file.durationSec > 0.0 ? ranges : 1;
+            for (int r = 0; r < fileRanges; r++)
+            {
+                ThumbnailExtractor::Range range;
+                if (fileRanges > 1)
+                {
+                    range.startSec = file.durationSec * r / fileRanges;
+                    range.endSec = r + 1 < fileRanges ? file.durationSec * (r + 1) / fileRanges : -1.0;
+                }
+                pool.Submit([&file, &config, range, r] {
+                    file.results[r] = ThumbnailExtractor::Extract(file.path.c_str(), range, config,
+                                                                  file.indexed ? &file.index : nullptr);
+                });
+            }
+        }
+        pool.WaitIdle();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::error_code ec;
+    std::filesystem::create_directories(outDir, ec);
+
+    int result = 0;
+    double videoSeconds = 0.0;
+    uint64_t totalThumbnails = 0;
+    for (FileWork &file : work)
+    {
+        // Ranges are in time order; sparse sampling of neighbouring ranges can pick the same keyframe
+        std::vector<const ThumbnailExtractor::Thumbnail *> thumbnails;
+        uint64_t packets = 0;
+        bool ok = !file.results.empty();
+        double duration = file.durationSec;
+        for (const ThumbnailExtractor::Result &r : file.results)
+        {
+            ok = ok && r.ok;
+            packets += r.packetsRead;
+            duration = duration > 0.0 ? duration : r.durationSec;
+            for (const ThumbnailExtractor::Thumbnail &t : r.thumbnails)
+            {
+                if (thumbnails.empty() || thumbnails.back()->pts != t.pts)
+                    thumbnails.push_back(&t);
+            }
+        }
+
+        std::string stem = (std::filesystem::path(outDir) / std::filesystem::path(file.path).stem()).string();
+        if (!ok || thumbnails.empty())
+        {
+            std::printf("%s: failed (%zu thumbnails)\n", file.path.c_str(), thumbnails.size());
+            result = 1;
+            continue;
+        }
+
+        if (sequence)
+        {
+            char suffix[32];
+            for (size_t i = 0; i < thumbnails.size(); i++)
+            {
+                std::snprintf(suffix, sizeof(suffix), "_%05zu", i);
+                if (!ThumbnailExtractor::WriteImage(stem + suffix + extension, thumbnails[i]->rgb.data(), config.width, config.height))
+                    result = 1;
+            }
+        }
+        else
+        {
+            int sheetWidth, sheetHeight;
+            std::vector<uint8_t> sheet = ThumbnailExtractor::ComposeSheet(thumbnails, config, columns, sheetWidth, sheetHeight);
+            if (!ThumbnailExtractor::WriteImage(stem + "_sheet" + extension, sheet.data(), sheetWidth, sheetHeight))
+                result = 1;
+        }
+
+        std::printf("%s: %zu thumbnails, %.1f s of video, %llu packets read\n", file.path.c_str(), thumbnails.size(),
+                    duration, (unsigned long long)packets);
+        videoSeconds += duration;
+        totalThumbnails += thumbnails.size();
+    }
+
+    std::printf("Total:   %llu thumbnails from %.1f min of video in %.2f s (%.0fx real time, %.1f s per hour of video)\n",
+                (unsigned long long)totalThumbnails, videoSeconds / 60.0, seconds, seconds > 0.0 ? videoSeconds / seconds : 0.0,
+                videoSeconds > 0.0 ? seconds * 3600.0 / videoSeconds : 0.0);
+    return result;
+}
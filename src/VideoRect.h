@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// Placement of a picture inside an output surface, shared by the CPU scaler and the
+// D3D11 renderers. No FFmpeg dependency.
+struct VideoRect
+{
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+
+    bool operator==(const VideoRect &o) const { return x == o.x && y == o.y && width == o.width && height == o.height; }
+    bool operator!=(const VideoRect &o) const { return !(*this == o); }
+};
+
+// Largest rectangle with the picture's display aspect ratio centred in a dstWidth x
+// dstHeight output (letterbox or pillarbox bars around it). sarNum/sarDen is the sample
+// aspect ratio, 0 or negative for square pixels.
+inline VideoRect FitVideoRect(int width, int height, int sarNum, int sarDen, int dstWidth, int dstHeight)
+{
+    VideoRect rect;
+    if (width <= 0 || height <= 0 || dstWidth <= 0 || dstHeight <= 0)
+        return rect;
+
+    double displayWidth = width;
+    if (sarNum > 0 && sarDen > 0)
+        displayWidth = displayWidth * sarNum / sarDen;
+    double scale = std::min(dstWidth / displayWidth, (double)dstHeight / height);
+    rect.width = std::clamp((int)std::lround(displayWidth * scale), 1, dstWidth);
+    rect.height = std::clamp((int)std::lround(height * scale), 1, dstHeight);
+    rect.x = (dstWidth - rect.width) / 2;
+    rect.y = (dstHeight - rect.height) / 2;
+    return rect;
+}
@@ -1,6 +1,8 @@
 #include <Windows.h>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <cstdlib>
 #include <SDL3/SDL.h>
 #include <imgui.h>
 #include <imgui_impl_sdl3.h>
@@ -11,8 +13,22 @@
 int main(int argc, char* argv[])
 {
     // Parse command line
-    std::string videoFile = "test.h264";
+    std::vector<std::string> videoFiles; // played in order; default test.h264
     D3D11RendererFactory::Mode renderMode = D3D11RendererFactory::Mode::Shader;
+    int queueDepth = 8;
+    double playbackRate = 1.0;
+    bool live = false;
+    const char *inputFormat = nullptr;
+    bool paramCache = false;
+    bool indexSidecar = false;
+    const char *telemetryDump = nullptr;
+    int telemetryIntervalMs = 1000;
+    const char *tracePath = nullptr;
+    bool loadGovernor = true;
+    ReadAheadIO::Config readAheadConfig;
+    bool readAhead = false;
+    bool loop = false;
+    double frameCacheMb = 0.0;
 
     for (int i = 1; i < argc; i++)
     {
@@ -21,11 +37,72 @@ int main(int argc, char* argv[])
         {
             renderMode = D3D11RendererFactory::Mode::VideoProcessor;
         }
+        else if (arg == "--queue" && i + 1 < argc)
+        {
+            queueDepth = std::atoi(argv[++i]);
+            if (queueDepth < 1)
+                queueDepth = 1;
+        }
+        else if (arg == "--rate" && i + 1 < argc)
+        {
+            playbackRate = std::atof(argv[++i]);
+        }
+        else if (arg == "--live")
+        {
+            live = true;
+        }
+        else if (arg == "--format" && i + 1 < argc)
+        {
+            inputFormat = argv[++i];
+        }
+        else if (arg == "--param-cache")
+        {
+            paramCache = true;
+        }
+        else if (arg == "--index-sidecar")
+        {
+            indexSidecar = true;
+        }
+        else if (arg == "--telemetry-dump" && i + 1 < argc)
+        {
+            telemetryDump = argv[++i];
+        }
+        else if (arg == "--telemetry-interval" && i + 1 < argc)
+        {
+            telemetryIntervalMs = std::atoi(argv[++i]);
+        }
+        else if (arg == "--trace" && i + 1 < argc)
+        {
+            tracePath = argv[++i];
+        }
+        else if (arg == "--no-governor")
+        {
+            loadGovernor = false;
+        }
+        else if (arg == "--read-ahead" && i + 1 < argc)
+        {
+            readAheadConfig.prefetchBytes = (size_t)(std::atof(argv[++i]) * 1024 * 1024);
+            readAhead = true;
+        }
+        else if (arg == "--loop")
+        {
+            loop = true;
+        }
+        else if (arg == "--frame-cache" && i + 1 < argc)
+        {
+            frameCacheMb = std::atof(argv[++i]);
+        }
+        else if (arg == "-")
+        {
+            videoFiles.push_back(arg); // stdin
+        }
         else if (arg[0] != '-')
         {
-            videoFile = arg;
+            videoFiles.push_back(arg);
         }
     }
+    if (videoFiles.empty())
+        videoFiles.push_back("test.h264");
 
     // Initialize SDL3 (window + events)
     if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS))
@@ -59,6 +136,10 @@ int main(int argc, char* argv[])
         return -1;
     }
 
+    // The swap chain matches the client area in pixels, which differs from the window size
+    // on high-DPI displays
+    SDL_GetWindowSizeInPixels(window, &windowWidth, &windowHeight);
+
     // Create renderer
     ID3D11RendererBase *renderer = D3D11RendererFactory::Create(renderMode);
     if (!renderer || !renderer->Initialize(hwnd, windowWidth, windowHeight))
@@ -68,9 +149,26 @@ int main(int argc, char* argv[])
         return -1;
     }
 
+    // Hot-path latency histograms for the overlay; raw events only when a trace is written
+    Telemetry::Config telemetryConfig;
+    if (tracePath)
+        telemetryConfig.traceCapacity = 1 << 20;
+    Telemetry telemetry(telemetryConfig);
+    telemetry.SetThreadName("present");
+    if (!telemetry.Start(telemetryDump, telemetryIntervalMs))
+    {
+        delete renderer;
+        return -1;
+    }
+
     // Create decoder
     FFmpegD3D11Decoder decoder;
-    if (!decoder.Initialize(videoFile.c_str(), renderer))
+    decoder.SetTelemetry(&telemetry);
+    decoder.SetLoadGovernor(loadGovernor);
+    decoder.SetReadAhead(readAhead ? &readAheadConfig : nullptr, 256);
+    decoder.SetLoop(loop);
+    decoder.SetFrameCache((size_t)(frameCacheMb * 1024 * 1024));
+    if (!decoder.Initialize(videoFiles, renderer, queueDepth, playbackRate, live, inputFormat, paramCache, indexSidecar))
     {
         std::cerr << "Failed to initialize decoder" << std::endl;
         delete renderer;
@@ -92,12 +190,38 @@ int main(int argc, char* argv[])
 
     // Print usage
     std::cout << "\n=== FFmpeg D3D11VA Zero-Copy Decoder ===" << std::endl;
-    std::cout << "Usage: H264_HW_Decoder.exe [video_file] [--vp]" << std::endl;
+    std::cout << "Usage: H264_HW_Decoder.exe [video_file...] [--vp] [--queue N] [--rate R] [--live] [--format NAME] [--param-cache] [--index-sidecar]" << std::endl;
+    std::cout << "       [--telemetry-dump FILE|unix:PATH] [--telemetry-interval MS] [--trace FILE] [--no-governor] [--read-ahead MB]" << std::endl;
+    std::cout << "       [--loop] [--frame-cache MB]" << std::endl;
     std::cout << "  --vp: Use Video Processor (hardware YUV->RGB)" << std::endl;
+    std::cout << "  --queue N: Frames decoded ahead of display (default 8)" << std::endl;
+    std::cout << "  --rate R: Playback speed 0.5 - 4.0 (default 1.0)" << std::endl;
+    std::cout << "  --live: Low-latency input, show frames as soon as they decode" << std::endl;
+    std::cout << "          (automatic for tcp:// udp:// pipe: and - for stdin)" << std::endl;
+    std::cout << "  --format NAME: Input format for live sources (default h264, e.g. mpegts)" << std::endl;
+    std::cout << "  --param-cache: Cache stream parameters in <file>.params to skip probing next time" << std::endl;
+    std::cout << "  --index-sidecar: Keep the keyframe index for seeking in <file>.kfidx" << std::endl;
+    std::cout << "  --telemetry-dump T: Write stage latency JSON every --telemetry-interval ms (default 1000)" << std::endl;
+    std::cout << "                      to a file or a Unix socket" << std::endl;
+    std::cout << "  --trace FILE: Write a Chrome trace (chrome://tracing) of decode/render calls on exit" << std::endl;
+    std::cout << "  --no-governor: Never skip decode work when playback falls behind (default: degrade" << std::endl;
+    std::cout << "                 to skip deblocking, then non-reference frames, then keyframes only)" << std::endl;
+    std::cout << "  --read-ahead MB: Keep MB of the file loaded ahead on an I/O thread and demux on its own" << std::endl;
+    std::cout << "                   thread, so slow storage (network shares) does not stall playback" << std::endl;
+    std::cout << "  --loop: Start over at the end; one file rewinds its decoder, several files repeat as a playlist" << std::endl;
+    std::cout << "          (each file is opened and decoding ahead before the previous one ends)" << std::endl;
+    std::cout << "  --frame-cache MB: With --loop on one file: if a pass fits in MB of video memory, decode it" << std::endl;
+    std::cout << "                    once and replay the decoded frames" << std::endl;
     std::cout << "  default: Use Shader conversion" << std::endl;
     std::cout << "\nControls:" << std::endl;
     std::cout << "  ESC: Exit" << std::endl;
-    std::cout << "\nPlaying: " << videoFile << std::endl;
+    std::cout << "  Space: Pause / Resume" << std::endl;
+    std::cout << "  [ / ]: Slower / Faster" << std::endl;
+    std::cout << "  Left / Right: Seek -5 s / +5 s" << std::endl;
+    std::cout << "\nPlaying: " << videoFiles[0];
+    if (videoFiles.size() > 1)
+        std::cout << " (+" << videoFiles.size() - 1 << " more)";
+    std::cout << std::endl;
     std::cout << "========================================\n"
               << std::endl;
 
@@ -115,25 +239,28 @@ int main(int argc, char* argv[])
 
             if (ev.type == SDL_EVENT_QUIT)
                 running = false;
+            else if (ev.type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED)
+                renderer->Resize(ev.window.data1, ev.window.data2);
             else if (ev.type == SDL_EVENT_KEY_DOWN)
             {
                 if (ev.key.key == SDLK_ESCAPE)
                     running = false;
                 else if (ev.key.key == SDLK_SPACE)
                     paused = !paused;
+                else if (ev.key.key == SDLK_LEFTBRACKET)
+                    decoder.SetPlaybackRate(decoder.GetPlaybackRate() * 0.5);
+                else if (ev.key.key == SDLK_RIGHTBRACKET)
+                    decoder.SetPlaybackRate(decoder.GetPlaybackRate() * 2.0);
+                else if (ev.key.key == SDLK_LEFT)
+                    decoder.SeekTo(decoder.GetPosition() - 5.0);
+                else if (ev.key.key == SDLK_RIGHT)
+                    decoder.SeekTo(decoder.GetPosition() + 5.0);
             }
         }
 
-        // Decode and render video frame
-        if (!paused)
-        {
-            if (!decoder.DecodeOneFrame())
-                running = false; // EOF or error
-        }
-        else
-        {
-            SDL_Delay(10); // avoid busy loop when paused
-        }
+        // Render the frame due for display; decoding runs on its own thread
+        if (!decoder.RenderDueFrame(paused))
+            running = false; // EOF of the last file (never with --loop) or error
 
         // Start ImGui frame
         ImGui_ImplDX11_NewFrame();
@@ -144,20 +271,80 @@ int main(int argc, char* argv[])
         if (showUI)
         {
             ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
-            ImGui::SetNextWindowSize(ImVec2(300, 150), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2(340, 470), ImGuiCond_FirstUseEver);
             ImGui::Begin("Video Player Control", &showUI);
             
             ImGui::Text("FFmpeg D3D11VA Decoder");
             ImGui::Separator();
-            ImGui::Text("File: %s", videoFile.c_str());
+            ImGui::Text("File: %s", decoder.GetCurrentFile().c_str());
+            if (decoder.GetPlaylistSize() > 1)
+                ImGui::Text("Playlist: %zu / %zu  (switches %llu)", decoder.GetPlaylistIndex() + 1, decoder.GetPlaylistSize(),
+                            (unsigned long long)decoder.GetItemSwitches());
+            if (decoder.GetLoops() > 0)
+                ImGui::Text("Loops: %llu%s  (cache %.1f MB)", (unsigned long long)decoder.GetLoops(),
+                            decoder.IsReplayingCache() ? ", replaying from cache" : "", decoder.GetFrameCacheBytes() / 1048576.0);
             ImGui::Text("Mode: %s", renderMode == D3D11RendererFactory::Mode::VideoProcessor ? "Video Processor" : "Shader");
+            if (decoder.GetFormatChanges() > 0)
+            {
+                ID3D11RendererBase::ReconfigStats reconfig = decoder.GetRendererReconfigStats();
+                ImGui::Text("Format changes: %llu  (renderer rebuild last %.2f ms, max %.2f ms)",
+                            (unsigned long long)decoder.GetFormatChanges(), reconfig.lastMs, reconfig.maxMs);
+            }
             ImGui::Separator();
             
             if (ImGui::Button(paused ? "Resume (Space)" : "Pause (Space)"))
                 paused = !paused;
             
+            float rate = (float)decoder.GetPlaybackRate();
+            if (ImGui::SliderFloat("Speed", &rate, (float)PresentationClock::kMinRate, (float)PresentationClock::kMaxRate, "%.2fx"))
+                decoder.SetPlaybackRate(rate);
+
             ImGui::Text("Press ESC to exit");
             ImGui::Text("Application average %.1f FPS", io.Framerate);
+
+            FrameQueue::Stats queueStats = decoder.GetQueueStats();
+            ImGui::Separator();
+            ImGui::Text("Queue: %zu / %zu frames", queueStats.occupancy, queueStats.capacity);
+            ImGui::Text("Underruns: %llu  Overruns: %llu",
+                        (unsigned long long)queueStats.underruns, (unsigned long long)queueStats.overruns);
+
+            PresentationClock::Stats clockStats = decoder.GetClockStats();
+            ImGui::Text("Presented: %llu  Dropped: %llu",
+                        (unsigned long long)clockStats.presented, (unsigned long long)clockStats.dropped);
+            ImGui::Text("Jitter: avg %.2f ms  max %.2f ms", clockStats.meanJitterMs, clockStats.maxJitterMs);
+            if (decoder.IsLoadGovernorEnabled())
+            {
+                LoadGovernor::Stats governorStats = decoder.GetGovernorStats();
+                ImGui::Text("Decode: %s  (busy %.0f%%, steps up %llu / down %llu)",
+                            LoadGovernor::LevelName(governorStats.level), governorStats.busy * 100.0,
+                            (unsigned long long)governorStats.escalations, (unsigned long long)governorStats.deescalations);
+            }
+            if (clockStats.presented > 0)
+            {
+                const DecoderCore::StartupTimes &startup = decoder.GetStartupTimes();
+                ImGui::Text("First frame: %.1f ms%s", startup.firstFrameMs, startup.paramCacheHit ? " (cached params)" : "");
+            }
+
+            ImGui::Separator();
+            ImGui::Text("Latency us      p50      p99     max");
+            for (int stage = 0; stage < Telemetry::StageCount; stage++)
+            {
+                Telemetry::Summary summary = telemetry.GetSummary((Telemetry::Stage)stage);
+                ImGui::Text("%-13s %8.1f %8.1f %8.1f", Telemetry::StageName(stage), summary.p50Us, summary.p99Us, summary.maxUs);
+            }
+
+            if (!decoder.IsLive())
+            {
+                ImGui::Text("Position: %.2f s  (Left/Right seek)", decoder.GetPosition());
+                if (decoder.GetLastSeekMs() >= 0.0)
+                    ImGui::Text("Last seek: %.1f ms", decoder.GetLastSeekMs());
+            }
+
+            if (decoder.IsLive())
+            {
+                DecodeThread::LatencyStats latency = decoder.GetLatencyStats();
+                ImGui::Text("Arrival->decoded: %.2f ms (avg %.2f, max %.2f)", latency.lastMs, latency.avgMs, latency.maxMs);
+            }
             
             ImGui::End();
         }
@@ -167,9 +354,16 @@ int main(int argc, char* argv[])
         ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
 
         // Present the frame (video + ImGui overlay)
-        renderer->Present();
+        {
+            TelemetryScope scope(&telemetry, Telemetry::Present);
+            renderer->Present();
+        }
     }
 
+    telemetry.Stop();
+    if (tracePath)
+        telemetry.WriteChromeTrace(tracePath);
+
     // Cleanup ImGui
     ImGui_ImplDX11_Shutdown();
     ImGui_ImplSDL3_Shutdown();
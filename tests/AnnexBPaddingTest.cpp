@@ -0,0 +1,128 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "AnnexBReader.h"
+#include "FrameChecksum.h"
+
+// Zero-copy Annex-B packets: AnnexBReader hands out packets whose padding is the next access
+// unit instead of zeros. Each clip is decoded once with those packets as they are and once
+// with every packet copied into a buffer with zeroed padding, with one thread and with frame
+// threads; the frames must be identical, and some packets must really have had non-zero
+// bytes in their padding, or the clip does not exercise the case.
+//   H264_Test_AnnexBPadding <clip.h264> [<clip.h264> ...]
+
+struct PaddingRun
+{
+    std::vector<std::string> md5s;
+    uint64_t zeroCopyPackets = 0;
+    uint64_t dirtyPadding = 0; // zero-copy packets followed by non-zero bytes
+};
+
+static bool HasDirtyPadding(const AVPacket *packet)
+{
+    for (int i = 0; i < AV_INPUT_BUFFER_PADDING_SIZE; i++)
+    {
+        if (packet->data[packet->size + i])
+            return true;
+    }
+    return false;
+}
+
+static bool ReceiveFrames(AVCodecContext *ctx, AVFrame *frame, PaddingRun &run)
+{
+    int ret;
+    while ((ret = avcodec_receive_frame(ctx, frame)) >= 0)
+    {
+        FrameDigest digest;
+        if (!FrameChecksumSink::Compute(frame, (int64_t)run.md5s.size(), digest))
+            return false;
+        run.md5s.push_back(digest.md5);
+        av_frame_unref(frame);
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF;
+}
+
+static bool Decode(const char *clip, int threads, bool zeroPadding, PaddingRun &run)
+{
+    AnnexBReader reader;
+    if (!reader.Open(clip, AV_CODEC_ID_H264))
+        return false;
+
+    const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+    AVCodecContext *ctx = codec ? avcodec_alloc_context3(codec) : nullptr;
+    AVPacket *packet = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    bool ok = ctx && packet && frame;
+    if (ok)
+    {
+        ctx->thread_count = threads;
+        ctx->thread_type = FF_THREAD_FRAME;
+        ok = avcodec_open2(ctx, codec, nullptr) >= 0;
+    }
+
+    while (ok && reader.ReadPacket(packet))
+    {
+        if (reader.GetStats().zeroCopyPackets > run.zeroCopyPackets)
+        {
+            run.zeroCopyPackets++;
+            if (HasDirtyPadding(packet))
+                run.dirtyPadding++;
+            // The mapping is read-only, so this copies into a new buffer with zeroed padding
+            if (zeroPadding && av_packet_make_writable(packet) < 0)
+                ok = false;
+        }
+        ok = ok && avcodec_send_packet(ctx, packet) >= 0 && ReceiveFrames(ctx, frame, run);
+        av_packet_unref(packet);
+    }
+    ok = ok && avcodec_send_packet(ctx, nullptr) >= 0 && ReceiveFrames(ctx, frame, run);
+
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    avcodec_free_context(&ctx);
+    return ok;
+}
+
+static bool CheckClip(const char *clip, int threads)
+{
+    PaddingRun zeroCopy, padded;
+    if (!Decode(clip, threads, false, zeroCopy) || !Decode(clip, threads, true, padded))
+    {
+        std::printf("FAIL: cannot decode %s\n", clip);
+        return false;
+    }
+
+    size_t differing = 0;
+    for (size_t i = 0; i < zeroCopy.md5s.size() && i < padded.md5s.size(); i++)
+    {
+        if (zeroCopy.md5s[i] != padded.md5s[i])
+            differing++;
+    }
+    bool ok = !zeroCopy.md5s.empty() && zeroCopy.md5s.size() == padded.md5s.size() && differing == 0 &&
+              zeroCopy.dirtyPadding > 0;
+    std::printf("%s: %s, %d thread(s): %zu frames zero-copy, %zu with zeroed padding, %zu differ; "
+                "%llu zero-copy packets, %llu with non-zero padding\n",
+                ok ? "ok" : "FAIL", clip, threads, zeroCopy.md5s.size(), padded.md5s.size(), differing,
+                (unsigned long long)zeroCopy.zeroCopyPackets, (unsigned long long)zeroCopy.dirtyPadding);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::printf("Usage: H264_Test_AnnexBPadding <clip.h264> [<clip.h264> ...]\n");
+        return -1;
+    }
+
+    bool pass = true;
+    for (int i = 1; i < argc; i++)
+    {
+        for (int threads : {1, 4})
+            pass = CheckClip(argv[i], threads) && pass;
+    }
+
+    std::printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "DecoderCore.h"
+
+// Smoke test of the decoder_core library: open a clip with the software backend through
+// both input paths (elementary stream reader and avformat), decode it to the end and check
+// the frame count and picture size.
+//   H264_Test_Smoke <clip.h264> <width> <height> <frames>
+
+class SmokeSink : public IFrameSink
+{
+public:
+    int64_t frames = 0;
+    int64_t wrongSize = 0;
+    int width = 0;
+    int height = 0;
+
+    bool OnFrame(AVFrame *frame) override
+    {
+        if (frame->width != width || frame->height != height || !frame->data[0])
+            wrongSize++;
+        frames++;
+        return true;
+    }
+};
+
+static bool DecodeClip(const char *clip, DecoderCore::InputMode mode, const char *modeName, int width, int height,
+                       int64_t expected)
+{
+    IDecodeBackend *backend = DecodeBackendFactory::Create("sw", 1);
+    if (!backend)
+    {
+        std::printf("FAIL: no software backend\n");
+        return false;
+    }
+
+    SmokeSink sink;
+    sink.width = width;
+    sink.height = height;
+    bool ok = true;
+    {
+        DecoderCore decoder;
+        decoder.SetInputMode(mode);
+        if (!decoder.Open(clip, backend))
+        {
+            std::printf("FAIL: %s: cannot open %s\n", modeName, clip);
+            ok = false;
+        }
+        else
+        {
+            while (decoder.DecodeOneFrame(&sink))
+            {
+            }
+            if (decoder.GetState() != DecoderCore::State::Finished)
+            {
+                std::printf("FAIL: %s: decoding stopped before the end of the stream\n", modeName);
+                ok = false;
+            }
+            decoder.Close();
+        }
+    }
+    delete backend;
+
+    if (sink.frames != expected)
+    {
+        std::printf("FAIL: %s: %lld frames, expected %lld\n", modeName, (long long)sink.frames, (long long)expected);
+        ok = false;
+    }
+    if (sink.wrongSize)
+    {
+        std::printf("FAIL: %s: %lld frames are not %dx%d\n", modeName, (long long)sink.wrongSize, width, height);
+        ok = false;
+    }
+    if (ok)
+        std::printf("ok: %s: %lld frames %dx%d\n", modeName, (long long)sink.frames, width, height);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5)
+    {
+        std::printf("Usage: H264_Test_Smoke <clip.h264> <width> <height> <frames>\n");
+        return -1;
+    }
+    const char *clip = argv[1];
+    int width = std::atoi(argv[2]);
+    int height = std::atoi(argv[3]);
+    int64_t expected = std::atoll(argv[4]);
+
+    bool pass = DecodeClip(clip, DecoderCore::InputMode::ElementaryStream, "elementary stream", width, height, expected);
+    pass = DecodeClip(clip, DecoderCore::InputMode::Demuxer, "avformat", width, height, expected) && pass;
+
+    std::printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "DecoderCore.h"
+
+extern "C"
+{
+#include <libavutil/pixdesc.h>
+}
+
+// Mid-stream resolution / pixel format switches: decode a clip concatenated from differently
+// sized and 8/10-bit streams, with the default allocator and with a FramePool, and check that
+// DecoderCore counts exactly the known number of switches, that no switch stalled decoding
+// for more than kFormatStallFrames mean frame times, and that the pool re-laid out its
+// buffers once per switch.
+//   H264_Test_FormatChange <clip> <changes> <frames> [--threads N]
+
+// A switch may cost this many mean frame decode times (a keyframe at the new size, the
+// codec's reinit and buffer re-layout) before it counts as a stall
+static constexpr double kFormatStallFrames = 8.0;
+
+class CountSink : public IFrameSink
+{
+public:
+    int64_t frames = 0;
+
+    bool OnFrame(AVFrame *) override
+    {
+        frames++;
+        return true;
+    }
+};
+
+static bool DecodeSwitches(const char *clip, int threads, bool usePool, uint64_t expectedChanges, int64_t expectedFrames)
+{
+    FramePool::Config poolConfig;
+    IDecodeBackend *backend = DecodeBackendFactory::Create("sw", threads, usePool ? &poolConfig : nullptr);
+    if (!backend)
+    {
+        std::printf("FAIL: no software backend\n");
+        return false;
+    }
+
+    CountSink sink;
+    DecoderCore::FormatChangeStats formats;
+    FramePool::Stats pool;
+    bool finished = false;
+    {
+        DecoderCore decoder;
+        if (decoder.Open(clip, backend))
+        {
+            while (decoder.DecodeOneFrame(&sink))
+            {
+            }
+            finished = decoder.GetState() == DecoderCore::State::Finished;
+            formats = decoder.GetFormatChangeStats();
+            decoder.Close();
+        }
+        else
+        {
+            std::printf("FAIL: cannot open %s\n", clip);
+        }
+    }
+    if (FramePool *framePool = backend->GetFramePool())
+        pool = framePool->GetStats();
+    delete backend;
+
+    double limitMs = kFormatStallFrames * formats.meanFrameMs;
+    bool ok = finished && sink.frames == expectedFrames && formats.changes == expectedChanges &&
+              formats.maxStallMs <= limitMs && (!usePool || pool.relayouts == expectedChanges);
+    const char *name = av_get_pix_fmt_name((AVPixelFormat)formats.format);
+    std::printf("%s: %d thread(s)%s: %lld of %lld frames, %llu of %llu format changes ending at %dx%d %s, "
+                "worst stall %.2f ms (limit %.2f ms)%s\n",
+                ok ? "ok" : "FAIL", threads, usePool ? ", frame pool" : "", (long long)sink.frames,
+                (long long)expectedFrames, (unsigned long long)formats.changes, (unsigned long long)expectedChanges,
+                formats.width, formats.height, name ? name : "?", formats.maxStallMs, limitMs,
+                finished ? "" : ", stopped before the end of the stream");
+    if (usePool)
+        std::printf("    frame pool: %llu relayouts, %llu idle slabs reused\n", (unsigned long long)pool.relayouts,
+                    (unsigned long long)pool.slabsReused);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        std::printf("Usage: H264_Test_FormatChange <clip> <changes> <frames> [--threads N]\n");
+        return -1;
+    }
+    const char *clip = argv[1];
+    uint64_t changes = (uint64_t)std::atoll(argv[2]);
+    int64_t frames = std::atoll(argv[3]);
+    int threads = 1;
+    for (int i = 4; i + 1 < argc; i++)
+    {
+        if (std::string(argv[i]) == "--threads")
+            threads = std::atoi(argv[++i]);
+    }
+
+    bool pass = DecodeSwitches(clip, threads, false, changes, frames);
+    pass = DecodeSwitches(clip, threads, true, changes, frames) && pass;
+
+    std::printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
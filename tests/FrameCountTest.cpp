@@ -0,0 +1,86 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "DecoderCore.h"
+
+// Every access unit of a progressive H.264 stream yields exactly one frame, including the
+// frames still held for reordering / frame threading when input ends. Decodes a clip with a
+// known frame count through both input paths, with one thread and with frame threads, and
+// checks the count and that display order never goes backwards.
+//   H264_Test_FrameCount <clip> <frames>
+
+class CountSink : public IFrameSink
+{
+public:
+    int64_t frames = 0;
+    int64_t outOfOrder = 0;
+    int64_t lastPts = AV_NOPTS_VALUE;
+
+    bool OnFrame(AVFrame *frame) override
+    {
+        int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+        if (pts != AV_NOPTS_VALUE && lastPts != AV_NOPTS_VALUE && pts <= lastPts)
+            outOfOrder++;
+        lastPts = pts;
+        frames++;
+        return true;
+    }
+};
+
+static bool CountFrames(const char *clip, DecoderCore::InputMode mode, int threads, int64_t expected)
+{
+    const char *modeName = mode == DecoderCore::InputMode::Demuxer ? "avformat" : "auto";
+    IDecodeBackend *backend = DecodeBackendFactory::Create("sw", threads);
+    if (!backend)
+    {
+        std::printf("FAIL: no software backend\n");
+        return false;
+    }
+
+    CountSink sink;
+    bool finished = false;
+    {
+        DecoderCore decoder;
+        decoder.SetInputMode(mode);
+        if (decoder.Open(clip, backend))
+        {
+            while (decoder.DecodeOneFrame(&sink))
+            {
+            }
+            finished = decoder.GetState() == DecoderCore::State::Finished;
+            decoder.Close();
+        }
+        else
+        {
+            std::printf("FAIL: cannot open %s\n", clip);
+        }
+    }
+    delete backend;
+
+    bool ok = finished && sink.frames == expected && sink.outOfOrder == 0;
+    std::printf("%s: %s, %d thread(s): %lld of %lld frames, %lld out of order%s\n", ok ? "ok" : "FAIL", modeName,
+                threads, (long long)sink.frames, (long long)expected, (long long)sink.outOfOrder,
+                finished ? "" : ", stopped before the end of the stream");
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::printf("Usage: H264_Test_FrameCount <clip> <frames>\n");
+        return -1;
+    }
+    const char *clip = argv[1];
+    int64_t expected = std::atoll(argv[2]);
+
+    bool pass = true;
+    for (DecoderCore::InputMode mode : {DecoderCore::InputMode::Auto, DecoderCore::InputMode::Demuxer})
+    {
+        for (int threads : {1, 4})
+            pass = CountFrames(clip, mode, threads, expected) && pass;
+    }
+
+    std::printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
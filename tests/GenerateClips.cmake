@@ -0,0 +1,97 @@
+# Generates the test clips with ffmpeg (testsrc2 + libx264). Run by the generate_clips test:
+#   cmake -DFFMPEG=<ffmpeg> -DCLIP_DIR=<dir> -P GenerateClips.cmake
+# Clips that already exist are kept, so only the first ctest run pays for encoding.
+
+if(NOT FFMPEG OR NOT EXISTS "${FFMPEG}")
+    message(FATAL_ERROR "ffmpeg not found; install it or configure with -DFFMPEG_EXECUTABLE=<path>")
+endif()
+file(MAKE_DIRECTORY "${CLIP_DIR}")
+
+# clip(<file> <size> <rate> <frames> [encoder options...]): the container follows the extension
+function(clip file size rate frames)
+    set(out "${CLIP_DIR}/${file}")
+    if(EXISTS "${out}")
+        return()
+    endif()
+    # Encode under a temporary name (same extension) so an interrupted run leaves no half clip
+    set(tmp "${CLIP_DIR}/partial_${file}")
+    execute_process(
+        COMMAND "${FFMPEG}" -hide_banner -loglevel error -y
+                -f lavfi -i "testsrc2=size=${size}:rate=${rate}" -frames:v ${frames}
+                -c:v libx264 ${ARGN} "${tmp}"
+        RESULT_VARIABLE result
+    )
+    if(NOT result EQUAL 0)
+        file(REMOVE "${tmp}")
+        message(FATAL_ERROR "ffmpeg failed to generate ${file}")
+    endif()
+    file(RENAME "${tmp}" "${out}")
+endfunction()
+
+# I/P only, 4:2:0 8-bit
+clip(ip_320x240.h264 320x240 25 50 -bf 0)
+# Width not a multiple of 16, B-pyramid reordering
+clip(bframes_350x198.h264 350x198 25 50 -bf 3 -b_pyramid normal)
+# MP4 with B-frames
+clip(bframes_720p.mp4 1280x720 30 60 -bf 2)
+
+# reference(<file>): <file>.framemd5, ffmpeg's own decode of the clip for H264_Test_Golden
+function(reference file)
+    set(out "${CLIP_DIR}/${file}.framemd5")
+    if(EXISTS "${out}")
+        return()
+    endif()
+    execute_process(
+        COMMAND "${FFMPEG}" -hide_banner -loglevel error -y -i "${CLIP_DIR}/${file}"
+                -map 0:v:0 -fps_mode passthrough -f framemd5 "${out}.partial"
+        RESULT_VARIABLE result
+    )
+    if(NOT result EQUAL 0)
+        file(REMOVE "${out}.partial")
+        message(FATAL_ERROR "ffmpeg failed to write the framemd5 reference of ${file}")
+    endif()
+    file(RENAME "${out}.partial" "${out}")
+endfunction()
+
+# concat(<file> <parts>...): raw streams back to back; the reference is the parts' references
+# in order (ffmpeg would rescale to the first size when writing one for the switching stream)
+function(concat file)
+    set(out "${CLIP_DIR}/${file}")
+    if(EXISTS "${out}" AND EXISTS "${out}.framemd5")
+        return()
+    endif()
+    set(parts)
+    set(references)
+    foreach(part ${ARGN})
+        reference(${part})
+        list(APPEND parts "${CLIP_DIR}/${part}")
+        list(APPEND references "${CLIP_DIR}/${part}.framemd5")
+    endforeach()
+    execute_process(COMMAND "${CMAKE_COMMAND}" -E cat ${parts} OUTPUT_FILE "${out}.partial" RESULT_VARIABLE result)
+    execute_process(COMMAND "${CMAKE_COMMAND}" -E cat ${references} OUTPUT_FILE "${out}.framemd5" RESULT_VARIABLE result2)
+    if(NOT result EQUAL 0 OR NOT result2 EQUAL 0)
+        file(REMOVE "${out}.partial" "${out}.framemd5")
+        message(FATAL_ERROR "cannot concatenate ${file}")
+    endif()
+    file(RENAME "${out}.partial" "${out}")
+endfunction()
+
+# Golden suite: the clips above plus a stream switching size and bit depth mid-stream
+clip(sw_640x360.h264 640x360 25 25)
+clip(sw_720p.h264 1280x720 25 25)
+clip(sw_640x360_10bit.h264 640x360 25 25 -pix_fmt yuv420p10le)
+reference(ip_320x240.h264)
+reference(bframes_350x198.h264)
+reference(bframes_720p.mp4)
+concat(res_switch.h264 ip_320x240.h264 sw_640x360.h264 sw_720p.h264 sw_640x360_10bit.h264
+       bframes_350x198.h264 ip_320x240.h264)
+
+# Seeking: one-second GOPs with B-pyramid reordering, raw and in MP4
+clip(seek_640x360.h264 640x360 25 150 -bf 3 -g 25)
+clip(seek_640x360.mp4 640x360 25 150 -bf 3 -g 25)
+# Bitstream statistics: constant QP 28 without adaptive quantisation, an IDR every 12 frames
+# and no scene cuts, raw and in MP4
+clip(gop12_qp28.h264 352x288 25 60 -bf 3 -b_pyramid normal -g 12 -sc_threshold 0 -qp 28 -aq-mode 0)
+clip(gop12_qp28.mp4 352x288 25 60 -bf 3 -b_pyramid normal -g 12 -sc_threshold 0 -qp 28 -aq-mode 0)
+# Real-time playback under load / slow storage
+clip(realtime_1080p.mp4 1920x1080 60 300 -preset veryfast)
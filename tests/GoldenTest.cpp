@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BenchFrameSink.h"
+#include "DecoderCore.h"
+#include "FrameChecksum.h"
+
+// Golden-output suite: every clip in a directory is decoded with the given backend as one
+// thread, with frame threading and from a FramePool; each run's per-frame checksums must
+// equal the clip's reference: <clip>.golden (our own format, written by --update-golden) or
+// else <clip>.framemd5 from ffmpeg, which covers frame count, order and content. A timed
+// pass records decode and convert throughput as JSON lines, optionally checked against a
+// baseline file from an earlier run.
+
+struct GoldenOptions
+{
+    std::string dir;
+    bool update = false;         // (re)write the golden files from the single-thread run
+    const char *perfPath = nullptr;
+    const char *baselinePath = nullptr;
+    double tolerance = 0.10;     // allowed fractional throughput loss against the baseline
+    double perfSeconds = 1.0;    // minimum timed decoding per clip
+};
+
+struct PerfRecord
+{
+    std::string clip;
+    uint64_t frames = 0;
+    double decodeFps = 0.0;
+    double convertMs = 0.0; // median per frame
+};
+
+static bool IsGoldenClip(const std::filesystem::path &path)
+{
+    static const char *kExtensions[] = {".h264", ".264", ".h265", ".hevc", ".mp4", ".mkv", ".ts"};
+    std::string ext = path.extension().string();
+    for (const char *e : kExtensions)
+    {
+        if (ext == e)
+            return true;
+    }
+    return false;
+}
+
+// Decode the whole file into the checksum sink
+static bool ChecksumClip(const std::string &clip, const std::string &backendName, int threads, bool usePool,
+                         DecoderCore::InputMode inputMode, FrameChecksumSink &sink)
+{
+    FramePool::Config poolConfig;
+    IDecodeBackend *backend = DecodeBackendFactory::Create(backendName.c_str(), threads, usePool ? &poolConfig : nullptr);
+    if (!backend)
+        return false;
+
+    bool ok = false;
+    {
+        DecoderCore decoder;
+        decoder.SetInputMode(inputMode);
+        sink.Reset();
+        if (decoder.Open(clip.c_str(), backend))
+        {
+            while (decoder.DecodeOneFrame(&sink))
+            {
+            }
+            ok = decoder.GetState() == DecoderCore::State::Finished;
+        }
+    }
+    delete backend;
+    return ok;
+}
+
+// Repeated decode + convert until minSeconds; best decode rate (convert time excluded)
+static bool MeasureClip(const std::string &clip, const std::string &backendName, int threads,
+                        DecoderCore::InputMode inputMode, double minSeconds, PerfRecord &record)
+{
+    BenchFrameSink sink;
+    double totalSeconds = 0.0;
+    do
+    {
+        IDecodeBackend *backend = DecodeBackendFactory::Create(backendName.c_str(), threads);
+        if (!backend)
+            return false;
+
+        bool opened;
+        double seconds = 0.0, convertBefore = sink.convertStats.TotalUs();
+        int64_t framesBefore = sink.framesDecoded;
+        {
+            DecoderCore decoder;
+            decoder.SetInputMode(inputMode);
+            opened = decoder.Open(clip.c_str(), backend);
+            auto start = std::chrono::steady_clock::now();
+            sink.BeginDecode();
+            while (opened && decoder.DecodeOneFrame(&sink))
+                sink.BeginDecode();
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        delete backend;
+        if (!opened)
+            return false;
+
+        double decodeSeconds = seconds - (sink.convertStats.TotalUs() - convertBefore) / 1e6;
+        record.frames = (uint64_t)(sink.framesDecoded - framesBefore);
+        if (decodeSeconds > 0.0)
+            record.decodeFps = std::max(record.decodeFps, record.frames / decodeSeconds);
+        totalSeconds += seconds;
+    } while (totalSeconds < minSeconds && record.frames > 0);
+
+    record.convertMs = sink.convertStats.Percentile(50.0) / 1000.0;
+    return true;
+}
+
+// Value of "key": in one JSON line of our own perf output
+static bool JsonField(const std::string &line, const char *key, std::string &value)
+{
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos)
+        return false;
+    pos += pattern.size();
+    if (pos < line.size() && line[pos] == '"')
+    {
+        size_t end = line.find('"', pos + 1);
+        value = line.substr(pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1);
+    }
+    else
+    {
+        size_t end = line.find_first_of(",}", pos);
+        value = line.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+    }
+    return true;
+}
+
+static std::vector<PerfRecord> ReadPerfRecords(const char *path)
+{
+    std::vector<PerfRecord> records;
+    std::ifstream in(path);
+    std::string line, value;
+    while (std::getline(in, line))
+    {
+        PerfRecord r;
+        if (!JsonField(line, "clip", r.clip))
+            continue;
+        if (JsonField(line, "frames", value))
+            r.frames = std::strtoull(value.c_str(), nullptr, 10);
+        if (JsonField(line, "decode_fps", value))
+            r.decodeFps = std::atof(value.c_str());
+        if (JsonField(line, "convert_ms", value))
+            r.convertMs = std::atof(value.c_str());
+        records.push_back(r);
+    }
+    return records;
+}
+
+static int RunGoldenSuite(const GoldenOptions &options, const std::string &backendName, int threads,
+                          DecoderCore::InputMode inputMode)
+{
+    std::error_code ec;
+    std::vector<std::string> clips;
+    for (const auto &entry : std::filesystem::directory_iterator(options.dir, ec))
+    {
+        if (!entry.is_regular_file() || !IsGoldenClip(entry.path()))
+            continue;
+        std::string path = entry.path().string();
+        if (options.update || std::filesystem::exists(path + ".golden") || std::filesystem::exists(path + ".framemd5"))
+            clips.push_back(path);
+    }
+    std::sort(clips.begin(), clips.end());
+    if (ec || clips.empty())
+    {
+        std::cerr << "No clips with .golden or .framemd5 references in " << options.dir << std::endl;
+        return -1;
+    }
+
+    // Frame threading with at least two threads, or the requested count
+    int frameThreads = threads > 1 ? threads : 4;
+    struct Variant
+    {
+        const char *name;
+        int threads;
+        bool pool;
+    };
+    const Variant variants[] = {{"1-thread", 1, false}, {"threads", frameThreads, false}, {"pool", 1, true}};
+
+    std::printf("Golden suite: %s, %zu clips, backend %s%s\n", options.dir.c_str(), clips.size(), backendName.c_str(),
+                options.update ? ", updating golden files" : "");
+    std::printf("%-28s %7s %11s %9s %9s %9s %12s %11s\n", "clip", "frames", "size", variants[0].name, variants[1].name,
+                variants[2].name, "decode fps", "convert ms");
+
+    std::vector<std::string> failures;
+    std::vector<PerfRecord> records;
+    for (const std::string &clip : clips)
+    {
+        std::string name = std::filesystem::path(clip).filename().string();
+        std::string goldenPath = clip + ".golden";
+        std::vector<FrameDigest> golden;
+        std::vector<std::string> md5s;
+        bool haveGolden = !options.update && FrameChecksumSink::ReadGolden(goldenPath.c_str(), golden);
+        bool haveMd5 = !haveGolden && !options.update &&
+                       FrameChecksumSink::ReadFrameMd5((clip + ".framemd5").c_str(), md5s);
+
+        const char *verdicts[3];
+        FrameChecksumSink sink;
+        std::vector<FrameDigest> decoded; // single-thread run, for the size column
+        for (int v = 0; v < 3; v++)
+        {
+            if (!ChecksumClip(clip, backendName, variants[v].threads, variants[v].pool, inputMode, sink))
+            {
+                verdicts[v] = "error";
+                failures.push_back(name + " (" + variants[v].name + "): decode failed");
+                continue;
+            }
+            if (v == 0 && options.update)
+            {
+                // The single-thread run is the reference for the others
+                golden = sink.GetDigests();
+                haveGolden = FrameChecksumSink::WriteGolden(goldenPath.c_str(), golden, name + ", " + backendName +
+                                                            " decoder, " + std::to_string(golden.size()) + " frames");
+            }
+            if (v == 0)
+                decoded = sink.GetDigests();
+            if (!haveGolden && !haveMd5)
+            {
+                verdicts[v] = "no golden";
+                failures.push_back(name + ": cannot read " + goldenPath + " or " + clip + ".framemd5");
+                continue;
+            }
+
+            FrameChecksumSink::Comparison cmp = haveGolden ? FrameChecksumSink::Compare(golden, sink.GetDigests())
+                                                           : FrameChecksumSink::CompareMd5(md5s, sink.GetDigests());
+            verdicts[v] = cmp.Passed() ? "ok" : "FAIL";
+            if (!cmp.Passed())
+            {
+                failures.push_back(name + " (" + variants[v].name + "): " + cmp.firstMismatch + ", " +
+                                   std::to_string(cmp.mismatched) + " frames differ");
+            }
+        }
+
+        char size[32] = "-";
+        if (!decoded.empty())
+        {
+            bool mixed = false;
+            for (const FrameDigest &d : decoded)
+                mixed = mixed || d.width != decoded[0].width || d.height != decoded[0].height;
+            if (mixed)
+                std::snprintf(size, sizeof(size), "mixed");
+            else
+                std::snprintf(size, sizeof(size), "%dx%d", decoded[0].width, decoded[0].height);
+        }
+
+        PerfRecord record;
+        record.clip = name;
+        if (options.perfPath || options.baselinePath)
+        {
+            if (!MeasureClip(clip, backendName, threads, inputMode, options.perfSeconds, record))
+                failures.push_back(name + ": timed decode failed");
+            records.push_back(record);
+        }
+        std::printf("%-28s %7zu %11s %9s %9s %9s %12.1f %11.3f\n", name.c_str(),
+                    haveGolden ? golden.size() : md5s.size(), size, verdicts[0],
+                    verdicts[1], verdicts[2], record.decodeFps, record.convertMs);
+    }
+
+    if (options.perfPath)
+    {
+        std::ofstream out(options.perfPath, std::ios::trunc);
+        for (const PerfRecord &r : records)
+        {
+            char line[512];
+            std::snprintf(line, sizeof(line),
+                          "{\"clip\":\"%s\",\"backend\":\"%s\",\"threads\":%d,\"frames\":%llu,\"decode_fps\":%.2f,"
+                          "\"convert_ms\":%.4f}",
+                          r.clip.c_str(), backendName.c_str(), threads, (unsigned long long)r.frames, r.decodeFps,
+                          r.convertMs);
+            out << line << "\n";
+        }
+        if (!out)
+            failures.push_back(std::string("cannot write ") + options.perfPath);
+        else
+            std::printf("Throughput written to %s\n", options.perfPath);
+    }
+
+    if (options.baselinePath)
+    {
+        std::vector<PerfRecord> baseline = ReadPerfRecords(options.baselinePath);
+        if (baseline.empty())
+            failures.push_back(std::string("no records in baseline ") + options.baselinePath);
+        for (const PerfRecord &b : baseline)
+        {
+            auto it = std::find_if(records.begin(), records.end(), [&](const PerfRecord &r) { return r.clip == b.clip; });
+            if (it == records.end())
+                continue;
+            char what[256];
+            if (b.decodeFps > 0.0 && it->decodeFps < b.decodeFps * (1.0 - options.tolerance))
+            {
+                std::snprintf(what, sizeof(what), "%s: decode %.1f fps, baseline %.1f (-%.1f%%)", b.clip.c_str(),
+                              it->decodeFps, b.decodeFps, (1.0 - it->decodeFps / b.decodeFps) * 100.0);
+                failures.push_back(what);
+            }
+            if (b.convertMs > 0.0 && it->convertMs > b.convertMs * (1.0 + options.tolerance))
+            {
+                std::snprintf(what, sizeof(what), "%s: convert %.3f ms, baseline %.3f (+%.1f%%)", b.clip.c_str(),
+                              it->convertMs, b.convertMs, (it->convertMs / b.convertMs - 1.0) * 100.0);
+                failures.push_back(what);
+            }
+        }
+        std::printf("Baseline: %s, tolerance %.0f%%\n", options.baselinePath, options.tolerance * 100.0);
+    }
+
+    for (const std::string &f : failures)
+        std::printf("FAIL: %s\n", f.c_str());
+    std::printf("%s: %zu clips, %zu failures\n", failures.empty() ? "PASS" : "FAIL", clips.size(), failures.size());
+    return failures.empty() ? 0 : 1;
+}
+
+static void PrintUsage()
+{
+    std::cout << "Usage: H264_Test_Golden <clip directory> [--update-golden] [--perf FILE] [--perf-baseline FILE]\n"
+              << "                        [--perf-tolerance F] [--backend NAME] [--threads N] [--input auto|demux|es]\n"
+              << "  --update-golden: write <clip>.golden files from the single-thread decode\n"
+              << "  --perf FILE:  also time decode + convert per clip and write JSON lines to FILE\n"
+              << "  --perf-baseline FILE: fail if a clip decodes or converts slower than in FILE beyond the tolerance\n"
+              << "  --perf-tolerance F: allowed throughput loss against the baseline (default 0.10)" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    GoldenOptions options;
+    std::string backendName = "sw";
+    int threads = 0;
+    DecoderCore::InputMode inputMode = DecoderCore::InputMode::Auto;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--update-golden")
+            options.update = true;
+        else if (arg == "--perf" && i + 1 < argc)
+            options.perfPath = argv[++i];
+        else if (arg == "--perf-baseline" && i + 1 < argc)
+            options.baselinePath = argv[++i];
+        else if (arg == "--perf-tolerance" && i + 1 < argc)
+            options.tolerance = std::atof(argv[++i]);
+        else if (arg == "--backend" && i + 1 < argc)
+            backendName = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (arg == "--input" && i + 1 < argc)
+        {
+            std::string mode = argv[++i];
+            if (mode == "demux")
+                inputMode = DecoderCore::InputMode::Demuxer;
+            else if (mode == "es")
+                inputMode = DecoderCore::InputMode::ElementaryStream;
+            else
+                inputMode = DecoderCore::InputMode::Auto;
+        }
+        else if (arg[0] != '-')
+            options.dir = arg;
+    }
+    if (options.dir.empty())
+    {
+        PrintUsage();
+        return -1;
+    }
+    return RunGoldenSuite(options, backendName, threads, inputMode);
+}
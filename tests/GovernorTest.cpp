@@ -0,0 +1,77 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "PlaybackHarness.h"
+
+// Real-time playback, optionally with busy-loop threads competing for the CPU while the
+// LoadGovernor degrades decode (skipping loop filter, non-reference frames, everything but
+// keyframes). Without load it checks that playback stays real time; under load the outcome
+// depends on the machine, so it only reports how the governor coped (its decisions are
+// checked deterministically by H264_Test_LoadGovernor).
+//   H264_Test_Governor <clip> [--load-threads N|auto] [--rate R] [--no-governor] [--threads N]
+
+// Without load, fails when playback did not stay real time: a clock resync (a stall over one
+// second) or a p90 lateness of two frame intervals or more
+static int RunRealtime(const std::string &videoFile, const std::string &backendName, int threads,
+                       DecoderCore::InputMode inputMode, const PlaybackOptions &options)
+{
+    PlaybackResult r;
+    if (!PlayRealtime(videoFile, backendName, threads, inputMode, options, r))
+        return -1;
+
+    std::printf("File:    %s\n", videoFile.c_str());
+    std::printf("Backend: %s, %d load threads on %u cores, rate %.2fx (%.2f ms/frame), governor %s\n",
+                r.backend.c_str(), options.loadThreads, std::thread::hardware_concurrency(), options.rate, r.frameMs,
+                options.governor ? "on" : "off");
+    PrintPlayback(r);
+    if (options.governor)
+    {
+        std::printf("Governor: %llu steps up, %llu steps down, ended at %s\n", (unsigned long long)r.governor.escalations,
+                    (unsigned long long)r.governor.deescalations, LoadGovernor::LevelName(r.governor.level));
+        for (int level = 0; level < LoadGovernor::kLevelCount; level++)
+        {
+            std::printf("  %-20s entered %llu times, %.2f s\n", LoadGovernor::LevelName((LoadGovernor::Level)level),
+                        (unsigned long long)r.governor.entered[level], r.governor.secondsAt[level]);
+        }
+    }
+
+    double p90Ms = r.lateness.Percentile(90.0) / 1000.0;
+    bool pass = r.clock.presented > 0 && r.clock.resyncs == 0 && p90Ms < 2.0 * r.frameMs;
+    const char *verdict = options.loadThreads > 0 ? "INFO" : (pass ? "PASS" : "FAIL");
+    std::printf("%s: p90 lateness %.2f ms (real-time limit %.2f ms), %llu resyncs\n", verdict, p90Ms,
+                2.0 * r.frameMs, (unsigned long long)r.clock.resyncs);
+    return options.loadThreads > 0 || pass ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string videoFile;
+    int threads = 0;
+    PlaybackOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--load-threads" && i + 1 < argc)
+        {
+            // auto: twice the cores, so decoding gets about a third of the machine
+            std::string n = argv[++i];
+            options.loadThreads = n == "auto" ? 2 * (int)std::thread::hardware_concurrency() : std::atoi(n.c_str());
+        }
+        else if (arg == "--rate" && i + 1 < argc)
+            options.rate = std::atof(argv[++i]);
+        else if (arg == "--no-governor")
+            options.governor = false;
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (arg[0] != '-')
+            videoFile = arg;
+    }
+    if (videoFile.empty())
+    {
+        std::printf("Usage: H264_Test_Governor <clip> [--load-threads N|auto] [--rate R] [--no-governor] [--threads N]\n");
+        return -1;
+    }
+    return RunRealtime(videoFile, "sw", threads, DecoderCore::InputMode::Auto, options);
+}
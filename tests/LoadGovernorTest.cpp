@@ -0,0 +1,149 @@
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "LoadGovernor.h"
+
+// LoadGovernor decisions, driven with synthetic time points and window outcomes instead of a
+// loaded machine: the escalation order, escalateDwellMs between steps up, stepping down only
+// after healthyWindows consecutive healthy windows and recoverDwellMs at the level, the
+// doubled recovery dwell after a quick bounce, the Stats counters and PrintChange.
+//   H264_Test_LoadGovernor
+
+using Level = LoadGovernor::Level;
+
+static constexpr double kFrameMs = 40.0;
+
+enum class Window
+{
+    Overloaded, // decoder saturated, 30% dropped, presented frames 50 ms late
+    Healthy,    // decoder 30% busy, nothing dropped or late
+    Neutral     // decoder 75% busy: neither overloaded nor healthy
+};
+
+struct Change
+{
+    int atMs;
+    Level level;
+};
+
+class GovernorDriver
+{
+public:
+    LoadGovernor governor;
+    std::vector<Change> changes;
+    std::vector<std::string> lines; // PrintChange per change
+    int nowMs = 0;
+
+private:
+    double busyMs = 0.0;
+    double windowMs;
+
+    static LoadGovernor::Clock::time_point At(int ms)
+    {
+        return LoadGovernor::Clock::time_point() + std::chrono::milliseconds(ms);
+    }
+
+public:
+    explicit GovernorDriver(const LoadGovernor::Config &config) : governor(config), windowMs(config.windowMs)
+    {
+        governor.Update(At(0), 0.0, kFrameMs);
+    }
+
+    void Run(Window kind, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            double busy = kind == Window::Overloaded ? 1.0 : (kind == Window::Healthy ? 0.3 : 0.75);
+            int presented = kind == Window::Overloaded ? 7 : 12;
+            for (int f = 0; f < presented; f++)
+                governor.OnPresented(kind == Window::Overloaded ? 50.0 : 0.0);
+            for (int f = 0; kind == Window::Overloaded && f < 3; f++)
+                governor.OnDropped();
+
+            nowMs += (int)windowMs;
+            busyMs += busy * windowMs;
+            if (governor.Update(At(nowMs), busyMs, kFrameMs))
+            {
+                changes.push_back({nowMs, governor.GetLevel()});
+                std::ostringstream line;
+                governor.PrintChange(line, kFrameMs);
+                lines.push_back(line.str());
+            }
+        }
+    }
+};
+
+static bool Check(bool ok, const char *what)
+{
+    std::printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+    return ok;
+}
+
+int main()
+{
+    LoadGovernor::Config config;
+    config.windowMs = 500.0;
+    config.healthyWindows = 4;
+    config.escalateDwellMs = 1000.0;
+    config.recoverDwellMs = 2000.0;
+    config.maxRecoverDwellMs = 30000.0;
+    GovernorDriver driver(config);
+
+    // Overload: one step per escalateDwellMs, in order, up to keyframes only and no further
+    driver.Run(Window::Overloaded, 8);
+    // Recovery: a step down once four healthy windows and recoverDwellMs at the level have passed
+    driver.Run(Window::Healthy, 8);
+    // A neutral window restarts the healthy count although the dwell is over
+    driver.Run(Window::Healthy, 3);
+    driver.Run(Window::Neutral, 1);
+    driver.Run(Window::Healthy, 4);
+    // Overloaded again within twice the recovery dwell of the last step down: the dwell doubles
+    driver.Run(Window::Overloaded, 2);
+    driver.Run(Window::Healthy, 8);
+
+    const std::vector<Change> expected = {
+        {1000, Level::SkipLoopFilter}, {2000, Level::SkipNonRef}, {3000, Level::KeyframesOnly},
+        {6000, Level::SkipNonRef},     {8000, Level::SkipLoopFilter}, {12000, Level::Full},
+        {13000, Level::SkipLoopFilter}, {17000, Level::Full}};
+
+    bool pass = true;
+    bool sameChanges = driver.changes.size() == expected.size();
+    for (size_t i = 0; i < driver.changes.size(); i++)
+    {
+        const Change &c = driver.changes[i];
+        bool match = i < expected.size() && c.atMs == expected[i].atMs && c.level == expected[i].level;
+        std::printf("    %6d ms: %s%s\n", c.atMs, LoadGovernor::LevelName(c.level), match ? "" : "  (unexpected)");
+        sameChanges = sameChanges && match;
+    }
+    pass = Check(sameChanges, "escalation order, escalate and recover dwells, healthy windows, dwell doubled after a bounce") && pass;
+
+    LoadGovernor::Stats stats = driver.governor.GetStats();
+    pass = Check(stats.escalations == 4 && stats.deescalations == 4, "escalation / de-escalation counters") && pass;
+    pass = Check(stats.entered[(int)Level::Full] == 2 && stats.entered[(int)Level::SkipLoopFilter] == 3 &&
+                     stats.entered[(int)Level::SkipNonRef] == 2 && stats.entered[(int)Level::KeyframesOnly] == 1,
+                 "transitions into each level") && pass;
+    pass = Check(stats.level == Level::Full && stats.previousLevel == Level::SkipLoopFilter, "current and previous level") &&
+           pass;
+
+    // Time at each level, accounted up to the last evaluated window
+    const double expectedSeconds[LoadGovernor::kLevelCount] = {2.0, 9.0, 3.0, 3.0};
+    bool seconds = true;
+    for (int level = 0; level < LoadGovernor::kLevelCount; level++)
+        seconds = seconds && std::fabs(stats.secondsAt[level] - expectedSeconds[level]) < 1e-6;
+    pass = Check(seconds, "seconds at each level") && pass;
+
+    bool lines = driver.lines.size() == expected.size() &&
+                 driver.lines[0] == "Load governor: full -> skip loop filter (decode busy 100%, 30% dropped, late 50 ms "
+                                    "at 40 ms/frame)\n" &&
+                 driver.lines[3] == "Load governor: keyframes only -> skip non-reference (decode busy 30%, 0% dropped, "
+                                    "late 0 ms at 40 ms/frame)\n";
+    for (const std::string &line : driver.lines)
+        std::printf("    %s", line.c_str());
+    pass = Check(lines, "PrintChange lines") && pass;
+
+    std::printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "PlaybackHarness.h"
+
+// Looping playback: DecodeThread rewinds the decoder at EOF (or replays a FrameCache) and the
+// present side must see one gapless stream. With --playlist the clip is played as that many
+// playlist items instead (PlaylistSequencer), each opened and decoding ahead before the
+// previous one ends.
+//   H264_Test_LoopPlayback <clip> [--passes N] [--frame-cache MB] [--playlist N] [--threads N]
+
+// Play the file N times over without reopening it, first rewinding the decoder at each EOF,
+// then (with a frame cache budget) replaying the first pass from memory. Fails if a pass
+// boundary stalled playback, its first frame came a frame interval late or more, or its
+// timestamps do not continue the previous pass; with a cache, also if later passes were
+// decoded again instead of replayed.
+static int RunLoop(const std::string &videoFile, const std::string &backendName, int threads,
+                   DecoderCore::InputMode inputMode, const PlaybackOptions &options)
+{
+    PlaybackOptions rewind = options;
+    rewind.frameCacheBytes = 0;
+    PlaybackResult r[2];
+    int runs = options.frameCacheBytes > 0 ? 2 : 1;
+    if (!PlayRealtime(videoFile, backendName, threads, inputMode, rewind, r[0]) ||
+        (runs > 1 && !PlayRealtime(videoFile, backendName, threads, inputMode, options, r[1])))
+        return -1;
+
+    std::printf("File:    %s (%s, %.2f ms/frame), %d passes of %.2f s\n", videoFile.c_str(), r[0].backend.c_str(),
+                r[0].frameMs, options.passes, r[0].periodSec);
+    std::printf("Restart: %.1f ms from open to first frame, the gap every pass had when playback restarted\n",
+                r[0].restartMs);
+    bool pass = true;
+    for (int i = 0; i < runs; i++)
+    {
+        const PlaybackResult &run = r[i];
+        if (i == 0)
+            std::printf("\nRewind at EOF (%llu rewinds, codec kept open):\n", (unsigned long long)run.rewinds);
+        else
+            std::printf("\nFrame cache (%zu MB budget: %zu frames, %.1f MB%s):\n", options.frameCacheBytes >> 20,
+                        run.cacheFrames, run.cacheBytes / (1024.0 * 1024.0),
+                        run.cacheComplete ? ", replayed" : ", clip did not fit - decoded every pass");
+        PrintPlayback(run);
+        std::printf("Lateness of the first frame of each pass (us):\n");
+        run.passStart.Print();
+
+        double worstMs = run.passStart.Percentile(100.0) / 1000.0;
+        bool ok = run.passStart.Count() == (size_t)(options.passes - 1) && run.stalls == 0 && run.clock.resyncs == 0 &&
+                  worstMs < run.frameMs && run.timestampGaps == 0;
+        std::printf("%s: %zu pass boundaries, worst %.2f ms late (limit %.2f ms), %llu stalls, %llu timestamp gaps\n",
+                    ok ? "ok" : "FAILED", run.passStart.Count(), worstMs, run.frameMs, (unsigned long long)run.stalls,
+                    (unsigned long long)run.timestampGaps);
+        if (i > 0)
+        {
+            // Once the first pass is cached nothing is decoded again
+            bool replayed = run.cacheComplete && run.cacheReplayed && run.rewinds == 0;
+            std::printf("%s: cache %s, %llu rewinds after the first pass\n", replayed ? "ok" : "FAILED",
+                        run.cacheReplayed ? "replayed" : "not replayed", (unsigned long long)run.rewinds);
+            ok = ok && replayed;
+        }
+        pass = pass && ok;
+    }
+    std::printf("\n%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
+
+// Play the clip as `items` playlist entries through PlaylistSequencer, like the player: while
+// one plays, the next is opened and decodes ahead on another thread; when the last frame of
+// an item has been shown for its duration, the clock is rebased onto the next item's first
+// frame. Fails if an item switch found the next item's first frame not decoded yet, stalled,
+// came a frame interval late or more, or broke the timestamps within an item.
+static int RunPlaylist(const std::string &videoFile, const std::string &backendName, int threads,
+                       DecoderCore::InputMode inputMode, const PlaybackOptions &options)
+{
+    PlaybackResult r;
+    if (!PlayRealtime(videoFile, backendName, threads, inputMode, options, r))
+    {
+        std::printf("FAIL: cannot open %s\n", videoFile.c_str());
+        return -1;
+    }
+
+    std::printf("File:    %s (%s, %.2f ms/frame), %d playlist items\n", videoFile.c_str(), r.backend.c_str(), r.frameMs,
+                options.playlistItems);
+    PrintPlayback(r);
+    std::printf("Lateness of the first frame of each item (us):\n");
+    r.itemStart.Print();
+
+    double worstMs = r.itemStart.Percentile(100.0) / 1000.0;
+    bool pass = r.playlist.switches == (uint64_t)(options.playlistItems - 1) && r.playlist.skipped == 0 &&
+                r.itemStart.Count() == r.playlist.switches && r.playlist.notReady == 0 && r.stalls == 0 &&
+                r.clock.resyncs == 0 && worstMs < r.frameMs && r.timestampGaps == 0;
+    std::printf("%s: %llu item switches, %llu without a pre-decoded first frame, %llu skipped, worst %.2f ms late "
+                "(limit %.2f ms), %llu stalls, %llu timestamp gaps\n",
+                pass ? "ok" : "FAILED", (unsigned long long)r.playlist.switches, (unsigned long long)r.playlist.notReady,
+                (unsigned long long)r.playlist.skipped, worstMs, r.frameMs, (unsigned long long)r.stalls,
+                (unsigned long long)r.timestampGaps);
+    std::printf("\n%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string videoFile;
+    int threads = 0;
+    PlaybackOptions options;
+    options.passes = 3;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--passes" && i + 1 < argc)
+            options.passes = std::max(2, std::atoi(argv[++i]));
+        else if (arg == "--frame-cache" && i + 1 < argc)
+            options.frameCacheBytes = (size_t)(std::atof(argv[++i]) * 1024 * 1024);
+        else if (arg == "--playlist" && i + 1 < argc)
+            options.playlistItems = std::max(2, std::atoi(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (arg[0] != '-')
+            videoFile = arg;
+    }
+    if (videoFile.empty())
+    {
+        std::printf("Usage: H264_Test_LoopPlayback <clip> [--passes N] [--frame-cache MB] [--playlist N] [--threads N]\n");
+        return -1;
+    }
+    if (options.playlistItems > 1)
+        return RunPlaylist(videoFile, "sw", threads, DecoderCore::InputMode::Auto, options);
+    return RunLoop(videoFile, "sw", threads, DecoderCore::InputMode::Auto, options);
+}
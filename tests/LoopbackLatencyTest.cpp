@@ -0,0 +1,210 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+}
+
+#include "AnnexBReader.h"
+#include "BenchStats.h"
+#include "DecoderCore.h"
+
+// Live input latency: a sender thread streams a raw H.264 clip in real time over
+// tcp://127.0.0.1:PORT and DecoderCore decodes it as a low-latency live input; the p99
+// send-to-decoded latency must stay below one frame interval.
+//   H264_Test_LoopbackLatency <clip.h264> <port> [--send-fps F] [--threads N]
+
+// The sender retries its connect for kConnectAttempts * kConnectRetryMs; the listener gives up
+// a little later, so a sender that never connects fails the test instead of hanging it
+static constexpr int kConnectAttempts = 100;
+static constexpr int kConnectRetryMs = 50;
+static constexpr int kListenTimeoutMs = kConnectAttempts * kConnectRetryMs + 5000;
+// A connected sender that stops writing mid-stream ends the receive after this long
+static constexpr int64_t kReadTimeoutUs = 5000000;
+
+// Live latency sink: arrival (demuxer returned the packet) and send (loopback sender wrote
+// the access unit) to decoded, per frame
+class LiveLatencySink : public IFrameSink
+{
+private:
+    const DecoderCore *core;
+    std::mutex &sendMutex;
+    const std::vector<std::chrono::steady_clock::time_point> &sendTimes;
+
+public:
+    StageStats arrivalStats{"arrival"};
+    StageStats sendStats{"send"};
+    int64_t framesDecoded = 0;
+
+    LiveLatencySink(const DecoderCore *decoder, std::mutex &mutex, const std::vector<std::chrono::steady_clock::time_point> &times)
+        : core(decoder), sendMutex(mutex), sendTimes(times) {}
+
+    bool OnFrame(AVFrame *) override
+    {
+        auto now = std::chrono::steady_clock::now();
+        arrivalStats.Add(std::chrono::duration<double, std::micro>(now - core->GetPacketArrivalTime()).count());
+        {
+            // Low-delay decoding outputs frames in send order
+            std::lock_guard<std::mutex> lock(sendMutex);
+            if (framesDecoded < (int64_t)sendTimes.size())
+                sendStats.Add(std::chrono::duration<double, std::micro>(now - sendTimes[framesDecoded]).count());
+        }
+        framesDecoded++;
+        return true;
+    }
+};
+
+// Stream the file's access units to url in real time, like a live encoder
+static void RunLoopbackSender(const std::string &videoFile, const std::string &url, double fps, std::mutex &sendMutex,
+                              std::vector<std::chrono::steady_clock::time_point> &sendTimes, bool &connected)
+{
+    connected = false;
+    AnnexBReader reader;
+    AVPacket *packet = av_packet_alloc();
+    if (!reader.Open(videoFile.c_str(), AV_CODEC_ID_H264) || !reader.ReadPacket(packet))
+    {
+        std::cerr << "Sender: cannot read " << videoFile << std::endl;
+        av_packet_free(&packet);
+        return;
+    }
+
+    // The receiver starts listening once it opens its input
+    AVIOContext *io = nullptr;
+    for (int attempt = 0; attempt < kConnectAttempts && avio_open2(&io, url.c_str(), AVIO_FLAG_WRITE, nullptr, nullptr) < 0;
+         attempt++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(kConnectRetryMs));
+    if (!io)
+    {
+        std::cerr << "Sender: cannot connect to " << url << std::endl;
+        av_packet_free(&packet);
+        return;
+    }
+    connected = true;
+
+    if (fps <= 0.0)
+    {
+        AVRational rate = reader.GetFrameRate();
+        fps = rate.num > 0 && rate.den > 0 ? av_q2d(rate) : 25.0;
+    }
+    auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / fps));
+
+    // Annex-B has no length field: the receiver's parser only knows an access unit ended when
+    // the next one starts. A live encoder that wants no extra frame of delay sends the access
+    // unit delimiter of the next frame right after the current one, as done here.
+    static const uint8_t kAccessUnitDelimiter[] = {0x00, 0x00, 0x00, 0x01, 0x09, 0xF0};
+
+    auto next = std::chrono::steady_clock::now();
+    do
+    {
+        std::this_thread::sleep_until(next);
+        {
+            std::lock_guard<std::mutex> lock(sendMutex);
+            sendTimes.push_back(std::chrono::steady_clock::now());
+        }
+        avio_write(io, packet->data, packet->size);
+        avio_write(io, kAccessUnitDelimiter, sizeof(kAccessUnitDelimiter));
+        avio_flush(io);
+        av_packet_unref(packet);
+        next += interval;
+    } while (reader.ReadPacket(packet));
+
+    avio_closep(&io);
+    av_packet_free(&packet);
+}
+
+// Decode a real-time loopback TCP stream in low-latency mode and check that decoding adds
+// less than one frame of delay
+static int RunLoopback(const std::string &videoFile, int port, double fps, const std::string &backendName, int threads)
+{
+    IDecodeBackend *backend = DecodeBackendFactory::Create(backendName.c_str(), threads);
+    if (!backend)
+        return -1;
+
+    std::string address = "tcp://127.0.0.1:" + std::to_string(port);
+    std::mutex sendMutex;
+    std::vector<std::chrono::steady_clock::time_point> sendTimes;
+    bool senderConnected = false;
+    std::thread sender(RunLoopbackSender, std::cref(videoFile), address + "?tcp_nodelay=1", fps, std::ref(sendMutex),
+                       std::ref(sendTimes), std::ref(senderConnected));
+
+    // Bounded waits for the connection and for every read, so a failed sender cannot hang the test
+    std::string listenUrl = address + "?listen=1&listen_timeout=" + std::to_string(kListenTimeoutMs) +
+                            "&timeout=" + std::to_string(kReadTimeoutUs);
+    DecoderCore decoder;
+    decoder.SetLowLatency(true);
+    bool opened = decoder.Open(listenUrl.c_str(), backend);
+
+    LiveLatencySink sink(&decoder, sendMutex, sendTimes);
+    while (opened && decoder.DecodeOneFrame(&sink))
+    {
+    }
+    sender.join();
+
+    int result = 0;
+    if (!senderConnected)
+    {
+        std::printf("FAIL: the sender never connected to %s (see its error above)\n", address.c_str());
+        result = 1;
+    }
+    else if (opened)
+    {
+        // Sender pacing interval (the stream frame rate unless --send-fps was given)
+        double frameMs = fps > 0.0 ? 1000.0 / fps : 0.0;
+        if (frameMs == 0.0 && sendTimes.size() > 1)
+            frameMs = std::chrono::duration<double, std::milli>(sendTimes.back() - sendTimes.front()).count() / (sendTimes.size() - 1);
+
+        std::printf("Loopback: %s -> %s (%s)\n", videoFile.c_str(), address.c_str(), backend->GetName());
+        std::printf("Frames:   %lld decoded, %zu sent, frame interval %.2f ms\n", (long long)sink.framesDecoded,
+                    sendTimes.size(), frameMs);
+        std::printf("Latency to decoded frame (us):\n");
+        sink.arrivalStats.Print();
+        sink.sendStats.Print();
+
+        double p99Ms = sink.sendStats.Percentile(99.0) / 1000.0;
+        bool pass = sink.framesDecoded > 0 && p99Ms < frameMs;
+        std::printf("%s: p99 send->decoded %.2f ms, one frame is %.2f ms\n", pass ? "PASS" : "FAIL", p99Ms, frameMs);
+        result = pass ? 0 : 1;
+    }
+    else
+    {
+        std::printf("FAIL: cannot open the live input %s\n", listenUrl.c_str());
+        result = 1;
+    }
+
+    decoder.Close();
+    delete backend;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string videoFile;
+    int port = 0;
+    double sendFps = 0.0;
+    int threads = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--send-fps" && i + 1 < argc)
+            sendFps = std::atof(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (arg[0] != '-' && videoFile.empty())
+            videoFile = arg;
+        else if (arg[0] != '-')
+            port = std::atoi(arg.c_str());
+    }
+    if (videoFile.empty() || port <= 0)
+    {
+        std::printf("Usage: H264_Test_LoopbackLatency <clip.h264> <port> [--send-fps F] [--threads N]\n");
+        return -1;
+    }
+    return RunLoopback(videoFile, port, sendFps, "sw", threads);
+}
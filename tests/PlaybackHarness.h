@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C"
+{
+#include <libavutil/hwcontext.h>
+}
+
+#include "BenchStats.h"
+#include "DecodeThread.h"
+#include "DecoderCore.h"
+#include "FrameCache.h"
+#include "LoadGovernor.h"
+#include "PacketQueue.h"
+#include "PlaylistSequencer.h"
+#include "PresentationClock.h"
+#include "ReadAheadIO.h"
+
+// Paced playback without a window, shared by the real-time tests (governor, slow storage,
+// looping, playlists): the player's PlaylistSequencer / DecodeThread / PresentationClock /
+// LoadGovernor loop with the presentation replaced by bookkeeping.
+
+// Competing load: one core busy until running is cleared
+inline void BurnCpu(std::atomic<bool> &running)
+{
+    volatile uint64_t spin = 0;
+    while (running.load(std::memory_order_relaxed))
+        spin = spin + 1;
+}
+
+struct PlaybackOptions
+{
+    double rate = 1.0;
+    int loadThreads = 0;
+    bool governor = true;
+    const ReadAheadIO::Config *readAhead = nullptr; // null: avformat's file I/O
+    size_t demuxQueue = 0;                          // packets; 0: demux on the decode thread
+    int passes = 1;                                 // > 1: loop the file (DecodeThread rewinds at EOF)
+    size_t frameCacheBytes = 0;                     // looping: replay from a FrameCache of this size
+    int playlistItems = 1;                          // > 1: play the file as that many playlist items (no loop)
+};
+
+struct PlaybackResult
+{
+    std::string backend;
+    double frameMs = 0.0;
+    double seconds = 0.0;
+    double decodeBusyMs = 0.0;
+    uint64_t stalls = 0; // the next frame was due and not decoded yet
+    uint64_t timestampGaps = 0; // consecutive frames not one frame interval apart
+    PresentationClock::Stats clock;
+    StageStats lateness{"lateness"};
+    LoadGovernor::Stats governor;
+    bool readAhead = false;
+    ReadAheadIO::Stats io;
+    bool demuxThread = false;
+    PacketQueue::Stats packets;
+    // Looping
+    double restartMs = 0.0;      // open to first frame: what every pass cost when playback restarted
+    double periodSec = 0.0;      // one pass
+    uint64_t rewinds = 0;        // DecoderCore::Rewind calls
+    StageStats passStart{"pass start"}; // lateness of the first frame of each pass after the first
+    size_t cacheFrames = 0;
+    size_t cacheBytes = 0;
+    bool cacheComplete = false;
+    bool cacheReplayed = false; // later passes came from the cache
+    // Playlists
+    PlaylistSequencer::Stats playlist;
+    StageStats itemStart{"item start"}; // lateness of the first frame of each item after the first
+};
+
+// FrameCache copy for the tests: software frames are cloned (their pools grow), hardware
+// surfaces are downloaded so the cache does not hold the decoder's fixed surface pool
+inline AVFrame *CopyFrameForCache(const AVFrame *src, void *opaque)
+{
+    (void)opaque;
+    if (!src->hw_frames_ctx)
+        return av_frame_clone(src);
+    AVFrame *frame = av_frame_alloc();
+    if (!frame || av_hwframe_transfer_data(frame, src, 0) < 0 || av_frame_copy_props(frame, src) < 0)
+    {
+        av_frame_free(&frame);
+        return nullptr;
+    }
+    return frame;
+}
+
+// Input options of PlayRealtime, applied to every playlist item
+struct PlaybackInput
+{
+    std::string backendName;
+    int threads = 0;
+    DecoderCore::InputMode inputMode = DecoderCore::InputMode::Auto;
+    const PlaybackOptions *options = nullptr;
+};
+
+// PlaylistSequencer::PrepareFunc for PlaybackInput
+inline IDecodeBackend *PreparePlaybackItem(DecoderCore &core, void *opaque)
+{
+    const PlaybackInput *input = (const PlaybackInput *)opaque;
+    core.SetInputMode(input->inputMode);
+    core.SetReadAhead(input->options->readAhead);
+    core.SetDemuxThread(input->options->demuxQueue);
+    return DecodeBackendFactory::Create(input->backendName.c_str(), input->threads);
+}
+
+// Paced playback without a window: a DecodeThread decodes ahead and frames are "presented"
+// when the PresentationClock says they are due, dropping the late ones like the player.
+// loadThreads busy-loop threads oversubscribe the CPU; with the governor, decoding degrades
+// until it keeps up. With passes > 1 the file loops and playback ends after that many passes;
+// with playlistItems > 1 it is played as that many playlist items, switched like the player.
+inline bool PlayRealtime(const std::string &videoFile, const std::string &backendName, int threads,
+                        DecoderCore::InputMode inputMode, const PlaybackOptions &options, PlaybackResult &result)
+{
+    PlaybackInput input;
+    input.backendName = backendName;
+    input.threads = threads;
+    input.inputMode = inputMode;
+    input.options = &options;
+    PlaylistSequencer::Config config;
+    config.prepare = PreparePlaybackItem;
+    config.prepareOpaque = &input;
+    config.loop = options.passes > 1 && options.playlistItems <= 1;
+    config.frameCacheBytes = options.frameCacheBytes;
+    config.copyFrame = CopyFrameForCache;
+    PlaylistSequencer playlist;
+    if (!playlist.Open(std::vector<std::string>(std::max(options.playlistItems, 1), videoFile), config))
+        return false;
+    PlaylistSequencer::Item *item = playlist.GetItem();
+    DecodeThread *decodeThread = item->decodeThread;
+
+    std::atomic<bool> burning{true};
+    std::vector<std::thread> burners;
+    for (int i = 0; i < options.loadThreads; i++)
+        burners.emplace_back(BurnCpu, std::ref(burning));
+
+    AVStream *stream = item->core.GetVideoStream();
+    int64_t frameDurationPts = PlaylistSequencer::FrameDurationPts(stream);
+    PresentationClock clock;
+    clock.Reset(stream->time_base);
+    clock.SetRate(options.rate);
+    result.frameMs = PlaylistSequencer::FrameDurationMs(stream) / clock.GetRate();
+    result.backend = item->backend->GetName();
+
+    LoadGovernor governor;
+    AVFrame *current = nullptr;
+    bool stallCounted = false;
+
+    // Looping: the first presented timestamp and the start of the next pass
+    int64_t firstPts = AV_NOPTS_VALUE;
+    int64_t lastPts = AV_NOPTS_VALUE;
+    int pass = 1;
+    bool itemStarted = false; // the next presented frame is the first of a new item
+    auto start = PresentationClock::Clock::now();
+    while (true)
+    {
+        auto now = PresentationClock::Clock::now();
+        AVFrame *next = decodeThread->PeekFrame();
+        int64_t period = decodeThread->GetLoopPeriod();
+        if (next && period > 0 && firstPts != AV_NOPTS_VALUE &&
+            PresentationClock::FrameTimestamp(next) >= firstPts + options.passes * period)
+            break;
+        if (!next)
+        {
+            if (decodeThread->IsDrained())
+            {
+                // The next playlist item takes over when the last frame ends
+                PlaylistSequencer::Step step = playlist.Advance(clock, current, now);
+                if (step == PlaylistSequencer::Step::End)
+                    break;
+                if (step == PlaylistSequencer::Step::Switched)
+                {
+                    item = playlist.GetItem();
+                    decodeThread = item->decodeThread;
+                    frameDurationPts = PlaylistSequencer::FrameDurationPts(item->core.GetVideoStream());
+                    if (options.governor)
+                        decodeThread->SetDiscard(LoadGovernor::SkipFrameFor(governor.GetLevel()),
+                                                 LoadGovernor::SkipLoopFilterFor(governor.GetLevel()));
+                    governor.Restart(now, decodeThread->GetDecodeBusyMs());
+                    lastPts = AV_NOPTS_VALUE;
+                    itemStarted = true;
+                    stallCounted = false;
+                    continue;
+                }
+                if (step == PlaylistSequencer::Step::Skipped)
+                    continue;
+            }
+            int64_t duration = current && current->duration > 0 ? current->duration : frameDurationPts;
+            if (current && !stallCounted && clock.IsDue(PresentationClock::FrameTimestamp(current) + duration, now))
+            {
+                result.stalls++;
+                stallCounted = true;
+            }
+        }
+        else if (clock.IsDue(PresentationClock::FrameTimestamp(next), now))
+        {
+            next = decodeThread->PopFrame();
+            int64_t pts = PresentationClock::FrameTimestamp(next);
+            if (lastPts != AV_NOPTS_VALUE && pts - lastPts != frameDurationPts)
+                result.timestampGaps++;
+            lastPts = pts;
+            AVFrame *after = decodeThread->PeekFrame();
+            if (after && clock.IsDue(PresentationClock::FrameTimestamp(after), now))
+            {
+                av_frame_free(&next);
+                clock.OnDropped();
+                governor.OnDropped();
+                continue;
+            }
+            clock.OnPresented(pts, now);
+            double lateMs = clock.GetStats().lastLatenessMs;
+            governor.OnPresented(lateMs);
+            result.lateness.Add(std::max(lateMs, 0.0) * 1000.0);
+            if (itemStarted)
+            {
+                result.itemStart.Add(std::max(lateMs, 0.0) * 1000.0);
+                itemStarted = false;
+            }
+            if (firstPts == AV_NOPTS_VALUE)
+                firstPts = pts;
+            else if (period > 0 && pts >= firstPts + pass * period)
+            {
+                result.passStart.Add(std::max(lateMs, 0.0) * 1000.0);
+                pass++;
+            }
+            av_frame_free(&current);
+            current = next;
+            stallCounted = false;
+            continue;
+        }
+
+        if (options.governor && governor.Update(now, decodeThread->GetDecodeBusyMs(), result.frameMs))
+        {
+            governor.PrintChange(std::cout, result.frameMs);
+            decodeThread->SetDiscard(LoadGovernor::SkipFrameFor(governor.GetLevel()),
+                                     LoadGovernor::SkipLoopFilterFor(governor.GetLevel()));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    result.seconds = std::chrono::duration<double>(PresentationClock::Clock::now() - start).count();
+    result.decodeBusyMs = decodeThread->GetDecodeBusyMs();
+
+    // Stats of the last item played
+    decodeThread->Stop();
+    stream = item->core.GetVideoStream();
+    result.restartMs = item->core.GetStartupTimes().firstFrameMs;
+    result.periodSec = decodeThread->GetLoopPeriod() * av_q2d(stream->time_base);
+    result.rewinds = item->core.GetSeekStats().rewinds;
+    if (item->cache)
+    {
+        result.cacheFrames = item->cache->GetFrameCount();
+        result.cacheBytes = item->cache->GetBytes();
+        result.cacheComplete = item->cache->IsComplete();
+    }
+    result.cacheReplayed = decodeThread->IsReplayingCache();
+    av_frame_free(&current);
+    burning = false;
+    for (std::thread &burner : burners)
+        burner.join();
+
+    result.clock = clock.GetStats();
+    result.governor = governor.GetStats();
+    result.playlist = playlist.GetStats();
+    if (ReadAheadIO *readAhead = item->core.GetReadAhead())
+    {
+        result.readAhead = true;
+        result.io = readAhead->GetStats();
+    }
+    if (PacketQueue *queue = item->core.GetDemuxQueue())
+    {
+        result.demuxThread = true;
+        result.packets = queue->GetStats();
+    }
+
+    playlist.Close();
+    return true;
+}
+
+inline void PrintPlayback(const PlaybackResult &r)
+{
+    std::printf("Played:  %.2f s, %llu presented, %llu dropped, %llu stalls, %llu clock resyncs, decode busy %.0f%%\n",
+                r.seconds, (unsigned long long)r.clock.presented, (unsigned long long)r.clock.dropped,
+                (unsigned long long)r.stalls, (unsigned long long)r.clock.resyncs,
+                r.seconds > 0.0 ? r.decodeBusyMs / (r.seconds * 10.0) : 0.0);
+    if (r.readAhead)
+    {
+        std::printf("Input:   %.1f MB served, %llu storage reads (max %.1f ms), demuxer waited %llu times / %.1f ms"
+                    " (max %.1f ms), %llu seeks, %llu refills\n",
+                    r.io.bytesServed / (1024.0 * 1024.0), (unsigned long long)r.io.ioRequests, r.io.maxIoMs,
+                    (unsigned long long)r.io.waits, r.io.waitMs, r.io.maxWaitMs, (unsigned long long)r.io.seeks,
+                    (unsigned long long)r.io.refills);
+    }
+    if (r.demuxThread)
+    {
+        std::printf("Demux:   %llu packets queued (capacity %zu), decoder waited %llu times / %.1f ms (max %.1f ms)\n",
+                    (unsigned long long)r.packets.pushed, r.packets.capacity, (unsigned long long)r.packets.underruns,
+                    r.packets.underrunMs, r.packets.maxUnderrunMs);
+    }
+    std::printf("Lateness of presented frames (us):\n");
+    r.lateness.Print();
+}
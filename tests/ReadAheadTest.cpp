@@ -0,0 +1,127 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "PlaybackHarness.h"
+
+// Read-ahead input under slow storage: the file is read through a stand-in that stalls for MS
+// ms every MB megabytes, and playback through the prefetch window and demux thread must not
+// stall.
+//   H264_Test_ReadAhead <clip> [--stall MS] [--stall-every MB] [--threads N]
+
+// Slow storage stand-in: the file, with a sleep of stallMs before every stallEveryBytes read
+class ThrottledFileStorage : public ReadAheadIO::Storage
+{
+private:
+    std::ifstream file;
+    int64_t size = 0;
+    double stallMs;
+    size_t stallEveryBytes;
+    size_t bytesSinceStall = 0;
+
+public:
+    ThrottledFileStorage(const std::string &path, double ms, size_t everyBytes)
+        : file(path, std::ios::binary | std::ios::ate), stallMs(ms), stallEveryBytes(everyBytes)
+    {
+        if (file)
+            size = (int64_t)file.tellg();
+    }
+
+    int64_t GetSize() override { return size; }
+
+    int64_t ReadAt(int64_t offset, uint8_t *dst, size_t bytes) override
+    {
+        if (stallEveryBytes > 0 && stallMs > 0.0)
+        {
+            bytesSinceStall += bytes;
+            while (bytesSinceStall >= stallEveryBytes)
+            {
+                bytesSinceStall -= stallEveryBytes;
+                std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(stallMs));
+            }
+        }
+        // A short read at the end sets failbit; only a stream error is a storage error
+        file.clear();
+        file.seekg(offset);
+        file.read((char *)dst, (std::streamsize)bytes);
+        if (file.bad())
+            return -1;
+        return (int64_t)file.gcount();
+    }
+};
+
+// Play the file twice from a storage stand-in that stalls for stallMs every stall interval:
+// with reads on the decode thread (avformat's usual synchronous path), then with a ReadAheadIO
+// prefetch window and a demux thread. Fails unless read-ahead played without a stall.
+static int RunSlowIO(const std::string &videoFile, const std::string &backendName, int threads, double stallMs,
+                     size_t stallEveryBytes, size_t demuxQueue)
+{
+    // A storage per run, so both start at the same point of the stall pattern
+    ThrottledFileStorage directStorage(videoFile, stallMs, stallEveryBytes);
+    ThrottledFileStorage prefetchStorage(videoFile, stallMs, stallEveryBytes);
+    if (directStorage.GetSize() <= 0 || prefetchStorage.GetSize() <= 0)
+    {
+        std::printf("FAIL: cannot read %s\n", videoFile.c_str());
+        return -1;
+    }
+    ReadAheadIO::Config direct;
+    direct.prefetchBytes = 0;
+    direct.storage = &directStorage;
+    ReadAheadIO::Config slowConfig;
+    slowConfig.storage = &prefetchStorage;
+    PlaybackOptions baseline;
+    baseline.governor = false;
+    baseline.readAhead = &direct;
+    PlaybackOptions prefetch = baseline;
+    prefetch.readAhead = &slowConfig;
+    prefetch.demuxQueue = demuxQueue;
+
+    // The elementary stream reader maps the file itself; go through avformat in both runs
+    PlaybackResult r[2];
+    if (!PlayRealtime(videoFile, backendName, threads, DecoderCore::InputMode::Demuxer, baseline, r[0]) ||
+        !PlayRealtime(videoFile, backendName, threads, DecoderCore::InputMode::Demuxer, prefetch, r[1]))
+        return -1;
+
+    std::printf("File:    %s (%s, %.2f ms/frame)\n", videoFile.c_str(), r[0].backend.c_str(), r[0].frameMs);
+    std::printf("Storage: %.0f ms stall every %.1f MB, blocks of %zu KB\n", stallMs,
+                stallEveryBytes / (1024.0 * 1024.0), slowConfig.blockSize / 1024);
+    std::printf("\nDirect reads:\n");
+    PrintPlayback(r[0]);
+    std::printf("\nRead-ahead (%zu MB window, %zu packet demux queue):\n", slowConfig.prefetchBytes >> 20, demuxQueue);
+    PrintPlayback(r[1]);
+
+    bool pass = r[1].stalls == 0 && r[1].clock.resyncs == 0;
+    std::printf("\n%s: %llu stalls / %llu dropped with direct reads, %llu / %llu with read-ahead\n", pass ? "PASS" : "FAIL",
+                (unsigned long long)r[0].stalls, (unsigned long long)r[0].clock.dropped, (unsigned long long)r[1].stalls,
+                (unsigned long long)r[1].clock.dropped);
+    return pass ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string videoFile;
+    int threads = 0;
+    double stallMs = 400.0;
+    double stallEveryMB = 4.0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--stall" && i + 1 < argc)
+            stallMs = std::atof(argv[++i]);
+        else if (arg == "--stall-every" && i + 1 < argc)
+            stallEveryMB = std::atof(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (arg[0] != '-')
+            videoFile = arg;
+    }
+    if (videoFile.empty())
+    {
+        std::printf("Usage: H264_Test_ReadAhead <clip> [--stall MS] [--stall-every MB] [--threads N]\n");
+        return -1;
+    }
+    return RunSlowIO(videoFile, "sw", threads, stallMs, (size_t)(stallEveryMB * 1024 * 1024), 256);
+}
@@ -0,0 +1,190 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+
+#include "BenchStats.h"
+#include "DecoderCore.h"
+#include "FrameChecksum.h"
+
+// Frame-accurate seeking: index the keyframes, seek to random targets and check that the
+// first delivered frame is the one showing at the target, by timestamp and by content
+// against a straight decode of the whole clip.
+//   H264_Test_Seek <clip> [--seeks N] [--input auto|demux|es] [--index-sidecar] [--threads N]
+
+// Stops decoding at the first frame delivered after a seek
+class SeekSink : public IFrameSink
+{
+public:
+    bool delivered = false;
+    int64_t pts = AV_NOPTS_VALUE;
+    int64_t duration = 0;
+    FrameDigest digest;
+
+    bool OnFrame(AVFrame *frame) override
+    {
+        delivered = true;
+        pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+        duration = frame->duration;
+        FrameChecksumSink::Compute(frame, 0, digest);
+        return false;
+    }
+};
+
+// MD5 of every frame of a straight decode, by timestamp
+static bool DecodeReference(const std::string &videoFile, int threads, DecoderCore::InputMode inputMode,
+                            std::map<int64_t, std::string> &md5ByPts)
+{
+    IDecodeBackend *backend = DecodeBackendFactory::Create("sw", threads);
+    if (!backend)
+        return false;
+
+    FrameChecksumSink sink;
+    bool ok = false;
+    {
+        DecoderCore decoder;
+        decoder.SetInputMode(inputMode);
+        if (decoder.Open(videoFile.c_str(), backend))
+        {
+            while (decoder.DecodeOneFrame(&sink))
+            {
+            }
+            ok = decoder.GetState() == DecoderCore::State::Finished;
+        }
+    }
+    delete backend;
+
+    for (const FrameDigest &d : sink.GetDigests())
+        md5ByPts[d.pts] = d.md5;
+    return ok && !md5ByPts.empty();
+}
+
+// Seek to random timestamps and time each one up to the first frame at the target; every
+// delivered frame must be the one showing at its target
+static int RunSeekTest(const std::string &videoFile, int seeks, int threads, DecoderCore::InputMode inputMode,
+                       bool indexSidecar)
+{
+    std::map<int64_t, std::string> reference;
+    if (!DecodeReference(videoFile, threads, inputMode, reference))
+    {
+        std::printf("FAIL: cannot decode %s\n", videoFile.c_str());
+        return -1;
+    }
+
+    IDecodeBackend *backend = DecodeBackendFactory::Create("sw", threads);
+    if (!backend)
+        return -1;
+
+    DecoderCore decoder;
+    decoder.SetInputMode(inputMode);
+    decoder.SetIndexSidecar(indexSidecar);
+    if (!decoder.Open(videoFile.c_str(), backend) || !decoder.BuildKeyframeIndex())
+    {
+        delete backend;
+        return -1;
+    }
+
+    const KeyframeIndex &index = decoder.GetKeyframeIndex();
+    int64_t firstPts = index.GetEntries().front().pts;
+    int64_t endPts = index.GetEndPts();
+    int64_t frameDuration = decoder.GetFrameDuration();
+    const DecoderCore::SeekStats &seekStats = decoder.GetSeekStats();
+
+    std::printf("File:    %s\n", videoFile.c_str());
+    std::printf("Backend: %s, input %s\n", backend->GetName(), decoder.GetElementaryReader() ? "elementary stream" : "avformat demuxer");
+    std::printf("Index:   %zu keyframes, %lld packets, average GOP %.1f frames, %s in %.2f ms\n", index.Size(),
+                (long long)index.GetPacketCount(), (double)index.GetPacketCount() / index.Size(),
+                seekStats.indexFromSidecar ? "sidecar loaded" : "first pass", seekStats.indexBuildMs);
+
+    std::mt19937_64 rng(12345);
+    std::uniform_int_distribution<int64_t> targetDist(firstPts, endPts > firstPts + frameDuration ? endPts - frameDuration : firstPts);
+    StageStats latency("seek");
+    int failures = 0, inexact = 0, wrongContent = 0;
+    uint64_t framesBefore = decoder.GetFramesDecoded();
+
+    for (int i = 0; i < seeks; i++)
+    {
+        int64_t target = targetDist(rng);
+        SeekSink sink;
+        auto start = std::chrono::steady_clock::now();
+        if (decoder.Seek(target))
+        {
+            while (!sink.delivered && decoder.DecodeOneFrame(&sink))
+            {
+            }
+        }
+        latency.Add(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+
+        if (!sink.delivered)
+        {
+            failures++;
+            continue;
+        }
+        if (sink.pts > target || sink.pts + (sink.duration > 0 ? sink.duration : frameDuration) <= target)
+            inexact++;
+
+        // The straight decode's frame showing at the target: the last one starting at or before it
+        auto it = reference.upper_bound(target);
+        if (it == reference.begin() || std::prev(it)->second != sink.digest.md5)
+        {
+            if (wrongContent++ == 0)
+                std::printf("Seek to %lld delivered pts %lld with different content than the straight decode\n",
+                            (long long)target, (long long)sink.pts);
+        }
+    }
+
+    uint64_t decoded = decoder.GetFramesDecoded() - framesBefore;
+    std::printf("Seeks:   %d random targets, %.1f frames decoded per seek (%.1f pre-roll), %.1f non-reference skipped\n",
+                seeks, (double)decoded / seeks, (double)seekStats.preRollFrames / seeks,
+                (double)seekStats.skippedPackets / seeks);
+    std::printf("Latency (us):\n");
+    latency.Print();
+
+    int result = failures || inexact || wrongContent ? 1 : 0;
+    std::printf("%s: %d seeks without a frame, %d landed on the wrong timestamp, %d on the wrong picture\n",
+                result ? "FAIL" : "PASS", failures, inexact, wrongContent);
+
+    decoder.Close();
+    delete backend;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string videoFile;
+    int seeks = 50;
+    int threads = 0;
+    bool indexSidecar = false;
+    DecoderCore::InputMode inputMode = DecoderCore::InputMode::Auto;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--seeks" && i + 1 < argc)
+            seeks = std::atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (arg == "--index-sidecar")
+            indexSidecar = true;
+        else if (arg == "--input" && i + 1 < argc)
+        {
+            std::string mode = argv[++i];
+            if (mode == "demux")
+                inputMode = DecoderCore::InputMode::Demuxer;
+            else if (mode == "es")
+                inputMode = DecoderCore::InputMode::ElementaryStream;
+            else
+                inputMode = DecoderCore::InputMode::Auto;
+        }
+        else if (arg[0] != '-')
+            videoFile = arg;
+    }
+    if (videoFile.empty() || seeks <= 0)
+    {
+        std::printf("Usage: H264_Test_Seek <clip> [--seeks N] [--input auto|demux|es] [--index-sidecar] [--threads N]\n");
+        return -1;
+    }
+    return RunSeekTest(videoFile, seeks, threads, inputMode, indexSidecar);
+}
@@ -0,0 +1,177 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "DecoderCore.h"
+#include "KeyframeIndex.h"
+#include "StreamParamCache.h"
+
+// Concurrent sidecar writers: several threads (standing in for players opening the same file)
+// store the stream parameter and keyframe index sidecars of one copy of the clip over and
+// over while other threads load them. Every load must find a complete entry equal to what was
+// stored, no store may fail, and no temporary file may be left behind.
+//   H264_Test_Sidecar <clip> [--writers N] [--stores N]
+
+struct RaceResult
+{
+    std::atomic<uint64_t> storeFailures{0};
+    std::atomic<uint64_t> loads{0};
+    std::atomic<uint64_t> badParams{0};
+    std::atomic<uint64_t> badIndexes{0};
+};
+
+static bool SameParams(const StreamParamCache::Entry &entry, const AVStream *stream)
+{
+    const AVCodecParameters *a = entry.codecpar, *b = stream->codecpar;
+    return entry.streamIndex == stream->index && a->codec_id == b->codec_id && a->width == b->width &&
+           a->height == b->height && a->format == b->format && a->extradata_size == b->extradata_size &&
+           (!b->extradata_size || std::memcmp(a->extradata, b->extradata, b->extradata_size) == 0);
+}
+
+static bool SameIndex(const KeyframeIndex &a, const KeyframeIndex &b)
+{
+    if (a.Size() != b.Size() || a.GetEndPts() != b.GetEndPts() || a.GetPacketCount() != b.GetPacketCount())
+        return false;
+    for (size_t i = 0; i < a.Size(); i++)
+    {
+        const KeyframeIndex::Entry &x = a.GetEntries()[i], &y = b.GetEntries()[i];
+        if (x.pts != y.pts || x.pos != y.pos || x.packet != y.packet)
+            return false;
+    }
+    return true;
+}
+
+// Temporary files of either sidecar still lying next to the clip
+static size_t LeftoverTempFiles(const std::string &clip)
+{
+    std::filesystem::path path(clip);
+    std::string prefix = path.filename().string() + ".";
+    size_t leftovers = 0;
+    std::error_code ec;
+    for (const auto &item : std::filesystem::directory_iterator(path.parent_path(), ec))
+    {
+        std::string name = item.path().filename().string();
+        if (name.compare(0, prefix.size(), prefix) == 0 && name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0)
+            leftovers++;
+    }
+    return leftovers;
+}
+
+static void RemoveSidecars(const std::string &clip)
+{
+    std::error_code ec;
+    std::filesystem::remove(StreamParamCache::SidecarPath(clip.c_str()), ec);
+    std::filesystem::remove(KeyframeIndex::SidecarPath(clip.c_str()), ec);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::printf("Usage: H264_Test_Sidecar <clip> [--writers N] [--stores N]\n");
+        return -1;
+    }
+    int writers = 8;
+    int stores = 200;
+    for (int i = 2; i + 1 < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--writers")
+            writers = std::atoi(argv[++i]);
+        else if (arg == "--stores")
+            stores = std::atoi(argv[++i]);
+    }
+
+    // A private copy in the working directory, so other tests' sidecars of the clip are untouched
+    std::filesystem::path source(argv[1]);
+    std::string clip = (std::filesystem::absolute("sidecar_race_" + source.filename().string())).string();
+    std::error_code ec;
+    std::filesystem::copy_file(source, clip, std::filesystem::copy_options::overwrite_existing, ec);
+    if (ec)
+    {
+        std::printf("FAIL: cannot copy %s to %s\n", argv[1], clip.c_str());
+        return 1;
+    }
+    RemoveSidecars(clip);
+
+    IDecodeBackend *backend = DecodeBackendFactory::Create("sw", 1);
+    if (!backend)
+        return 1;
+
+    bool pass = false;
+    {
+        DecoderCore decoder;
+        decoder.SetInputMode(DecoderCore::InputMode::Demuxer);
+        const AVStream *stream = nullptr;
+        if (decoder.Open(clip.c_str(), backend) && decoder.BuildKeyframeIndex())
+            stream = decoder.GetVideoStream();
+        const KeyframeIndex &index = decoder.GetKeyframeIndex();
+
+        // Readers start once a sidecar exists; from then on every load must succeed
+        if (!stream || !index.IsComplete() || !StreamParamCache::Store(clip.c_str(), stream) || !index.Store(clip.c_str()))
+        {
+            std::printf("FAIL: cannot index %s and store its sidecars\n", clip.c_str());
+        }
+        else
+        {
+            RaceResult result;
+            std::atomic<bool> writing{true};
+            std::vector<std::thread> threads;
+            for (int w = 0; w < writers; w++)
+            {
+                threads.emplace_back([&] {
+                    for (int i = 0; i < stores; i++)
+                    {
+                        if (!StreamParamCache::Store(clip.c_str(), stream))
+                            result.storeFailures++;
+                        if (!index.Store(clip.c_str()))
+                            result.storeFailures++;
+                    }
+                });
+            }
+            std::vector<std::thread> readers;
+            for (int r = 0; r < 2; r++)
+            {
+                readers.emplace_back([&] {
+                    while (writing.load())
+                    {
+                        StreamParamCache::Entry entry;
+                        if (!StreamParamCache::Load(clip.c_str(), entry) || !SameParams(entry, stream))
+                            result.badParams++;
+                        KeyframeIndex loaded;
+                        if (!loaded.Load(clip.c_str()) || !SameIndex(loaded, index))
+                            result.badIndexes++;
+                        result.loads++;
+                    }
+                });
+            }
+            for (std::thread &t : threads)
+                t.join();
+            writing = false;
+            for (std::thread &t : readers)
+                t.join();
+
+            size_t leftovers = LeftoverTempFiles(clip);
+            pass = result.storeFailures == 0 && result.badParams == 0 && result.badIndexes == 0 && result.loads > 0 &&
+                   leftovers == 0;
+            std::printf("%s: %d writers x %d stores of both sidecars, %llu failed; %llu loads, %llu with bad parameters, "
+                        "%llu with a bad keyframe index; %zu temporary files left\n",
+                        pass ? "ok" : "FAIL", writers, stores, (unsigned long long)result.storeFailures.load(),
+                        (unsigned long long)result.loads.load(), (unsigned long long)result.badParams.load(),
+                        (unsigned long long)result.badIndexes.load(), leftovers);
+        }
+        decoder.Close();
+    }
+    delete backend;
+
+    RemoveSidecars(clip);
+    std::filesystem::remove(clip, ec);
+    std::printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
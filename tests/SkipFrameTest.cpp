@@ -0,0 +1,105 @@
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+
+#include "DecoderCore.h"
+#include "FrameChecksum.h"
+
+// Degraded decoding keeps the timestamps of the frames it still delivers: with non-reference
+// frames (AVDISCARD_NONREF) or everything but keyframes (AVDISCARD_NONKEY) skipped, every
+// frame of a raw stream, which has no timestamps of its own, must carry the timestamp of the
+// same picture in a full decode. Runs both input paths, with one thread and with frame threads.
+//   H264_Test_SkipFrame <clip.h264>
+
+// MD5 of every frame by timestamp; false when a timestamp repeats
+static bool Decode(const char *clip, DecoderCore::InputMode mode, int threads, AVDiscard skipFrame,
+                   std::map<int64_t, std::string> &md5ByPts, bool &finished)
+{
+    IDecodeBackend *backend = DecodeBackendFactory::Create("sw", threads);
+    if (!backend)
+        return false;
+
+    FrameChecksumSink sink;
+    finished = false;
+    {
+        DecoderCore decoder;
+        decoder.SetInputMode(mode);
+        decoder.SetSkipFrame(skipFrame);
+        if (decoder.Open(clip, backend))
+        {
+            while (decoder.DecodeOneFrame(&sink))
+            {
+            }
+            finished = decoder.GetState() == DecoderCore::State::Finished;
+            decoder.Close();
+        }
+    }
+    delete backend;
+
+    for (const FrameDigest &d : sink.GetDigests())
+    {
+        if (!md5ByPts.emplace(d.pts, d.md5).second)
+            return false;
+    }
+    return true;
+}
+
+static bool CheckSkip(const char *clip, DecoderCore::InputMode mode, int threads, AVDiscard skipFrame,
+                      const std::map<int64_t, std::string> &reference)
+{
+    const char *modeName = mode == DecoderCore::InputMode::Demuxer ? "avformat" : "auto";
+    const char *skipName = skipFrame == AVDISCARD_NONKEY ? "keyframes only" : "non-reference skipped";
+    std::map<int64_t, std::string> frames;
+    bool finished;
+    bool unique = Decode(clip, mode, threads, skipFrame, frames, finished);
+
+    size_t unknown = 0, wrong = 0;
+    for (const auto &frame : frames)
+    {
+        auto it = reference.find(frame.first);
+        if (it == reference.end())
+            unknown++;
+        else if (it->second != frame.second)
+            wrong++;
+    }
+
+    // Skipping must drop something, or the clip does not exercise it
+    bool ok = finished && unique && !frames.empty() && frames.size() < reference.size() && !unknown && !wrong;
+    std::printf("%s: %s, %d thread(s), %s: %zu of %zu frames, %zu with a timestamp the full decode lacks, "
+                "%zu showing another picture%s%s\n",
+                ok ? "ok" : "FAIL", modeName, threads, skipName, frames.size(), reference.size(), unknown, wrong,
+                unique ? "" : ", repeated timestamps", finished ? "" : ", stopped before the end of the stream");
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::printf("Usage: H264_Test_SkipFrame <clip.h264>\n");
+        return -1;
+    }
+    const char *clip = argv[1];
+
+    bool pass = true;
+    for (DecoderCore::InputMode mode : {DecoderCore::InputMode::Auto, DecoderCore::InputMode::Demuxer})
+    {
+        std::map<int64_t, std::string> reference;
+        bool finished;
+        if (!Decode(clip, mode, 1, AVDISCARD_DEFAULT, reference, finished) || !finished || reference.empty())
+        {
+            std::printf("FAIL: cannot decode %s\n", clip);
+            return 1;
+        }
+
+        for (int threads : {1, 4})
+        {
+            for (AVDiscard skipFrame : {AVDISCARD_NONREF, AVDISCARD_NONKEY})
+                pass = CheckSkip(clip, mode, threads, skipFrame, reference) && pass;
+        }
+    }
+
+    std::printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
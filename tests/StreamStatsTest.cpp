@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "BitstreamStats.h"
+
+// Bitstream statistics checked against what is known independently of the header parser: the
+// access unit count of the generated clip, and with --gop the IDR positions (every N-th access
+// unit, frame_num 0) of a clip encoded without scene cuts. With --qp (a constant-QP encode,
+// adaptive quantisation off) every picture's slice QP must equal the QP the decoder reports
+// in AV_FRAME_DATA_VIDEO_ENC_PARAMS, and P slices the encode's QP. In full mode every access
+// unit must be joined to exactly one decoded frame whose picture type agrees with its slice
+// headers. --min-speedup X fails unless headers mode is at least X times faster than full.
+//   H264_Test_StreamStats <clip> <frames> [--gop N] [--qp QP] [--min-speedup X]
+
+static bool Analyze(const char *clip, BitstreamAnalyzer::Mode mode, BitstreamAnalyzer::Result &result)
+{
+    BitstreamAnalyzer::Config config;
+    config.mode = mode;
+    result = BitstreamAnalyzer::Analyze(clip, config);
+    if (!result.ok)
+        std::printf("FAIL: cannot analyse %s in %s mode\n", clip, mode == BitstreamAnalyzer::Mode::Full ? "full" : "headers");
+    return result.ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::printf("Usage: H264_Test_StreamStats <clip> <frames> [--gop N] [--qp QP] [--min-speedup X]\n");
+        return -1;
+    }
+    const char *clip = argv[1];
+    size_t expected = (size_t)std::atoll(argv[2]);
+    int gop = 0;
+    int qp = -1;
+    double minSpeedup = 0.0;
+    for (int i = 3; i + 1 < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--gop")
+            gop = std::atoi(argv[++i]);
+        else if (arg == "--qp")
+            qp = std::atoi(argv[++i]);
+        else if (arg == "--min-speedup")
+            minSpeedup = std::atof(argv[++i]);
+    }
+
+    // Full mode first, so the headers run does not pay for a cold page cache
+    BitstreamAnalyzer::Result headers, full;
+    if (!Analyze(clip, BitstreamAnalyzer::Mode::Full, full) || !Analyze(clip, BitstreamAnalyzer::Mode::Headers, headers))
+        return 1;
+
+    bool pass = true;
+    bool counts = headers.frames.size() == expected && full.frames.size() == expected && full.framesDecoded == expected;
+    std::printf("%s: %zu access units by headers, %zu by full mode, %llu frames decoded, %zu expected\n",
+                counts ? "ok" : "FAIL", headers.frames.size(), full.frames.size(),
+                (unsigned long long)full.framesDecoded, expected);
+    pass = counts && pass;
+
+    size_t unknownTypes = 0;
+    for (const FrameStats &h : headers.frames)
+    {
+        if (h.type == '?')
+            unknownTypes++;
+    }
+    bool parsed = unknownTypes == 0 && headers.headerErrors == 0;
+    std::printf("%s: %zu access units without a picture type, %llu header errors\n", parsed ? "ok" : "FAIL",
+                unknownTypes, (unsigned long long)headers.headerErrors);
+    pass = parsed && pass;
+
+    // Without scene cuts the encoder places an IDR exactly every gop pictures; a closed GOP
+    // codes every picture before it first, so decode order keeps the display positions
+    if (gop > 0)
+    {
+        size_t misplaced = 0, idrs = 0;
+        for (size_t i = 0; i < headers.frames.size(); i++)
+        {
+            const FrameStats &h = headers.frames[i];
+            bool idr = i % gop == 0;
+            idrs += h.idr;
+            if (h.idr != idr || (idr && (h.type != 'I' || h.frameNum != 0)))
+                misplaced++;
+        }
+        size_t expectedIdrs = (expected + gop - 1) / gop;
+        bool gops = misplaced == 0 && idrs == expectedIdrs;
+        std::printf("%s: %zu IDR pictures, %zu expected every %d access units; %zu access units disagree\n",
+                    gops ? "ok" : "FAIL", idrs, expectedIdrs, gop, misplaced);
+        pass = gops && pass;
+    }
+
+    // Constant QP without adaptive quantisation codes no mb_qp_delta: every block decodes at
+    // the slice QP
+    if (qp >= 0)
+    {
+        size_t qpDiffs = 0, pQpDiffs = 0, pSlices = 0;
+        size_t frames = std::min(headers.frames.size(), full.frames.size());
+        for (size_t i = 0; i < frames; i++)
+        {
+            const FrameStats &h = headers.frames[i];
+            if (full.frames[i].decodedQp < 0.0 || std::fabs(h.qp - full.frames[i].decodedQp) > 1e-6)
+                qpDiffs++;
+            if (h.type == 'P')
+            {
+                pSlices++;
+                if (h.qp != qp)
+                    pQpDiffs++;
+            }
+        }
+        bool qps = qpDiffs == 0 && pSlices > 0 && pQpDiffs == 0;
+        std::printf("%s: %zu pictures whose slice QP differs from the decoder's, %zu of %zu P pictures not at QP %d\n",
+                    qps ? "ok" : "FAIL", qpDiffs, pQpDiffs, pSlices, qp);
+        pass = qps && pass;
+    }
+
+    size_t typeMismatches = 0, notDecoded = 0, repeatedOutputs = 0;
+    std::vector<int> outputs(full.frames.size());
+    for (size_t i = 0; i < full.frames.size(); i++)
+    {
+        const FrameStats &f = full.frames[i];
+        if (f.outputIndex < 0 || f.outputIndex >= (int64_t)outputs.size())
+        {
+            notDecoded++;
+            continue;
+        }
+        if (outputs[f.outputIndex]++)
+            repeatedOutputs++;
+        // SP/SI and BI come back as lower case; the header type comes from the headers run
+        char type = i < headers.frames.size() ? headers.frames[i].type : f.type;
+        if ((char)std::toupper(f.decodedType) != type)
+            typeMismatches++;
+    }
+    bool joined = notDecoded == 0 && repeatedOutputs == 0 && typeMismatches == 0;
+    std::printf("%s: %zu access units without a decoded frame, %zu frames joined twice, %zu decoded picture "
+                "types disagree with the slice headers\n",
+                joined ? "ok" : "FAIL", notDecoded, repeatedOutputs, typeMismatches);
+    pass = joined && pass;
+
+    if (minSpeedup > 0.0)
+    {
+        double speedup = headers.elapsedSec > 0.0 ? full.elapsedSec / headers.elapsedSec : 0.0;
+        bool fast = speedup >= minSpeedup;
+        std::printf("%s: headers mode %.1f ms, full mode %.1f ms: %.1fx, at least %.1fx required\n", fast ? "ok" : "FAIL",
+                    headers.elapsedSec * 1000.0, full.elapsedSec * 1000.0, speedup, minSpeedup);
+        pass = fast && pass;
+    }
+
+    std::printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}